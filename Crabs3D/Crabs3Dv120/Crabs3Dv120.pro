@@ -11,6 +11,9 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = Crabs3Dv120
 TEMPLATE = app
 
+# std::string_view is used for the C3D labels/strings
+CONFIG += c++17
+
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked as deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -22,41 +25,41 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# 64-bit file offsets (fseeko/off_t) for C3D files larger than 2 GB on 32-bit targets
+DEFINES += _FILE_OFFSET_BITS=64
+
+
+include(crabs3d_core.pri)
 
 SOURCES += \
         main.cpp \
         main_window.cpp \
-    read_c3d.cpp \
-    glwidget.cpp \
-    kmeans.cpp \
-    cluster_options.cpp \
     crabs_editor.cpp \
-    model.cpp \
-    model_create_dialog.cpp \
-    unit_dialog.cpp \
-    set_bones.cpp
+    trial_catalog.cpp
 
 HEADERS += \
         main_window.h \
-    read_c3d.h \
-    glwidget.h \
-    kmeans.h \
-    cluster_options.h \
     crabs_editor.h \
-    model.h \
-    model_create_dialog.h \
-    unit_dialog.h \
-    set_bones.h
+    trial_catalog.h
 
 FORMS += \
         main_window.ui \
-    cluster_options.ui \
-    crabs_editor.ui \
-    model_create_dialog.ui \
-    unit_dialog.ui \
-    set_bones.ui
+    crabs_editor.ui
 
 RESOURCES += \
     resource.qrc
 
+# OpenMP is used for the parallel loops (clustering, bones, decoding).
+# Without it the pragmas are ignored and the loops run serially.
+QMAKE_CXXFLAGS += -fopenmp
+# Lets sqrt() be vectorized inside the SIMD loops
+QMAKE_CXXFLAGS += -fno-math-errno
+QMAKE_LFLAGS += -fopenmp
+
 LIBS += -lGL -lGLEW -lglut -lGLU
+
+# Instrumented build (qmake CONFIG+=profile): scoped timers and counters,
+# the trace is written on exit to $CRABS3D_TRACE (default crabs3d_trace.json)
+CONFIG(profile) {
+    DEFINES += CRABS3D_PROFILE
+}
@@ -0,0 +1,430 @@
+/* crabs3d-bench: time the C3D pipeline on a synthetic corpus and print the results as JSON.
+ *
+ * crabs3d-bench [--points N] [--frames N] [--channels N] [--spf N] [--float] [--big] [--dec]
+ *               [--repeat N] [--clusters N] [--dir path] [--out results.json] [--trace trace.json]
+ *
+ * Without --float/--big/--dec every data format is benchmarked (int16/float, little/big endian, DEC floats).
+ * --trace writes the Chrome trace of the run (instrumented builds only, see profiler.h).
+ * The trial cache entries of the open benchmarks are written to <dir>/trial_cache.
+ * Every trial must round trip through Write_C3D, the frame decoders must agree and a copy of the first trial
+ * with a malformed group ID must import (the exit status is 1 if a check fails).
+ * GLWidget::SetCloud needs a QApplication: run with -platform offscreen on a machine without a display.
+ */
+#include "synthetic_c3d.h"
+#include "../read_c3d.h"
+#include "../write_c3d.h"
+#include "../kmeans.h"
+#include "../model.h"
+#include "../trajectory_filter.h"
+#include "../glwidget.h"
+#include "../profiler.h"
+#include <QApplication>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct BenchArgs {
+    SyntheticOptions options;
+    bool allFormats;
+    int repeat;
+    int clusters;
+    std::string dir;
+    std::string out;
+    std::string trace;
+};
+
+struct BenchTiming {
+    std::string name;
+    std::vector<double> ms;
+};
+
+//Time a function (milliseconds)
+template <typename F>
+static double Time(F function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Cloud of every frame (GLWidget::SetCloud positions without the screen axes)
+static Cloud* CreateClouds(Read_C3D* c3d_f, const int frameSize, const int pointSize) {
+    Cloud* cloud = (Cloud*)malloc(frameSize*sizeof(Cloud));
+    float multiplier = c3d_f->POINT().MultiplierForMeters(c3d_f->POINT());
+    for(int i = 0; i < frameSize; i++) {
+        cloud[i].id = (int*)malloc(pointSize*sizeof(int));
+        cloud[i].x = (float*)malloc(pointSize*sizeof(float));
+        cloud[i].y = (float*)malloc(pointSize*sizeof(float));
+        cloud[i].z = (float*)malloc(pointSize*sizeof(float));
+        cloud[i].name = new std::string[pointSize];
+
+        Frames_C3D frame = c3d_f->Data().Frame(i);
+        for(int j = 0; j < pointSize; j++) {
+            cloud[i].id[j] = j+1;
+            cloud[i].x[j] = frame.Point(j).X()*multiplier;
+            cloud[i].y[j] = frame.Point(j).Y()*multiplier;
+            cloud[i].z[j] = frame.Point(j).Z()*multiplier;
+            cloud[i].name[j] = c3d_f->POINT().Labels(j);
+        }
+    }
+    return cloud;
+}
+
+static void CleanUpClouds(Cloud* cloud, const int frameSize) {
+    for(int i = 0; i < frameSize; i++) {
+        free(cloud[i].id);
+        free(cloud[i].x);
+        free(cloud[i].y);
+        free(cloud[i].z);
+        delete[] cloud[i].name;
+    }
+    free(cloud);
+}
+
+//Data section of a trial (frameSize frames of frameBytes bytes)
+static std::vector<char> ReadDataSection(const std::string fileName, const int dataStart, const long long frameBytes, const int frameSize) {
+    std::vector<char> section((size_t)frameSize*frameBytes + 1, 0);
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if(file != NULL) {
+        fseeko(file, (off_t)(dataStart-1)*512, SEEK_SET);
+        size_t read = fread(section.data(), 1, (size_t)frameSize*frameBytes, file);
+        (void)read; //a short file leaves zeros
+        fclose(file);
+    }
+    return section;
+}
+
+//Decode every frame of a data section in memory
+static void DecodeFrames(FrameDecoder decode, const std::vector<char>& section, const long long frameBytes, const int frameSize,
+                         const DecodeLayout layout, Points_C3D* points, float* analog) {
+    for(int i = 0; i < frameSize; i++)
+        decode(&points[(size_t)i*layout.pointSize], analog, &section[(size_t)i*frameBytes], &layout, i);
+}
+
+//Import a copy of a trial whose last group has ID groupId (-128 is outside -1..-127, 0 gives it the ID of the
+//first group): the group must be skipped, not read
+static bool CheckMalformedGroup(const std::string fileName, const std::string malformedName, const int groupId) {
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if(file == NULL)
+        return false;
+    std::vector<char> data;
+    char chunk[4096];
+    size_t read;
+    while((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+    if(data.empty())
+        return false;
+
+    //Walk the records of the parameter section (next pointers are big endian only on MIPS files)
+    int pos = ((unsigned char)data[0] - 1)*512;
+    if(pos < 0 || pos + 4 > (int)data.size())
+        return false;
+    bool big = data[pos+3] == 86;
+    int firstGroup = -1;
+    int lastGroup = -1;
+    for(pos += 4; pos + 4 <= (int)data.size();) {
+        int characterNumber = abs((signed char)data[pos]);
+        int id = (signed char)data[pos+1];
+        if(characterNumber == 0 || id == 0 || pos + 4 + characterNumber > (int)data.size())
+            break;
+        if(id < 0 && firstGroup < 0)
+            firstGroup = pos;
+        if(id < 0)
+            lastGroup = pos;
+
+        const unsigned char* field = (const unsigned char*)&data[pos + 2 + characterNumber];
+        int next = big ? field[0] << 8 | field[1] : field[1] << 8 | field[0];
+        if(next == 0)
+            break;
+        pos += 2 + characterNumber + next;
+    }
+    if(lastGroup < 0 || lastGroup == firstGroup)
+        return false;
+
+    data[lastGroup+1] = groupId != 0 ? (char)groupId : data[firstGroup+1];
+    file = fopen(malformedName.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    Read_C3D* c3d_f = new Read_C3D;
+    c3d_f->Import(fileName, NULL, c3d_f);
+    std::vector<std::string> names;
+    for(int i = 0; i < c3d_f->Parameter()->GroupSize(); i++)
+        names.push_back(c3d_f->Parameter()->Group(i).Name());
+    c3d_f->CleanUp(c3d_f);
+    delete c3d_f;
+
+    //The other groups are read as they are (a duplicate ID doesn't overwrite the group that has it)
+    c3d_f = new Read_C3D;
+    c3d_f->Import(malformedName, NULL, c3d_f);
+    bool skipped = c3d_f->Parameter()->GroupSize() == (int)names.size() - 1;
+    for(int i = 0; skipped && i < c3d_f->Parameter()->GroupSize(); i++)
+        skipped = c3d_f->Parameter()->Group(i).Name() == names[i];
+    c3d_f->CleanUp(c3d_f);
+    delete c3d_f;
+
+    return skipped;
+}
+
+//Run every benchmark on one trial (failed is set if a check of the trial fails)
+static std::vector<BenchTiming> RunCase(const std::string fileName, const BenchArgs args, const SyntheticOptions options, bool* failed) {
+    std::vector<BenchTiming> timings = {{"generate_ms", {}}, {"import_ms", {}}, {"set_cloud_ms", {}}, {"kmeans_ms", {}},
+                                        {"kmeans_minibatch_ms", {}}, {"create_model_ms", {}}, {"filter_butterworth_ms", {}}, {"filter_golay_ms", {}},
+                                        {"export_header_ms", {}}, {"export_parameter_ms", {}},
+                                        {"export_points_ms", {}}, {"export_analog_ms", {}}, {"export_c3d_ms", {}},
+                                        {"open_uncached_ms", {}}, {"open_cached_ms", {}},
+                                        {"decode_generic_ms", {}}, {"decode_specialized_ms", {}}};
+    const std::string base = fileName.substr(0, fileName.size() - 4);
+
+    for(int r = 0; r < args.repeat; r++) {
+        int t = 0;
+        SyntheticC3D generator;
+        timings[t++].ms.push_back(Time([&] {generator.Write(fileName, options);}));
+
+        Read_C3D* c3d_f = new Read_C3D;
+        timings[t++].ms.push_back(Time([&] {c3d_f->Import(fileName, NULL, c3d_f);}));
+        const int frameSize = c3d_f->FrameSize();
+        const int pointSize = c3d_f->Header().NumberOfPoints();
+
+        GLWidget widget(NULL);
+        widget.ReadC3D(fileName, NULL);
+        timings[t++].ms.push_back(Time([&] {widget.SetCloud(&widget);}));
+
+        Cloud* cloud = CreateClouds(c3d_f, frameSize, pointSize);
+        int clusters = std::min(args.clusters, pointSize);
+        KMeans kmeans;
+        timings[t++].ms.push_back(Time([&] {kmeans.SetCluster(cloud[0], clusters, pointSize);}));
+        KMeans miniBatch;
+        miniBatch.SetMiniBatchMode(true, 1024, 100);
+        timings[t++].ms.push_back(Time([&] {miniBatch.SetCluster(cloud[0], clusters, pointSize);}));
+        miniBatch.CleanUp();
+
+        Model model;
+        timings[t++].ms.push_back(Time([&] {
+            FrameStore frames = Model::CreateFrameStore(cloud, frameSize, pointSize);
+            for(int i = 0; i < clusters; i++)
+                model.CreateModelFromCluster(kmeans.GetCluster(i), frames, &model);
+        }));
+        model.CleanUpBones(&model);
+        kmeans.CleanUp();
+
+        //Positions and accelerations of every marker, then the same columns with the other filter
+        TrajectoryFilter filter;
+        FrameStore filterFrames = Model::CreateFrameStore(cloud, frameSize, pointSize);
+        FilterOptions filterOptions = FILTER_DEFAULT_OPTIONS;
+        filterOptions.method = FILTER_BUTTERWORTH;
+        float rate = c3d_f->Header().FrameRate();
+        timings[t++].ms.push_back(Time([&] {
+            filter.Apply(&filter, filterFrames, rate, filterOptions);
+            for(int p = 0; p < pointSize; p++)
+                for(int a = 0; a < 3; a++)
+                    filter.Acceleration(p, a);
+        }));
+        filterOptions.method = FILTER_SAVITZKY_GOLAY;
+        timings[t++].ms.push_back(Time([&] {
+            filter.Reapply(&filter, filterOptions);
+            for(int p = 0; p < pointSize; p++)
+                for(int a = 0; a < 3; a++)
+                    filter.Acceleration(p, a);
+        }));
+        filter.CleanUp(&filter);
+        CleanUpClouds(cloud, frameSize);
+
+        timings[t++].ms.push_back(Time([&] {c3d_f->printHeaderFile(base + "_header.txt");}));
+        timings[t++].ms.push_back(Time([&] {c3d_f->printParameterFile(base + "_parameter.txt");}));
+        timings[t++].ms.push_back(Time([&] {c3d_f->printPointFile(base + "_points.txt");}));
+        timings[t++].ms.push_back(Time([&] {c3d_f->printAnalogFile(base + "_analog.txt");}));
+        Write_C3D writer;
+        timings[t++].ms.push_back(Time([&] {
+            writer.Export(base + "_export.c3d", c3d_f, options.floatFormat, c3d_f->Parameter()->Header().ProcessorType());
+        }));
+
+        //The written trial must import as the trial (in its own data format and in the other one)
+        for(int f = 0; f < 2; f++) {
+            bool floatFormat = f == 0 ? options.floatFormat : !options.floatFormat;
+            if(!writer.RoundTrip(base + "_roundtrip.c3d", c3d_f, floatFormat, c3d_f->Parameter()->Header().ProcessorType())) {
+                fprintf(stderr, "crabs3d-bench: %s written as %s doesn't round trip\n", fileName.c_str(), floatFormat ? "float" : "int16");
+                *failed = true;
+            }
+        }
+
+        //Open through the trial cache: read, cluster and store, then map the entry
+        GLWidget opened(NULL);
+        opened.GetTrialCache()->SetDirectory(args.dir + "/trial_cache");
+        opened.GetTrialCache()->Clear();
+        timings[t++].ms.push_back(Time([&] {opened.OpenC3D(fileName, NULL);}));
+        timings[t++].ms.push_back(Time([&] {opened.OpenC3D(fileName, NULL);}));
+
+        //Frame decoders on the data section in memory: per-word generic path and the decoder of the format
+        const unsigned one = 1U;
+        DecodeLayout layout;
+        layout.pointSize = pointSize;
+        layout.pointScale = c3d_f->Header().ScaleFactor();
+        if(options.decFloat)
+            layout.endianFlag = (*(const char*)&one == 1 ? SAME_ENDIAN : DIFF_ENDIAN) | (options.floatFormat ? DEC_FLOAT : 0);
+        else
+            layout.endianFlag = (*(const char*)&one == 1) == options.bigEndian ? DIFF_ENDIAN : SAME_ENDIAN;
+        layout.analogChannels = c3d_f->Data().AnalogChannelSize();
+        layout.analogPerFrame = c3d_f->Data().AnalogPerFrame();
+        layout.analogSamples = frameSize*layout.analogPerFrame;
+        layout.analogUnsigned = false;
+        int dataStart = c3d_f->POINT().DataStart() > 0 ? c3d_f->POINT().DataStart() : c3d_f->Header().DataStart();
+        long long frameBytes = Data_c3d::FrameBytes(pointSize, layout.pointScale, layout.analogChannels*layout.analogPerFrame);
+        std::vector<char> section = ReadDataSection(fileName, dataStart, frameBytes, frameSize);
+
+        std::vector<Points_C3D> genericPoints((size_t)frameSize*pointSize + 1), points((size_t)frameSize*pointSize + 1);
+        std::vector<float> genericAnalog((size_t)layout.analogChannels*layout.analogSamples + 1), analog(genericAnalog.size());
+        FrameDecoder decode = Data_c3d::SelectDecoder(layout.pointScale, layout.endianFlag, layout.analogChannels > 0);
+        timings[t++].ms.push_back(Time([&] {
+            DecodeFrames(Data_c3d::DecodeFrameGeneric, section, frameBytes, frameSize, layout, genericPoints.data(), genericAnalog.data());
+        }));
+        timings[t++].ms.push_back(Time([&] {DecodeFrames(decode, section, frameBytes, frameSize, layout, points.data(), analog.data());}));
+        if(memcmp(genericPoints.data(), points.data(), points.size()*sizeof(Points_C3D)) != 0 ||
+           memcmp(genericAnalog.data(), analog.data(), analog.size()*sizeof(float)) != 0) {
+            fprintf(stderr, "crabs3d-bench: the decoders of %s disagree\n", fileName.c_str());
+            *failed = true;
+        }
+
+        c3d_f->CleanUp(c3d_f);
+        delete c3d_f;
+    }
+    return timings;
+}
+
+static void PrintUsage() {
+    fprintf(stderr, "usage: crabs3d-bench [--points N] [--frames N] [--channels N] [--spf N] [--float] [--big] [--dec]\n"
+                    "                     [--repeat N] [--clusters N] [--dir path] [--out results.json] [--trace trace.json]\n");
+}
+
+static bool ParseArgs(int argc, char* argv[], BenchArgs* args) {
+    args->options = SyntheticC3D::Defaults();
+    args->allFormats = true;
+    args->repeat = 5;
+    args->clusters = 5;
+    args->dir = ".";
+    args->out = "";
+    args->trace = "";
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool value = i + 1 < argc;
+        if(arg == "--points" && value)
+            args->options.points = atoi(argv[++i]);
+        else if(arg == "--frames" && value)
+            args->options.frames = atoi(argv[++i]);
+        else if(arg == "--channels" && value)
+            args->options.channels = atoi(argv[++i]);
+        else if(arg == "--spf" && value)
+            args->options.analogPerFrame = atoi(argv[++i]);
+        else if(arg == "--repeat" && value)
+            args->repeat = std::max(1, atoi(argv[++i]));
+        else if(arg == "--clusters" && value)
+            args->clusters = std::max(1, atoi(argv[++i]));
+        else if(arg == "--dir" && value)
+            args->dir = argv[++i];
+        else if(arg == "--out" && value)
+            args->out = argv[++i];
+        else if(arg == "--trace" && value)
+            args->trace = argv[++i];
+        else if(arg == "--float") {
+            args->options.floatFormat = true;
+            args->allFormats = false;
+        } else if(arg == "--big") {
+            args->options.bigEndian = true;
+            args->allFormats = false;
+        } else if(arg == "--dec") {
+            args->options.decFloat = true;
+            args->allFormats = false;
+        } else if(arg == "-platform" && value)
+            i++; //Qt option
+        else
+            return false;
+    }
+    return true;
+}
+
+//Minimum, median and maximum of the repeats
+static void PrintTiming(FILE* file, BenchTiming timing, const bool last) {
+    std::sort(timing.ms.begin(), timing.ms.end());
+    size_t n = timing.ms.size();
+    double median = n % 2 ? timing.ms[n/2] : 0.5*(timing.ms[n/2 - 1] + timing.ms[n/2]);
+    fprintf(file, "        \"%s\": {\"min\": %.3f, \"median\": %.3f, \"max\": %.3f}%s\n",
+            timing.name.c_str(), timing.ms.front(), median, timing.ms.back(), last ? "" : ",");
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication application(argc, argv); //GLWidget is a QGLWidget (nothing is drawn, so glut is not initialized)
+
+    BenchArgs args;
+    if(!ParseArgs(argc, argv, &args)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<SyntheticOptions> corpus;
+    if(args.allFormats) {
+        for(int f = 0; f < 2; f++) {
+            for(int b = 0; b < 2; b++) {
+                SyntheticOptions options = args.options;
+                options.floatFormat = f == 1;
+                options.bigEndian = b == 1;
+                corpus.push_back(options);
+            }
+        }
+        SyntheticOptions options = args.options; //DEC processor (VAX floats)
+        options.floatFormat = true;
+        options.decFloat = true;
+        corpus.push_back(options);
+    } else {
+        corpus.push_back(args.options);
+    }
+
+    FILE* file = args.out.empty() ? stdout : fopen(args.out.c_str(), "w");
+    if(file == NULL) {
+        fprintf(stderr, "crabs3d-bench: cannot write %s\n", args.out.c_str());
+        return 1;
+    }
+
+    int status = 0;
+    fprintf(file, "{\n  \"suite\": \"crabs3d-bench\",\n  \"version\": 1,\n  \"repeat\": %d,\n  \"results\": [\n", args.repeat);
+    for(size_t c = 0; c < corpus.size(); c++) {
+        SyntheticOptions options = corpus[c];
+        std::string name = SyntheticC3D::Name(options);
+        bool failed = false;
+        std::vector<BenchTiming> timings = RunCase(args.dir + "/" + name + ".c3d", args, options, &failed);
+        if(failed)
+            status = 1;
+
+        fprintf(file, "    {\n      \"case\": \"%s\",\n      \"points\": %d,\n      \"frames\": %d,\n      \"channels\": %d,\n"
+                      "      \"analog_per_frame\": %d,\n      \"format\": \"%s\",\n      \"endian\": \"%s\",\n      \"benchmarks\": {\n",
+                name.c_str(), options.points, options.frames, options.channels, options.analogPerFrame,
+                options.floatFormat ? "float" : "int16", options.decFloat ? "dec" : (options.bigEndian ? "big" : "little"));
+        for(size_t t = 0; t < timings.size(); t++)
+            PrintTiming(file, timings[t], t + 1 == timings.size());
+        fprintf(file, "      }\n    }%s\n", c + 1 == corpus.size() ? "" : ",");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    if(file != stdout)
+        fclose(file);
+
+    //Malformed files must not crash the reader
+    std::string base = args.dir + "/" + SyntheticC3D::Name(corpus[0]);
+    if(!CheckMalformedGroup(base + ".c3d", base + "_malformed.c3d", -128)) {
+        fprintf(stderr, "crabs3d-bench: the group with ID -128 of %s_malformed.c3d was not skipped\n", base.c_str());
+        status = 1;
+    }
+    if(!CheckMalformedGroup(base + ".c3d", base + "_duplicate.c3d", 0)) {
+        fprintf(stderr, "crabs3d-bench: the group with a duplicate ID of %s_duplicate.c3d was not skipped\n", base.c_str());
+        status = 1;
+    }
+
+    if(!args.trace.empty())
+        PROFILE_EXPORT(args.trace);
+    return status;
+}
@@ -0,0 +1,78 @@
+#-------------------------------------------------
+#
+# crabs3d-bench: benchmarks of the C3D pipeline on a synthetic corpus
+# (run: crabs3d-bench -platform offscreen --out results.json)
+#
+#-------------------------------------------------
+
+QT       += core gui opengl
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = crabs3d-bench
+TEMPLATE = app
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += _FILE_OFFSET_BITS=64
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    bench_main.cpp \
+    synthetic_c3d.cpp \
+    ../read_c3d.cpp \
+    ../glwidget.cpp \
+    ../kmeans.cpp \
+    ../cluster_options.cpp \
+    ../model.cpp \
+    ../model_create_dialog.cpp \
+    ../unit_dialog.cpp \
+    ../set_bones.cpp \
+    ../spatial_index.cpp \
+    ../string_table.cpp \
+    ../force_plate.cpp \
+    ../write_c3d.cpp \
+    ../marker_gaps.cpp \
+    ../trajectory_filter.cpp \
+    ../profiler.cpp \
+    ../trial_cache.cpp
+
+HEADERS += \
+    synthetic_c3d.h \
+    ../read_c3d.h \
+    ../glwidget.h \
+    ../kmeans.h \
+    ../cluster_options.h \
+    ../model.h \
+    ../model_create_dialog.h \
+    ../unit_dialog.h \
+    ../set_bones.h \
+    ../spatial_index.h \
+    ../string_table.h \
+    ../force_plate.h \
+    ../write_c3d.h \
+    ../marker_gaps.h \
+    ../trajectory_filter.h \
+    ../profiler.h \
+    ../trial_cache.h
+
+FORMS += \
+    ../cluster_options.ui \
+    ../model_create_dialog.ui \
+    ../unit_dialog.ui \
+    ../set_bones.ui
+
+# Same flags as the application, so the numbers match the shipped build
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_CXXFLAGS += -fno-math-errno
+QMAKE_LFLAGS += -fopenmp
+
+LIBS += -lGL -lGLEW -lglut -lGLU
+
+# CONFIG+=profile: also write the Chrome trace of the run (--trace)
+CONFIG(profile) {
+    DEFINES += CRABS3D_PROFILE
+}
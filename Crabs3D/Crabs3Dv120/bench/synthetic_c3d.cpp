@@ -0,0 +1,295 @@
+#include "synthetic_c3d.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#define SYNTHETIC_INTEL 84
+#define SYNTHETIC_DEC   85
+#define SYNTHETIC_MIPS  86
+
+/**********/
+/* Public */
+/**********/
+
+SyntheticOptions SyntheticC3D::Defaults() {
+    SyntheticOptions options;
+    options.points = 50;
+    options.frames = 1000;
+    options.channels = 16;
+    options.analogPerFrame = 10;
+    options.floatFormat = false;
+    options.bigEndian = false;
+    options.decFloat = false;
+    options.rate = 100.0;
+    options.seed = 1;
+    return options;
+}
+
+std::string SyntheticC3D::Name(const SyntheticOptions options) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s-%s-p%d-f%d-a%d", options.floatFormat ? "float" : "int16",
+             options.decFloat ? "dec" : (options.bigEndian ? "be" : "le"),
+             options.points, options.frames, options.channels);
+    return name;
+}
+
+bool SyntheticC3D::Write(const std::string fileName, const SyntheticOptions options) {
+    const int points = options.points > 0 ? options.points : 0;
+    const int frames = options.frames > 0 ? options.frames : 1;
+    const int headerFrames = frames < 65535 ? frames : 65535; //longer trials: TRIAL:ACTUAL_START_FIELD/ACTUAL_END_FIELD
+    const int channels = options.channels > 0 ? (options.channels < 255 ? options.channels : 255) : 0;
+    const int perFrame = options.analogPerFrame > 0 ? options.analogPerFrame : 1;
+    const float rate = options.rate > 0 ? options.rate : 100.0;
+
+    const unsigned one = 1U;
+    bool littleSystem = *(const char*)&one == 1;
+    bool bigEndian = options.bigEndian && !options.decFloat;
+    swap = littleSystem == bigEndian;
+    vax = options.decFloat;
+    state = options.seed != 0 ? options.seed : 1;
+
+    //Integer scale that keeps every coordinate in range (markers are 100 mm apart on x)
+    float scale = (100.0*points + 100.0) / 32000.0;
+    if(scale < 0.1)
+        scale = 0.1;
+    float fileScale = options.floatFormat ? -scale : scale;
+
+    /* Parameters */
+    buffer.clear();
+    buffer.push_back(1);
+    buffer.push_back(80);
+    buffer.push_back(0); //blocks (patched)
+    buffer.push_back(options.decFloat ? SYNTHETIC_DEC : (bigEndian ? SYNTHETIC_MIPS : SYNTHETIC_INTEL));
+    nextOffset = -1;
+
+    std::vector<std::string> labels, descriptions;
+    for(int i = 0; i < points; i++) {
+        labels.push_back("M" + std::to_string(i + 1));
+        descriptions.push_back("Marker " + std::to_string(i + 1));
+    }
+
+    Group(1, "POINT", "3-D point parameters");
+    Parameter(1, "USED", 2, {});
+    Put<short int>((short int)points);
+    EndRecord();
+    Parameter(1, "SCALE", 4, {});
+    Put<float>(fileScale);
+    EndRecord();
+    Parameter(1, "RATE", 4, {});
+    Put<float>(rate);
+    EndRecord();
+    Parameter(1, "DATA_START", 2, {});
+    long dataStartPosition = (long)buffer.size();
+    Put<short int>(0);
+    EndRecord();
+    Parameter(1, "FRAMES", 2, {});
+    Put<short int>((short int)(unsigned short int)headerFrames);
+    EndRecord();
+    Chars(1, "LABELS", labels, 8);
+    Chars(1, "DESCRIPTIONS", descriptions, 16);
+    Chars(1, "UNITS", {"mm"}, 2);
+
+    std::vector<std::string> analogLabels, analogUnits;
+    for(int c = 0; c < channels; c++) {
+        analogLabels.push_back("A" + std::to_string(c + 1));
+        analogUnits.push_back("V");
+    }
+
+    Group(2, "ANALOG", "Analog data parameters");
+    Parameter(2, "USED", 2, {});
+    Put<short int>((short int)channels);
+    EndRecord();
+    Chars(2, "LABELS", analogLabels, 8);
+    Chars(2, "UNITS", analogUnits, 4);
+    Parameter(2, "GEN_SCALE", 4, {});
+    Put<float>(1.0);
+    EndRecord();
+    Parameter(2, "SCALE", 4, {channels});
+    for(int c = 0; c < channels; c++)
+        Put<float>(0.01);
+    EndRecord();
+    Parameter(2, "OFFSET", 2, {channels});
+    for(int c = 0; c < channels; c++)
+        Put<short int>(0);
+    EndRecord();
+    Parameter(2, "RATE", 4, {});
+    Put<float>(rate*perFrame);
+    EndRecord();
+
+    Group(3, "TRIAL", "Trial parameters");
+    Parameter(3, "ACTUAL_START_FIELD", 2, {2});
+    Put<short int>(1);
+    Put<short int>(0);
+    EndRecord();
+    Parameter(3, "ACTUAL_END_FIELD", 2, {2});
+    Put<short int>((short int)(frames & 0xFFFF));
+    Put<short int>((short int)(frames >> 16));
+    EndRecord();
+    Parameter(3, "CAMERA_RATE", 4, {});
+    Put<float>(rate);
+    EndRecord();
+
+    //The last record points to 0
+    buffer[nextOffset] = buffer[nextOffset+1] = 0;
+
+    buffer.resize((buffer.size() + 511) / 512 * 512, 0);
+    int blocks = (int)(buffer.size() / 512);
+    int dataStart = 2 + blocks;
+    buffer[2] = (char)blocks;
+    PatchInt16(dataStartPosition, (short int)dataStart);
+    std::vector<char> parameters;
+    parameters.swap(buffer);
+
+    /* Header */
+    buffer.push_back(2);
+    buffer.push_back(80);
+    Put<short int>((short int)points);
+    Put<short int>((short int)(channels*perFrame));
+    Put<short int>(1);
+    Put<short int>((short int)(unsigned short int)headerFrames);
+    Put<short int>(10);
+    Put<float>(fileScale);
+    Put<short int>((short int)dataStart);
+    Put<short int>((short int)perFrame);
+    Put<float>(rate);
+    buffer.resize(512, 0);
+
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    bool result = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    result = result && fwrite(parameters.data(), 1, parameters.size(), file) == parameters.size();
+
+    /* Data (written every 1 MB) */
+    buffer.clear();
+    size_t written = 0;
+    for(int f = 0; f < frames && result; f++) {
+        float t = f / rate;
+        for(int i = 0; i < points; i++) {
+            float x = 100.0*i + 50.0*cos(t + i) + Noise();
+            float y = 30.0*i + 20.0*sin(2.0*t + i) + Noise();
+            float z = 1000.0 + 10.0*i + 5.0*sin(3.0*t) + Noise();
+            if(options.floatFormat) {
+                Put<float>(x);
+                Put<float>(y);
+                Put<float>(z);
+                Put<float>((float)((3 << 8) | 2));
+            } else {
+                Put<short int>((short int)floor(x/scale + 0.5));
+                Put<short int>((short int)floor(y/scale + 0.5));
+                Put<short int>((short int)floor(z/scale + 0.5));
+                buffer.push_back(2); //cameras
+                buffer.push_back(3); //residual
+            }
+        }
+        for(int s = 0; s < perFrame; s++) {
+            float ts = (f*perFrame + s) / (rate*perFrame);
+            for(int c = 0; c < channels; c++) {
+                float value = 1000.0*sin(2.0*M_PI*(c + 1)*ts) + 10.0*Noise();
+                if(options.floatFormat)
+                    Put<float>(value);
+                else
+                    Put<short int>((short int)floor(value + 0.5));
+            }
+        }
+        if(buffer.size() >= (1 << 20)) {
+            result = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+    written += buffer.size();
+    buffer.resize(buffer.size() + (512 - written % 512) % 512, 0);
+    result = result && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+
+    fclose(file);
+    return result;
+}
+
+/***********/
+/* Private */
+/***********/
+
+template <typename T>
+void SyntheticC3D::Put(const T value) {
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+
+    //VAX F-float: 4 times the IEEE value (exponent + 2) with the 16-bit halves swapped (0 stays 0)
+    if constexpr(std::is_same<T, float>::value) {
+        if(vax) {
+            unsigned int bits;
+            memcpy(&bits, &value, sizeof(bits));
+            if((bits & 0x7FFFFFFF) != 0)
+                bits += 0x01000000;
+            else
+                bits = 0;
+            bits = (bits << 16) | (bits >> 16);
+            memcpy(bytes, &bits, sizeof(T));
+        }
+    }
+
+    if(swap)
+        for(int i = (int)sizeof(T) - 1; i >= 0; i--)
+            buffer.push_back(bytes[i]);
+    else
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void SyntheticC3D::PutBytes(const char* data, const int size) {
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+void SyntheticC3D::Group(const int id, const std::string name, const std::string description) {
+    buffer.push_back((char)name.size());
+    buffer.push_back((char)-id);
+    PutBytes(name.c_str(), (int)name.size());
+    nextOffset = (long)buffer.size();
+    Put<short int>((short int)(2 + 1 + description.size()));
+    buffer.push_back((char)description.size());
+    PutBytes(description.c_str(), (int)description.size());
+}
+
+void SyntheticC3D::Parameter(const int group, const std::string name, const int format, const std::vector<int> dimensions) {
+    buffer.push_back((char)name.size());
+    buffer.push_back((char)group);
+    PutBytes(name.c_str(), (int)name.size());
+    nextOffset = (long)buffer.size();
+    Put<short int>(0); //patched by EndRecord
+    buffer.push_back((char)format);
+    buffer.push_back((char)dimensions.size());
+    for(size_t i = 0; i < dimensions.size(); i++)
+        buffer.push_back((char)dimensions[i]);
+}
+
+void SyntheticC3D::EndRecord() {
+    buffer.push_back(0); //no description
+    PatchInt16(nextOffset, (short int)(buffer.size() - nextOffset));
+}
+
+void SyntheticC3D::PatchInt16(const long position, const short int value) {
+    size_t end = buffer.size();
+    Put<short int>(value);
+    memcpy(&buffer[position], &buffer[end], 2);
+    buffer.resize(end);
+}
+
+void SyntheticC3D::Chars(const int group, const std::string name, const std::vector<std::string> words, const int width) {
+    int size = words.empty() ? 1 : (words.size() < 255 ? (int)words.size() : 255); //dimensions are bytes
+    Parameter(group, name, -1, {width, size});
+    for(int i = 0; i < size; i++) {
+        std::string word = i < (int)words.size() ? words[i] : std::string();
+        word.resize(width, ' ');
+        PutBytes(word.c_str(), width);
+    }
+    EndRecord();
+}
+
+float SyntheticC3D::Noise() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state & 0xFFFFFF) / 16777216.0 - 0.5;
+}
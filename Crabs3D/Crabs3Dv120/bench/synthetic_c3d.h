@@ -0,0 +1,57 @@
+#ifndef SYNTHETIC_C3D_H
+#define SYNTHETIC_C3D_H
+
+#include <string>
+#include <vector>
+
+//Options of a synthetic trial (the same options and seed always give the same file)
+struct SyntheticOptions {
+    int points;         //Markers
+    int frames;         //Frames (longer than 65535: saturated header, 32-bit TRIAL fields)
+    int channels;       //Analog channels
+    int analogPerFrame; //Analog samples per frame
+    bool floatFormat;   //float (true) or scaled int16 (false) data
+    bool bigEndian;     //MIPS (true) or Intel (false) byte order
+    bool decFloat;      //DEC processor: Intel byte order with VAX floats (bigEndian is ignored)
+    float rate;         //Frame rate (Hz)
+    unsigned int seed;  //Noise seed
+};
+
+/* Write a synthetic C3D trial: markers moving on smooth curves with a little noise
+ * and analog channels with sine waves (POINT, ANALOG and TRIAL groups).
+ */
+class SyntheticC3D
+{
+public:
+    //Default options (50 markers, 1000 frames, 16 analog channels at 10 samples per frame)
+    static SyntheticOptions Defaults();
+
+    //Write the trial to fileName (returns false if the file cannot be written)
+    bool Write(const std::string fileName, const SyntheticOptions options);
+
+    //Name of the options (e.g. int16-le-p50-f1000-a16, float-dec-p50-f1000-a16)
+    static std::string Name(const SyntheticOptions options);
+
+private:
+    std::vector<char> buffer;
+    bool swap;
+    bool vax; //floats are written as VAX F-floats
+    unsigned int state;
+
+    template <typename T> void Put(const T value);
+    void PutBytes(const char* data, const int size);
+
+    //Parameter records (the next record offset is patched by EndRecord)
+    void Group(const int id, const std::string name, const std::string description);
+    void Parameter(const int group, const std::string name, const int format, const std::vector<int> dimensions);
+    void EndRecord();
+    void PatchInt16(const long position, const short int value);
+    void Chars(const int group, const std::string name, const std::vector<std::string> words, const int width);
+
+    //Deterministic noise (xorshift) in [-0.5, 0.5)
+    float Noise();
+
+    long nextOffset;
+};
+
+#endif // SYNTHETIC_C3D_H
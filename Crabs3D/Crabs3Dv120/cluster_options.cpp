@@ -1,5 +1,6 @@
 #include "cluster_options.h"
 #include "ui_cluster_options.h"
+#include "glwidget.h"
 #include <QMessageBox>
 
 /**********/
@@ -12,6 +13,8 @@ ClusterOptions::ClusterOptions(QWidget *parent) :
 {
     ui->setupUi(this);
     saveState = false;
+    clusterExists = false;
+    clusterWidget = NULL;
 }
 
 ClusterOptions::~ClusterOptions()
@@ -41,6 +44,14 @@ void ClusterOptions::ClusterTypeOptions(KMeans *cluster, const int clusterSize,
 
 }
 
+void ClusterOptions::MiniBatchOptions(GLWidget *widget, KMeans *cluster) {
+    clusterWidget = widget;
+
+    ui->miniBatchCheckBox->setChecked(cluster->IsMiniBatch());
+    ui->batchSizeSpin->setValue(cluster->BatchSize());
+    ui->iterationsSpin->setValue(cluster->MaxIterations());
+}
+
 void ClusterOptions::CleanUpCluster() {
     if(clusterExists) {
         clusterDialog->CleanUp();
@@ -61,6 +72,15 @@ void ClusterOptions::CleanBox() {
     ui->clusterBox->clear();
 }
 
+void ClusterOptions::ShowQuality(ClusterQuality quality) {
+    QString text = "Inertia: " + QString::number(quality.inertia);
+    text += "  Full batch: " + QString::number(quality.fullInertia);
+    text += "  Error: " + QString::number(quality.relativeError * 100.0, 'f', 2) + "%";
+    text += "  Iterations: " + QString::number(quality.iterations);
+
+    ui->qualityLabel->setText(text);
+}
+
 /*****************/
 /* Private Slots */
 /*****************/
@@ -138,3 +158,15 @@ void ClusterOptions::on_NewNameEdit_textEdited(const QString &arg1)
         ui->NewNameEdit->setCursorPosition(cursorPosition);
     }
 }
+
+void ClusterOptions::on_applyMiniBatch_clicked()
+{
+    if(clusterWidget == NULL)
+        return;
+
+    clusterWidget->SetClusterMiniBatch(clusterWidget, ui->miniBatchCheckBox->isChecked(), ui->batchSizeSpin->value(), ui->iterationsSpin->value());
+    clusterWidget->ChangeClusterFromDialog(clusterWidget, this); //Refresh the cluster box with the new clusters
+
+    if(clusterExists)
+        ShowQuality(clusterWidget->GetClusterQuality(clusterWidget));
+}
@@ -5,6 +5,8 @@
 #include <QTimer>
 #include "kmeans.h"
 
+class GLWidget;
+
 namespace Ui {
 class ClusterOptions;
 }
@@ -20,6 +22,7 @@ public:
     void ClusterTypeOptions(KMeans *cluster, const int clusterSize, bool state, std::string ItemName);
     void CleanUpCluster();
     void ChangeCluster(KMeans *cluster);
+    void MiniBatchOptions(GLWidget *widget, KMeans *cluster);
 
 public slots:
 
@@ -34,6 +37,7 @@ private:
     int clusterDialogSize;
     int clusterIndex;
     KMeans *clusterDialog;
+    GLWidget *clusterWidget;
 
     //ClusterBox Timer
     QTimer clusterBoxTimer;
@@ -41,6 +45,9 @@ private:
     //Clean Cluster Box
     void CleanBox();
 
+    //Show the inertia of the clusters against the full batch KMeans
+    void ShowQuality(ClusterQuality quality);
+
 private slots:
     //Check if cluster Box changed value
     void on_clusterBox_currentTextChanged(const QString &arg1);
@@ -63,6 +70,9 @@ private slots:
     //Change the name of a cluster
     void on_NewNameEdit_textEdited(const QString &arg1);
 
+    //Recreate the clusters with the Mini-Batch options
+    void on_applyMiniBatch_clicked();
+
 };
 
 #endif // CLUSTER_OPTIONS_H
@@ -0,0 +1,51 @@
+#-------------------------------------------------
+#
+# Sources shared by the application (Crabs3Dv120.pro) and
+# crabs3d-render (render/crabs3d-render.pro): reading, writing and
+# drawing of the trials, clustering and the model
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/read_c3d.cpp \
+    $$PWD/glwidget.cpp \
+    $$PWD/kmeans.cpp \
+    $$PWD/cluster_options.cpp \
+    $$PWD/model.cpp \
+    $$PWD/model_create_dialog.cpp \
+    $$PWD/unit_dialog.cpp \
+    $$PWD/set_bones.cpp \
+    $$PWD/spatial_index.cpp \
+    $$PWD/string_table.cpp \
+    $$PWD/force_plate.cpp \
+    $$PWD/write_c3d.cpp \
+    $$PWD/marker_gaps.cpp \
+    $$PWD/trajectory_filter.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/trial_cache.cpp
+
+HEADERS += \
+    $$PWD/read_c3d.h \
+    $$PWD/glwidget.h \
+    $$PWD/kmeans.h \
+    $$PWD/cluster_options.h \
+    $$PWD/model.h \
+    $$PWD/model_create_dialog.h \
+    $$PWD/unit_dialog.h \
+    $$PWD/set_bones.h \
+    $$PWD/spatial_index.h \
+    $$PWD/string_table.h \
+    $$PWD/force_plate.h \
+    $$PWD/write_c3d.h \
+    $$PWD/marker_gaps.h \
+    $$PWD/trajectory_filter.h \
+    $$PWD/profiler.h \
+    $$PWD/trial_cache.h
+
+FORMS += \
+    $$PWD/cluster_options.ui \
+    $$PWD/model_create_dialog.ui \
+    $$PWD/unit_dialog.ui \
+    $$PWD/set_bones.ui
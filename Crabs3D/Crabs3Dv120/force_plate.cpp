@@ -0,0 +1,237 @@
+#include "force_plate.h"
+#include <math.h>
+#include <string.h>
+
+#define PLATE_ARRAYS 10 //force[3], moment[3], cop[3], freeMoment
+
+/**********/
+/* Public */
+/**********/
+
+bool ForcePlates::Compute(ForcePlates* fp, Force_Platform platform, Data_c3d data, const float threshold) {
+    CleanUp(fp);
+
+    if(platform.Used() <= 0 || data.AnalogChannelSize() <= 0 || data.AnalogSampleSize() <= 0)
+        return false;
+
+    fp->plateSize = platform.Used();
+    fp->sampleSize = data.AnalogSampleSize();
+    fp->samplesPerFrame = data.AnalogPerFrame();
+    fp->plates = (PlateWrench*)malloc(fp->plateSize*sizeof(PlateWrench));
+    fp->arena = (float*)malloc((size_t)fp->plateSize*PLATE_ARRAYS*fp->sampleSize*sizeof(float));
+
+    const int sampleSize = fp->sampleSize;
+
+    #pragma omp parallel for
+    for(int p = 0; p < fp->plateSize; p++) {
+        PlateWrench* plate = &fp->plates[p];
+        float* base = &fp->arena[(size_t)p*PLATE_ARRAYS*sampleSize];
+        for(int k = 0; k < 3; k++) {
+            plate->force[k] = &base[(size_t)k*sampleSize];
+            plate->moment[k] = &base[(size_t)(3+k)*sampleSize];
+            plate->cop[k] = &base[(size_t)(6+k)*sampleSize];
+        }
+        plate->freeMoment = &base[(size_t)9*sampleSize];
+
+        plate->type = platform.Type(p);
+        SetGeometry(plate, &platform, p);
+
+        plate->state = PlateOutputs(plate, &platform, &data, p, sampleSize);
+        if(!plate->state) {
+            memset(base, 0, (size_t)PLATE_ARRAYS*sampleSize*sizeof(float));
+            for(int k = 0; k < 3; k++)
+                for(int s = 0; s < sampleSize; s++)
+                    plate->cop[k][s] = plate->center[k];
+            continue;
+        }
+
+        float* fx = plate->force[0];
+        float* fy = plate->force[1];
+        float* fz = plate->force[2];
+        float* mx = plate->moment[0];
+        float* my = plate->moment[1];
+        float* mz = plate->moment[2];
+        float* cx = plate->cop[0];
+        float* cy = plate->cop[1];
+        float* cz = plate->cop[2];
+        float* tz = plate->freeMoment;
+
+        if(plate->type == 1) {
+            //The plate outputs the center of pressure (cx, cy) and the free moment (tz)
+            #pragma omp simd
+            for(int s = 0; s < sampleSize; s++) {
+                mx[s] = cy[s]*fz[s];
+                my[s] = -cx[s]*fz[s];
+                mz[s] = tz[s] - cx[s]*fy[s] + cy[s]*fx[s];
+            }
+        } else {
+            //Moment about the center of the surface: M + origin x F (Type 3 origin is only the height az0)
+            const float ox = plate->type == 3 ? 0.0 : platform.Origin(p, 0);
+            const float oy = plate->type == 3 ? 0.0 : platform.Origin(p, 1);
+            const float oz = platform.Origin(p, 2);
+            const float limit = threshold;
+
+            #pragma omp simd
+            for(int s = 0; s < sampleSize; s++) {
+                float x = mx[s] + oy*fz[s] - oz*fy[s];
+                float y = my[s] + oz*fx[s] - ox*fz[s];
+                float z = mz[s] + ox*fy[s] - oy*fx[s];
+                bool valid = fabsf(fz[s]) > limit;
+                float inv = valid ? 1.0f/fz[s] : 0.0f;
+
+                mx[s] = x;
+                my[s] = y;
+                mz[s] = z;
+                cx[s] = -y*inv;
+                cy[s] = x*inv;
+                tz[s] = z - cx[s]*fy[s] + cy[s]*fx[s];
+            }
+        }
+
+        //Plate coordinates to global coordinates
+        const float (*a)[3] = plate->axes;
+        const float c0 = plate->center[0], c1 = plate->center[1], c2 = plate->center[2];
+
+        #pragma omp simd
+        for(int s = 0; s < sampleSize; s++) {
+            float x = fx[s], y = fy[s], z = fz[s];
+            fx[s] = x*a[0][0] + y*a[1][0] + z*a[2][0];
+            fy[s] = x*a[0][1] + y*a[1][1] + z*a[2][1];
+            fz[s] = x*a[0][2] + y*a[1][2] + z*a[2][2];
+
+            float px = cx[s], py = cy[s];
+            cx[s] = c0 + px*a[0][0] + py*a[1][0];
+            cy[s] = c1 + px*a[0][1] + py*a[1][1];
+            cz[s] = c2 + px*a[0][2] + py*a[1][2];
+        }
+    }
+
+    return true;
+}
+
+void ForcePlates::CleanUp(ForcePlates* fp) {
+    free(fp->plates);
+    free(fp->arena);
+
+    fp->plates = NULL;
+    fp->arena = NULL;
+    fp->plateSize = 0;
+    fp->sampleSize = 0;
+    fp->samplesPerFrame = 1;
+}
+
+/***********/
+/* Private */
+/***********/
+
+void ForcePlates::SetGeometry(PlateWrench* plate, Force_Platform* platform, const int index) {
+    for(int i = 0; i < 3; i++) {
+        plate->center[i] = 0.0;
+        for(int k = 0; k < 4; k++) {
+            plate->corners[k][i] = platform->Corner(index, k, i);
+            plate->center[i] += plate->corners[k][i] / 4.0;
+        }
+    }
+
+    //Corner 1 is (+x,+y), 2 (-x,+y), 3 (-x,-y), 4 (+x,-y)
+    float (*c)[3] = plate->corners;
+    float* x = plate->axes[0];
+    float* y = plate->axes[1];
+    float* z = plate->axes[2];
+    for(int i = 0; i < 3; i++) {
+        x[i] = (c[0][i] - c[1][i] + c[3][i] - c[2][i]) / 2.0;
+        y[i] = (c[0][i] - c[3][i] + c[1][i] - c[2][i]) / 2.0;
+    }
+    z[0] = x[1]*y[2] - x[2]*y[1];
+    z[1] = x[2]*y[0] - x[0]*y[2];
+    z[2] = x[0]*y[1] - x[1]*y[0];
+
+    for(int k = 0; k < 3; k++) {
+        float* axis = plate->axes[k];
+        float length = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+        if(length <= 0) {
+            //No corners: the plate is aligned with the global system
+            for(int i = 0; i < 3; i++)
+                for(int j = 0; j < 3; j++)
+                    plate->axes[i][j] = (i == j) ? 1.0 : 0.0;
+            return;
+        }
+        for(int i = 0; i < 3; i++)
+            axis[i] /= length;
+    }
+}
+
+bool ForcePlates::PlateOutputs(PlateWrench* plate, Force_Platform* platform, Data_c3d* data, const int index, const int sampleSize) {
+    int outputs = plate->type == 3 ? 8 : 6;
+    if(plate->type < 1 || plate->type > 4 || platform->ChannelsPerPlate() < outputs)
+        return false;
+
+    const float* in[8];
+    for(int k = 0; k < outputs; k++) {
+        int channel = platform->Channel(index, k) - 1;
+        if(channel < 0 || channel >= data->AnalogChannelSize())
+            return false;
+        in[k] = data->AnalogChannel(channel);
+    }
+
+    size_t bytes = (size_t)sampleSize*sizeof(float);
+    switch(plate->type) {
+        case 1: {
+            //Fx, Fy, Fz, Px, Py, Mz
+            for(int k = 0; k < 3; k++)
+                memcpy(plate->force[k], in[k], bytes);
+            memcpy(plate->cop[0], in[3], bytes);
+            memcpy(plate->cop[1], in[4], bytes);
+            memcpy(plate->freeMoment, in[5], bytes);
+            break;
+        } case 2: {
+            //Fx, Fy, Fz, Mx, My, Mz
+            for(int k = 0; k < 3; k++) {
+                memcpy(plate->force[k], in[k], bytes);
+                memcpy(plate->moment[k], in[3+k], bytes);
+            }
+            break;
+        } case 3: {
+            //Fx12, Fx34, Fy14, Fy23, Fz1, Fz2, Fz3, Fz4 (sensors at +-a, +-b)
+            const float a = fabsf(platform->Origin(index, 0));
+            const float b = fabsf(platform->Origin(index, 1));
+            float* fx = plate->force[0];
+            float* fy = plate->force[1];
+            float* fz = plate->force[2];
+            float* mx = plate->moment[0];
+            float* my = plate->moment[1];
+            float* mz = plate->moment[2];
+
+            #pragma omp simd
+            for(int s = 0; s < sampleSize; s++) {
+                fx[s] = in[0][s] + in[1][s];
+                fy[s] = in[2][s] + in[3][s];
+                fz[s] = in[4][s] + in[5][s] + in[6][s] + in[7][s];
+                mx[s] = b*(in[4][s] + in[5][s] - in[6][s] - in[7][s]);
+                my[s] = a*(-in[4][s] + in[5][s] + in[6][s] - in[7][s]);
+                mz[s] = b*(-in[0][s] + in[1][s]) + a*(in[2][s] - in[3][s]);
+            }
+            break;
+        } case 4: {
+            //Type 2 outputs multiplied by the 6 x 6 calibration matrix
+            bool cal = platform->CalRows() == 6 && platform->CalColumns() == 6;
+            for(int r = 0; r < 6; r++) {
+                float* out = r < 3 ? plate->force[r] : plate->moment[r-3];
+                memset(out, 0, bytes);
+                for(int c = 0; c < 6; c++) {
+                    const float k = cal ? platform->CalMatrix(index, r, c) : (r == c ? 1.0 : 0.0);
+                    if(k == 0)
+                        continue;
+                    const float* channel = in[c];
+
+                    #pragma omp simd
+                    for(int s = 0; s < sampleSize; s++)
+                        out[s] += k*channel[s];
+                }
+            }
+            break;
+        }
+    }
+
+    return true;
+}
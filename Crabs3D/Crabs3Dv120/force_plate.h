@@ -0,0 +1,65 @@
+#ifndef FORCE_PLATE_H
+#define FORCE_PLATE_H
+
+#include "read_c3d.h"
+
+//Minimum vertical force (N) for a valid center of pressure
+#define FORCE_PLATE_THRESHOLD 10.0
+
+/* Forces, moments and center of pressure of a plate for every analog sample.
+ * Every array has SampleSize() values (frames * analog samples per frame).
+ */
+struct PlateWrench {
+    int type;
+    bool state; //false if the plate channels are missing
+
+    float corners[4][3]; //Global coordinates (POINT units)
+    float center[3];     //Center of the plate surface (global)
+    float axes[3][3];    //Plate x, y, z axes in global coordinates
+
+    float* force[3];    //Force (global, N)
+    float* moment[3];   //Moment about the center of the surface (plate coordinates, N*POINT units)
+    float* cop[3];      //Center of pressure (global, the center of the plate when Fz is under the threshold)
+    float* freeMoment;  //Vertical moment at the center of pressure
+};
+
+class ForcePlates
+{
+public:
+    ForcePlates() {plateSize = 0; sampleSize = 0; samplesPerFrame = 1; plates = NULL; arena = NULL;}
+
+    /* Compute every plate from the calibrated analog channels of the trial.
+     * Returns false if the trial has no force plates.
+     */
+    bool Compute(ForcePlates* fp, Force_Platform platform, Data_c3d data, const float threshold = FORCE_PLATE_THRESHOLD);
+
+    //Return the number of plates
+    int PlateSize() {return plateSize;}
+
+    //Return the number of samples of every plate
+    int SampleSize() {return sampleSize;}
+
+    //Return the analog samples per frame
+    int SamplesPerFrame() {return samplesPerFrame;}
+
+    //Return a plate
+    PlateWrench Plate(const int index) {return plates[index];}
+
+    //Clean Memory
+    void CleanUp(ForcePlates* fp);
+
+private:
+    int plateSize;
+    int sampleSize;
+    int samplesPerFrame;
+    PlateWrench* plates;
+    float* arena; //Every array of every plate (one allocation)
+
+    //Geometry of a plate (center and axes from the corners)
+    static void SetGeometry(PlateWrench* plate, Force_Platform* platform, const int index);
+
+    //Force and moment about the sensor origin in plate coordinates
+    static bool PlateOutputs(PlateWrench* plate, Force_Platform* platform, Data_c3d* data, const int index, const int sampleSize);
+};
+
+#endif // FORCE_PLATE_H
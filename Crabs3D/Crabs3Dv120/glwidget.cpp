@@ -1,6 +1,12 @@
+#define GL_GLEXT_PROTOTYPES //Vertex buffers (OpenGL 1.5) for the trails
 #include "glwidget.h"
+#include "profiler.h"
 #include <math.h>
+#include <stdio.h>
+#include <limits.h>
 #include <QDebug>
+#include <QToolTip>
+#include <QMessageBox>
 
 #define RADPERDEG 0.017453293
 
@@ -33,6 +39,15 @@ void GLWidget::initializeGL() {
 
 //Draw to the OpenGl window
 void GLWidget::paintGL() {
+    PROFILE_SCOPE("GLWidget::paintGL");
+
+    //The clock is read only when the HUD is on
+    std::chrono::steady_clock::time_point paintStart;
+    if(hudViewState)
+        paintStart = std::chrono::steady_clock::now();
+    renderStats.drawCalls = 0;
+    renderStats.vertices = 0;
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //Clear COLOR buffer and DEPTH buffer
 
     //If ChangeScreen = true (this means resizing window)
@@ -52,6 +67,12 @@ void GLWidget::paintGL() {
     if(C3D_IsOpen == true) {
         DrawC3D(); //Draw C3D
     }
+
+    PROFILE_COUNT(PROFILE_DRAW_CALLS, renderStats.drawCalls);
+    PROFILE_COUNT(PROFILE_VERTICES, renderStats.vertices);
+
+    if(hudViewState)
+        DrawHUD(paintStart);
 }
 
 //When window resized
@@ -79,6 +100,25 @@ void GLWidget::resizeGL(int w, int h){
     glRotatef(rotateZ, 0.0, 0.0, rotNumZ);
 }
 
+//Pick the marker under the mouse and show its label and position
+void GLWidget::mousePressEvent(QMouseEvent* event) {
+    if(event->button() != Qt::LeftButton || !cloudExists) {
+        QGLWidget::mousePressEvent(event);
+        return;
+    }
+
+    pickedPoint = PickScreenPoint(this, event->x(), event->y());
+    if(pickedPoint < 0) {
+        QToolTip::hideText();
+        return;
+    }
+
+    Cloud frame = cloud[C3DframeNum];
+    QString text = QString::fromUtf8(frame.name[pickedPoint].c_str());
+    text += QString("\nX: %1  Y: %2  Z: %3").arg(frame.x[pickedPoint]).arg(frame.y[pickedPoint]).arg(frame.z[pickedPoint]);
+    QToolTip::showText(event->globalPos(), text, this);
+}
+
 //Grid
 void GLWidget::Axes() {
     axesExist = true;
@@ -91,18 +131,20 @@ void GLWidget::Axes() {
 /*~~~~~~~~~~~~~~~*/
 
 //Read C3D file
-bool GLWidget::ReadC3D(std::string fileName, QWidget *widget) {
+bool GLWidget::ReadC3D(std::string fileName, QWidget *widget, const long long firstFrame, const long long lastFrame, const int stride) {
     //If fileName is not NULL
     if(fileName.c_str() != NULL) {
         //If C3D is open
         if(C3D_IsOpen == true) {
             c3d_f->CleanUp(c3d_f); //clean memory
+            delete c3d_f;
         }
         C3D_IsOpen = true; //set C3D_IsOpen = true
-        c3d_f = (Read_C3D*)malloc(1*sizeof(Read_C3D)); //allocate memory
-        c3d_f->Import(fileName, widget, c3d_f); //Import C3D file
+        trialCached = false; //OpenC3D caches the trial
+        c3d_f = new Read_C3D; //allocate memory (new: the parameter index and the string table need their constructors)
+        c3d_f->Import(fileName, widget, c3d_f, firstFrame, lastFrame, stride); //Import C3D file (frame range and stride)
 
-        C3DMultiplier = c3d_f->POINT().MultiplierForMeters(c3d_f->POINT()); //Set C3D scaling value (transform units to meters)
+        PrepareTrial(this, true); //Scale, force plates and marker gaps
         C3DframeNum = 0; //Set frameNum to 0 (frame Start)
 
         return true; //C3D file has been read
@@ -110,6 +152,64 @@ bool GLWidget::ReadC3D(std::string fileName, QWidget *widget) {
     return false; //fileName is NULL
 }
 
+//Open C3D file through the trial cache
+bool GLWidget::OpenC3D(std::string fileName, QWidget* widget, const long long firstFrame, const long long lastFrame, const int stride) {
+    PROFILE_SCOPE("GLWidget::OpenC3D");
+
+    //Long trials (hours of capture) don't fit in memory once decoded: open their first OPEN_FRAMES frames at the full rate
+    //and read the next ones as the playback moves (see PageTrial)
+    int step = stride > 1 ? stride : 1;
+    long long first = firstFrame, last = lastFrame;
+    long long fileFirst = 0, fileLast = 0;
+    bool page = firstFrame <= 0 && lastFrame <= 0 && step == 1 && Read_C3D::ReadFrameRange(fileName, &fileFirst, &fileLast)
+                && fileLast - fileFirst + 1 > OPEN_FRAMES;
+    if(page) {
+        first = fileFirst;
+        last = fileFirst + OPEN_FRAMES - 1;
+    }
+    paged = false;
+
+    TrialParameters parameters;
+    parameters.firstFrame = first;
+    parameters.lastFrame = last;
+    parameters.stride = step;
+    parameters.clusterSize = clusterSize;
+    parameters.miniBatch = cluster.IsMiniBatch();
+    parameters.batchSize = cluster.BatchSize();
+    parameters.iterations = cluster.MaxIterations();
+    parameters.rigidityThreshold = model.GetRigidityThreshold();
+
+    //Sampled hash: the whole file is hashed only when the trial is stored or the file was modified since
+    memset(&trialSource, 0, sizeof(trialSource));
+    bool hashed = trialCache.IsEnabled() && TrialCache::SampleFile(fileName, &trialSource);
+    trialKey = hashed ? TrialCache::Key(trialSource.sample, trialSource.fileSize, parameters) : 0;
+    trialParameters = parameters;
+
+    //Opened before: map the entry
+    CachedTrial trial;
+    if(hashed && trialCache.Load(trialKey, parameters, fileName, trialSource, &trial) && RestoreTrial(this, trial)) {
+        trialMetadata.assign(trial.metadata, trial.metadata + trial.metadataSize);
+        trialCached = true;
+        SetPaging(page, fileName, fileFirst, fileLast);
+        return true;
+    }
+
+    //Read the file, create the cloud and the clusters and cache them
+    if(!ReadC3D(fileName, widget, first, last, step))
+        return false;
+    SetCloud(this);
+    SetPaging(page, fileName, fileFirst, fileLast);
+
+    if(hashed) {
+        int dataStart = c3d_f->POINT().DataStart() > 0 ? c3d_f->POINT().DataStart() : c3d_f->Header().DataStart();
+        long long fileSize = 0;
+        trialCached = TrialCache::ReadMetadata(fileName, dataStart, &trialMetadata) &&
+                      TrialCache::HashFile(fileName, &trialSource.content, &fileSize) && fileSize == trialSource.fileSize;
+        StoreTrial(this);
+    }
+    return true;
+}
+
 //Export C3D File
 bool GLWidget::ExportC3D(std::string fileName, const GLWidget::c3d IsType) {
     //If C3D_IsOpen
@@ -132,6 +232,11 @@ bool GLWidget::ExportC3D(std::string fileName, const GLWidget::c3d IsType) {
             c3d_f->printAnalogFile(fileName); //export Analog
             return true;
             break;
+        } case c3d::IsC3D: {
+            Write_C3D writer;
+            int processor = c3d_f->Parameter()->Header().ProcessorType();
+            return writer.Export(fileName, c3d_f, c3d_f->Header().ScaleFactor() < 0, processor); //save C3D (same data format)
+            break;
         }
         default:
             return false; //default return false (for safety)
@@ -147,10 +252,85 @@ void GLWidget::CleanUpC3D() {
     //if C3D is open (the only format in version 1.20)
     if(C3D_IsOpen) {
         C3D_IsOpen = false; //set C3D_IsOpen value to false
+        trialCached = false;
+        SetPaging(false, "", 0, 0);
+        forcePlates.CleanUp(&forcePlates);
+        markerGaps.CleanUp(&markerGaps);
         c3d_f->CleanUp(c3d_f); //free memory
+        delete c3d_f;
+        c3d_f = NULL;
     }
 }
 
+//Go to a frame
+void GLWidget::SetFrame(GLWidget* widget, const int frame) {
+    if(!widget->C3D_IsOpen)
+        return ;
+
+    int frameSize = widget->c3d_f->FrameSize();
+    widget->C3DframeNum = frame < 0 ? 0 : (frame > frameSize - 1 ? frameSize - 1 : frame);
+}
+
+//Go to a frame of the whole trial
+bool GLWidget::SeekTrialFrame(GLWidget* widget, const long long frame) {
+    if(!widget->C3D_IsOpen)
+        return false;
+
+    if(widget->paged) {
+        long long target = widget->trialFirst + (frame < 0 ? 0 : frame);
+        if(target > widget->trialLast)
+            target = widget->trialLast;
+        //Out of the window: read the window centred on the frame (kept inside the trial)
+        if(target < widget->windowFirst || target > widget->windowFirst + widget->c3d_f->FrameSize() - 1) {
+            long long start = target - OPEN_FRAMES/2;
+            if(start > widget->trialLast - OPEN_FRAMES + 1)
+                start = widget->trialLast - OPEN_FRAMES + 1;
+            if(start < widget->trialFirst)
+                start = widget->trialFirst;
+            if(!widget->PageTrial(widget, start))
+                return false;
+        }
+        widget->C3DframeNum = (int)(target - widget->windowFirst);
+        return true;
+    }
+
+    SetFrame(widget, frame > INT_MAX ? INT_MAX : (int)frame);
+    return true;
+}
+
+//Go to the previous or next event
+bool GLWidget::SeekEvent(GLWidget* widget, const int direction) {
+    if(!widget->C3D_IsOpen)
+        return false;
+
+    Event event = widget->c3d_f->EVENT();
+    int index = direction < 0 ? event.Previous(widget->C3DframeNum) : event.Next(widget->C3DframeNum);
+
+    return SeekEventIndex(widget, index);
+}
+
+//Go to an event
+bool GLWidget::SeekEventIndex(GLWidget* widget, const int index) {
+    if(!widget->C3D_IsOpen)
+        return false;
+
+    Event event = widget->c3d_f->EVENT();
+    if(index < 0 || index >= event.EventSize())
+        return false;
+
+    int frameSize = widget->c3d_f->FrameSize();
+    int frame = event.Events(index).frame;
+    if(widget->paged)
+        return SeekTrialFrame(widget, widget->windowFirst - widget->trialFirst + frame); //the event frames start at the window
+    if(frame < 0)
+        frame = 0;
+    if(frame > frameSize - 1)
+        frame = frameSize - 1;
+
+    widget->C3DframeNum = frame;
+    return true;
+}
+
 //-------------------------------------------------------------------------------//
 
 /*~~~~~~~~~~~~~~~~~~~*/
@@ -211,6 +391,49 @@ void GLWidget::SetUpZ(GLWidget* widget, const float AddValue) {
     ChangeScreen = true;
 }
 
+//Return the camera
+ViewCamera GLWidget::GetCamera() {
+    ViewCamera camera;
+    camera.eye[0] = eyeX;
+    camera.eye[1] = eyeY;
+    camera.eye[2] = eyeZ;
+    camera.center[0] = centerX;
+    camera.center[1] = centerY;
+    camera.center[2] = centerZ;
+    camera.up[0] = upX;
+    camera.up[1] = upY;
+    camera.up[2] = upZ;
+    camera.rotate[0] = rotateX;
+    camera.rotate[1] = rotateY;
+    camera.rotate[2] = rotateZ;
+    camera.zoom = zoom;
+    return camera;
+}
+
+//Set the camera
+void GLWidget::SetCamera(GLWidget* widget, const ViewCamera camera) {
+    widget->eyeX = camera.eye[0];
+    widget->eyeY = camera.eye[1];
+    widget->eyeZ = camera.eye[2];
+    widget->centerX = camera.center[0];
+    widget->centerY = camera.center[1];
+    widget->centerZ = camera.center[2];
+    widget->upX = camera.up[0];
+    widget->upY = camera.up[1];
+    widget->upZ = camera.up[2];
+    widget->rotateX = camera.rotate[0];
+    widget->rotateY = camera.rotate[1];
+    widget->rotateZ = camera.rotate[2];
+    widget->zoom = camera.zoom < 15 ? 15 : (camera.zoom > 150 ? 150 : camera.zoom);
+    ChangeScreen = true;
+}
+
+//Set the number of frames of the trails
+void GLWidget::SetTrailLength(GLWidget* widget, const int length) {
+    widget->trailLength = length < 2 ? 2 : length;
+    widget->ResetTrails(); //the ring is resized on the next frame
+}
+
 //Set Play value
 void GLWidget::SetPlay(GLWidget* widget) {
     if(widget->play == true) {
@@ -288,6 +511,49 @@ void GLWidget::SetAxisZ(GLWidget* widget, const float value) {
     widget->axis_Z += value;
 }
 
+//Set the performance HUD view
+void GLWidget::SetHUDView(GLWidget* widget, const bool state) {
+    //Start a new graph (the time spent while the HUD was off is not a frame time)
+    if(state && !widget->hudViewState) {
+        widget->hudIndex = 0;
+        for(int i = 0; i < HUD_HISTORY; i++)
+            widget->hudFrameTime[i] = widget->hudPaintTime[i] = 0.0;
+        widget->hudLastFrame = std::chrono::steady_clock::now();
+    }
+    widget->hudViewState = state;
+}
+
+//Memory held by the trial data
+TrialMemory GLWidget::GetTrialMemory() {
+    TrialMemory memory = {0, 0, 0, 0, 0};
+
+    if(C3D_IsOpen) {
+        size_t frameSize = c3d_f->FrameSize();
+        memory.trial = frameSize*(sizeof(Frames_C3D) + c3d_f->Header().NumberOfPoints()*sizeof(Points_C3D))
+                     + (size_t)c3d_f->Data().AnalogChannelSize()*c3d_f->Data().AnalogSampleSize()*sizeof(float);
+    }
+
+    if(cloudExists) {
+        size_t pointBytes = 3*sizeof(float) + sizeof(int) + sizeof(std::string); //x, y, z, id and name
+        memory.frameStore = (size_t)frameStore.frameSize*frameStore.pointSize*3*sizeof(float) + frameStore.pointSize*sizeof(int);
+        memory.clouds = (size_t)cloudSize*(sizeof(Cloud) + pointPerCloudFrame*pointBytes);
+        if(clusterExists)
+            memory.clusters = (size_t)clusterSize*(sizeof(Cluster) + pointPerCloudFrame*pointBytes); //every cluster cloud holds a whole frame
+    }
+
+    //Bone arenas (CSR graph: id, column, offsets and neighbors)
+    Bones bones = model.GetBones();
+    if(bones.state)
+        memory.bones += ((size_t)3*bones.boneSize + 1 + bones.edgeSize)*sizeof(int);
+    for(int m = 0; m < modelSize; m++) {
+        bones = models[m].GetBones();
+        if(bones.state)
+            memory.bones += ((size_t)3*bones.boneSize + 1 + bones.edgeSize)*sizeof(int);
+    }
+
+    return memory;
+}
+
 //-------------------------------------------------------------------------------//
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~*/
@@ -296,7 +562,21 @@ void GLWidget::SetAxisZ(GLWidget* widget, const float value) {
 
 //Set Point Cloud and Create a Cluster (from the first Point Cloud Frame)
 void GLWidget::SetCloud(GLWidget* widget) {
+    PROFILE_SCOPE("GLWidget::SetCloud");
+
+    widget->LoadCloud(widget);
+
+    //if clusterExists
+    if(widget->clusterExists) {
+        widget->CleanUpClusters(); //clean up memory
+    }
 
+    widget->clusterExists = true; //set clusterExists value to true
+    widget->cluster.SetCluster(cloud[0], clusterSize, pointPerCloudFrame, widget->CloudWeights(0)); //create clusters from the first cloud frame (this frame always exist)
+}
+
+//Cloud, frame store, grid and centroids of the decoded frames (the clusters are left as they are)
+void GLWidget::LoadCloud(GLWidget* widget) {
     //If cloudExists
     if(widget->cloudExists) {
         widget->CleanUpClouds(); //Clean memory
@@ -305,22 +585,10 @@ void GLWidget::SetCloud(GLWidget* widget) {
     //If C3D is open (in version 1.20 is the only format)
     if(widget->C3D_IsOpen) {
         //Set frameNum and pointNum
-        widget->cloudSize = widget->c3d_f->Header().LastFrame() - widget->c3d_f->Header().FirstFrame() + 1;
+        widget->cloudSize = widget->c3d_f->FrameSize();
         widget->pointPerCloudFrame = widget->c3d_f->Header().NumberOfPoints();
     }
-    widget->cloudExists = true; //Set cloudExists value to true
-
-
-    widget->cloud = (Cloud*)malloc(cloudSize*sizeof(Cloud)); //allocate memory for the new cloud
-    //Loop through cloudSize and allocate memory for cloud variables
-    for(int i = 0; i < cloudSize; i++) {
-        widget->cloud[i].id = (int*)malloc(pointPerCloudFrame*sizeof(int));
-        widget->cloud[i].x = (float*)malloc(pointPerCloudFrame*sizeof(float));
-        widget->cloud[i].y = (float*)malloc(pointPerCloudFrame*sizeof(float));
-        widget->cloud[i].z = (float*)malloc(pointPerCloudFrame*sizeof(float));
-
-        widget->cloud[i].name = new std::string[pointPerCloudFrame];
-    }
+    widget->AllocateClouds(widget);
 
     //Loop through cloudSize
     for(int i = 0; i < widget->cloudSize; i++) {
@@ -342,32 +610,132 @@ void GLWidget::SetCloud(GLWidget* widget) {
         }
     }
 
-    //if clusterExists
-    if(widget->clusterExists) {
-        widget->CleanUpClusters(); //clean up memory
-    }
+    //Frame store shared by every model of the trial
+    widget->frameStore = Model::CreateFrameStore(widget->cloud, widget->cloudSize, widget->pointPerCloudFrame);
+    widget->ResetTrails();
 
-    widget->clusterExists = true; //set clusterExists value to true
-    widget->cluster.SetCluster(cloud[0], clusterSize, pointPerCloudFrame); //create clusters from the first cloud frame (this frame always exist)
+    //Index the first frame (it is moved incrementally as frames advance)
+    {
+        PROFILE_SCOPE("Frame grid");
+        widget->frameGrid.Build(widget->cloud[0], widget->pointPerCloudFrame);
+        widget->gridFrame = 0;
+    }
 
     widget->cloudCentroids = (GeoCentroid*)malloc(widget->cloudSize*sizeof(GeoCentroid));
+    widget->SetCloudCentroids(widget);
+}
+
+//Page the trial or not
+void GLWidget::SetPaging(const bool state, const std::string fileName, const long long first, const long long last) {
+    paged = state && C3D_IsOpen;
+    trialFile = paged ? fileName : "";
+    trialFirst = paged ? first : 0;
+    trialLast = paged ? last : 0;
+    windowFirst = paged ? first : 0;
+}
+
+//Read the window of the paged trial starting at a file frame
+bool GLWidget::PageTrial(GLWidget* widget, const long long first) {
+    PROFILE_SCOPE("GLWidget::PageTrial");
+
+    if(!widget->paged)
+        return false;
+
+    long long start = first < widget->trialFirst ? widget->trialFirst : (first > widget->trialLast ? widget->trialLast : first);
+    long long last = start + OPEN_FRAMES - 1 < widget->trialLast ? start + OPEN_FRAMES - 1 : widget->trialLast;
+
+    Read_C3D* window = new Read_C3D;
+    window->Import(widget->trialFile, NULL, window, start, last, 1);
+    if(!window->IsOpen() || window->FrameSize() <= 0 || window->Header().NumberOfPoints() != widget->pointPerCloudFrame) {
+        window->CleanUp(window);
+        delete window;
+        return false;
+    }
+
+    //The filter of the last window is applied to the next one
+    bool filtered = widget->trajectoryFilter.FrameSize() > 0;
+    FilterOptions options = widget->trajectoryFilter.Options();
+
+    widget->c3d_f->CleanUp(widget->c3d_f);
+    delete widget->c3d_f;
+    widget->c3d_f = window;
+    widget->trialCached = false; //only the first window is cached
+    widget->PrepareTrial(widget, true);
+    widget->C3DframeNum = 0;
+    widget->windowFirst = start;
+
+    //Same markers: the clusters are kept and the models read their bones from the new store
+    widget->LoadCloud(widget);
+    widget->model.SetBoneFrames(widget->frameStore, &widget->model);
+    for(int i = 0; i < widget->modelSize; i++)
+        widget->models[i].SetBoneFrames(widget->frameStore, &widget->models[i]);
+    if(filtered)
+        widget->FilterTrajectories(widget, options);
+
+    return true;
+}
+
+//Filter the marker trajectories of the point cloud
+bool GLWidget::FilterTrajectories(GLWidget* widget, const FilterOptions options) {
+    if(!widget->cloudExists || !widget->C3D_IsOpen || widget->frameStore.positions == NULL)
+        return false;
+
+    //The frame store already holds the last filter: filter its raw copy again instead of compounding the filters
+    if(widget->trajectoryFilter.FrameSize() == widget->cloudSize && widget->trajectoryFilter.PointSize() == widget->pointPerCloudFrame) {
+        if(!widget->trajectoryFilter.Reapply(&widget->trajectoryFilter, options))
+            return false;
+    } else {
+        float rate = widget->c3d_f->POINT().Rate() > 0 ? widget->c3d_f->POINT().Rate() : widget->c3d_f->Header().FrameRate();
+        MarkerGaps* gaps = widget->markerGaps.FrameSize() == widget->cloudSize ? &widget->markerGaps : NULL;
+        if(!widget->trajectoryFilter.Apply(&widget->trajectoryFilter, widget->frameStore, rate, options, gaps))
+            return false;
+    }
+    widget->trialCached = false; //the cache holds the unfiltered store
+
+    //The frame store is shared by the models, the cloud is drawn
+    widget->trajectoryFilter.Store(&widget->trajectoryFilter, widget->frameStore);
+    widget->ResetTrails();
+    for(int i = 0; i < widget->cloudSize; i++) {
+        const float* frame = &widget->frameStore.positions[(size_t)i*widget->pointPerCloudFrame*3];
+        for(int j = 0; j < widget->pointPerCloudFrame; j++) {
+            widget->cloud[i].x[j] = frame[j*3 + 0];
+            widget->cloud[i].y[j] = frame[j*3 + 1];
+            widget->cloud[i].z[j] = frame[j*3 + 2];
+        }
+    }
+
+    widget->frameGrid.Build(widget->cloud[widget->gridFrame], widget->pointPerCloudFrame);
+    widget->SetCloudCentroids(widget);
+
+    return true;
+}
+
+//Centroid of the valid points of every cloud frame
+void GLWidget::SetCloudCentroids(GLWidget* widget) {
+    PROFILE_SCOPE("Cloud centroids");
 
     for(int i = 0; i < widget->cloudSize; i++) {
          widget->cloudCentroids[i].x = 0;
          widget->cloudCentroids[i].y = 0;
          widget->cloudCentroids[i].z = 0;
 
-        //Loop through pointNum
-        for (int j = 0; j < widget->pointPerCloudFrame; j++) {
-            if(widget->C3D_IsOpen) {
-                widget->cloudCentroids[i].x += widget->cloud[i].x[j];
-                widget->cloudCentroids[i].y += widget->cloud[i].y[j];
-                widget->cloudCentroids[i].z += widget->cloud[i].z[j];
+        //Loop through pointNum (invalid samples have weight 0, every sample is valid without gap weights)
+        float validPoints = 0;
+        if(widget->C3D_IsOpen) {
+            const float* weight = widget->CloudWeights(i);
+            for (int j = 0; j < widget->pointPerCloudFrame; j++) {
+                float w = weight != NULL ? weight[j] : 1;
+                widget->cloudCentroids[i].x += w*widget->cloud[i].x[j];
+                widget->cloudCentroids[i].y += w*widget->cloud[i].y[j];
+                widget->cloudCentroids[i].z += w*widget->cloud[i].z[j];
+                validPoints += w;
             }
         }
-        widget->cloudCentroids[i].x /= widget->pointPerCloudFrame;
-        widget->cloudCentroids[i].y /= widget->pointPerCloudFrame;
-        widget->cloudCentroids[i].z /= widget->pointPerCloudFrame;
+        if(validPoints > 0) {
+            widget->cloudCentroids[i].x /= validPoints;
+            widget->cloudCentroids[i].y /= validPoints;
+            widget->cloudCentroids[i].z /= validPoints;
+        }
     }
 
 
@@ -386,6 +754,15 @@ void GLWidget::CleanUpClouds() {
             delete[] cloud[i].name;
         }
         free(cloud); //then free memory from cloud
+        free(cloudCentroids); //one centroid per cloud frame
+        cloudCentroids = NULL;
+        frameGrid.CleanUp(); //the grid points to the cloud arrays
+        pickedPoint = -1;
+        trajectoryFilter.CleanUp(&trajectoryFilter);
+        frameStore.arena.reset(); //models that still use the store keep it alive
+        frameStore.frameSize = 0;
+        frameStore.pointSize = 0;
+        ResetTrails();
         cloudExists = false; //Set cloudExists value to false (there are no more point clouds) :-(
     }
 }
@@ -402,6 +779,7 @@ void GLWidget::CleanUpClusters() {
 //Recreate Clusters
 void GLWidget::SetClusterNumber(GLWidget* widget, const int clus) {
     widget->clusterSize = clus; //Set the size of the clusters
+    widget->trialCached = false; //the cache key holds the cluster options of the trial
 
     //If a point cloud exists
     if(widget->cloudExists) {
@@ -409,7 +787,7 @@ void GLWidget::SetClusterNumber(GLWidget* widget, const int clus) {
 
         widget->clusterExists = true; //Set clusterExists value to true
         //At last create the clusters (with kmeans method)
-        widget->cluster.SetCluster(widget->cloud[0], widget->clusterSize, widget->c3d_f->Header().NumberOfPoints());
+        widget->cluster.SetCluster(widget->cloud[0], widget->clusterSize, widget->c3d_f->Header().NumberOfPoints(), widget->CloudWeights(0));
     }
 }
 
@@ -429,9 +807,104 @@ void GLWidget::ChangeView(std::string name, bool state) {
 void GLWidget::ChangeClusterFromDialog(GLWidget* widget, ClusterOptions* dialog, std::string name) {
     //User input new cluster values (name, color, point size)
     dialog->ClusterTypeOptions(&widget->cluster, widget->clusterSize, clusterExists, name);
+    dialog->MiniBatchOptions(widget, &widget->cluster);
 
 }
 
+//Set Mini-Batch KMeans mode (batch size, iterations) and recreate the clusters
+void GLWidget::SetClusterMiniBatch(GLWidget* widget, const bool state, const int batch, const int iterations) {
+    widget->cluster.SetMiniBatchMode(state, batch, iterations);
+
+    //Recreate clusters with the new mode
+    if(widget->cloudExists) {
+        widget->SetClusterNumber(widget, widget->clusterSize);
+    }
+}
+
+//Update the clusters with the points of a frame (streaming Mini-Batch KMeans)
+void GLWidget::UpdateClusterFromFrame(GLWidget* widget, const int frame) {
+    if(widget->cloudExists && frame >= 0 && frame < widget->cloudSize) {
+        widget->cluster.PartialFit(widget->cloud[frame], widget->clusterSize, widget->pointPerCloudFrame, widget->CloudWeights(frame));
+        widget->clusterExists = true;
+        widget->trialCached = false;
+    }
+}
+
+//Compare the inertia of the clusters with the full batch KMeans
+ClusterQuality GLWidget::GetClusterQuality(GLWidget* widget) {
+    ClusterQuality quality = {0.0, 0.0, 0.0, 0};
+
+    if(widget->cloudExists) {
+        quality = widget->cluster.CompareToFullBatch(widget->cloud[0], widget->pointPerCloudFrame, widget->CloudWeights(0));
+    }
+
+    return quality;
+}
+
+//Return the cloud index of the point drawn under a window position (-1 if there is none)
+int GLWidget::PickScreenPoint(GLWidget* widget, const int x, const int y) {
+    if(!widget->cloudExists || widget->unitDistance <= 0)
+        return -1;
+
+    //The view of the scene (the HUD restores the matrices it changes)
+    GLdouble modelView[16], projection[16];
+    GLint viewport[4];
+    widget->makeCurrent();
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelView);
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    //Ray from the near to the far plane (cloud units: the points are drawn scaled by unitDistance)
+    GLdouble winX = x;
+    GLdouble winY = viewport[3] - y - 1;
+    GLdouble nearX, nearY, nearZ, farX, farY, farZ;
+    GLdouble nearEdgeX, nearEdgeY, nearEdgeZ, farEdgeX, farEdgeY, farEdgeZ;
+    if(!gluUnProject(winX, winY, 0.0, modelView, projection, viewport, &nearX, &nearY, &nearZ) ||
+       !gluUnProject(winX, winY, 1.0, modelView, projection, viewport, &farX, &farY, &farZ) ||
+       !gluUnProject(winX + PICK_PIXELS, winY, 0.0, modelView, projection, viewport, &nearEdgeX, &nearEdgeY, &nearEdgeZ) ||
+       !gluUnProject(winX + PICK_PIXELS, winY, 1.0, modelView, projection, viewport, &farEdgeX, &farEdgeY, &farEdgeZ))
+        return -1;
+
+    //PICK_PIXELS in cloud units at the near and the far plane: the pick is a cone (a cylinder for an orthographic view)
+    double length = sqrt((farX - nearX)*(farX - nearX) + (farY - nearY)*(farY - nearY) + (farZ - nearZ)*(farZ - nearZ));
+    double nearRadius = sqrt((nearEdgeX - nearX)*(nearEdgeX - nearX) + (nearEdgeY - nearY)*(nearEdgeY - nearY) + (nearEdgeZ - nearZ)*(nearEdgeZ - nearZ));
+    double farRadius = sqrt((farEdgeX - farX)*(farEdgeX - farX) + (farEdgeY - farY)*(farEdgeY - farY) + (farEdgeZ - farZ)*(farEdgeZ - farZ));
+    if(length <= 0)
+        return -1;
+    float radius = nearRadius / widget->unitDistance;
+    float spread = farRadius > nearRadius ? (farRadius - nearRadius) / length : 0.0;
+
+    //Markers near the ray (closest to the eye first), the one drawn nearest to the click wins
+    std::vector<int> result;
+    widget->UpdateFrameGrid();
+    widget->frameGrid.RayQuery(nearX / widget->unitDistance, nearY / widget->unitDistance, nearZ / widget->unitDistance,
+                               (farX - nearX) / widget->unitDistance, (farY - nearY) / widget->unitDistance, (farZ - nearZ) / widget->unitDistance,
+                               radius, &result, spread);
+
+    const float* valid = widget->CloudWeights(widget->C3DframeNum);
+    Cloud frame = widget->cloud[widget->C3DframeNum];
+    int picked = -1;
+    double best = PICK_PIXELS*PICK_PIXELS;
+    for(size_t i = 0; i < result.size(); i++) {
+        int index = result[i];
+        if(valid != NULL && valid[index] == 0)
+            continue;
+
+        GLdouble screenX, screenY, screenZ;
+        if(!gluProject(frame.x[index]*widget->unitDistance, frame.y[index]*widget->unitDistance, frame.z[index]*widget->unitDistance,
+                       modelView, projection, viewport, &screenX, &screenY, &screenZ))
+            continue;
+
+        double dist = (screenX - winX)*(screenX - winX) + (screenY - winY)*(screenY - winY);
+        if(dist < best) {
+            best = dist;
+            picked = index;
+        }
+    }
+
+    return picked;
+}
+
 //Create Model
 void GLWidget::CreateModel(GLWidget* widget, ModelCreateDialog* dialog, bool* state) {
     dialog->ModelCreate(&widget->model, state);
@@ -456,17 +929,99 @@ bool GLWidget::CreateBones(GLWidget* widget) {
             break;
         }
     }
-    widget->model.CreateModelFromCluster(widget->cluster.GetCluster(index), widget->cloud, widget->cloudSize, widget->pointPerCloudFrame, &widget->model);
+    widget->model.CreateModelFromCluster(widget->cluster.GetCluster(index), widget->frameStore, &widget->model, widget->CloudWeights(0));
+
+    return true;
+}
+
+//Create one Model per cluster
+bool GLWidget::CreateModelsFromClusters(GLWidget* widget) {
+    if(!widget->clusterExists || !widget->cloudExists)
+        return false;
+
+    std::vector<std::string> names;
+    std::vector<ModelColor> colors;
+    std::vector<std::vector<int> > ids;
+
+    for(int i = 0; i < widget->clusterSize; i++) {
+        Cluster clusterIndex = widget->cluster.GetCluster(i);
+
+        ModelColor color;
+        color.red = clusterIndex.color.red * 255;
+        color.green = clusterIndex.color.green * 255;
+        color.blue = clusterIndex.color.blue * 255;
+
+        names.push_back(clusterIndex.name[0]);
+        colors.push_back(color);
+        ids.push_back(std::vector<int>(clusterIndex.cloud.id, clusterIndex.cloud.id + clusterIndex.size));
+    }
+
+    widget->BuildModels(widget, names, colors, ids);
+    widget->StoreTrial(widget); //reopening the trial restores the models
+    return true;
+}
+
+//Create one Model per subject (SUBJECTS:NAMES, markers are matched by label prefix)
+bool GLWidget::CreateModelsFromSubjects(GLWidget* widget) {
+    if(!widget->C3D_IsOpen || !widget->cloudExists)
+        return false;
+
+    Subjects subjects = widget->c3d_f->SUBJECTS();
+    if(subjects.NamesSize() <= 0)
+        return false;
+
+    std::vector<std::string> names;
+    std::vector<ModelColor> colors;
+    std::vector<std::vector<int> > ids;
+
+    for(int s = 0; s < subjects.NamesSize(); s++) {
+        //Prefix of the subject labels ("Name:" when LABEL_PREFIXES is missing)
+        std::string prefix = std::string(subjects.Names(s)) + ":";
+        if(subjects.UsesPrefixes() && s < subjects.LabelPrefixesSize())
+            prefix = subjects.LabelPrefixes(s);
+
+        std::vector<int> subjectIds;
+        for(int j = 0; j < widget->pointPerCloudFrame; j++) {
+            if(widget->cloud[0].name[j].compare(0, prefix.size(), prefix) == 0)
+                subjectIds.push_back(widget->cloud[0].id[j]);
+        }
+
+        //A different color for every subject
+        ModelColor color;
+        color.red = (s % 3 == 0) ? 255 : 64 + (s*97) % 192;
+        color.green = (s % 3 == 1) ? 255 : 64 + (s*59) % 192;
+        color.blue = (s % 3 == 2) ? 255 : 64 + (s*31) % 192;
+
+        names.push_back(std::string(subjects.Names(s)));
+        colors.push_back(color);
+        ids.push_back(subjectIds);
+    }
 
+    widget->BuildModels(widget, names, colors, ids);
+    widget->StoreTrial(widget); //reopening the trial restores the models
     return true;
 }
 
+//Clean Up Models
+void GLWidget::CleanUpModels() {
+    for(size_t i = 0; i < models.size(); i++)
+        models[i].CleanUpBones(&models[i]);
+    models.clear();
+    modelSize = 0;
+}
+
 //Set Bone View State
 void GLWidget::SetBoneViewState(GLWidget *widget, const bool state) {
     widget->model.SetBoneViewState(state);
     widget->boneViewState = state;
 }
 
+//Set Bone View State of a Model of the collection
+void GLWidget::SetModelViewState(GLWidget *widget, const int index, const bool state) {
+    if(index >= 0 && index < widget->modelSize)
+        widget->models[index].SetBoneViewState(state);
+}
+
 /*******************************************************************************************************************/
 /*******************************************************************************************************************/
 
@@ -521,6 +1076,21 @@ void GLWidget::SetScreenViewingDefaults() {
 
     minThreshold = 0.0; //Starting histogram min Threshold is 0 (all points are visible)
     maxThreshold = 10.0; //Starting histogram max Threshold is 10 (a good looking value - it works fine in version 1.20)
+
+    trailViewState = false; //Only the current frame is drawn
+    trailLength = TRAIL_LENGTH;
+    trailBuffer = 0; //Created in the context on the first frame with trails
+    trailSlots = 0;
+    trailPoints = 0;
+    trailFirst = -1;
+    trailFrame = -1;
+
+    hudViewState = false; //The performance HUD is off (paintGL doesn't read the clock)
+    renderStats.drawCalls = 0;
+    renderStats.vertices = 0;
+    hudIndex = 0;
+    for(int i = 0; i < HUD_HISTORY; i++)
+        hudFrameTime[i] = hudPaintTime[i] = 0.0;
 }
 
 //Set C3D defaults
@@ -528,6 +1098,7 @@ void GLWidget::SetC3Ddefaults() {
     C3D_IsOpen = false; //C3D is not open yet (and may not be opened - this is not true in version 1.20)
     C3DframeNum = 0; //default value to frameNum is 0
     C3DMultiplier = 1.0; //We assume that the C3D data is in meters (till we learn the true scale of measurements - usually is mm)
+    forcePlateViewState = true; //Force plates are drawn if the trial has any
 }
 
 //Set Cloud/Cluster defaults
@@ -535,8 +1106,182 @@ void GLWidget::SetCloudClusterDefaults() {
     cloudExists = false; //Cloud doesn't exist when software starts
     clusterExists = false; //Also cluster doesn't exist when software starts
     clusterSize = 1; //However cluster size must be set to 1 (there is no point for 0 clusters)
+    gridFrame = 0; //Grid is built on the first frame
+    pickedPoint = -1; //No marker is picked
+    cloudCentroids = NULL; //Allocated with the cloud
+    paged = false; //The trial fits in memory
+    trialFirst = 0;
+    trialLast = 0;
+    windowFirst = 0;
+    trialCached = false; //No trial to cache yet
+    trialKey = 0;
+    memset(&trialSource, 0, sizeof(trialSource));
 
     modelSize = 0; //Set Model Size
+    frameStore.frameSize = 0; //There is no frame store yet
+    frameStore.pointSize = 0;
+    frameStore.id = NULL;
+    frameStore.positions = NULL;
+}
+
+//Build the models of the collection in parallel (they all read the same frame store)
+void GLWidget::BuildModels(GLWidget* widget, const std::vector<std::string>& names, const std::vector<ModelColor>& colors, const std::vector<std::vector<int> >& ids) {
+    widget->CleanUpModels();
+
+    int size = (int)names.size();
+    widget->models.resize(size);
+
+    for(int i = 0; i < size; i++) {
+        widget->models[i].SetModelName(names[i]);
+        widget->models[i].SetColor(colors[i]);
+        widget->models[i].SetState(true);
+        widget->models[i].SetRigidityThreshold(widget->model.GetRigidityThreshold());
+    }
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i = 0; i < size; i++) {
+        Cluster subset;
+        subset.cloud.id = const_cast<int*>(ids[i].data());
+        subset.size = (int)ids[i].size();
+
+        widget->models[i].CreateModelFromCluster(subset, widget->frameStore, &widget->models[i], widget->CloudWeights(0));
+        widget->models[i].SetBoneViewState(true);
+    }
+
+    widget->modelSize = size;
+}
+
+//Scale, force plates and marker gaps of the trial just imported
+void GLWidget::PrepareTrial(GLWidget* widget, const bool fill) {
+    Read_C3D* c3d_f = widget->c3d_f;
+    widget->C3DMultiplier = c3d_f->POINT().MultiplierForMeters(c3d_f->POINT()); //Set C3D scaling value (transform units to meters)
+    widget->forcePlates.Compute(&widget->forcePlates, c3d_f->FORCE_PLATFORM(), c3d_f->Data()); //Forces, moments and COP of every plate
+
+    int frameSize = c3d_f->FrameSize();
+    widget->markerGaps.Analyse(&widget->markerGaps, c3d_f->Data(), frameSize, c3d_f->Header().NumberOfPoints()); //Valid intervals of every marker
+    if(fill)
+        widget->markerGaps.Fill(&widget->markerGaps, c3d_f->Data(), c3d_f->Header().MaxGap(), GAP_FILL_SPLINE); //Fill the gaps allowed by the header
+}
+
+//Allocate cloudSize clouds of pointPerCloudFrame points
+void GLWidget::AllocateClouds(GLWidget* widget) {
+    widget->cloudExists = true; //Set cloudExists value to true
+
+    PROFILE_COUNT(PROFILE_ALLOCATIONS, 1 + 5*widget->cloudSize);
+
+    widget->cloud = (Cloud*)malloc(widget->cloudSize*sizeof(Cloud)); //allocate memory for the new cloud
+    //Loop through cloudSize and allocate memory for cloud variables
+    for(int i = 0; i < widget->cloudSize; i++) {
+        widget->cloud[i].id = (int*)malloc(widget->pointPerCloudFrame*sizeof(int));
+        widget->cloud[i].x = (float*)malloc(widget->pointPerCloudFrame*sizeof(float));
+        widget->cloud[i].y = (float*)malloc(widget->pointPerCloudFrame*sizeof(float));
+        widget->cloud[i].z = (float*)malloc(widget->pointPerCloudFrame*sizeof(float));
+
+        widget->cloud[i].name = new std::string[widget->pointPerCloudFrame];
+    }
+}
+
+//Restore the trial, the cloud, the clusters and the models of a cache entry
+bool GLWidget::RestoreTrial(GLWidget* widget, const CachedTrial& trial) {
+    PROFILE_SCOPE("GLWidget::RestoreTrial");
+
+    //The entry holds the decoded points (gaps filled) and the metadata of the file
+    Read_C3D* decoded = new Read_C3D;
+    if(!decoded->ImportDecoded(trial.metadata, trial.metadataSize, NULL, decoded, widget->trialParameters.firstFrame, widget->trialParameters.lastFrame,
+                               widget->trialParameters.stride, trial.points, trial.frameSize, trial.pointSize, trial.analog, trial.analogChannels, trial.analogPerFrame)) {
+        delete decoded;
+        return false;
+    }
+
+    if(widget->C3D_IsOpen) {
+        widget->c3d_f->CleanUp(widget->c3d_f);
+        delete widget->c3d_f;
+    }
+    widget->C3D_IsOpen = true;
+    widget->c3d_f = decoded;
+    widget->PrepareTrial(widget, false);
+    widget->C3DframeNum = 0;
+
+    //Cloud of the cached frame store (the store is used in place)
+    if(widget->cloudExists) {
+        widget->CleanUpClouds();
+    }
+    widget->cloudSize = trial.frameSize;
+    widget->pointPerCloudFrame = trial.pointSize;
+    widget->AllocateClouds(widget);
+    widget->frameStore = trial.frames;
+    widget->ResetTrails();
+
+    for(int i = 0; i < widget->cloudSize; i++) {
+        const float* frame = &widget->frameStore.positions[(size_t)i*widget->pointPerCloudFrame*3];
+        for(int j = 0; j < widget->pointPerCloudFrame; j++) {
+            widget->cloud[i].id[j] = widget->frameStore.id[j];
+            widget->cloud[i].x[j] = frame[j*3 + 0];
+            widget->cloud[i].y[j] = frame[j*3 + 1];
+            widget->cloud[i].z[j] = frame[j*3 + 2];
+            widget->cloud[i].name[j] = widget->c3d_f->POINT().Labels(j);
+        }
+    }
+
+    widget->frameGrid.Build(widget->cloud[0], widget->pointPerCloudFrame);
+    widget->gridFrame = 0;
+
+    //Clusters without KMeans
+    if(widget->clusterExists) {
+        widget->CleanUpClusters();
+    }
+    widget->clusterExists = true;
+    widget->cluster.RestoreClusters(widget->cloud[0], widget->clusterSize, widget->pointPerCloudFrame, trial.centroids, trial.colors,
+                                    trial.clusterStart, trial.clusterIds, widget->CloudWeights(0));
+
+    widget->cloudCentroids = (GeoCentroid*)malloc(widget->cloudSize*sizeof(GeoCentroid));
+    widget->SetCloudCentroids(widget);
+
+    //Models and their bones (the entry has models only if they were created before)
+    if(trial.modelSize > 0) {
+        widget->CleanUpModels();
+        widget->models.resize(trial.modelSize);
+        for(int m = 0; m < trial.modelSize; m++) {
+            const CachedModel cached = trial.models[m];
+            const int* column = &trial.bones[cached.bone];
+            widget->models[m].SetModelName(cached.name);
+            widget->models[m].SetColor(cached.color);
+            widget->models[m].SetState(true);
+            widget->models[m].SetRigidityThreshold(widget->trialParameters.rigidityThreshold);
+            widget->models[m].RestoreBones(widget->frameStore, cached.boneSize, column, cached.edgeSize,
+                                           &column[cached.boneSize], &column[2*cached.boneSize + 1], &widget->models[m]);
+            widget->models[m].SetBoneViewState(true);
+        }
+        widget->modelSize = trial.modelSize;
+    }
+
+    return true;
+}
+
+//Store the trial, the clusters and the models
+void GLWidget::StoreTrial(GLWidget* widget) {
+    if(!widget->trialCached || !widget->cloudExists || !widget->clusterExists || widget->clusterSize != widget->trialParameters.clusterSize ||
+       widget->model.GetRigidityThreshold() != widget->trialParameters.rigidityThreshold)
+        return ;
+
+    widget->trialCache.Store(widget->trialKey, widget->trialParameters, widget->trialSource, widget->trialMetadata, widget->c3d_f, widget->frameStore,
+                             &widget->cluster, widget->clusterSize, &widget->models);
+}
+
+//Weights of the cloud from a frame on (NULL if the marker gaps aren't the ones of the cloud)
+const float* GLWidget::CloudWeights(const int frame) {
+    if(!C3D_IsOpen || markerGaps.FrameSize() != cloudSize || markerGaps.PointSize() != pointPerCloudFrame)
+        return NULL;
+
+    return markerGaps.Weights(frame);
+}
+
+//Move frameGrid to the current frame
+void GLWidget::UpdateFrameGrid() {
+    if(cloudExists && gridFrame != C3DframeNum && C3DframeNum >= 0 && C3DframeNum < cloudSize) {
+        frameGrid.Update(cloud[C3DframeNum]); //only the points that changed cell are moved
+        gridFrame = C3DframeNum;
+    }
 }
 
 //Draw C3D
@@ -545,7 +1290,14 @@ void GLWidget::DrawC3D() {
 
     //Loop through c3d Points
     int pointSizeMax = c3d_f->Header().NumberOfPoints();
+    const float* valid = CloudWeights(C3DframeNum);
+    int pointsDrawn = 0;
+    if(trailViewState)
+        trailCluster.assign(pointSizeMax, -1);
     for(register int i = 0; i < pointSizeMax; i++) {
+        //Missing samples are not drawn
+        if(valid != NULL && valid[i] == 0)
+            continue;
 
         //Set GeoPoin Values (only dr is useful in version 1.20)
         geo = c3d_f->POINT().CheckScreens(c3d_f->POINT(), c3d_f->Data().Frame(C3DframeNum).Point(i).X(), c3d_f->Data().Frame(C3DframeNum).Point(i).Y(), c3d_f->Data().Frame(C3DframeNum).Point(i).Z(), c3d_f->Data().Relocation(0).DR(i));
@@ -571,37 +1323,54 @@ void GLWidget::DrawC3D() {
                             //Draw the point
                             glVertex3f(cloud[C3DframeNum].x[i]*unitDistance, cloud[C3DframeNum].y[i]*unitDistance, cloud[C3DframeNum].z[i]*unitDistance);
                             glEnd();
+                            pointsDrawn++;
+                            if(trailViewState)
+                                trailCluster[i] = k;
                         }
                     }
                 }
             }
+        }
+        glFlush();
+    }
 
-            if(boneViewState) {
-                glLineWidth(1);
-                glColor3f(model.GetColorRed()/255.0, model.GetColorGreen()/255.0, model.GetColorBlue()/255.0);
-
-                int boneIndexMax = model.GetBones().boneSize;
-                //int clusterIndexMax = model.GetBones().boneSize
-
-                for(register int boneIndex = 0; boneIndex < boneIndexMax; boneIndex++) {
-                    int newConnectionsMax = model.GetBones().bones[boneIndex].newConnectionsSize;
-                    for(register int clusterIndex = 0; clusterIndex < boneIndexMax; clusterIndex++) {
-                        for(register int newConnections = 0; newConnections < newConnectionsMax; newConnections++) {
-                            if(model.GetBones().bones[boneIndex].idNewConnections[newConnections] == model.GetBones().points[C3DframeNum].id[clusterIndex]) {
-                                glBegin(GL_LINES);
-                                //Draw the point
-                                glVertex3f(model.GetBones().points[C3DframeNum].x[boneIndex]*unitDistance, model.GetBones().points[C3DframeNum].y[boneIndex]*unitDistance, model.GetBones().points[C3DframeNum].z[boneIndex]*unitDistance);
-                                glVertex3f(model.GetBones().points[C3DframeNum].x[clusterIndex]*unitDistance, model.GetBones().points[C3DframeNum].y[clusterIndex]*unitDistance, model.GetBones().points[C3DframeNum].z[clusterIndex]*unitDistance);
-                                glEnd();
-                            }
-                        }
-                    }
-                }
-            }
+    //Mark the picked marker
+    if(pickedPoint >= 0 && pickedPoint < pointSizeMax && valid[pickedPoint] != 0) {
+        glPointSize(8.0);
+        glBegin(GL_POINTS);
+        glColor3f(1.0, 1.0, 1.0);
+        glVertex3f(cloud[C3DframeNum].x[pickedPoint]*unitDistance, cloud[C3DframeNum].y[pickedPoint]*unitDistance, cloud[C3DframeNum].z[pickedPoint]*unitDistance);
+        glEnd();
+        pointsDrawn++;
+    }
+    renderStats.drawCalls += pointsDrawn; //one glBegin per point
+    renderStats.vertices += pointsDrawn;
+
+    //Draw the trails of the markers drawn above
+    if(trailViewState && cloudExists)
+        DrawTrails();
+
+    //Draw the bones of every model in one batch of lines (CSR adjacency over the shared frame store)
+    if(boneViewState || modelSize > 0) {
+        renderStats.drawCalls++;
+        glLineWidth(1);
+        glBegin(GL_LINES);
+
+        if(boneViewState)
+            DrawBones(&model);
+        for(int m = 0; m < modelSize; m++) {
+            if(models[m].SetBoneViewState())
+                DrawBones(&models[m]);
         }
+
+        glEnd();
         glFlush();
     }
 
+    //Draw the force plates
+    if(forcePlateViewState && forcePlates.PlateSize() > 0)
+        DrawForcePlates();
+
     //If frameNumber (index) is negative (this must never happens - this check is for safety only)
     if(C3DframeNum < 0) {
         C3DframeNum = 0; //Set frameNumber (index) to 0
@@ -611,12 +1380,175 @@ void GLWidget::DrawC3D() {
             C3DframeNum += velocity; //Add velocity value to frameNum (index)
 
         //If frameNum is higher than the FrameSize (this means segmentation fault)
-        if(C3DframeNum > (c3d_f->Header().LastFrame() - c3d_f->Header().FirstFrame() - 1))
-            C3DframeNum = 0; //Reset the frameNum (index) to 0 (start again)
+        //A paged trial goes on with its next window (or its first one after the last)
+        if(C3DframeNum > c3d_f->FrameSize() - 2) {
+            long long next = windowFirst + c3d_f->FrameSize() - 1 < trialLast ? windowFirst + C3DframeNum : trialFirst;
+            if(!paged || !PageTrial(this, next))
+                C3DframeNum = 0; //Reset the frameNum (index) to 0 (start again)
+        }
+
+    }
+}
+
+//Copy a frame of the frame store into its slot of the trail ring (the buffer is bound)
+void GLWidget::UploadTrailFrame(const int frame) {
+    GLsizeiptr slotBytes = (GLsizeiptr)TRAIL_BLOCK*3*sizeof(float);
+    int slot = frame % trailLength;
 
+    for(int first = 0; first < trailPoints; first += TRAIL_BLOCK) {
+        GLintptr block = (GLintptr)(first/TRAIL_BLOCK)*trailSlots*slotBytes;
+        GLsizeiptr bytes = (GLsizeiptr)(trailPoints - first < TRAIL_BLOCK ? trailPoints - first : TRAIL_BLOCK)*3*sizeof(float);
+        const float* positions = &frameStore.positions[((size_t)frame*trailPoints + first)*3];
+
+        glBufferSubData(GL_ARRAY_BUFFER, block + slot*slotBytes, bytes, positions);
+        if(slot == 0)
+            glBufferSubData(GL_ARRAY_BUFFER, block + trailLength*slotBytes, bytes, positions); //the repeated slot
     }
 }
 
+//Draw the trails of the markers drawn in the current frame
+void GLWidget::DrawTrails() {
+    PROFILE_SCOPE("GLWidget::DrawTrails");
+
+    int frame = C3DframeNum;
+    int pointSize = frameStore.pointSize;
+    if(frameStore.positions == NULL || frame < 0 || frame >= frameStore.frameSize || pointSize != (int)trailCluster.size())
+        return ;
+
+    if(trailBuffer == 0)
+        glGenBuffers(1, &trailBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, trailBuffer);
+
+    //New trail length or trial: allocate the ring
+    if(trailSlots != trailLength + 1 || trailPoints != pointSize) {
+        trailSlots = trailLength + 1;
+        trailPoints = pointSize;
+        int blocks = (trailPoints + TRAIL_BLOCK - 1)/TRAIL_BLOCK;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)blocks*trailSlots*TRAIL_BLOCK*3*sizeof(float), NULL, GL_DYNAMIC_DRAW);
+        ResetTrails();
+    }
+
+    //Upload the frames after the newest one (a jump backwards or past the length of the ring refills it)
+    if(trailFrame < 0 || frame < trailFrame || frame - trailFrame >= trailLength) {
+        trailFirst = frame - trailLength + 1 > 0 ? frame - trailLength + 1 : 0;
+        trailFrame = trailFirst - 1;
+    }
+    for(int f = trailFrame + 1; f <= frame; f++)
+        UploadTrailFrame(f);
+    trailFrame = frame;
+    if(trailFirst < frame - trailLength + 1)
+        trailFirst = frame - trailLength + 1;
+
+    //Every marker is a column of the ring of its block: the stride of its vertices is one slot
+    GLsizei slotBytes = TRAIL_BLOCK*3*sizeof(float);
+    int strips = 0;
+    int vertices = 0;
+    glPushMatrix();
+    glScalef(unitDistance, unitDistance, unitDistance);
+    glLineWidth(1);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    for(int i = 0; i < pointSize; i++) {
+        if(trailCluster[i] < 0)
+            continue;
+
+        Color color = cluster.GetCluster(trailCluster[i]).color;
+        glColor3f(color.red, color.green, color.blue);
+        glVertexPointer(3, GL_FLOAT, slotBytes, (const GLvoid*)((size_t)(i/TRAIL_BLOCK)*trailSlots*slotBytes + (i%TRAIL_BLOCK)*3*sizeof(float)));
+
+        //One line per run of valid samples (the marker gaps aren't bridged)
+        int start = trailFirst;
+        for(int f = trailFirst; f <= frame + 1; f++) {
+            const float* valid = f <= frame ? CloudWeights(f) : NULL;
+            if(f <= frame && (valid == NULL || valid[i] != 0))
+                continue;
+
+            int count = f - start;
+            if(count >= 2) {
+                int slot = start % trailLength;
+                int first = count < trailSlots - slot ? count : trailSlots - slot;
+                glDrawArrays(GL_LINE_STRIP, slot, first);
+                strips++;
+                if(first < count) {
+                    glDrawArrays(GL_LINE_STRIP, 0, count - first + 1); //from slot 0, the frame of the repeated slot
+                    strips++;
+                }
+                vertices += count;
+            }
+            start = f + 1;
+        }
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPopMatrix();
+
+    renderStats.drawCalls += strips;
+    renderStats.vertices += vertices;
+}
+
+//Draw the bones of a model (called inside glBegin(GL_LINES))
+void GLWidget::DrawBones(Model* model) {
+    Bones bones = model->GetBones();
+    if(!bones.state || C3DframeNum >= bones.frames.frameSize)
+        return;
+
+    glColor3f(model->GetColorRed()/255.0, model->GetColorGreen()/255.0, model->GetColorBlue()/255.0);
+
+    renderStats.vertices += 2*bones.edgeSize;
+
+    const float* frame = &bones.frames.positions[(size_t)C3DframeNum*bones.frames.pointSize*3];
+    for(int i = 0; i < bones.boneSize; i++) {
+        const float* a = &frame[bones.column[i]*3];
+        for(int e = bones.offsets[i]; e < bones.offsets[i+1]; e++) {
+            const float* b = &frame[bones.column[bones.neighbors[e]]*3];
+            glVertex3f(a[0]*unitDistance, a[1]*unitDistance, a[2]*unitDistance);
+            glVertex3f(b[0]*unitDistance, b[1]*unitDistance, b[2]*unitDistance);
+        }
+    }
+}
+
+//Draw the plate outlines and the force vectors of the current frame
+void GLWidget::DrawForcePlates() {
+    int sample = C3DframeNum*forcePlates.SamplesPerFrame(); //First analog sample of the frame
+    if(sample < 0 || sample >= forcePlates.SampleSize())
+        return;
+
+    const float forceLength = 0.001; //meters per Newton
+    GeoPoint geo;
+
+    renderStats.drawCalls++;
+    renderStats.vertices += 10*forcePlates.PlateSize(); //4 outline lines and the force vector
+
+    glLineWidth(2);
+    glBegin(GL_LINES);
+    for(int p = 0; p < forcePlates.PlateSize(); p++) {
+        PlateWrench plate = forcePlates.Plate(p);
+
+        //Outline
+        glColor3f(0.6, 0.6, 0.6);
+        for(int k = 0; k < 4; k++) {
+            for(int e = k; e <= k+1; e++) {
+                float* corner = plate.corners[e % 4];
+                geo = c3d_f->POINT().CheckScreens(c3d_f->POINT(), corner[0], corner[1], corner[2], 0.0);
+                glVertex3f(geo.x*C3DMultiplier*unitDistance, geo.y*C3DMultiplier*unitDistance, geo.z*C3DMultiplier*unitDistance);
+            }
+        }
+
+        //Force vector from the center of pressure
+        if(!plate.state)
+            continue;
+        GeoPoint cop = c3d_f->POINT().CheckScreens(c3d_f->POINT(), plate.cop[0][sample], plate.cop[1][sample], plate.cop[2][sample], 0.0);
+        GeoPoint force = c3d_f->POINT().CheckScreens(c3d_f->POINT(), plate.force[0][sample], plate.force[1][sample], plate.force[2][sample], 0.0);
+
+        glColor3f(1.0, 0.2, 0.2);
+        glVertex3f(cop.x*C3DMultiplier*unitDistance, cop.y*C3DMultiplier*unitDistance, cop.z*C3DMultiplier*unitDistance);
+        glVertex3f((cop.x*C3DMultiplier + force.x*forceLength)*unitDistance,
+                   (cop.y*C3DMultiplier + force.y*forceLength)*unitDistance,
+                   (cop.z*C3DMultiplier + force.z*forceLength)*unitDistance);
+    }
+    glEnd();
+    glFlush();
+}
+
 //Draw Grid
 void GLWidget::DrawGrid() {
     float xsize = 0.0;
@@ -624,6 +1556,10 @@ void GLWidget::DrawGrid() {
 
     glLineWidth(1);
 
+    int planes = (gridXY_is_on ? 1 : 0) + (gridXZ_is_on ? 1 : 0) + (gridYZ_is_on ? 1 : 0);
+    renderStats.drawCalls += 100*100*planes;
+    renderStats.vertices += 100*100*4*planes;
+
     for(int i = 0; i < 100; i++) {
         xsize = 0;
         for(int j = 0; j < 100; j++) {
@@ -671,6 +1607,9 @@ void GLWidget::DrawAxes()
     float dy = - axis_X * sin(rotateZ*RADPERDEG) + axis_Y * cos(rotateZ*RADPERDEG) * cos(rotateX*RADPERDEG) + axis_Z * sin(rotateX*RADPERDEG);  //- drXZ * sin(rotZ) + drXY * cos(rotZ) * cos(rotX) + drYZ * sin(rotY)
     float dz =   axis_X * sin(rotateY*RADPERDEG) - axis_Y * sin(rotateX*RADPERDEG) + axis_Z * cos(rotateY*RADPERDEG) * cos(rotateX*RADPERDEG);  //  drXZ * sin(rotY) - drXY * sin(rotX) - drYZ * cos(rotY) * cos(rotX)
 
+    renderStats.drawCalls += 3;
+    renderStats.vertices += 18;
+
     glLineWidth(3);
     glColor3f(1.0,0.0,0.0); // red x
         glBegin(GL_LINES);
@@ -718,3 +1657,128 @@ void GLWidget::DrawAxes()
         glEnd();
         glFlush();
 }
+
+//Text of the HUD (bitmap font, window coordinates)
+static void HUDText(const float x, const float y, const char* text) {
+    glRasterPos2f(x, y);
+    glutBitmapString(GLUT_BITMAP_8_BY_13, (const unsigned char*)text);
+}
+
+//Draw the performance HUD
+void GLWidget::DrawHUD(const std::chrono::steady_clock::time_point paintStart) {
+    //Wait for the scene, so the paint time includes the GPU work
+    glFinish();
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    hudPaintTime[hudIndex] = std::chrono::duration<float, std::milli>(now - paintStart).count();
+    hudFrameTime[hudIndex] = std::chrono::duration<float, std::milli>(paintStart - hudLastFrame).count();
+    hudLastFrame = paintStart;
+    hudIndex = (hudIndex + 1) % HUD_HISTORY;
+
+    //Averages over the graph
+    float frameTime = 0.0;
+    float paintTime = 0.0;
+    float maxTime = 50.0; //ms (graph scale)
+    int samples = 0;
+    for(int i = 0; i < HUD_HISTORY; i++) {
+        if(hudFrameTime[i] <= 0)
+            continue;
+        frameTime += hudFrameTime[i];
+        paintTime += hudPaintTime[i];
+        if(hudFrameTime[i] > maxTime)
+            maxTime = hudFrameTime[i];
+        samples++;
+    }
+    if(samples > 0) {
+        frameTime /= samples;
+        paintTime /= samples;
+    }
+    float fps = frameTime > 0 ? 1000.0/frameTime : 0.0;
+    float rate = C3D_IsOpen ? c3d_f->POINT().Rate() : 0.0;
+    TrialMemory memory = GetTrialMemory();
+    const float MB = 1024.0*1024.0;
+
+    //Window coordinates
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, width, 0, height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glDisable(GL_DEPTH_TEST);
+
+    char line[160];
+    float y = height - 18;
+    glColor3f(1.0, 1.0, 1.0);
+    snprintf(line, sizeof(line), "Frame %lld / %lld", TrialFrame(), TrialFrameSize());
+    HUDText(10, y, line);
+    y -= 15;
+    snprintf(line, sizeof(line), "Frame time %.1f ms  paint %.1f ms", frameTime, paintTime);
+    HUDText(10, y, line);
+    y -= 15;
+    snprintf(line, sizeof(line), "%.1f FPS  playback %.1f of %.1f frames/s (POINT:RATE)", fps, play ? fps*velocity : 0.0, rate);
+    HUDText(10, y, line);
+    y -= 15;
+    snprintf(line, sizeof(line), "Draw calls %d  vertices %d", renderStats.drawCalls, renderStats.vertices);
+    HUDText(10, y, line);
+    y -= 15;
+    snprintf(line, sizeof(line), "Memory: trial %.1f MB  frame store %.1f MB  clouds %.1f MB  clusters %.1f MB  bones %.2f MB",
+             memory.trial/MB, memory.frameStore/MB, memory.clouds/MB, memory.clusters/MB, memory.bones/MB);
+    HUDText(10, y, line);
+    y -= 15;
+
+    //paintGL takes the whole frame: render-bound; otherwise the frames are paced by the update timer (the trial is decoded on import)
+    bool renderBound = samples > 0 && paintTime >= 0.8*frameTime;
+    if(renderBound)
+        glColor3f(1.0, 0.3, 0.3);
+    else
+        glColor3f(0.3, 1.0, 0.3);
+    HUDText(10, y, renderBound ? "render-bound" : "paced by the update timer");
+
+    //Frame-time graph (yellow: frame time, green: paint time, red: frame period of POINT:RATE)
+    const float graphX = 10.0, graphY = 10.0, graphWidth = 2.0*HUD_HISTORY, graphHeight = 80.0;
+    glLineWidth(1);
+    glColor3f(0.5, 0.5, 0.5);
+    glBegin(GL_LINE_LOOP);
+    glVertex2f(graphX, graphY);
+    glVertex2f(graphX + graphWidth, graphY);
+    glVertex2f(graphX + graphWidth, graphY + graphHeight);
+    glVertex2f(graphX, graphY + graphHeight);
+    glEnd();
+
+    if(rate > 0 && 1000.0/rate <= maxTime) {
+        float period = graphY + graphHeight*(1000.0/rate)/maxTime;
+        glColor3f(1.0, 0.3, 0.3);
+        glBegin(GL_LINES);
+        glVertex2f(graphX, period);
+        glVertex2f(graphX + graphWidth, period);
+        glEnd();
+    }
+
+    const float* series[2] = {hudFrameTime, hudPaintTime};
+    for(int s = 0; s < 2; s++) {
+        if(s == 0)
+            glColor3f(1.0, 1.0, 0.2);
+        else
+            glColor3f(0.2, 1.0, 0.2);
+        glBegin(GL_LINE_STRIP);
+        for(int i = 0; i < HUD_HISTORY; i++) {
+            float value = series[s][(hudIndex + i) % HUD_HISTORY]; //oldest first
+            if(hudFrameTime[(hudIndex + i) % HUD_HISTORY] <= 0) //not measured yet
+                continue;
+            glVertex2f(graphX + 2.0*i, graphY + graphHeight*(value < maxTime ? value : maxTime)/maxTime);
+        }
+        glEnd();
+    }
+
+    snprintf(line, sizeof(line), "%.0f ms", maxTime);
+    glColor3f(0.7, 0.7, 0.7);
+    HUDText(graphX + graphWidth + 5, graphY + graphHeight - 10, line);
+
+    glEnable(GL_DEPTH_TEST);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glFlush();
+}
@@ -5,16 +5,62 @@
 #include <QTimer>
 #include <QMouseEvent>
 #include <GL/freeglut.h>
+#include <chrono>
 
 #include "read_c3d.h"
 #include "kmeans.h"
+#include "spatial_index.h"
 #include "cluster_options.h"
 #include "model.h"
+#include "force_plate.h"
+#include "write_c3d.h"
+#include "marker_gaps.h"
+#include "trajectory_filter.h"
+#include "trial_cache.h"
 #include "model_create_dialog.h"
 
 #include "unit_dialog.h"
 #include "set_bones.h"
 
+//Frames kept by the frame-time graph of the HUD
+#define HUD_HISTORY 120
+
+//Frames decoded when a whole trial is opened (longer trials are paged in windows of OPEN_FRAMES frames)
+#define OPEN_FRAMES 65535
+
+//Pixels between a click and the marker it picks
+#define PICK_PIXELS 6
+
+//Default number of frames of the marker trails
+#define TRAIL_LENGTH 60
+
+//Markers per block of the trail ring (vertex stride 128*12 bytes: OpenGL 4.4 guarantees strides up to 2048 bytes only)
+#define TRAIL_BLOCK 128
+
+//Work submitted by one paintGL
+struct RenderStats {
+    int drawCalls; //glBegin/glEnd batches
+    int vertices;
+};
+
+//Camera of the view (rotations in degrees, zoom: field of view in degrees)
+struct ViewCamera {
+    double eye[3];
+    double center[3];
+    double up[3];
+    float rotate[3];
+    double zoom;
+};
+
+//Memory held by the trial data (bytes)
+struct TrialMemory {
+    size_t trial; //Decoded points and analog samples
+    size_t frameStore;
+    size_t clouds;
+    size_t clusters;
+    size_t bones;
+};
+
 class GLWidget : public QGLWidget
 {
 public:
@@ -38,14 +84,26 @@ public:
     /* C3D Functions */
     /*~~~~~~~~~~~~~~~*/
 
-    //Read C3D file
-    bool ReadC3D(std::string fileName, QWidget* widget);
+    //Read C3D file (optionally frames firstFrame to lastFrame, every stride-th frame)
+    bool ReadC3D(std::string fileName, QWidget* widget, const long long firstFrame = 0, const long long lastFrame = 0, const int stride = 1);
+
+    /* Open a C3D file through the trial cache: a trial opened before with the same frame range and
+     * cluster/model options is mapped from the cache (points, frame store, clusters and models),
+     * else it is read, the cloud and the clusters are created and the result is cached.
+     * A whole trial (no frame range) longer than OPEN_FRAMES frames is paged: windows of OPEN_FRAMES frames are read at the full rate
+     * as the playback moves (see PageTrial).
+     */
+    bool OpenC3D(std::string fileName, QWidget* widget, const long long firstFrame = 0, const long long lastFrame = 0, const int stride = 1);
+
+    //Return the trial cache (directory and size limit)
+    TrialCache* GetTrialCache() {return &trialCache;}
 
     //Enumeration class for exporting c3d sections
     enum class c3d {IsHeader,
                     IsParameter,
                     Is3DPoints,
-                    IsAnalog};
+                    IsAnalog,
+                    IsC3D};
 
     //Export C3D File
     bool ExportC3D(std::string fileName, c3d IsType);
@@ -53,6 +111,36 @@ public:
     //Clean C3D file
     void CleanUpC3D();
 
+    //Return the current frame
+    int GetFrame() {return C3DframeNum;}
+
+    //Go to a frame (clamped to the trial)
+    void SetFrame(GLWidget* widget, const int frame);
+
+    //Return the number of frames of the open trial
+    int FrameSize() {return C3D_IsOpen ? c3d_f->FrameSize() : 0;}
+
+    //Return true if the trial is paged (only a window of OPEN_FRAMES frames is in memory)
+    bool IsPaged() {return paged;}
+
+    //Return the number of frames of the whole trial (FrameSize() if it isn't paged)
+    long long TrialFrameSize() {return paged ? trialLast - trialFirst + 1 : FrameSize();}
+
+    //Return the current frame in the whole trial (GetFrame() if it isn't paged)
+    long long TrialFrame() {return paged ? windowFirst - trialFirst + C3DframeNum : C3DframeNum;}
+
+    //Go to a frame of the whole trial (the window holding it is read if the trial is paged)
+    bool SeekTrialFrame(GLWidget* widget, const long long frame);
+
+    //Return the event timeline of the trial
+    Event GetEvents() {return C3D_IsOpen ? c3d_f->EVENT() : Event();}
+
+    //Go to the previous (direction < 0) or next event from the current frame (returns false if there is none)
+    bool SeekEvent(GLWidget* widget, const int direction);
+
+    //Go to an event of the timeline
+    bool SeekEventIndex(GLWidget* widget, const int index);
+
     //-------------------------------------------------------------------------------//
 
     /*~~~~~~~~~~~~~~~~~~~*/
@@ -89,6 +177,12 @@ public:
     //Set UpZ value
     void SetUpZ(GLWidget* widget, const float AddValue);
 
+    //Return the camera
+    ViewCamera GetCamera();
+
+    //Set the camera (eye, center, up, rotations and zoom at once)
+    void SetCamera(GLWidget* widget, const ViewCamera camera);
+
     //Set Play value
     void SetPlay(GLWidget* widget);
 
@@ -131,6 +225,39 @@ public:
     //Set Grid YZ value
     void SetGridYZView(GLWidget* widget, const bool state) {widget->gridYZ_is_on = state;}
 
+    //Set the performance HUD view (frame time, FPS, draw calls, memory and the frame-time graph)
+    void SetHUDView(GLWidget* widget, const bool state);
+
+    //Return the HUD view state
+    bool GetHUDView() {return hudViewState;}
+
+    //Return the work submitted by the last paintGL
+    RenderStats GetRenderStats() {return renderStats;}
+
+    //Return the memory held by the trial, the frame store, the clouds, the clusters and the bones
+    TrialMemory GetTrialMemory();
+
+    //Set Force Plate view (plate outlines and force vectors)
+    void SetForcePlateView(GLWidget* widget, const bool state) {widget->forcePlateViewState = state;}
+
+    //Set Trail view (the last frames of every visible marker as lines, in the color of its cluster)
+    void SetTrailView(GLWidget* widget, const bool state) {widget->trailViewState = state;}
+
+    //Return the Trail view state
+    bool GetTrailView() {return trailViewState;}
+
+    //Set the number of frames of the trails (at least 2)
+    void SetTrailLength(GLWidget* widget, const int length);
+
+    //Return the number of frames of the trails
+    int GetTrailLength() {return trailLength;}
+
+    //Return the force plates of the trial
+    ForcePlates GetForcePlates() {return forcePlates;}
+
+    //Return the valid intervals of the markers
+    MarkerGaps GetMarkerGaps() {return markerGaps;}
+
     //-------------------------------------------------------------------------------//
 
     /*~~~~~~~~~~~~~~~~~~~~~~~~~*/
@@ -149,12 +276,21 @@ public:
     //Set Point Cloud and Create a Cluster (from the first Point Cloud Frame)
     void SetCloud(GLWidget* widget);
 
+    //Filter the marker trajectories of the point cloud (the cloud and the frame store get the filtered positions)
+    bool FilterTrajectories(GLWidget* widget, const FilterOptions options);
+
+    //Return the filtered trajectories with their velocity and acceleration (NULL before FilterTrajectories)
+    TrajectoryFilter* GetTrajectoryFilter() {return trajectoryFilter.FrameSize() > 0 ? &trajectoryFilter : NULL;}
+
     //Clean Memory (delete point cloud)
     void CleanUpClouds();
 
     //Clean Memory (delete cluster)
     void CleanUpClusters();
 
+    //Centroid of the valid points of every cloud frame
+    void SetCloudCentroids(GLWidget* widget);
+
     //Recreate Clusters
     void SetClusterNumber(GLWidget* widget, const int clus);
 
@@ -164,6 +300,18 @@ public:
     //Open Dialog window and change cluster viewing options (color, point size etc)
     void ChangeClusterFromDialog(GLWidget* widget, ClusterOptions* dialog, std::string name = "");
 
+    //Set Mini-Batch KMeans mode (batch size, iterations) and recreate the clusters
+    void SetClusterMiniBatch(GLWidget* widget, const bool state, const int batch, const int iterations);
+
+    //Update the clusters with the points of a frame (streaming Mini-Batch KMeans)
+    void UpdateClusterFromFrame(GLWidget* widget, const int frame);
+
+    //Compare the inertia of the clusters with the full batch KMeans
+    ClusterQuality GetClusterQuality(GLWidget* widget);
+
+    //Return the cloud index of the point drawn under a window position (-1 if there is none)
+    int PickScreenPoint(GLWidget* widget, const int x, const int y);
+
     //-------------------------------------------------------------------------------//
 
     /*~~~~~~~~~~~~~~~~~*/
@@ -189,11 +337,33 @@ public:
     Model ModelReturn() {return model;}
 
     //Clean Up Model Bones
-    void CleanUpModelBones() {model.CleanUpBones(&model);}
+    void CleanUpModelBones() {model.CleanUpBones(&model); CleanUpModels();}
+
+    //Create one Model per cluster (built in parallel, all models share the trial frame store)
+    bool CreateModelsFromClusters(GLWidget* widget);
+
+    //Create one Model per subject of SUBJECTS:NAMES
+    bool CreateModelsFromSubjects(GLWidget* widget);
+
+    //Return the size of the Model collection
+    int ModelsSize() {return modelSize;}
+
+    //Return a Model of the collection
+    Model ModelsReturn(const int index) {return models[index];}
+
+    //Set Bone View State of a Model of the collection
+    void SetModelViewState(GLWidget *widget, const int index, const bool state);
+
+    //Clean Up the Model collection
+    void CleanUpModels();
 
     //Return Bone View
     bool BoneView() {return boneViewState;}
 
+protected:
+    //Pick the marker under the mouse
+    void mousePressEvent(QMouseEvent* event);
+
 private:
     QTimer GLtimer;
     bool axesExist;
@@ -245,12 +415,63 @@ private:
     int C3DframeNum;
     float C3DMultiplier;
 
+    //Trial cache (trialCached: the trial, the clusters and the models can be stored under trialKey)
+    TrialCache trialCache;
+    bool trialCached;
+    unsigned long long trialKey;
+    TrialSource trialSource;
+    TrialParameters trialParameters;
+    std::vector<char> trialMetadata;
+
+    //Paged trial (trialFirst to trialLast are the frames of the file, windowFirst is the file frame of C3DframeNum 0)
+    bool paged;
+    std::string trialFile;
+    long long trialFirst;
+    long long trialLast;
+    long long windowFirst;
+
+    //Performance HUD (frame times are kept only while it is on)
+    bool hudViewState;
+    RenderStats renderStats;
+    float hudFrameTime[HUD_HISTORY]; //ms between two paintGL calls
+    float hudPaintTime[HUD_HISTORY]; //ms spent in paintGL
+    int hudIndex;
+    std::chrono::steady_clock::time_point hudLastFrame;
+
+    //Force Plates
+    ForcePlates forcePlates;
+    bool forcePlateViewState;
+
+    /* Trails: a ring of trailLength+1 slots in a vertex buffer for every block of TRAIL_BLOCK markers, one frame of
+     * the frame store (TRAIL_BLOCK x,y,z) per slot. Frame f is in slot f % trailLength and slot trailLength repeats
+     * slot 0, so a trail is at most two line strips. Only the frames after trailFrame are uploaded as C3DframeNum
+     * advances (one row per block; a jump refills the ring).
+     */
+    bool trailViewState;
+    int trailLength;
+    GLuint trailBuffer;
+    int trailSlots; //Slots of the buffer (trailLength+1)
+    int trailPoints; //Points per slot
+    int trailFirst; //Oldest frame in the ring (-1: empty)
+    int trailFrame; //Newest frame in the ring
+    std::vector<int> trailCluster; //Cluster of every marker drawn in the current frame (-1: not drawn)
+
+    //Valid intervals of the markers (gaps up to the header maximum gap are filled on import)
+    MarkerGaps markerGaps;
+
+    //Filtered trajectories (velocity and acceleration on demand)
+    TrajectoryFilter trajectoryFilter;
+
     //Cloud
     bool cloudExists;
     int cloudSize;
     int pointPerCloudFrame;
     Cloud* cloud;
     GeoCentroid* cloudCentroids;
+    SpatialGrid frameGrid; //Spatial index of the current frame
+    FrameStore frameStore; //Frame-major copy of the cloud shared by the models
+    int gridFrame; //Frame indexed by frameGrid
+    int pickedPoint; //Cloud index of the picked marker (-1 if there is none)
 
     //Cluster
     bool clusterExists;
@@ -259,8 +480,9 @@ private:
 
     //Model
     bool modelExists;
-    int modelSize;
+    int modelSize; //Size of models
     Model model;
+    std::vector<Model> models; //One model per cluster/subject
 
     //ModelBuffers
     std::string bufModelName;
@@ -281,14 +503,62 @@ private:
     //Set Cloud/Cluster defaults
     void SetCloudClusterDefaults();
 
+    //Weights of the cloud from a frame on (NULL if the marker gaps aren't the ones of the cloud)
+    const float* CloudWeights(const int frame);
+
+    //Move frameGrid to the current frame
+    void UpdateFrameGrid();
+
+    //Scale, force plates and marker gaps of the trial just imported (fill: interpolate the gaps allowed by the header)
+    void PrepareTrial(GLWidget* widget, const bool fill);
+
+    //Allocate cloudSize clouds of pointPerCloudFrame points
+    void AllocateClouds(GLWidget* widget);
+
+    //Cloud, frame store, grid and centroids of the decoded frames (the clusters are left as they are)
+    void LoadCloud(GLWidget* widget);
+
+    //Page the trial (state) or not: frames first to last of fileName
+    void SetPaging(const bool state, const std::string fileName, const long long first, const long long last);
+
+    //Read the window of the paged trial starting at the file frame first (the clusters and the models are kept)
+    bool PageTrial(GLWidget* widget, const long long first);
+
+    //Restore the trial, the cloud, the clusters and the models of a cache entry
+    bool RestoreTrial(GLWidget* widget, const CachedTrial& trial);
+
+    //Store the trial, the clusters and the models (if they still match the key of the trial)
+    void StoreTrial(GLWidget* widget);
+
+    //Build the Model collection (one model per ids list)
+    void BuildModels(GLWidget* widget, const std::vector<std::string>& names, const std::vector<ModelColor>& colors, const std::vector<std::vector<int> >& ids);
+
     //Draw C3D
     void DrawC3D();
 
+    //Empty the trail ring (the frame store changed)
+    void ResetTrails() {trailFirst = -1; trailFrame = -1;}
+
+    //Copy a frame of the frame store into its slot of the trail ring
+    void UploadTrailFrame(const int frame);
+
+    //Draw the trails of the markers drawn in the current frame
+    void DrawTrails();
+
+    //Draw the bones of a model (inside glBegin(GL_LINES))
+    void DrawBones(Model* model);
+
+    //Draw the plate outlines and the force vectors of the current frame (one batch of lines)
+    void DrawForcePlates();
+
     //Draw Grid
     void DrawGrid();
 
     //Draw Axes
     void DrawAxes();
+
+    //Draw the performance HUD over the scene (paintStart: when paintGL started)
+    void DrawHUD(const std::chrono::steady_clock::time_point paintStart);
 };
 
 #endif // GLWIDGET_H
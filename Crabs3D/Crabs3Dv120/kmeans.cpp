@@ -1,35 +1,32 @@
 #include "kmeans.h"
+#include "profiler.h"
+#include <math.h>
 #include <random>
+#include <vector>
 
-void KMeans::SetCluster(Cloud cloud, int clusterNumber, const int pointSize)
+void KMeans::SetCluster(Cloud cloud, int clusterNumber, const int pointSize, const float* weights)
 {
-    clusterSize = clusterNumber;
-    cluster = new Cluster[clusterNumber];
+    PROFILE_SCOPE("KMeans::SetCluster");
 
-    float *dist;
-    dist = (float*)malloc(clusterNumber*sizeof(float));
-    Centroid *NewCentroids;
-    NewCentroids = (Centroid*)malloc(clusterNumber*sizeof(Centroid));
+    //Mini-Batch mode
+    if(miniBatch) {
+        SetClusterMiniBatch(cloud, clusterNumber, pointSize, weights);
+        return;
+    }
 
-    for(int i = 0; i < clusterNumber; i++) {
-        cluster[i].view = true;
-        cluster[i].pointSize = 1.0;
+    InitClusters(cloud, clusterNumber, pointSize, weights);
 
-        cluster[i].color.red = (rand() % 255) / 255.0;
-        cluster[i].color.green = (rand() % 255) / 255.0;
-        cluster[i].color.blue = (rand() % 255) / 255.0;
-        cluster[i].changeColor = true;
-
-        cluster[i].centroid.x = cloud.x[i];
-        cluster[i].centroid.y = cloud.y[i];
-        cluster[i].centroid.z = cloud.z[i];
-    }
+    Centroid *NewCentroids;
+    NewCentroids = (Centroid*)malloc(clusterNumber*sizeof(Centroid));
+    float *weightSum;
+    weightSum = (float*)malloc(clusterNumber*sizeof(float));
 
-    float mindist;
     int mindist_index;
     int index;
     bool loop = true;
+    lastIterations = 0;
     while (loop) {
+        lastIterations++;
         //Allocate starting memory for cluster cloud
         for(int i = 0; i < clusterNumber; i++) {
             cluster[i].size = 0;
@@ -39,36 +36,25 @@ void KMeans::SetCluster(Cloud cloud, int clusterNumber, const int pointSize)
             cluster[i].cloud.z = (float*)malloc(pointSize*sizeof(float));
             cluster[i].cloud.name = new std::string[pointSize];
         }
+        PROFILE_COUNT(PROFILE_ALLOCATIONS, 5*clusterNumber);
 
-        //Set clouds to clusters
-        for(int i = 0; i < pointSize; i++) {
-            for(int j = 0; j < clusterNumber; j++) {
-                 float dx = (cluster[j].centroid.x  - cloud.x[i]);
-                 float dy = (cluster[j].centroid.y - cloud.y[i]);
-                 float dz = (cluster[j].centroid.z - cloud.z[i]);
-
-                 if(dx < 0) {
-                     dx *= -1;
-                 }
-                 if(dy < 0) {
-                     dy *= -1;
-                 }
-                 if(dz < 0) {
-                     dz *= -1;
-                 }
-
-                dist[j] = dx + dy + dz; //Manhantan distance;
-            }
+        for(int i = 0; i < clusterNumber; i++) {
+            NewCentroids[i].x = 0.0;
+            NewCentroids[i].y = 0.0;
+            NewCentroids[i].z = 0.0;
+            weightSum[i] = 0.0;
+        }
 
-            mindist = dist[0];
-            mindist_index = 0;
+        //Set clouds to clusters (Manhattan distance)
+        //Every point joins a cluster, only the valid ones move its centroid
+        for(int i = 0; i < pointSize; i++) {
+            mindist_index = ClosestCentroidManhattan(cloud.x[i], cloud.y[i], cloud.z[i]);
 
-            for(int j = 1; j < clusterNumber; j++) {
-                if(dist[j] < mindist) {
-                    mindist = dist[j];
-                    mindist_index = j;
-                }
-            }
+            float weight = weights != NULL ? weights[i] : 1.0f;
+            NewCentroids[mindist_index].x += weight*cloud.x[i];
+            NewCentroids[mindist_index].y += weight*cloud.y[i];
+            NewCentroids[mindist_index].z += weight*cloud.z[i];
+            weightSum[mindist_index] += weight;
 
              index = cluster[mindist_index].size;
              cluster[mindist_index].cloud.id[index] = cloud.id[i];
@@ -81,19 +67,15 @@ void KMeans::SetCluster(Cloud cloud, int clusterNumber, const int pointSize)
 
         //Recalculate Centroids
         for(int i = 0; i < clusterNumber; i++) {
-            NewCentroids[i].x = 0.0;
-            NewCentroids[i].y = 0.0;
-            NewCentroids[i].z = 0.0;
-
-            for(int j = 0; j < cluster[i].size; j++) {
-                NewCentroids[i].x += cluster[i].cloud.x[j];
-                NewCentroids[i].y += cluster[i].cloud.y[j];
-                NewCentroids[i].z += cluster[i].cloud.z[j];
+            //A cluster without valid points keeps its centroid
+            if(weightSum[i] == 0) {
+                NewCentroids[i] = cluster[i].centroid;
+                continue;
             }
 
-            NewCentroids[i].x /= cluster[i].size;
-            NewCentroids[i].y /= cluster[i].size;
-            NewCentroids[i].z /= cluster[i].size;
+            NewCentroids[i].x /= weightSum[i];
+            NewCentroids[i].y /= weightSum[i];
+            NewCentroids[i].z /= weightSum[i];
         }
 
         //Check loop conditions
@@ -135,29 +117,368 @@ void KMeans::SetCluster(Cloud cloud, int clusterNumber, const int pointSize)
         }
     }
 
-    std::string nameIndex;
+    SetClusterNames();
+    inertia = Inertia(cloud, pointSize, weights);
+    fitted = true;
+
+    free(NewCentroids);
+    free(weightSum);
+
+}
+
+void KMeans::CleanUp() {
+    if(cluster == NULL)
+        return;
+
+    FreeClusterClouds();
+    for(int i = 0; i < clusterSize; i++)
+        delete[] cluster[i].name;
+
+    delete[] cluster;
+    free(centroidCount);
+
+    cluster = NULL;
+    centroidCount = NULL;
+    clusterSize = 0;
+    fitted = false;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~*/
+/* Mini-Batch KMeans */
+/*~~~~~~~~~~~~~~~~~~~~*/
+
+void KMeans::SetMiniBatchMode(const bool state, const int batch, const int iterations) {
+    miniBatch = state;
+    if(batch > 0)
+        batchSize = batch;
+    if(iterations > 0)
+        maxIterations = iterations;
+}
+
+void KMeans::SetClusterMiniBatch(Cloud cloud, int clusterNumber, const int pointSize, const float* weights) {
+    InitClusters(cloud, clusterNumber, pointSize, weights);
+
+    //There are no points to sample
+    if(pointSize <= 0) {
+        lastIterations = 0;
+        AssignCloud(cloud, pointSize, weights);
+        SetClusterNames();
+        fitted = true;
+        return;
+    }
+
+    //Same seed every time, so the same cloud always gives the same clusters
+    std::mt19937 generator(5489u);
+    std::uniform_int_distribution<int> sample(0, pointSize - 1);
+
+    int batch = batchSize < pointSize ? batchSize : pointSize;
+    int *batchIndex = (int*)malloc(batch*sizeof(int));
+    int *batchCentroid = (int*)malloc(batch*sizeof(int));
+
+    for(int it = 0; it < maxIterations; it++) {
+        //Set the batch points to their closest centroids (centroids are fixed during this step)
+        for(int i = 0; i < batch; i++) {
+            batchIndex[i] = sample(generator);
+            batchCentroid[i] = ClosestCentroid(cloud.x[batchIndex[i]], cloud.y[batchIndex[i]], cloud.z[batchIndex[i]], NULL);
+        }
+
+        //Move each centroid towards its valid points with learning rate 1/count
+        for(int i = 0; i < batch; i++) {
+            if(weights != NULL && weights[batchIndex[i]] == 0)
+                continue;
+
+            int c = batchCentroid[i];
+            float eta = 1.0 / ++centroidCount[c];
+
+            cluster[c].centroid.x += eta * (cloud.x[batchIndex[i]] - cluster[c].centroid.x);
+            cluster[c].centroid.y += eta * (cloud.y[batchIndex[i]] - cluster[c].centroid.y);
+            cluster[c].centroid.z += eta * (cloud.z[batchIndex[i]] - cluster[c].centroid.z);
+        }
+    }
+    lastIterations = maxIterations;
+
+    free(batchIndex);
+    free(batchCentroid);
+
+    AssignCloud(cloud, pointSize, weights);
+    SetClusterNames();
+    fitted = true;
+}
+
+void KMeans::PartialFit(Cloud cloud, int clusterNumber, const int pointSize, const float* weights) {
+    //First call creates the clusters (clusterNumber is ignored after that)
+    if(!fitted)
+        InitClusters(cloud, clusterNumber, pointSize, weights);
+
+    //Stream the cloud through the centroids one batch at a time: the batch is set to the centroids before it,
+    //then each centroid moves once towards the mean of its batch points (learning rate batch count / total count)
+    std::vector<Centroid> sum(clusterSize);
+    std::vector<int> count(clusterSize);
+    for(int start = 0; start < pointSize; start += batchSize) {
+        int end = start + batchSize < pointSize ? start + batchSize : pointSize;
+
+        for(int c = 0; c < clusterSize; c++) {
+            sum[c].x = sum[c].y = sum[c].z = 0.0;
+            count[c] = 0;
+        }
+
+        for(int i = start; i < end; i++) {
+            if(weights != NULL && weights[i] == 0)
+                continue;
+
+            int c = ClosestCentroid(cloud.x[i], cloud.y[i], cloud.z[i], NULL);
+            sum[c].x += cloud.x[i];
+            sum[c].y += cloud.y[i];
+            sum[c].z += cloud.z[i];
+            count[c]++;
+        }
+
+        for(int c = 0; c < clusterSize; c++) {
+            if(count[c] == 0)
+                continue;
+
+            centroidCount[c] += count[c];
+            float eta = (float)count[c] / centroidCount[c];
+
+            cluster[c].centroid.x += eta * (sum[c].x / count[c] - cluster[c].centroid.x);
+            cluster[c].centroid.y += eta * (sum[c].y / count[c] - cluster[c].centroid.y);
+            cluster[c].centroid.z += eta * (sum[c].z / count[c] - cluster[c].centroid.z);
+        }
+    }
+    lastIterations = (pointSize + batchSize - 1) / batchSize;
+
+    //Points of the cluster are the points of the last cloud
+    FreeClusterClouds();
+    AssignCloud(cloud, pointSize, weights);
+    SetClusterNames();
+    fitted = true;
+}
+
+float KMeans::Inertia(Cloud cloud, const int pointSize, const float* weights) {
+    double sum = 0.0;
+    float dist;
+
+    for(int i = 0; i < pointSize; i++) {
+        ClosestCentroid(cloud.x[i], cloud.y[i], cloud.z[i], &dist);
+        sum += weights != NULL ? weights[i]*dist : dist;
+    }
+
+    return (float)sum;
+}
+
+ClusterQuality KMeans::CompareToFullBatch(Cloud cloud, const int pointSize, const float* weights) {
+    ClusterQuality quality;
+    quality.inertia = 0.0;
+    quality.fullInertia = 0.0;
+    quality.relativeError = 0.0;
+    quality.iterations = 0;
+
+    //There is nothing to compare
+    if(!fitted)
+        return quality;
+
+    quality.inertia = Inertia(cloud, pointSize, weights);
+    quality.iterations = lastIterations;
+
+    //Full batch clusters with the same starting centroids
+    KMeans full;
+    full.SetCluster(cloud, clusterSize, pointSize, weights);
+    quality.fullInertia = full.GetInertia();
+    full.CleanUp();
+
+    if(quality.fullInertia > 0)
+        quality.relativeError = (quality.inertia - quality.fullInertia) / quality.fullInertia;
+    else
+        quality.relativeError = 0.0;
+
+    return quality;
+}
+
+void KMeans::RestoreClusters(Cloud cloud, const int clusterNumber, const int pointSize, const Centroid* centroids, const Color* colors,
+                             const int* start, const int* ids, const float* weights) {
+    InitClusters(cloud, clusterNumber, pointSize, weights);
+
+    //Cloud index of every id (ids are unique inside a frame)
+    int maxId = 0;
+    for(int i = 0; i < pointSize; i++) {
+        if(cloud.id[i] > maxId)
+            maxId = cloud.id[i];
+    }
+    std::vector<int> index(maxId + 1, -1);
+    for(int i = 0; i < pointSize; i++) {
+        if(cloud.id[i] >= 0)
+            index[cloud.id[i]] = i;
+    }
+
+    for(int k = 0; k < clusterNumber; k++) {
+        cluster[k].centroid = centroids[k];
+        cluster[k].color = colors[k];
+
+        cluster[k].cloud.id = (int*)malloc(pointSize*sizeof(int));
+        cluster[k].cloud.x = (float*)malloc(pointSize*sizeof(float));
+        cluster[k].cloud.y = (float*)malloc(pointSize*sizeof(float));
+        cluster[k].cloud.z = (float*)malloc(pointSize*sizeof(float));
+        cluster[k].cloud.name = new std::string[pointSize];
+
+        for(int j = start[k]; j < start[k+1]; j++) {
+            int i = ids[j] >= 0 && ids[j] <= maxId ? index[ids[j]] : -1;
+            if(i < 0 || cluster[k].size >= pointSize)
+                continue;
+            int size = cluster[k].size;
+            cluster[k].cloud.id[size] = cloud.id[i];
+            cluster[k].cloud.x[size] = cloud.x[i];
+            cluster[k].cloud.y[size] = cloud.y[i];
+            cluster[k].cloud.z[size] = cloud.z[i];
+            cluster[k].size++;
+        }
+    }
+
+    SetClusterNames();
+    inertia = Inertia(cloud, pointSize, weights);
+    lastIterations = 0;
+    fitted = true;
+}
+
+/***********/
+/* Private */
+/***********/
+
+void KMeans::InitClusters(Cloud cloud, const int clusterNumber, const int pointSize, const float* weights) {
+    CleanUp();
+
+    clusterSize = clusterNumber;
+    cluster = new Cluster[clusterNumber];
+    centroidCount = (int*)malloc(clusterNumber*sizeof(int));
+
+    int next = 0; //next candidate for a starting centroid
     for(int i = 0; i < clusterNumber; i++) {
+        cluster[i].view = true;
+        cluster[i].pointSize = 1.0;
+
+        cluster[i].color.red = (rand() % 255) / 255.0;
+        cluster[i].color.green = (rand() % 255) / 255.0;
+        cluster[i].color.blue = (rand() % 255) / 255.0;
+        cluster[i].changeColor = true;
+
+        //Start from the first valid points of the cloud (there may be fewer points than clusters)
+        while(next < pointSize && weights != NULL && weights[next] == 0)
+            next++;
+        int start = next < pointSize ? next++ : i % (pointSize > 0 ? pointSize : 1);
+        if(pointSize > 0) {
+            cluster[i].centroid.x = cloud.x[start];
+            cluster[i].centroid.y = cloud.y[start];
+            cluster[i].centroid.z = cloud.z[start];
+        } else {
+            cluster[i].centroid.x = 0.0;
+            cluster[i].centroid.y = 0.0;
+            cluster[i].centroid.z = 0.0;
+        }
+
+        cluster[i].name = NULL;
+        cluster[i].size = 0;
+        cluster[i].cloud.id = NULL;
+        cluster[i].cloud.x = NULL;
+        cluster[i].cloud.y = NULL;
+        cluster[i].cloud.z = NULL;
+        cluster[i].cloud.name = NULL;
+
+        centroidCount[i] = 0;
+    }
+}
+
+void KMeans::AssignCloud(Cloud cloud, const int pointSize, const float* weights) {
+    for(int i = 0; i < clusterSize; i++) {
+        cluster[i].size = 0;
+        cluster[i].cloud.id = (int*)malloc(pointSize*sizeof(int));
+        cluster[i].cloud.x = (float*)malloc(pointSize*sizeof(float));
+        cluster[i].cloud.y = (float*)malloc(pointSize*sizeof(float));
+        cluster[i].cloud.z = (float*)malloc(pointSize*sizeof(float));
+        cluster[i].cloud.name = new std::string[pointSize];
+    }
+
+    double sum = 0.0;
+    float dist;
+    for(int i = 0; i < pointSize; i++) {
+        int c = ClosestCentroid(cloud.x[i], cloud.y[i], cloud.z[i], &dist);
+        sum += weights != NULL ? weights[i]*dist : dist;
+
+        int index = cluster[c].size;
+        cluster[c].cloud.id[index] = cloud.id[i];
+        cluster[c].cloud.x[index] = cloud.x[i];
+        cluster[c].cloud.y[index] = cloud.y[i];
+        cluster[c].cloud.z[index] = cloud.z[i];
+        cluster[c].size++;
+    }
+
+    inertia = (float)sum;
+}
+
+void KMeans::FreeClusterClouds() {
+    for(int i = 0; i < clusterSize; i++) {
+        free(cluster[i].cloud.id);
+        free(cluster[i].cloud.x);
+        free(cluster[i].cloud.y);
+        free(cluster[i].cloud.z);
+        delete[] cluster[i].cloud.name;
+
+        cluster[i].cloud.id = NULL;
+        cluster[i].cloud.x = NULL;
+        cluster[i].cloud.y = NULL;
+        cluster[i].cloud.z = NULL;
+        cluster[i].cloud.name = NULL;
+    }
+}
+
+void KMeans::SetClusterNames() {
+    std::string nameIndex;
+    for(int i = 0; i < clusterSize; i++) {
         nameIndex = "Cluster_";
         nameIndex += std::to_string(i);
         nameIndex += " (";
         nameIndex += std::to_string(cluster[i].size);
         nameIndex += ")";
 
-        cluster[i].name = new std::string[1];
+        if(cluster[i].name == NULL)
+            cluster[i].name = new std::string[1];
         cluster[i].name[0] = nameIndex;
     }
+}
 
-    free(dist);
-    free(NewCentroids);
+int KMeans::ClosestCentroidManhattan(const float x, const float y, const float z) {
+    int index = 0;
+    float mindist = -1.0;
 
+    for(int j = 0; j < clusterSize; j++) {
+        float d = fabs(cluster[j].centroid.x - x) + fabs(cluster[j].centroid.y - y) + fabs(cluster[j].centroid.z - z); //Manhantan distance
+
+        if(mindist < 0 || d < mindist) {
+            mindist = d;
+            index = j;
+        }
+    }
+
+    return index;
 }
 
-void KMeans::CleanUp() {
-    for(int i = 0; i < clusterSize; i++) {
-        free(cluster[i].cloud.id);
-        free(cluster[i].cloud.x);
-        free(cluster[i].cloud.y);
-        free(cluster[i].cloud.z);
+int KMeans::ClosestCentroid(const float x, const float y, const float z, float *dist) {
+    int index = 0;
+    float mindist = -1.0;
+
+    for(int j = 0; j < clusterSize; j++) {
+        float dx = cluster[j].centroid.x - x;
+        float dy = cluster[j].centroid.y - y;
+        float dz = cluster[j].centroid.z - z;
+        float d = dx*dx + dy*dy + dz*dz;
+
+        if(mindist < 0 || d < mindist) {
+            mindist = d;
+            index = j;
+        }
     }
+
+    if(dist != NULL)
+        *dist = mindist;
+
+    return index;
 }
 
@@ -40,13 +40,48 @@ struct Cluster
 
 };
 
+struct ClusterQuality
+{
+    float inertia; //Sum of squared distances between the points and their closest centroid
+    float fullInertia; //Inertia of the full batch (Lloyd) KMeans for the same cloud
+    float relativeError; //(inertia - fullInertia) / fullInertia
+    int iterations; //Iterations spent by the mini-batch run
+};
+
 class KMeans
 {
 public:
-    KMeans() {}
-    void SetCluster(Cloud cloud, int clusterNumber, const int pointSize);
+    KMeans() {cluster = NULL; clusterSize = 0; centroidCount = NULL; inertia = 0.0;
+              miniBatch = false; batchSize = 1024; maxIterations = 100; lastIterations = 0; fitted = false;}
+    //weights: 1 for valid and 0 for invalid points (see MarkerGaps::Weights), invalid points don't move the centroids (NULL: all valid)
+    void SetCluster(Cloud cloud, int clusterNumber, const int pointSize, const float* weights = NULL);
     void CleanUp();
 
+    //Mini-Batch KMeans (when state is true SetCluster runs the mini-batch method)
+    void SetMiniBatchMode(const bool state, const int batch, const int iterations);
+    bool IsMiniBatch() {return miniBatch;}
+    int BatchSize() {return batchSize;}
+    int MaxIterations() {return maxIterations;}
+
+    //Create clusters with a fixed number of random mini-batches
+    void SetClusterMiniBatch(Cloud cloud, int clusterNumber, const int pointSize, const float* weights = NULL);
+
+    //Update the clusters with a new cloud (frame) - the first call creates the clusters
+    void PartialFit(Cloud cloud, int clusterNumber, const int pointSize, const float* weights = NULL);
+
+    /* Restore clusters found earlier for the same cloud (see TrialCache) without running KMeans:
+     * centroids and colors of every cluster and the cloud ids of cluster i in ids[start[i] .. start[i+1]-1]
+     */
+    void RestoreClusters(Cloud cloud, const int clusterNumber, const int pointSize, const Centroid* centroids, const Color* colors,
+                         const int* start, const int* ids, const float* weights = NULL);
+
+    //Inertia of the last fit and inertia of a cloud against the current centroids
+    float GetInertia() {return inertia;}
+    float Inertia(Cloud cloud, const int pointSize, const float* weights = NULL);
+
+    //Run a full batch KMeans on the same cloud and compare the inertia of the two methods
+    ClusterQuality CompareToFullBatch(Cloud cloud, const int pointSize, const float* weights = NULL);
+
     Cluster GetCluster(const int index) {return cluster[index];}
     void SetClusterView(const int index, bool state) {cluster[index].view = state;}
     void SetColorValueRed(const int index, const float red) {cluster[index].color.red = red;}
@@ -63,6 +98,33 @@ private:
 
     Cluster *cluster;
     int clusterSize;
+
+    //Mini-Batch
+    bool miniBatch;
+    int batchSize;
+    int maxIterations;
+    int lastIterations;
+    bool fitted;
+    int *centroidCount; //Points seen by each centroid (per-centroid learning rate)
+    float inertia;
+
+    //Set colors, view state and starting centroids (the first clusterNumber valid points)
+    void InitClusters(Cloud cloud, const int clusterNumber, const int pointSize, const float* weights);
+
+    //Allocate the cluster clouds and set every point to its closest centroid (inertia of the valid points)
+    void AssignCloud(Cloud cloud, const int pointSize, const float* weights);
+
+    //Free the cluster clouds
+    void FreeClusterClouds();
+
+    //Set the names of the clusters ("Cluster_i (size)")
+    void SetClusterNames();
+
+    //Return the index of the closest centroid (squared euclidean distance)
+    int ClosestCentroid(const float x, const float y, const float z, float *dist);
+
+    //Return the index of the closest centroid (Manhattan distance, the metric of the full batch KMeans)
+    int ClosestCentroidManhattan(const float x, const float y, const float z);
 };
 
 #endif // KMEANS_H
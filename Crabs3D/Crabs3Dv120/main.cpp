@@ -1,6 +1,8 @@
 #include "main_window.h"
+#include "profiler.h"
 #include <QApplication>
 #include <GL/freeglut.h>
+#include <stdlib.h>
 
 int main(int argc, char *argv[])
 {
@@ -9,5 +11,10 @@ int main(int argc, char *argv[])
     MainWindow w;
     w.show();
 
-    return a.exec();
+    int result = a.exec();
+
+    //Instrumented builds (CONFIG+=profile) write a Chrome trace on exit
+    PROFILE_EXPORT(getenv("CRABS3D_TRACE") != NULL ? getenv("CRABS3D_TRACE") : "crabs3d_trace.json");
+
+    return result;
 }
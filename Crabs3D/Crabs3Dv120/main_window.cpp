@@ -5,10 +5,13 @@
 #include <QDebug>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QListWidgetItem>
 #include <QTime>
 #include <QDir>
 #include <QBrush>
+#include <algorithm>
+#include <climits>
 
 #define ALL_FORMAT "All Files (*.*)"
 #define TXT_FORMAT "Text File (*.txt)"
@@ -98,6 +101,10 @@ void MainWindow::RefreshList() {
     if(ui->ViewWidget->ModelReturn().GetState()) {
         AddToModelList(ui->ViewWidget->ModelReturn(), ui->ModelList, ui->ViewWidget->BoneView());
     }
+    for(int i = 0; i < ui->ViewWidget->ModelsSize(); i++) {
+        Model model = ui->ViewWidget->ModelsReturn(i);
+        AddToModelList(model, ui->ModelList, model.SetBoneViewState());
+    }
 
     if(checkModelExistence) {
         if(modelExists) {
@@ -116,6 +123,24 @@ void MainWindow::RefreshList() {
 /* Private */
 /***********/
 
+//Open a C3D file and add its clusters to the list
+void MainWindow::OpenC3DFile(QString openFilePath, const long long firstFrame, const long long lastFrame, const int stride) {
+    //Check if the file has been read correctly
+    //Read the file and create the point cloud and clusters (or map them from the trial cache)
+    if(ui->ViewWidget->OpenC3D(openFilePath.toUtf8().constData(), this, firstFrame, lastFrame, stride)) {
+
+        //Add items to the list for the fisrt time
+        for(int i=0; i < ui->ViewWidget->GetClusterSize(); i++) {
+            QString name = QString::fromUtf8(ui->ViewWidget->GetCluster().GetCluster(i).name[0].c_str());
+            AddToList(name, ui->ViewWidget->GetCluster().GetCluster(i).color, ui->ClusterList, ui->ViewWidget->GetView(i));
+        }
+        listSize = ui->ViewWidget->GetClusterSize(); //save the size of the list
+        listExists = true; //set the flag
+
+        //QMessageBox::information(this, "Open Successful", "File opening was successful!"); //this option is from a previous version
+    }
+}
+
 //Add Items to list
 void MainWindow::AddToList(QString itemName, Color color,  QListWidget* widget, bool viewState) {
     QListWidgetItem *item = new QListWidgetItem(itemName, widget);
@@ -181,22 +206,85 @@ void MainWindow::on_actionC3D_triggered()
     QString openFilePath = QFileDialog::getOpenFileName(this, "Open", QDir::homePath(), filter, 0, QFileDialog::DontUseNativeDialog);
 
     //Check if the file path isn't null
-    if(openFilePath != nullptr) {
-        //Check if the file has been read correctly
-       if(ui->ViewWidget->ReadC3D(openFilePath.toUtf8().constData(), this)) {
-           ui->ViewWidget->SetCloud(ui->ViewWidget); //Create the point cloud and clusters
-
-           //Add items to the list for the fisrt time
-           for(int i=0; i < ui->ViewWidget->GetClusterSize(); i++) {
-               QString name = QString::fromUtf8(ui->ViewWidget->GetCluster().GetCluster(i).name[0].c_str());
-               AddToList(name, ui->ViewWidget->GetCluster().GetCluster(i).color, ui->ClusterList, ui->ViewWidget->GetView(i));
-           }
-           listSize = ui->ViewWidget->GetClusterSize(); //save the size of the list
-           listExists = true; //set the flag
-
-           //QMessageBox::information(this, "Open Successful", "File opening was successful!"); //this option is from a previous version
-       }
+    if(openFilePath != nullptr)
+        OpenC3DFile(openFilePath);
+}
+
+//Open C3D file from the catalog of a directory -> When triggered
+void MainWindow::on_actionC3D_Catalog_triggered()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, "Catalog", QDir::homePath(), QFileDialog::ShowDirsOnly | QFileDialog::DontUseNativeDialog);
+    if(directory.isEmpty())
+        return ;
+
+    //Index the new and changed files of the directory
+    CatalogUpdate update;
+    if(!catalog.Update(directory.toUtf8().constData(), &update) && catalog.Size() == 0) {
+        QMessageBox::warning(this, "Catalog", "The directory cannot be indexed!");
+        return ;
+    }
+
+    bool ok;
+    QString label = QString("%1 trials (%2 read, %3 unchanged)\n\n"
+                            "Filter: words, subject:name label:name maker:name rate>=Hz rate<=Hz frames>=n frames<=n")
+                    .arg(catalog.Size() - catalog.FailedSize()).arg(update.read - update.failed).arg(update.reused);
+    QString query = QInputDialog::getText(this, "Catalog", label, QLineEdit::Normal, "", &ok);
+    if(!ok)
+        return ;
+
+    std::vector<int> found = catalog.Filter(TrialCatalog::ParseFilter(query.toUtf8().constData()));
+    if(found.empty()) {
+        QMessageBox::information(this, "Catalog", "No trial matches the filter.");
+        return ;
+    }
+
+    //One line per trial: path, frames, rate, subjects
+    QStringList items;
+    for(size_t i = 0; i < found.size(); i++) {
+        const CatalogRecord& record = catalog.Record(found[i]);
+        std::string_view subjects = catalog.Text(record.subjects);
+        items << QString("%1  |  %2 frames  |  %3 Hz  |  %4").arg(QString::fromUtf8(catalog.Path(found[i]).c_str()))
+                 .arg(record.frameSize).arg(record.pointRate).arg(QString::fromUtf8(subjects.data(), (int)subjects.size()).replace('\n', ", "));
     }
+    QString item = QInputDialog::getItem(this, "Catalog", QString("%1 trials").arg(found.size()), items, 0, false, &ok);
+    if(!ok || items.indexOf(item) < 0)
+        return ;
+
+    OpenC3DFile(QString::fromUtf8(catalog.Path(found[items.indexOf(item)]).c_str()));
+}
+
+//Open a frame range of a C3D file -> When triggered
+void MainWindow::on_actionC3D_Frame_Range_triggered()
+{
+    QString filter = C3D_FORMAT;
+    QString openFilePath = QFileDialog::getOpenFileName(this, "Open", QDir::homePath(), filter, 0, QFileDialog::DontUseNativeDialog);
+    if(openFilePath == nullptr)
+        return ;
+
+    //Frame numbers of the file (nothing is decoded yet; the dialogs count in 32 bits)
+    long long trialFirst, trialLast;
+    if(!Read_C3D::ReadFrameRange(openFilePath.toUtf8().constData(), &trialFirst, &trialLast)) {
+        QMessageBox::warning(this, "Frame Range", "The frames of the file cannot be read!");
+        return ;
+    }
+    int fileFirst = (int)std::min(trialFirst, (long long)INT_MAX);
+    int fileLast = (int)std::min(trialLast, (long long)INT_MAX);
+
+    bool ok;
+    int firstFrame = QInputDialog::getInt(this, "Frame Range", QString("First frame (%1 - %2):").arg(fileFirst).arg(fileLast),
+                                          fileFirst, fileFirst, fileLast, 1, &ok);
+    if(!ok)
+        return ;
+    int lastFrame = QInputDialog::getInt(this, "Frame Range", QString("Last frame (%1 - %2):").arg(firstFrame).arg(fileLast),
+                                         std::min(fileLast, firstFrame + OPEN_FRAMES - 1), firstFrame, fileLast, 1, &ok);
+    if(!ok)
+        return ;
+    int stride = QInputDialog::getInt(this, "Frame Range", "Open every n-th frame:", (lastFrame - firstFrame) / OPEN_FRAMES + 1,
+                                      1, std::max(1, lastFrame - firstFrame + 1), 1, &ok);
+    if(!ok)
+        return ;
+
+    OpenC3DFile(openFilePath, firstFrame, lastFrame, stride);
 }
 
 //Velocity Change -> When valueChanged
@@ -269,6 +357,21 @@ void MainWindow::on_actionAnalog_data_TXT_triggered()
     }
 }
 
+//Save the trial to a C3D file -> When triggered
+void MainWindow::on_actionC3D_File_triggered()
+{
+    QString filter = C3D_FORMAT;
+
+    QString openFilePath = QFileDialog::getSaveFileName(this, "Open", QDir::homePath(), filter, 0, QFileDialog::DontUseNativeDialog);
+
+    if(openFilePath != nullptr) {
+        if(ui->ViewWidget->ExportC3D(openFilePath.toUtf8().constData(), ui->ViewWidget->c3d::IsC3D))
+            QMessageBox::information(this, "Export Successful", "File exporting was successful!");
+        else
+            QMessageBox::warning(this, "Export Failed", "The trial cannot be written (its parameters exceed the limits of a C3D file)!");
+    }
+}
+
 //About Info -> When triggered
 void MainWindow::on_actionAbout_Crabs3D_triggered()
 {
@@ -507,6 +610,74 @@ void MainWindow::on_actionYZ_grid_triggered()
     }
 }
 
+void MainWindow::on_actionForce_Plates_triggered()
+{
+    ui->ViewWidget->SetForcePlateView(ui->ViewWidget, ui->actionForce_Plates->isChecked());
+}
+
+void MainWindow::on_actionTrails_triggered()
+{
+    ui->ViewWidget->SetTrailView(ui->ViewWidget, ui->actionTrails->isChecked());
+}
+
+void MainWindow::on_actionTrail_Length_triggered()
+{
+    bool ok;
+    int length = QInputDialog::getInt(this, "Trails", "Frames per trail:", ui->ViewWidget->GetTrailLength(), 2, 100000, 10, &ok);
+    if(ok)
+        ui->ViewWidget->SetTrailLength(ui->ViewWidget, length);
+}
+
+void MainWindow::on_actionPerformance_HUD_triggered()
+{
+    ui->ViewWidget->SetHUDView(ui->ViewWidget, ui->actionPerformance_HUD->isChecked());
+}
+
+void MainWindow::on_actionPrevious_Event_triggered()
+{
+    ui->ViewWidget->SeekEvent(ui->ViewWidget, -1);
+}
+
+void MainWindow::on_actionNext_Event_triggered()
+{
+    ui->ViewWidget->SeekEvent(ui->ViewWidget, 1);
+}
+
+//Filter the marker trajectories (the last filter is replaced, "None" restores the recorded trajectories)
+void MainWindow::on_actionFilter_Trajectories_triggered()
+{
+    bool ok;
+    QStringList methods;
+    methods << "None" << "Butterworth" << "Savitzky-Golay";
+
+    FilterOptions options = FILTER_DEFAULT_OPTIONS;
+    TrajectoryFilter* filter = ui->ViewWidget->GetTrajectoryFilter();
+    if(filter != NULL)
+        options = filter->Options();
+
+    QString method = QInputDialog::getItem(this, "Filter Trajectories", "Method:", methods, options.method, false, &ok);
+    if(!ok)
+        return;
+    options.method = methods.indexOf(method);
+
+    if(options.method == FILTER_BUTTERWORTH) {
+        options.cutoff = QInputDialog::getDouble(this, "Filter Trajectories", "Cutoff frequency (Hz):", options.cutoff, 0.1, 1000, 2, &ok);
+        if(!ok)
+            return;
+    } else if(options.method == FILTER_SAVITZKY_GOLAY) {
+        options.window = QInputDialog::getInt(this, "Filter Trajectories", "Window (frames, odd):", options.window, 3, 1001, 2, &ok);
+        if(!ok)
+            return;
+        //Degree 2 at least, so the acceleration is a Savitzky-Golay derivative too
+        options.polynomial = QInputDialog::getInt(this, "Filter Trajectories", "Polynomial degree:", options.polynomial, 2, options.window - 1, 1, &ok);
+        if(!ok)
+            return;
+    }
+
+    if(!ui->ViewWidget->FilterTrajectories(ui->ViewWidget, options))
+        QMessageBox::warning(this, "Filter Trajectories", "The trajectories cannot be filtered (open a C3D file first)!");
+}
+
 //Show XY grid
 void MainWindow::on_XY_CheckBox_stateChanged(int arg1)
 {
@@ -557,6 +728,18 @@ void MainWindow::on_actionCreate_Bones_triggered()
     ui->ViewWidget->CreateBones(ui->ViewWidget);
 }
 
+//Create a Model for every cluster -> When triggered
+void MainWindow::on_actionModels_From_Clusters_triggered()
+{
+    ui->ViewWidget->CreateModelsFromClusters(ui->ViewWidget);
+}
+
+//Create a Model for every subject -> When triggered
+void MainWindow::on_actionModels_From_Subjects_triggered()
+{
+    ui->ViewWidget->CreateModelsFromSubjects(ui->ViewWidget);
+}
+
 void MainWindow::on_ModelList_itemChanged(QListWidgetItem *item)
 {
     bool state;
@@ -568,5 +751,13 @@ void MainWindow::on_ModelList_itemChanged(QListWidgetItem *item)
         state = true; //set state to true
     }
 
-    ui->ViewWidget->SetBoneViewState(ui->ViewWidget, state);
+    //The first row is the created Model (if any), then the Model collection
+    int row = ui->ModelList->row(item);
+    int offset = ui->ViewWidget->ModelReturn().GetState() ? 1 : 0;
+
+    if(row < offset) {
+        ui->ViewWidget->SetBoneViewState(ui->ViewWidget, state);
+    } else {
+        ui->ViewWidget->SetModelViewState(ui->ViewWidget, row - offset, state);
+    }
 }
@@ -11,6 +11,7 @@
 #include "cluster_options.h"
 #include "unit_dialog.h"
 #include "set_bones.h"
+#include "trial_catalog.h"
 
 namespace Ui {
 class MainWindow;
@@ -42,6 +43,9 @@ private:
     //Add Items to Model list
     void AddToModelList(Model model, QListWidget* widget, bool viewState);
 
+    //Open a C3D file (or a frame range of it, see GLWidget::OpenC3D) and list its clusters
+    void OpenC3DFile(QString openFilePath, const long long firstFrame = 0, const long long lastFrame = 0, const int stride = 1);
+
     Ui::MainWindow *ui;
 
     //Timer
@@ -55,6 +59,9 @@ private:
     UnitDialog* unitDialog;
     SetBones* setBones;
 
+    //Metadata of the C3D files of a directory
+    TrialCatalog catalog;
+
     bool listExists;
     bool modelExists;
     bool boneExists;
@@ -69,6 +76,12 @@ private slots:
     //Open C3D file -> When triggered
     void on_actionC3D_triggered();
 
+    //Find a C3D file in the catalog of a directory and open it -> When triggered
+    void on_actionC3D_Catalog_triggered();
+
+    //Open a frame range of a C3D file (every frame, or a stride of a long trial) -> When triggered
+    void on_actionC3D_Frame_Range_triggered();
+
     //Velocity Change -> When valueChanged
     void on_horizontalSlider_valueChanged(int value);
 
@@ -90,6 +103,9 @@ private slots:
     //Save C3D Header section to CSV -> When triggered
     void on_actionAnalog_data_TXT_triggered();
 
+    //Save the trial to a C3D file -> When triggered
+    void on_actionC3D_File_triggered();
+
     //About Info -> When triggered
     void on_actionAbout_Crabs3D_triggered();
 
@@ -165,6 +181,27 @@ private slots:
     //Show YZ grid
     void on_actionYZ_grid_triggered();
 
+    //Show force plates
+    void on_actionForce_Plates_triggered();
+
+    //Show the marker trails
+    void on_actionTrails_triggered();
+
+    //Set the number of frames of the trails
+    void on_actionTrail_Length_triggered();
+
+    //Show the performance HUD
+    void on_actionPerformance_HUD_triggered();
+
+    //Go to the previous event of the trial
+    void on_actionPrevious_Event_triggered();
+
+    //Go to the next event of the trial
+    void on_actionNext_Event_triggered();
+
+    //Filter the marker trajectories -> When triggered
+    void on_actionFilter_Trajectories_triggered();
+
     //Show XY grid
     void on_XY_CheckBox_stateChanged(int arg1);
 
@@ -182,6 +219,13 @@ private slots:
 
     //Create Bones -> When triggered
     void on_actionCreate_Bones_triggered();
+
+    //Create a Model for every cluster -> When triggered
+    void on_actionModels_From_Clusters_triggered();
+
+    //Create a Model for every subject -> When triggered
+    void on_actionModels_From_Subjects_triggered();
+
     void on_ModelList_itemChanged(QListWidgetItem *item);
 };
 
@@ -0,0 +1,170 @@
+#include "marker_gaps.h"
+#include <vector>
+
+/**********/
+/* Public */
+/**********/
+
+void MarkerGaps::Analyse(MarkerGaps* gaps, Data_c3d data, const int frameSize, const int pointSize) {
+    CleanUp(gaps);
+
+    gaps->frameSize = frameSize > 0 ? frameSize : 0;
+    gaps->pointSize = pointSize > 0 ? pointSize : 0;
+    gaps->weights = (float*)malloc(((size_t)gaps->frameSize*gaps->pointSize + 1)*sizeof(float));
+    gaps->intervalStart = (int*)malloc((gaps->pointSize + 1)*sizeof(int));
+
+    float* weights = gaps->weights;
+    const int points = gaps->pointSize;
+    const int frames = gaps->frameSize;
+
+    //Valid samples of every frame
+    #pragma omp parallel for
+    for(int f = 0; f < frames; f++) {
+        Frames_C3D frame = data.Frame(f);
+        for(int p = 0; p < points; p++)
+            weights[(size_t)f*points + p] = frame.Point(p).IsValid() ? 1.0 : 0.0;
+    }
+
+    //Valid intervals of every marker
+    std::vector<std::vector<GapInterval>> lists(points);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int p = 0; p < points; p++) {
+        int first = -1;
+        for(int f = 0; f <= frames; f++) {
+            bool valid = f < frames && weights[(size_t)f*points + p] > 0;
+            if(valid && first < 0)
+                first = f;
+            else if(!valid && first >= 0) {
+                lists[p].push_back({first, f - 1});
+                first = -1;
+            }
+        }
+    }
+
+    int size = 0;
+    for(int p = 0; p < points; p++) {
+        gaps->intervalStart[p] = size;
+        size += (int)lists[p].size();
+    }
+    gaps->intervalStart[points] = size;
+
+    gaps->intervals = (GapInterval*)malloc((size + 1)*sizeof(GapInterval));
+    for(int p = 0; p < points; p++)
+        for(size_t i = 0; i < lists[p].size(); i++)
+            gaps->intervals[gaps->intervalStart[p] + i] = lists[p][i];
+}
+
+int MarkerGaps::Fill(MarkerGaps* gaps, Data_c3d data, const int maxGap, const int method) {
+    if(maxGap <= 0 || gaps->intervals == NULL)
+        return 0;
+
+    int filled = 0;
+    const int points = gaps->pointSize;
+
+    //Markers are independent (every marker writes only its own samples)
+    #pragma omp parallel for schedule(dynamic) reduction(+:filled)
+    for(int p = 0; p < points; p++)
+        filled += FillPoint(gaps, &data, p, maxGap, method);
+
+    if(filled > 0)
+        Analyse(gaps, data, gaps->frameSize, gaps->pointSize);
+
+    return filled;
+}
+
+int MarkerGaps::ValidFrames(const int point) {
+    int size = 0;
+    for(int i = intervalStart[point]; i < intervalStart[point+1]; i++)
+        size += intervals[i].last - intervals[i].first + 1;
+    return size;
+}
+
+bool MarkerGaps::IsValid(const int point, const int frame) {
+    int low = intervalStart[point];
+    int high = intervalStart[point+1] - 1;
+    while(low <= high) {
+        int middle = (low + high) / 2;
+        if(frame < intervals[middle].first)
+            high = middle - 1;
+        else if(frame > intervals[middle].last)
+            low = middle + 1;
+        else
+            return true;
+    }
+    return false;
+}
+
+void MarkerGaps::CleanUp(MarkerGaps* gaps) {
+    free(gaps->intervalStart);
+    free(gaps->intervals);
+    free(gaps->weights);
+
+    gaps->intervalStart = NULL;
+    gaps->intervals = NULL;
+    gaps->weights = NULL;
+    gaps->pointSize = 0;
+    gaps->frameSize = 0;
+}
+
+/***********/
+/* Private */
+/***********/
+
+int MarkerGaps::FillPoint(MarkerGaps* gaps, Data_c3d* data, const int point, const int maxGap, const int method) {
+    int filled = 0;
+    std::vector<float> out[3];
+
+    for(int k = gaps->intervalStart[point]; k < gaps->intervalStart[point+1] - 1; k++) {
+        GapInterval before = gaps->intervals[k];
+        GapInterval after = gaps->intervals[k+1];
+        const int a = before.last;
+        const int b = after.first;
+        const int gap = b - a - 1;
+        if(gap <= 0 || gap > maxGap)
+            continue;
+
+        Points_C3D pa = data->Frame(a).Point(point);
+        Points_C3D pb = data->Frame(b).Point(point);
+        const float h = b - a;
+        float p0[3] = {pa.X(), pa.Y(), pa.Z()};
+        float p1[3] = {pb.X(), pb.Y(), pb.Z()};
+
+        //Slopes (per frame) at both sides: the slope of the gap for linear filling (or without a second sample)
+        float v0[3], v1[3];
+        for(int i = 0; i < 3; i++)
+            v0[i] = v1[i] = (p1[i] - p0[i]) / h;
+        if(method == GAP_FILL_SPLINE && a - 1 >= before.first) {
+            Points_C3D q = data->Frame(a-1).Point(point);
+            v0[0] = p0[0] - q.X(); v0[1] = p0[1] - q.Y(); v0[2] = p0[2] - q.Z();
+        }
+        if(method == GAP_FILL_SPLINE && b + 1 <= after.last) {
+            Points_C3D q = data->Frame(b+1).Point(point);
+            v1[0] = q.X() - p1[0]; v1[1] = q.Y() - p1[1]; v1[2] = q.Z() - p1[2];
+        }
+
+        //Cubic Hermite curve between the two samples (a line when the slopes are the slope of the gap)
+        for(int i = 0; i < 3; i++) {
+            out[i].resize(gap);
+            float* values = out[i].data();
+            const float y0 = p0[i], y1 = p1[i], m0 = v0[i]*h, m1 = v1[i]*h;
+
+            #pragma omp simd
+            for(int s = 0; s < gap; s++) {
+                float t = (s + 1) / h;
+                float t2 = t*t;
+                float t3 = t2*t;
+                values[s] = (2*t3 - 3*t2 + 1)*y0 + (t3 - 2*t2 + t)*m0 + (-2*t3 + 3*t2)*y1 + (t3 - t2)*m1;
+            }
+        }
+
+        for(int s = 0; s < gap; s++) {
+            Points_C3D* target = data->Frame(a + 1 + s).PointPointer(point);
+            target->SetPoint(target, out[0][s], out[1][s], out[2][s], 0.0, 0.0);
+        }
+
+        filled += gap;
+    }
+
+    return filled;
+}
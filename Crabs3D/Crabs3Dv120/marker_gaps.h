@@ -0,0 +1,69 @@
+#ifndef MARKER_GAPS_H
+#define MARKER_GAPS_H
+
+#include "read_c3d.h"
+
+//Gap filling methods
+#define GAP_FILL_LINEAR 0
+#define GAP_FILL_SPLINE 1 //cubic Hermite spline (velocity of the samples next to the gap)
+
+//Frames [first, last] of a marker with valid samples
+struct GapInterval {
+    int first;
+    int last;
+};
+
+/* Valid intervals of every marker of a trial (invalid samples have a negative residual).
+ * Weights() gives 1 for valid and 0 for invalid samples, so sums over the markers of a frame
+ * can skip the invalid ones without branches.
+ */
+class MarkerGaps
+{
+public:
+    MarkerGaps() {pointSize = 0; frameSize = 0; intervalStart = NULL; intervals = NULL; weights = NULL;}
+
+    //Build the valid intervals of every marker
+    void Analyse(MarkerGaps* gaps, Data_c3d data, const int frameSize, const int pointSize);
+
+    /* Interpolate every gap of maxGap frames or less that has valid samples on both sides
+     * and analyse the trial again. Filled samples get residual 0 (interpolated).
+     * Returns the number of filled samples.
+     */
+    int Fill(MarkerGaps* gaps, Data_c3d data, const int maxGap, const int method = GAP_FILL_SPLINE);
+
+    //Return the number of markers
+    int PointSize() {return pointSize;}
+
+    //Return the number of frames
+    int FrameSize() {return frameSize;}
+
+    //Return the number of valid intervals of a marker
+    int IntervalSize(const int point) {return intervalStart[point+1] - intervalStart[point];}
+
+    //Return a valid interval of a marker
+    GapInterval Interval(const int point, const int index) {return intervals[intervalStart[point] + index];}
+
+    //Return the number of valid frames of a marker
+    int ValidFrames(const int point);
+
+    //Return true if the sample of a marker is valid (binary search of the intervals)
+    bool IsValid(const int point, const int frame);
+
+    //Return the weights of a frame (PointSize() values: 1 valid, 0 invalid)
+    const float* Weights(const int frame) {return &weights[(size_t)frame*pointSize];}
+
+    //Clean Memory
+    void CleanUp(MarkerGaps* gaps);
+
+private:
+    int pointSize;
+    int frameSize;
+    int* intervalStart; //first interval of every marker (pointSize + 1 values)
+    GapInterval* intervals;
+    float* weights;     //frame-major (frameSize * pointSize)
+
+    //Interpolate the gaps of one marker (returns the number of filled samples)
+    static int FillPoint(MarkerGaps* gaps, Data_c3d* data, const int point, const int maxGap, const int method);
+};
+
+#endif // MARKER_GAPS_H
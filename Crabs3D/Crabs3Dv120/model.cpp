@@ -1,5 +1,7 @@
 #include "model.h"
+#include "profiler.h"
 #include "math.h"
+#include <string.h>
 
 Model::Model()
 {
@@ -10,7 +12,9 @@ Model::Model()
     modelInfo.color.green = 0;
     modelInfo.color.blue = 0;
 
-    bones.state = false;
+    bones.viewState = false;
+    CleanUpBones(this);
+    rigidityThreshold = 0.05; //5% of the mean bone length
 }
 
 Model::~Model()
@@ -19,112 +23,262 @@ Model::~Model()
 }
 
 void Model::CreateModelFromCluster(const Cluster cluster, const Cloud cloud[], const int pointCloudFrameSize, const int pointCloudPointSize, Model *model) {
+    model->CreateModelFromCluster(cluster, CreateFrameStore(cloud, pointCloudFrameSize, pointCloudPointSize), model);
+}
 
-    //Allocate memory for Bones
-    model->bones.boneSize = cluster.size;
-    model->bones.pointSize = cluster.size;
-    model->bones.bones = (Connections*) malloc(model->bones.boneSize*sizeof(Connections));
-    model->bones.points = (BonePoints*) malloc(pointCloudFrameSize*sizeof(BonePoints));
+void Model::CreateModelFromCluster(const Cluster cluster, const FrameStore frames, Model *model, const float* weights) {
+    PROFILE_SCOPE("Model::CreateModelFromCluster");
+    PROFILE_COUNT(PROFILE_ALLOCATIONS, 7); //id map, marker columns, x/y/z columns, pair statistics, arena
 
-    for(register int i = 0; i <  model->bones.boneSize; i++) {
-        model->bones.bones[i].idNewConnections = (int*)malloc((model->bones.boneSize - 1)*sizeof(int));
-        model->bones.bones[i].idPrevConnections = (int*)malloc((model->bones.boneSize - 1)*sizeof(int));
+    //Drop the previous bones (the arena is freed when no copy uses it)
+    model->CleanUpBones(model);
 
-        model->bones.bones[i].newConnectionsSize = 0;
-        model->bones.bones[i].prevConnectionsSize = 0;
+    //Map cluster ids to store columns (ids are unique inside a frame)
+    int maxId = 0;
+    for(int j = 0; j < frames.pointSize; j++) {
+        if(frames.id[j] > maxId)
+            maxId = frames.id[j];
+    }
+    int* idColumn = (int*)malloc((maxId+1)*sizeof(int));
+    for(int j = 0; j <= maxId; j++)
+        idColumn[j] = -1;
+    for(int j = 0; j < frames.pointSize; j++) {
+        if(frames.id[j] >= 0)
+            idColumn[frames.id[j]] = j;
     }
 
-    for(register int i = 0; i < pointCloudFrameSize; i++) {
-        model->bones.points[i].id = (int*)malloc(model->bones.boneSize*sizeof(int));
-        model->bones.points[i].x = (float*)malloc(model->bones.boneSize*sizeof(float));
-        model->bones.points[i].y = (float*)malloc(model->bones.boneSize*sizeof(float));
-        model->bones.points[i].z = (float*)malloc(model->bones.boneSize*sizeof(float));
+    //Keep the cluster markers that exist in the store
+    int* markerColumn = (int*)malloc((cluster.size > 0 ? cluster.size : 1)*sizeof(int));
+    int markerSize = 0;
+    for(int i = 0; i < cluster.size; i++) {
+        int id = cluster.cloud.id[i];
+        if(id >= 0 && id <= maxId && idColumn[id] >= 0)
+            markerColumn[markerSize++] = idColumn[id];
     }
+    free(idColumn);
 
-    //Create Bones
-    int accIndex = 0;
-    int accuracy = (85*((pointCloudFrameSize/4))) / 100;
-    float dist1 = 0;
-    float dist2;
-
-    for(register int i = 0; i < model->bones.boneSize; i++) {
-        for(register int j = 0; j < pointCloudPointSize; j++) {
-            if(cluster.cloud.id[i] == cloud[0].id[j]) {
-                for(register int k = 0; k < pointCloudFrameSize; k++) {
-                    model->bones.points[k].id[i] = cloud[k].id[j];
-                    model->bones.points[k].x[i] = cloud[k].x[j];
-                    model->bones.points[k].y[i] = cloud[k].y[j];
-                    model->bones.points[k].z[i] = cloud[k].z[j];
-                }
-            }
+    //Copy the markers marker-major for the pair statistics (scratch only)
+    int frameSize = frames.frameSize;
+    int pointSize = frames.pointSize;
+    float* columnX = (float*)malloc(((size_t)markerSize*frameSize + 1)*sizeof(float));
+    float* columnY = (float*)malloc(((size_t)markerSize*frameSize + 1)*sizeof(float));
+    float* columnZ = (float*)malloc(((size_t)markerSize*frameSize + 1)*sizeof(float));
+    float* columnW = weights != NULL ? (float*)malloc(((size_t)markerSize*frameSize + 1)*sizeof(float)) : NULL;
+
+    for(int k = 0; k < frameSize; k++) {
+        const float* frame = &frames.positions[(size_t)k*pointSize*3];
+        for(int i = 0; i < markerSize; i++) {
+            size_t index = (size_t)i*frameSize + k;
+            columnX[index] = frame[markerColumn[i]*3 + 0];
+            columnY[index] = frame[markerColumn[i]*3 + 1];
+            columnZ[index] = frame[markerColumn[i]*3 + 2];
+            if(columnW != NULL)
+                columnW[index] = weights[(size_t)k*pointSize + markerColumn[i]];
         }
     }
 
-    //Loop through model
-    for(register int modelIndex = 0; modelIndex < model->bones.boneSize; modelIndex++) {
-        model->bones.bones[modelIndex].idBase = cluster.cloud.id[modelIndex];
-
-        for(register int clusterIndex = modelIndex + 1; clusterIndex < cluster.size; clusterIndex++) {
-            //Loop through PointCloud points
-            for(register int pointIndex = 0; pointIndex < pointCloudPointSize; pointIndex++) {
-                if(cluster.cloud.id[clusterIndex] == cloud[0].id[pointIndex]) {
-
-                    //Loop through the next points
-                    for(register int pointIndex2 = pointIndex+1; pointIndex2 < pointCloudPointSize; pointIndex2++) {
-                        float dx1 = cloud[0].x[pointIndex2] - cloud[0].x[modelIndex];
-                        float dy1 = cloud[0].y[pointIndex2] - cloud[0].y[modelIndex];
-                        float dz1 = cloud[0].z[pointIndex2] - cloud[0].z[modelIndex];
-
-                        dist1 = dx1*dx1 + dy1*dy1 + dz1*dz1;
-
-                        //Loop through PointCloud frames
-                        accIndex = 1;
-                        int frameMax = pointCloudFrameSize;
-                        for(register int cloudFrame = 1; cloudFrame < frameMax; cloudFrame+=2) {
-                            float dx2 = cloud[cloudFrame].x[pointIndex2] - cloud[cloudFrame].x[pointIndex];
-                            float dy2 = cloud[cloudFrame].y[pointIndex2] - cloud[cloudFrame].y[pointIndex];
-                            float dz2 = cloud[cloudFrame].z[pointIndex2] - cloud[cloudFrame].z[pointIndex];
-
-                            dist2 = dx2*dx2 + dy2*dy2 + dz2*dz2;
-                            float dist = dist2 - dist1;
-                            if(dist < 0) {
-                                dist *= -1;
-                             }
-                            if(dist < 0.003) {
-                                accIndex++;
-                            }
-                        }
-                        if(accIndex > accuracy) {
-                            model->bones.bones[modelIndex].idNewConnections[model->bones.bones[modelIndex].newConnectionsSize++] = cloud[0].id[pointIndex2];
-                            model->bones.bones[modelIndex].idPrevConnections[model->bones.bones[modelIndex].prevConnectionsSize++] = cloud[0].id[pointIndex];
-                        }
-                    }
-                }
-             }
+    //Distance mean/variance of every pair
+    int pairSize = markerSize*(markerSize-1)/2;
+    PairStatistics* stats = (PairStatistics*)malloc((pairSize > 0 ? pairSize : 1)*sizeof(PairStatistics));
+    ComputePairStatistics(columnX, columnY, columnZ, markerSize, frameSize, stats, columnW);
+
+    free(columnX);
+    free(columnY);
+    free(columnZ);
+    free(columnW);
+
+    //A pair is a bone if its distance is (almost) constant
+    int edgeSize = 0;
+    for(int p = 0; p < pairSize; p++) {
+        bool rigid = false;
+        if(stats[p].mean > 0)
+            rigid = sqrt(stats[p].variance) / stats[p].mean < model->rigidityThreshold;
+
+        //Keep only the bones at the front of stats (pairs are sorted by a, then b)
+        if(rigid)
+            stats[edgeSize++] = stats[p];
+    }
+
+    //One arena for every array of the model
+    model->AllocateBones(model, frames, markerSize, edgeSize);
+
+    //Ids and columns
+    for(int i = 0; i < markerSize; i++) {
+        model->bones.id[i] = frames.id[markerColumn[i]];
+        model->bones.column[i] = markerColumn[i];
+    }
+
+    //CSR adjacency (bones are already grouped by their first marker)
+    int edge = 0;
+    for(int i = 0; i < markerSize; i++) {
+        model->bones.offsets[i] = edge;
+        while(edge < edgeSize && stats[edge].a == i) {
+            model->bones.neighbors[edge] = stats[edge].b;
+            edge++;
         }
-     }
+    }
+    model->bones.offsets[markerSize] = edge;
+
+    free(stats);
+    free(markerColumn);
 
     model->bones.state = true;
 
 }
 
-void Model::CleanUpBones(Model* model) {
-    if(model->bones.state) {
-        for(int i = 0; i < model->bones.boneSize; i++) {
-            free(model->bones.bones[i].idNewConnections);
-            free(model->bones.bones[i].idPrevConnections);
+void Model::RestoreBones(const FrameStore frames, const int boneSize, const int* column, const int edgeSize, const int* offsets, const int* neighbors, Model* model) {
+    model->CleanUpBones(model);
+    model->AllocateBones(model, frames, boneSize, edgeSize);
+
+    for(int i = 0; i < boneSize; i++) {
+        model->bones.id[i] = frames.id[column[i]];
+        model->bones.column[i] = column[i];
+    }
+    memcpy(model->bones.offsets, offsets, (boneSize + 1)*sizeof(int));
+    memcpy(model->bones.neighbors, neighbors, edgeSize*sizeof(int));
+
+    model->bones.state = true;
+}
+
+FrameStore Model::CreateFrameStore(const Cloud cloud[], const int frameSize, const int pointSize) {
+    PROFILE_SCOPE("Model::CreateFrameStore");
+    PROFILE_COUNT(PROFILE_ALLOCATIONS, 1);
+
+    FrameStore frames;
+    frames.frameSize = frameSize;
+    frames.pointSize = pointSize;
+
+    size_t idBytes = (size_t)pointSize*sizeof(int);
+    size_t positionBytes = (size_t)frameSize*pointSize*3*sizeof(float);
+
+    //Floats first, so both arrays are aligned
+    char* block = new char[positionBytes + idBytes];
+    frames.arena = std::shared_ptr<char>(block, std::default_delete<char[]>());
+    frames.positions = (float*)block;
+    frames.id = (int*)(block + positionBytes);
+
+    for(int j = 0; j < pointSize; j++)
+        frames.id[j] = cloud[0].id[j];
+
+    for(int k = 0; k < frameSize; k++) {
+        float* frame = &frames.positions[(size_t)k*pointSize*3];
+        for(int j = 0; j < pointSize; j++) {
+            frame[j*3 + 0] = cloud[k].x[j];
+            frame[j*3 + 1] = cloud[k].y[j];
+            frame[j*3 + 2] = cloud[k].z[j];
         }
-        for(int i = 0; i < model->bones.pointSize; i++) {
-            free(model->bones.points[i].id);
-            free(model->bones.points[i].x);
-            free(model->bones.points[i].y);
-            free(model->bones.points[i].z);
+    }
+
+    return frames;
+}
+
+void Model::ComputePairStatistics(const float* x, const float* y, const float* z, const int pointSize, const int frameSize, PairStatistics* stats,
+                                  const float* valid) {
+    PROFILE_SCOPE("Pair statistics");
+
+    //Pair list (a < b)
+    int pairSize = 0;
+    for(int a = 0; a < pointSize; a++) {
+        for(int b = a + 1; b < pointSize; b++) {
+            stats[pairSize].a = a;
+            stats[pairSize].b = b;
+            pairSize++;
+        }
+    }
+
+    //Pairs are independent - each one streams its two columns once
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int p = 0; p < pairSize; p++) {
+        const float* xa = x + (size_t)stats[p].a*frameSize;
+        const float* ya = y + (size_t)stats[p].a*frameSize;
+        const float* za = z + (size_t)stats[p].a*frameSize;
+        const float* xb = x + (size_t)stats[p].b*frameSize;
+        const float* yb = y + (size_t)stats[p].b*frameSize;
+        const float* zb = z + (size_t)stats[p].b*frameSize;
+
+        double sum = 0.0;
+        double sumSq = 0.0;
+        double count = frameSize;
+
+        if(valid == NULL) {
+            #pragma omp simd reduction(+:sum,sumSq)
+            for(int f = 0; f < frameSize; f++) {
+                float dx = xb[f] - xa[f];
+                float dy = yb[f] - ya[f];
+                float dz = zb[f] - za[f];
+                float dist = sqrtf(dx*dx + dy*dy + dz*dz);
+
+                sum += dist;
+                sumSq += (double)dist*dist;
+            }
+        } else {
+            //Both markers must be valid (weights are 0 or 1, so the product keeps a frame or drops it)
+            const float* wa = valid + (size_t)stats[p].a*frameSize;
+            const float* wb = valid + (size_t)stats[p].b*frameSize;
+            count = 0.0;
+
+            #pragma omp simd reduction(+:sum,sumSq,count)
+            for(int f = 0; f < frameSize; f++) {
+                float dx = xb[f] - xa[f];
+                float dy = yb[f] - ya[f];
+                float dz = zb[f] - za[f];
+                float dist = sqrtf(dx*dx + dy*dy + dz*dz);
+                float weight = wa[f]*wb[f];
+
+                sum += weight*dist;
+                sumSq += (double)weight*dist*dist;
+                count += weight;
+            }
         }
 
-        free(model->bones.bones);
-        free(model->bones.points);
+        double mean = count > 0 ? sum / count : 0.0;
+        double variance = count > 0 ? sumSq / count - mean*mean : 0.0;
+
+        stats[p].mean = (float)mean;
+        stats[p].variance = variance > 0 ? (float)variance : 0.0f;
     }
 }
 
+void Model::AllocateBones(Model* model, const FrameStore frames, const int boneSize, const int edgeSize) {
+    size_t idBytes = (size_t)boneSize*sizeof(int);
+    size_t columnBytes = (size_t)boneSize*sizeof(int);
+    size_t offsetBytes = (size_t)(boneSize+1)*sizeof(int);
+    size_t neighborBytes = (size_t)edgeSize*sizeof(int);
+
+    char* block = new char[idBytes + columnBytes + offsetBytes + neighborBytes];
+    model->bones.arena = std::shared_ptr<char>(block, std::default_delete<char[]>());
+
+    model->bones.id = (int*)block;
+    model->bones.column = (int*)(block + idBytes);
+    model->bones.offsets = (int*)(block + idBytes + columnBytes);
+    model->bones.neighbors = (int*)(block + idBytes + columnBytes + offsetBytes);
 
+    model->bones.boneSize = boneSize;
+    model->bones.edgeSize = edgeSize;
+    model->bones.frames = frames;
+}
+
+void Model::SetBoneFrames(const FrameStore frames, Model* model) {
+    if(model->bones.state && model->bones.frames.pointSize == frames.pointSize)
+        model->bones.frames = frames;
+}
 
+void Model::CleanUpBones(Model* model) {
+    model->bones.arena.reset();
+
+    model->bones.frames.arena.reset();
+
+    model->bones.boneSize = 0;
+    model->bones.edgeSize = 0;
+    model->bones.id = NULL;
+    model->bones.column = NULL;
+    model->bones.offsets = NULL;
+    model->bones.neighbors = NULL;
+
+    model->bones.frames.frameSize = 0;
+    model->bones.frames.pointSize = 0;
+    model->bones.frames.id = NULL;
+    model->bones.frames.positions = NULL;
+
+    model->bones.state = false;
+}
@@ -2,6 +2,7 @@
 #define MODEL_H
 
 #include <iostream>
+#include <memory>
 
 #include "kmeans.h"
 
@@ -11,30 +12,39 @@ struct ModelColor {
     int blue;
 };
 
-struct Connections {
-    int idBase;
+/* Positions of every point of a trial, shared by all the models of the trial.
+ * The models keep only the columns of their markers, so N models cost one copy of the trial.
+ * Copies of the store share the block (the last copy frees it).
+ */
+struct FrameStore {
+    int frameSize; //Number of frames
+    int pointSize; //Number of points per frame
 
-    int newConnectionsSize;
-    int* idNewConnections;
+    int* id; //[pointSize] cloud id of each column
+    float* positions; //[frameSize*pointSize*3] frame-major x,y,z
 
-    int prevConnectionsSize;
-    int* idPrevConnections;
-};
-
-struct BonePoints {
-    int* id;
-    float* x;
-    float* y;
-    float* z;
+    std::shared_ptr<char> arena;
 };
 
+/* Bone graph of a model.
+ * Every array below is carved from one arena block owned by "arena", so a model costs one
+ * allocation and copies of the model share the block (the last copy frees it).
+ * Bones are stored CSR-style: the bones of marker i are neighbors[offsets[i] .. offsets[i+1]-1].
+ * Positions are read from the shared frame store through column[].
+ */
 struct Bones {
-    int boneSize;
-    int pointSize;
+    int boneSize; //Number of markers
+    int edgeSize; //Number of bones (marker pairs)
     bool viewState;
     bool state;
-    Connections* bones;
-    BonePoints* points;
+
+    int* id; //[boneSize] cloud id of each marker
+    int* column; //[boneSize] column of each marker in the frame store
+    int* offsets; //[boneSize+1] first bone of each marker
+    int* neighbors; //[edgeSize] model index of the other marker of the bone (always > i)
+
+    FrameStore frames; //Shared trial positions
+    std::shared_ptr<char> arena;
 };
 
 struct ModelInfo {
@@ -48,6 +58,14 @@ struct HumanSizes {
     float height;
 };
 
+//Distance statistics of a marker pair over all frames
+struct PairStatistics {
+    int a; //Model index of the first marker
+    int b; //Model index of the second marker
+    float mean; //Mean distance
+    float variance; //Variance of the distance
+};
+
 class Model
 {
 public:
@@ -79,13 +97,49 @@ public:
 
     Bones GetBones() {return bones;}
 
+    //Position (x,y,z) of a marker in a frame
+    const float* BonePosition(const int frame, const int marker) {return &bones.frames.positions[((size_t)frame*bones.frames.pointSize + bones.column[marker])*3];}
+
+    //Number of frames the bones can be drawn for
+    int BoneFrameSize() {return bones.frames.frameSize;}
+
+    //Rigidity threshold: a pair is a bone when std(distance)/mean(distance) is below it
+    void SetRigidityThreshold(const float threshold) {rigidityThreshold = threshold;}
+    float GetRigidityThreshold() {return rigidityThreshold;}
+
     void CreateModelFromCluster(const Cluster cluster, const Cloud cloud[], const int pointCloudFrameSize, const int pointCloudPointSize, Model* model);
+
+    /* Create the bones of the cluster markers, reading positions from a shared frame store.
+     * weights: frame-major like the store (see MarkerGaps::Weights), samples with weight 0 are left out of the pair statistics
+     */
+    void CreateModelFromCluster(const Cluster cluster, const FrameStore frames, Model* model, const float* weights = NULL);
+
+    //Restore bones found earlier over the same frame store (see TrialCache): store columns of the markers and the CSR graph
+    void RestoreBones(const FrameStore frames, const int boneSize, const int* column, const int edgeSize, const int* offsets, const int* neighbors, Model* model);
+
+    //Read the bones from another frame store with the same columns (the next window of a paged trial)
+    void SetBoneFrames(const FrameStore frames, Model* model);
+
+    //Copy a cloud (one Cloud per frame) to a frame store
+    static FrameStore CreateFrameStore(const Cloud cloud[], const int frameSize, const int pointSize);
     void CleanUpBones(Model* model);
 
+    /* Distance mean and variance of every marker pair (a < b) in one pass over the frames.
+     * x, y, z are marker-major (x[marker*frameSize + frame]) so each pair streams two contiguous columns.
+     * stats must hold pointSize*(pointSize-1)/2 pairs.
+     * valid (marker-major like x, or NULL): frames where either marker has weight 0 are skipped.
+     */
+    static void ComputePairStatistics(const float* x, const float* y, const float* z, const int pointSize, const int frameSize, PairStatistics* stats,
+                                      const float* valid = NULL);
+
 private:
+    //Allocate the arena of the bones (boneSize markers, edgeSize bones) over a frame store
+    void AllocateBones(Model* model, const FrameStore frames, const int boneSize, const int edgeSize);
+
     ModelInfo modelInfo;
     HumanSizes humanSizes;
     Bones bones;
+    float rigidityThreshold;
 };
 
 #endif // MODEL_H
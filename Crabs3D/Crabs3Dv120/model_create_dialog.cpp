@@ -21,6 +21,8 @@ void ModelCreateDialog::ModelCreate(Model* model, bool *state)
     modelDialog = model;
     okState = state;
     *okState = false;
+
+    ui->RigiditySpin->setValue(model->GetRigidityThreshold() * 100.0); //percent of the mean bone length
 }
 
 void ModelCreateDialog::on_Name_Edit_textEdited(const QString &arg1)
@@ -43,6 +45,11 @@ void ModelCreateDialog::on_BlueSpin_valueChanged(int arg1)
     modelDialog->SetColorBlue(arg1);
 }
 
+void ModelCreateDialog::on_RigiditySpin_valueChanged(double arg1)
+{
+    modelDialog->SetRigidityThreshold(arg1 / 100.0);
+}
+
 void ModelCreateDialog::on_Create_Button_clicked()
 {
     modelDialog->SetState(true);
@@ -27,6 +27,8 @@ private slots:
 
     void on_BlueSpin_valueChanged(int arg1);
 
+    void on_RigiditySpin_valueChanged(double arg1);
+
     void on_Create_Button_clicked();
 
 private:
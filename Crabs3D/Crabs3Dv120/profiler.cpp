@@ -0,0 +1,92 @@
+#include "profiler.h"
+#include <chrono>
+#include <stdio.h>
+
+std::atomic<long long> Profiler::counters[PROFILE_COUNTER_SIZE];
+std::mutex Profiler::lock;
+std::vector<ProfileEvent> Profiler::events;
+
+/**********/
+/* Public */
+/**********/
+
+long long Profiler::Now() {
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+int Profiler::Thread() {
+    static std::atomic<int> threadSize(0);
+    thread_local int thread = threadSize++;
+    return thread;
+}
+
+const char* Profiler::CounterName(const int counter) {
+    switch (counter) {
+    case PROFILE_BYTES_READ: return "bytes_read";
+    case PROFILE_FRAMES_DECODED: return "frames_decoded";
+    case PROFILE_ALLOCATIONS: return "allocations";
+    case PROFILE_DRAW_CALLS: return "draw_calls";
+    case PROFILE_VERTICES: return "vertices";
+    default: return "counter";
+    }
+}
+
+void Profiler::Record(const ProfileEvent event) {
+    std::lock_guard<std::mutex> guard(lock);
+    if(events.size() < PROFILE_MAX_EVENTS)
+        events.push_back(event);
+}
+
+bool Profiler::ExportChromeTrace(const std::string fileName) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    FILE* file = fopen(fileName.c_str(), "w");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for(size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent& event = events[i];
+
+        //Complete event (what the counters added while the scope was open)
+        fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %lld, \"dur\": %lld, \"args\": {",
+                event.name, event.thread, event.start, event.duration);
+        for(int c = 0; c < PROFILE_COUNTER_SIZE; c++)
+            fprintf(file, "%s\"%s\": %lld", c > 0 ? ", " : "", CounterName(c), event.after[c] - event.before[c]);
+        fprintf(file, "}},\n");
+
+        //Counter event (running totals when the scope was closed)
+        fprintf(file, "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, \"args\": {", event.start + event.duration);
+        for(int c = 0; c < PROFILE_COUNTER_SIZE; c++)
+            fprintf(file, "%s\"%s\": %lld", c > 0 ? ", " : "", CounterName(c), event.after[c]);
+        fprintf(file, "}},\n");
+    }
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Crabs3D\"}}\n]}\n");
+
+    bool result = !ferror(file);
+    fclose(file);
+    return result;
+}
+
+void Profiler::Reset() {
+    std::lock_guard<std::mutex> guard(lock);
+    events.clear();
+    for(int c = 0; c < PROFILE_COUNTER_SIZE; c++)
+        counters[c] = 0;
+}
+
+ProfileScope::ProfileScope(const char* name) {
+    event.name = name;
+    event.thread = Profiler::Thread();
+    for(int c = 0; c < PROFILE_COUNTER_SIZE; c++)
+        event.before[c] = Profiler::Counter(c);
+    event.start = Profiler::Now();
+}
+
+ProfileScope::~ProfileScope() {
+    event.duration = Profiler::Now() - event.start;
+    for(int c = 0; c < PROFILE_COUNTER_SIZE; c++)
+        event.after[c] = Profiler::Counter(c);
+    Profiler::Record(event);
+}
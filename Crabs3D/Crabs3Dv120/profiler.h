@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Counters
+#define PROFILE_BYTES_READ      0
+#define PROFILE_FRAMES_DECODED  1
+#define PROFILE_ALLOCATIONS     2
+#define PROFILE_DRAW_CALLS      3
+#define PROFILE_VERTICES        4
+#define PROFILE_COUNTER_SIZE    5
+
+//Events kept in memory (later scopes are dropped, the counters still count)
+#define PROFILE_MAX_EVENTS 200000
+
+/* Instrumentation (built only with CRABS3D_PROFILE defined - qmake CONFIG+=profile).
+ * PROFILE_SCOPE times the rest of the enclosing block, PROFILE_COUNT adds to a counter.
+ * Without CRABS3D_PROFILE the macros are empty and cost nothing.
+ */
+#ifdef CRABS3D_PROFILE
+#define PROFILE_JOIN_NAME(a, b) a##b
+#define PROFILE_SCOPE_NAME(line) PROFILE_JOIN_NAME(profileScope_, line)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_NAME(__LINE__)(name)
+#define PROFILE_COUNT(counter, value) Profiler::Count(counter, value)
+#define PROFILE_EXPORT(fileName) Profiler::ExportChromeTrace(fileName)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, value) ((void)sizeof(value)) //not evaluated
+#define PROFILE_EXPORT(fileName) ((void)0)
+#endif
+
+//A timed scope (microseconds since the first event) with the counters when it was opened and closed
+struct ProfileEvent {
+    const char* name;
+    int thread;
+    long long start;
+    long long duration;
+    long long before[PROFILE_COUNTER_SIZE];
+    long long after[PROFILE_COUNTER_SIZE];
+};
+
+class Profiler
+{
+public:
+    //Microseconds since the first call
+    static long long Now();
+
+    //Small id of the calling thread (0 is the first thread that records)
+    static int Thread();
+
+    //Add to a counter
+    static void Count(const int counter, const long long value) {counters[counter] += value;}
+
+    //Return a counter
+    static long long Counter(const int counter) {return counters[counter];}
+
+    //Name of a counter (as written to the trace)
+    static const char* CounterName(const int counter);
+
+    //Store an event
+    static void Record(const ProfileEvent event);
+
+    //Write the events to a Chrome trace file (chrome://tracing, Perfetto): complete events with the
+    //counter deltas of each scope as arguments, and the running counters as counter events
+    static bool ExportChromeTrace(const std::string fileName);
+
+    //Drop the events and zero the counters
+    static void Reset();
+
+private:
+    static std::atomic<long long> counters[PROFILE_COUNTER_SIZE];
+    static std::mutex lock;
+    static std::vector<ProfileEvent> events;
+};
+
+//Record the time between construction and destruction (see PROFILE_SCOPE)
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name);
+    ~ProfileScope();
+
+private:
+    ProfileEvent event;
+};
+
+#endif // PROFILER_H
@@ -1,7 +1,12 @@
 #include "read_c3d.h"
+#include "profiler.h"
 #include <cmath>
 #include <stdio.h>
+#include <limits.h>
 #include <ctype.h>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 
 #include <QMessageBox>
 
@@ -64,9 +69,9 @@ template <typename T>
 void readWord(T* word, const int bytes, FILE* file) {
     char* wordToRead = (char*) word;
 
-    if((int)sizeof(T) > bytes)
-        for(int i = 0; i < bytes; i++)
-            wordToRead[i+1] = 0;
+    //Clear the word (bytes can be less than sizeof(T))
+    for(int i = 0; i < (int)sizeof(T); i++)
+        wordToRead[i] = 0;
 
     for(int i = 0; i < bytes; i++) {
         wordToRead[i] = 0;
@@ -74,82 +79,221 @@ void readWord(T* word, const int bytes, FILE* file) {
     }
 }
 
-//ReadWordWithEndian
+/* VAX F-float to IEEE (bits: the 32-bit word in system byte order, as an Intel file would give it).
+ * The two 16-bit halves are swapped and the exponent bias is 2 higher: exponents above 2 lose 2,
+ * exponents 1 and 2 become IEEE denormals (value / 4) and exponent 0 is zero (VAX reserved operands too).
+ * Branch-free (selects only), so loops over arrays vectorize.
+ */
+inline float vaxToIEEE(unsigned int bits) {
+    bits = (bits << 16) | (bits >> 16);
+    unsigned int exponent = bits & 0x7F800000;
+
+    float small;
+    memcpy(&small, &bits, sizeof(float));
+    small *= 0.25f;
+    unsigned int smallBits;
+    memcpy(&smallBits, &small, sizeof(float));
+
+    //Masks instead of branches
+    unsigned int normal = 0U - (unsigned int)(exponent > 0x01000000);
+    unsigned int nonZero = 0U - (unsigned int)(exponent != 0);
+    unsigned int result = ((bits - 0x01000000) & normal) | (smallBits & ~normal & nonZero);
+
+    float value;
+    memcpy(&value, &result, sizeof(float));
+    return value;
+}
+
+//BufferWord (read a word from a memory buffer)
 template <typename T>
-void readWordWithEndian(T* word, const int bytes, FILE* file, const int endian_flag) {
-    char* wordToRead = (char*) word;
+T bufferWord(const char* buffer, const int endian_flag) {
+    T word;
+    memcpy(&word, buffer, sizeof(T));
+
+    if((endian_flag & DIFF_ENDIAN) && sizeof(T) > SIZE_8_BIT)
+        word = swapEndian(word);
+
+    if constexpr(std::is_same<T, float>::value) {
+        if(endian_flag & DEC_FLOAT) {
+            unsigned int bits;
+            memcpy(&bits, &word, sizeof(bits));
+            word = vaxToIEEE(bits);
+        }
+    }
 
-    if((int)sizeof(T) >= bytes)
-        for(int i = 0; i < bytes; i++)
-            wordToRead[i+1] = 0;
+    return word;
+}
 
-    if(endian_flag == SAME_ENDIAN)
-        for(int i = 0; i < bytes; i++) {
-            fread(&wordToRead[i], 1, 1, file);
-        }
-    else if(endian_flag == DIFF_ENDIAN) {
-        if(bytes > SIZE_8_BIT)
-            for(int i = bytes-1; i >= 0; i--) {
-                wordToRead[i] = 0;
-                fread(&wordToRead[i], 1, 1, file);
-            }
+//Convert size VAX F-floats of a memory buffer (the loop vectorizes)
+template <bool Swap>
+void vaxWords(float* values, const char* buffer, const int size) {
+    #pragma omp simd
+    for(int i = 0; i < size; i++) {
+        unsigned int bits;
+        memcpy(&bits, &buffer[i*SIZE_32_BIT], sizeof(bits));
+        values[i] = vaxToIEEE(Swap ? __builtin_bswap32(bits) : bits);
+    }
+}
+
+//Read size floats from a memory buffer (VAX F-floats are converted in bulk)
+inline void bufferFloats(float* values, const char* buffer, const int size, const int endian_flag) {
+    if(endian_flag & DEC_FLOAT) {
+        if(endian_flag & DIFF_ENDIAN)
+            vaxWords<true>(values, buffer, size);
         else
-            for(int i = 0; i < bytes; i++) {
-                wordToRead[i] = 0;
-                fread(&wordToRead[i], 1, 1, file);
-            }
+            vaxWords<false>(values, buffer, size);
+    } else {
+        for(int i = 0; i < size; i++)
+            values[i] = bufferWord<float>(&buffer[i*SIZE_32_BIT], endian_flag);
     }
 }
 
+//LoadWord (read a word from a memory buffer, the byte order is fixed at compile time)
+template <typename T, bool Swap>
+inline T loadWord(const char* buffer) {
+    T word;
+    if constexpr(Swap && sizeof(T) == SIZE_16_BIT) {
+        unsigned short int bits;
+        memcpy(&bits, buffer, sizeof(bits));
+        bits = __builtin_bswap16(bits);
+        memcpy(&word, &bits, sizeof(T));
+    } else if constexpr(Swap && sizeof(T) == SIZE_32_BIT) {
+        unsigned int bits;
+        memcpy(&bits, buffer, sizeof(bits));
+        bits = __builtin_bswap32(bits);
+        memcpy(&word, &bits, sizeof(T));
+    } else {
+        memcpy(&word, buffer, sizeof(T));
+    }
+    return word;
+}
+
 /***********************/
 /* Auxirialy Functions */
 /***********************/
 
-int wordCounter(const char* text) {
-    int counter = 0;
-    int i = 0;
+//Split a character parameter (e.g. LABELS 32 x N) to fixed width entries of the string table
+void setWords(Parameter_Parameter_C3D* parameter, StringTable* strings, const std::string_view** words, int* wordsSize) {
+    *words = NULL;
+    *wordsSize = 0;
+    if(parameter == NULL || parameter->Format() != FORMAT_CHAR)
+        return;
 
-    while(i < (int)strlen(text) || text[i] != '\0') {
-        while(!isgraph(text[i]) && text[i] != '\0') {
-            i++;
-        }
-        if(isgraph(text[i])) {
-            counter++;
-            while(isgraph(text[i]) && text[i] != '\0') {
-                i++;
-            }
-        }
-    }
+    int width = parameter->DimensionsSize() > 0 ? parameter->Dimension(0) : 1;
+    if(width <= 0)
+        return;
+    int size = parameter->DataSize() / width;
 
-    return counter;
+    *words = strings->Split(parameter->ParameterCharData(), width, size);
+    *wordsSize = *words != NULL ? size : 0;
 }
 
-std::string wordReturn (const char* text, const int wordToReturnIndex) {
-    int counter = 0;
-    int i = 0;
-    std::string word = "";
+//Copy a character parameter to a single (trimmed) string of the string table
+std::string_view setString(Parameter_Parameter_C3D* parameter, StringTable* strings) {
+    if(parameter == NULL || parameter->Format() != FORMAT_CHAR)
+        return std::string_view();
 
-    while(i < (int)strlen(text) || text[i] != '\0') {
-        while(!isgraph(text[i]) && text[i] != '\0') {
-            i++;
-        }
-        if(isgraph(text[i])) {
-            counter++;
-            if(counter == wordToReturnIndex) {
-                while(isgraph(text[i]) && text[i] != '\0') {
-                    word += text[i];
-                    i++;
-                }
-                break;
-            } else {
-                while(isgraph(text[i]) && text[i] != '\0') {
-                    i++;
-                }
-            }
-        }
+    std::string_view text(parameter->ParameterCharData(), parameter->DataSize());
+    return strings->Intern(StringTable::Trim(text));
+}
+
+//Copy a float parameter to a new array (returns the size, 0 if the parameter doesn't exist)
+int setFloats(Parameter_Parameter_C3D* parameter, float** values) {
+    int size = parameter != NULL && parameter->Format() == FORMAT_FLOAT ? parameter->DataSize() : 0;
+
+    *values = (float*)malloc((size+1)*sizeof(float));
+    for(int i = 0; i < size; i++)
+        (*values)[i] = parameter->ParameterFloat(i);
+
+    return size;
+}
+
+//Copy an integer (or byte) parameter to a new array (returns the size, 0 if the parameter doesn't exist)
+int setInt16s(Parameter_Parameter_C3D* parameter, short int** values) {
+    int size = 0;
+    if(parameter != NULL && (parameter->Format() == FORMAT_INT_16 || parameter->Format() == FORMAT_BYTE))
+        size = parameter->DataSize();
+
+    *values = (short int*)malloc((size+1)*sizeof(short int));
+    for(int i = 0; i < size; i++)
+        (*values)[i] = parameter->Format() == FORMAT_INT_16 ? parameter->ParameterInt16(i) : parameter->ParameterByte(i);
+
+    return size;
+}
+
+//Set an element of an integer parameter (if it exists)
+void setInt16(Parameter_c3d* parameter, const std::string group, const std::string name, const int index, const short int value) {
+    Parameter_Parameter_C3D* par = parameter->Find(group, name);
+    if(par != NULL && par->Format() == FORMAT_INT_16 && index < par->DataSize())
+        par->SetParameterInt16(index, value);
+}
+
+//Set an element of a float parameter (if it exists)
+void setFloat(Parameter_c3d* parameter, const std::string group, const std::string name, const int index, const float value) {
+    Parameter_Parameter_C3D* par = parameter->Find(group, name);
+    if(par != NULL && par->Format() == FORMAT_FLOAT && index < par->DataSize())
+        par->SetParameterFloat(index, value);
+}
+
+//32-bit value of an integer parameter of two unsigned words, least significant word first (0 if the parameter doesn't exist)
+unsigned int findInt32(Parameter_Parameter_C3D* parameter) {
+    if(parameter == NULL || parameter->Format() != FORMAT_INT_16 || parameter->DataSize() < 1)
+        return 0;
+
+    unsigned int value = (unsigned short int)parameter->ParameterInt16(0);
+    if(parameter->DataSize() > 1)
+        value |= (unsigned int)(unsigned short int)parameter->ParameterInt16(1) << 16;
+    return value;
+}
+
+//Set an integer parameter of two words (if it exists)
+void setInt32(Parameter_c3d* parameter, const std::string group, const std::string name, const unsigned int value) {
+    setInt16(parameter, group, name, 0, (short int)(value & 0xFFFF));
+    setInt16(parameter, group, name, 1, (short int)(value >> 16));
+}
+
+//POINT:LONG_FRAMES: a float, or two integer words (0 if the parameter doesn't exist)
+long long findLongFrames(Parameter_c3d* parameter) {
+    Parameter_Parameter_C3D* par = parameter->Find("POINT", "LONG_FRAMES");
+    if(par != NULL && par->Format() == FORMAT_FLOAT && par->DataSize() > 0)
+        return par->ParameterFloat(0) > 0 ? (long long)(par->ParameterFloat(0) + 0.5) : 0;
+    return findInt32(par);
+}
+
+/* Frame range of a file. The header words are unsigned 16-bit frame numbers: past frame 65535 they are saturated
+ * (or wrapped), then the range is TRIAL:ACTUAL_START_FIELD to ACTUAL_END_FIELD (fields of VIDEO_RATE_DIVIDER frames),
+ * else the first header frame and POINT:LONG_FRAMES frames. The 32-bit values are only used when the header can't
+ * hold the trial, so stale TRIAL fields of a short trial are ignored.
+ */
+static void fileFrames(Header_c3d header, Parameter_c3d* parameter, long long* first, long long* last) {
+    long long headerFirst = header.FirstFrame();
+    long long headerLast = header.LastFrame();
+    long long frames = headerLast - headerFirst + 1;
+
+    long long longFirst = headerFirst;
+    long long longFrames = 0;
+    unsigned int startField = findInt32(parameter->Find("TRIAL", "ACTUAL_START_FIELD"));
+    unsigned int endField = findInt32(parameter->Find("TRIAL", "ACTUAL_END_FIELD"));
+    if(startField > 0 && endField >= startField) {
+        int divider = parameter->FindInt16("TRIAL", "VIDEO_RATE_DIVIDER", 0, 1);
+        divider = divider > 0 ? divider : 1;
+        longFirst = (startField - 1) / divider + 1;
+        longFrames = (long long)(endField - startField) / divider + 1;
+    } else {
+        longFrames = findLongFrames(parameter);
     }
 
-    return word;
+    bool saturated = headerLast == MAX_HEADER_FRAME || frames <= 0;
+    if(saturated ? longFrames >= frames : longFrames > MAX_HEADER_FRAME && (longFrames - frames) % (MAX_HEADER_FRAME + 1) == 0) {
+        if(headerFirst == MAX_HEADER_FRAME)
+            headerFirst = longFirst;
+        frames = longFrames;
+    }
+    if(frames < 1)
+        frames = 1;
+
+    *first = headerFirst;
+    *last = headerFirst + frames - 1;
 }
 
 /******************************************/
@@ -231,6 +375,27 @@ void Header_c3d::swapHeader(Header_c3d* header) {
         header->future_use_block_4[i] = swapEndian(header->future_use_block_4[i]);
 }
 
+/*Convert the header floats of a DEC processor file (VAX F-floats) to IEEE*/
+void Header_c3d::decHeader(Header_c3d* header) {
+    float* values[2] = {&header->scale_factor, &header->frame_rate};
+    for(int i = 0; i < 2; i++) {
+        unsigned int bits;
+        memcpy(&bits, values[i], sizeof(bits));
+        *values[i] = vaxToIEEE(bits);
+    }
+    bufferFloats(header->event_times_in_sec, (const char*)header->event_times_in_sec, 18, DEC_FLOAT);
+}
+
+void Header_c3d::SetFrames(Header_c3d* header, const int firstFrame, const int lastFrame, const float frameRate,
+                           const int analogWords, const int analogPerFrame, const int maxGap) {
+    header->first_frame = firstFrame;
+    header->last_frame = lastFrame;
+    header->frame_rate = frameRate;
+    header->analog_number = analogWords;
+    header->analog_per_frame = analogPerFrame;
+    header->maximum_interpolation_gap = maxGap;
+}
+
 /*Print Header block to file*/
 void Header_c3d::print_header_to_file(Header_c3d header, const std::string fileName) {
     FILE* outputFile;
@@ -241,8 +406,8 @@ void Header_c3d::print_header_to_file(Header_c3d header, const std::string fileN
     fprintf(outputFile, "ADTech_ID_number = %d\n", header.id_number);
     fprintf(outputFile, "Number_of_Points = %d\n", header.points_number);
     fprintf(outputFile, "Number_of_Analog_data = %d\n", header.analog_number);
-    fprintf(outputFile, "First_Frame = %d\n", header.first_frame);
-    fprintf(outputFile, "Last_Frame = %d\n", header.last_frame);
+    fprintf(outputFile, "First_Frame = %d\n", header.FirstFrame());
+    fprintf(outputFile, "Last_Frame = %d\n", header.LastFrame());
     fprintf(outputFile, "Max_Interpolation_Gap = %d\n", header.maximum_interpolation_gap);
     fprintf(outputFile, "Point_Scale_Factor = %.4f\n", header.scale_factor);
     fprintf(outputFile, "Data_Start_Block = %d\n", header.data_start_block);
@@ -292,120 +457,109 @@ void Parameter_Header_C3D ::ReadHeaderBlock(FILE* file, Parameter_Header_C3D& he
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 /* ~~ Parameter_Parameter_C3D ~~ */
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-bool Parameter_Parameter_C3D::ReadParameterBlock(FILE* file, Parameter_Parameter_C3D& parameter, const int endianFlag) {
-    bool loop;
-
-    readWordWithEndian(&parameter.character_number, SIZE_8_BIT, file, endianFlag); //Read character number
-    if(parameter.character_number < 0) {
+int Parameter_Parameter_C3D::ReadParameterBlock(const char* buffer, const int size, Parameter_Parameter_C3D& parameter, const int endianFlag) {
+    int pos = 0;
+
+    //Every pointer is valid (or NULL) even if the record is truncated
+    parameter.parameter_name = NULL;
+    parameter.parameter_data_char = NULL;
+    parameter.parameter_data_byte = NULL;
+    parameter.parameter_data_16_int = NULL;
+    parameter.parameter_data_float = NULL;
+    parameter.description = NULL;
+    parameter.byte_format = 0;
+    parameter.number_of_dimensions = 0;
+    parameter.parameter_dimensions[0] = 0;
+    parameter.description_number = 0;
+
+    if(size < 2)
+        return 0;
+
+    //Character number (negative if locked) and parameter ID
+    parameter.character_number = (signed char)buffer[pos++];
+    parameter.locked = parameter.character_number < 0;
+    if(parameter.locked)
         parameter.character_number *= -1;
-        parameter.locked = true;
-    } else {
-        parameter.locked = false;
-    }
-
-    readWordWithEndian(&parameter.parameter_ID, SIZE_8_BIT, file, endianFlag); //Read parameter ID
-
-    //Read Parameter Name
-    parameter.parameter_name = (char*)malloc(parameter.character_number*sizeof(char));
-    for(int i = 0; i < parameter.character_number; i++) {
-        readWordWithEndian(&parameter.parameter_name[i] , SIZE_8_BIT, file, endianFlag);
-        parameter.parameter_name[i+1] = '\0';
-    }
-
-    //Read next group pointer
-    readWordWithEndian(&parameter.next_group_parameter_start, SIZE_16_BIT, file, endianFlag);
-    //Check if this is the last group
-    if(parameter.next_group_parameter_start == 0) {
-        loop = false;
-    } else {
-        loop = true;
+    parameter.parameter_ID = (signed char)buffer[pos++];
+
+    //Parameter Name
+    if(pos + parameter.character_number + 2 > size)
+        return 0;
+    parameter.parameter_name = (char*)malloc((parameter.character_number+1)*sizeof(char));
+    memcpy(parameter.parameter_name, &buffer[pos], parameter.character_number);
+    parameter.parameter_name[parameter.character_number] = '\0';
+    pos += parameter.character_number;
+
+    //Next parameter pointer (from the start of this word)
+    parameter.next_group_parameter_start = bufferWord<short int>(&buffer[pos], endianFlag);
+    pos += SIZE_16_BIT;
+
+    //Byte format and dimensions
+    if(pos + 2 > size)
+        return 0;
+    parameter.byte_format = (signed char)buffer[pos++];
+    parameter.number_of_dimensions = (unsigned char)buffer[pos++];
+    if(parameter.number_of_dimensions > MAX_DIMENSIONS || pos + parameter.number_of_dimensions > size) {
+        parameter.number_of_dimensions = 0;
+        return 0;
     }
 
-    //Read byte format
-    readWordWithEndian(&parameter.byte_format, SIZE_8_BIT, file, endianFlag);
-    if(parameter.byte_format == 255)
-        parameter.byte_format = -1;
-
-    //Read dimensions size
-    readWordWithEndian(&parameter.number_of_dimensions, SIZE_8_BIT, file, endianFlag);
-
-    //Read dimensions
     int dim = 1;
-    if(parameter.number_of_dimensions == 0) {
-        parameter.parameter_dimensions[0] = 0;
-    }
     for(int i = 0; i < parameter.number_of_dimensions; i++) {
-        readWordWithEndian(&parameter.parameter_dimensions[i], SIZE_8_BIT, file, endianFlag);
+        parameter.parameter_dimensions[i] = (unsigned char)buffer[pos++];
         dim *= parameter.parameter_dimensions[i];
     }
 
-    //Read the correct data type
+    //Parameter Data
+    int elementSize = parameter.byte_format == FORMAT_CHAR ? SIZE_8_BIT : parameter.byte_format;
+    if(elementSize != SIZE_8_BIT && elementSize != SIZE_16_BIT && elementSize != SIZE_32_BIT)
+        return 0;
+    if(pos + dim*elementSize > size)
+        return 0;
+
     switch(parameter.byte_format) {
         case FORMAT_CHAR: {
-                parameter.parameter_data_char = (char*)malloc((dim+1)*sizeof(char));
-                parameter.parameter_data_char[0] = '\0';
-                for(int i = 0; i < dim; i++) {
-                    readWordWithEndian(&parameter.parameter_data_char[i], SIZE_8_BIT, file, endianFlag);
-                    parameter.parameter_data_char[i+1] = '\0';
-            }
+            parameter.parameter_data_char = (char*)malloc((dim+1)*sizeof(char));
+            memcpy(parameter.parameter_data_char, &buffer[pos], dim);
+            parameter.parameter_data_char[dim] = '\0';
             break;
         } case FORMAT_BYTE: {
             parameter.parameter_data_byte = (short int*)malloc((dim+1)*sizeof(short int));
-            for(int i = 0; i < dim; i++) {
-                readWordWithEndian(&parameter.parameter_data_byte[i], SIZE_8_BIT, file, endianFlag);
-            }
+            for(int i = 0; i < dim; i++)
+                parameter.parameter_data_byte[i] = (unsigned char)buffer[pos + i];
             break;
         } case FORMAT_INT_16: {
             parameter.parameter_data_16_int = (short int*)malloc((dim+1)*sizeof(short int));
-            for(int i = 0; i < dim; i++) {
-                readWordWithEndian(&parameter.parameter_data_16_int[i], SIZE_16_BIT, file, endianFlag);
-            }
+            for(int i = 0; i < dim; i++)
+                parameter.parameter_data_16_int[i] = bufferWord<short int>(&buffer[pos + i*SIZE_16_BIT], endianFlag);
             break;
         } case FORMAT_FLOAT: {
             parameter.parameter_data_float = (float*)malloc((dim+1)*sizeof(float));
-            for(int i = 0; i < dim; i++) {
-                readWordWithEndian(&parameter.parameter_data_float[i], SIZE_32_BIT, file, endianFlag);
-            }
+            bufferFloats(parameter.parameter_data_float, &buffer[pos], dim, endianFlag);
             break;
         }
     }
+    pos += dim*elementSize;
 
-    //Read number description
-    readWordWithEndian(&parameter.description_number, SIZE_8_BIT, file, endianFlag);
-
-    //Read Description
-    //Read Description
-    if(parameter.description_number <= 0) {
-        parameter.description = (char*)malloc(1*sizeof(char));
-        parameter.description[0] = '\0';
-    } else {
-        parameter.description = (char*)malloc(parameter.description_number*sizeof(char));
-        parameter.description[0] = '\0';
-        for(int i = 0; i < parameter.description_number; i++) {
-            readWordWithEndian(&parameter.description[i], SIZE_8_BIT, file, endianFlag);
-            parameter.description[i+1] = '\0';
-        }
-    }
-
-    return loop;
+    //Description
+    if(pos + 1 > size)
+        return pos;
+    parameter.description_number = (unsigned char)buffer[pos++];
+    if(pos + parameter.description_number > size)
+        parameter.description_number = size - pos;
+    parameter.description = (char*)malloc((parameter.description_number+1)*sizeof(char));
+    memcpy(parameter.description, &buffer[pos], parameter.description_number);
+    parameter.description[parameter.description_number] = '\0';
+    pos += parameter.description_number;
+
+    return pos;
 }
 
 void Parameter_Parameter_C3D::CleanUp(Parameter_Parameter_C3D& parameter) {
-    switch(parameter.byte_format) {
-        case FORMAT_CHAR: {
-            free(parameter.parameter_data_char);
-            break;
-        } case FORMAT_BYTE: {
-            free(parameter.parameter_data_byte);
-            break;
-        } case FORMAT_INT_16: {
-            free(parameter.parameter_data_16_int);
-            break;
-        } case FORMAT_FLOAT: {
-            free(parameter.parameter_data_float);
-            break;
-        }
-    }
+    free(parameter.parameter_data_char);
+    free(parameter.parameter_data_byte);
+    free(parameter.parameter_data_16_int);
+    free(parameter.parameter_data_float);
 
     free(parameter.parameter_name);
     free(parameter.description);
@@ -414,66 +568,61 @@ void Parameter_Parameter_C3D::CleanUp(Parameter_Parameter_C3D& parameter) {
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~ */
 /* ~~ Parameter_Group_C3D ~~ */
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~ */
-bool Parameter_Group_C3D::ReadGroupBlock(FILE* file, Parameter_Group_C3D& group, const int endianFlag, const bool isGroup) {
-
-    bool loop;
-
-    if(isGroup == true) {
-        group.parameter_size = 0; //Set parameter size for this group to 0
-        group.parameter = (Parameter_Parameter_C3D*)malloc((127)*sizeof(Parameter_Parameter_C3D));
-
-        readWordWithEndian(&group.character_number, SIZE_8_BIT, file, endianFlag); //Read character number
-        if(group.character_number < 0) {
-            group.character_number *= -1;
-            group.locked = true;
-        } else {
-            group.locked = false;
-        }
-
-        readWordWithEndian(&group.group_ID , SIZE_8_BIT, file, endianFlag); //Read group ID
-        if(group.group_ID > 128) {
-            group.group_ID -= 256;
-        }
-        //Read Group Name
-        group.group_name = (char*)malloc(group.character_number*sizeof(char));
-        for(int i = 0; i < group.character_number; i++) {
-            readWordWithEndian(&group.group_name[i], SIZE_8_BIT, file, endianFlag);
-            group.group_name[i+1] = '\0';
-        }
+int Parameter_Group_C3D::ReadGroupBlock(const char* buffer, const int size, Parameter_Group_C3D& group, const int endianFlag, const int parameterSize) {
+    int pos = 0;
+
+    group.parameter_size = 0;
+    group.parameter = (Parameter_Parameter_C3D*)malloc((parameterSize > 0 ? parameterSize : 1)*sizeof(Parameter_Parameter_C3D));
+    group.group_name = NULL;
+    group.description = NULL;
+    group.description_number = 0;
+
+    if(size < 2)
+        return 0;
+
+    //Character number (negative if locked) and group ID (always negative)
+    group.character_number = (signed char)buffer[pos++];
+    group.locked = group.character_number < 0;
+    if(group.locked)
+        group.character_number *= -1;
+    group.group_ID = (signed char)buffer[pos++];
+
+    //Group Name
+    if(pos + group.character_number + 2 > size)
+        return 0;
+    group.group_name = (char*)malloc((group.character_number+1)*sizeof(char));
+    memcpy(group.group_name, &buffer[pos], group.character_number);
+    group.group_name[group.character_number] = '\0';
+    pos += group.character_number;
+
+    //Next group pointer (from the start of this word)
+    group.next_group_parameter_start = bufferWord<short int>(&buffer[pos], endianFlag);
+    pos += SIZE_16_BIT;
 
-        //Read next group pointer
-        group.next_group_parameter_start = 0;
-        readWordWithEndian(&group.next_group_parameter_start, SIZE_16_BIT, file, endianFlag);
-
-        //Read number description
-        readWordWithEndian(&group.description_number, SIZE_8_BIT, file, endianFlag);
-
-        //Read Description
-        if(group.description_number <= 0) {
-            group.description = (char*)malloc(1*sizeof(char));
-            group.description[0] = '\0';
-        } else {
-            group.description = (char*)malloc(group.description_number*sizeof(char));
-            for(int i = 0; i < group.description_number; i++) {
-                readWordWithEndian(&group.description[i], SIZE_8_BIT, file, endianFlag);
-                group.description[i+1] = '\0';
-            }
-        }
+    //Description
+    if(pos + 1 > size)
+        return pos;
+    group.description_number = (unsigned char)buffer[pos++];
+    if(pos + group.description_number > size)
+        group.description_number = size - pos;
+    group.description = (char*)malloc((group.description_number+1)*sizeof(char));
+    memcpy(group.description, &buffer[pos], group.description_number);
+    group.description[group.description_number] = '\0';
+    pos += group.description_number;
+
+    return pos;
+}
 
-        //Check if this is the last group
-        if(group.next_group_parameter_start == 0) {
-            loop = false;
-        } else {
-            loop = true;
-        }
+bool Parameter_Group_C3D::AddParameter(const char* buffer, const int size, Parameter_Group_C3D& group, const int endianFlag) {
+    Parameter_Parameter_C3D& parameter = group.parameter[group.parameter_size];
 
-    } else {
-       loop = group.parameter->ReadParameterBlock(file, group.parameter[group.parameter_size], endianFlag);
-       group.parameter_size++;
-       //group.parameter = (Parameter_Parameter_C3D*)realloc(group.parameter, (group.parameter_size+1)*sizeof(Parameter_Parameter_C3D));
+    if(parameter.ReadParameterBlock(buffer, size, parameter, endianFlag) == 0) {
+        parameter.CleanUp(parameter);
+        return false;
     }
 
-    return loop;
+    group.parameter_size++;
+    return true;
 }
 
 void Parameter_Group_C3D::CleanUp(Parameter_Group_C3D* group) {
@@ -493,74 +642,176 @@ void Parameter_c3d::ReadHeaderParameterBlock(FILE* file, Parameter_c3d* paramete
 }
 
 void Parameter_c3d::ReadGroupParameterBlock(FILE* file, Parameter_c3d* parameter, const int endianFlag) {
-    parameter->group_size = 0;
-    short int num_char;
-    short int par_id;
-
-    parameter->group = (Parameter_Group_C3D*)malloc((parameter->group_size+1)*sizeof(Parameter_Group_C3D));
-    bool loop = true;
-    while(loop) {
-        readWordWithEndian(&num_char, SIZE_8_BIT, file, endianFlag); //Read number of character
-        readWordWithEndian(&par_id, SIZE_8_BIT, file, endianFlag); //Read ID number
-        if(par_id > 128) {
-            par_id -= 256;
+    PROFILE_SCOPE("C3D parameters");
+
+    //The whole section in one read (the 4 bytes of the parameter header are already read)
+    int size = parameter->header.NumberOfParameterBlock()*512 - 4;
+    char* buffer = NULL;
+    if(size > 0) {
+        buffer = (char*)malloc(size*sizeof(char));
+        size = (int)fread(buffer, 1, size, file);
+    } else {
+        size = 0;
+    }
+
+    PROFILE_COUNT(PROFILE_BYTES_READ, size + 4);
+    PROFILE_COUNT(PROFILE_ALLOCATIONS, 1);
+
+    parameter->ReadGroupParameterBlock(buffer, size, parameter, endianFlag);
+    free(buffer);
+}
+
+void Parameter_c3d::ReadGroupParameterBlock(const char* buffer, const int size, Parameter_c3d* parameter, const int endianFlag) {
+    //Walk the records by their next pointers and keep where each one starts
+    std::vector<int> recordStart;
+    int groupCount = 0;
+    int parameterCount[128] = {0}; //parameters per group ID
+    int groupIndex[128]; //group ID -> index in group (-1 if the group doesn't exist)
+    for(int i = 0; i < 128; i++)
+        groupIndex[i] = -1;
+
+    int pos = 0;
+    while(pos + 2 <= size) {
+        int characterNumber = abs((signed char)buffer[pos]);
+        int id = (signed char)buffer[pos+1];
+        if(characterNumber == 0 || id == 0)
+            break;
+
+        int nextField = pos + 2 + characterNumber;
+        if(nextField + 2 > size)
+            break;
+
+        //Group IDs are -1..-127 (-128 has no parameter ID) and a group ID is defined once: the record is skipped
+        //(the first group with an ID keeps it and gets the parameters of the ID)
+        if(id > 0) {
+            recordStart.push_back(pos);
+            parameterCount[id]++;
+        } else if(id != -128 && groupIndex[-id] < 0) {
+            recordStart.push_back(pos);
+            groupIndex[-id] = groupCount++;
         }
 
-        fseek(file, -2, SEEK_CUR); //Return back to char number (correct the reading procedure)
-
-        //If is group
-        if(par_id < 0) {
-            loop = parameter->group[parameter->group_size].ReadGroupBlock(file, parameter->group[parameter->group_size], endianFlag, true);
-            parameter->group_size++;
-            parameter->group = (Parameter_Group_C3D*)realloc(parameter->group, (parameter->group_size+1)*sizeof(Parameter_Group_C3D));
-        } else if(par_id > 0) {
-            loop = parameter->group[par_id-1].ReadGroupBlock(file, parameter->group[par_id-1], endianFlag, false);
-        } else if(num_char == 0 || par_id == 0) {
-            loop = false;
+        //Offset is stored as unsigned (records with long data can exceed 32767 bytes)
+        int next = (unsigned short int)bufferWord<short int>(&buffer[nextField], endianFlag);
+        if(next == 0)
+            break;
+        pos = nextField + next;
+    }
+
+    //Allocate exactly the groups and parameters the section has
+    parameter->group_size = groupCount;
+    parameter->group = (Parameter_Group_C3D*)malloc((groupCount > 0 ? groupCount : 1)*sizeof(Parameter_Group_C3D));
+
+    for(size_t r = 0; r < recordStart.size(); r++) {
+        int start = recordStart[r];
+        int id = (signed char)buffer[start+1];
+        if(id < 0) {
+            Parameter_Group_C3D& group = parameter->group[groupIndex[-id]];
+            group.ReadGroupBlock(&buffer[start], size - start, group, endianFlag, parameterCount[-id]);
         }
     }
-    short int buf = 0;
-    while(buf == 0) {
-        readWordWithEndian(&buf, SIZE_8_BIT, file, endianFlag);
+
+    //Parameters go to the group with the same ID (parameters without group are skipped)
+    for(size_t r = 0; r < recordStart.size(); r++) {
+        int start = recordStart[r];
+        int id = (signed char)buffer[start+1];
+        if(id <= 0 || groupIndex[id] < 0)
+            continue;
+
+        Parameter_Group_C3D& group = parameter->group[groupIndex[id]];
+        group.AddParameter(&buffer[start], size - start, group, endianFlag);
+    }
+
+    parameter->BuildIndex(parameter);
+}
+
+Parameter_Parameter_C3D* Parameter_c3d::Find(const std::string group, const std::string name) {
+    std::unordered_map<std::string, Parameter_Parameter_C3D*>::iterator it = index.find(group + ":" + name);
+    if(it == index.end())
+        return NULL;
+
+    return it->second;
+}
+
+short int Parameter_c3d::FindInt16(const std::string group, const std::string name, const int index, const short int value) {
+    Parameter_Parameter_C3D* parameter = Find(group, name);
+    if(parameter == NULL || index < 0 || index >= parameter->DataSize())
+        return value;
+
+    if(parameter->Format() == FORMAT_INT_16)
+        return parameter->ParameterInt16(index);
+    if(parameter->Format() == FORMAT_BYTE)
+        return parameter->ParameterByte(index);
+
+    return value;
+}
+
+float Parameter_c3d::FindFloat(const std::string group, const std::string name, const int index, const float value) {
+    Parameter_Parameter_C3D* parameter = Find(group, name);
+    if(parameter == NULL || index < 0 || index >= parameter->DataSize())
+        return value;
+
+    if(parameter->Format() == FORMAT_FLOAT)
+        return parameter->ParameterFloat(index);
+
+    return value;
+}
+
+std::string Parameter_c3d::FindChar(const std::string group, const std::string name, const std::string value) {
+    Parameter_Parameter_C3D* parameter = Find(group, name);
+    if(parameter == NULL || parameter->Format() != FORMAT_CHAR)
+        return value;
+
+    return parameter->ParameterChar();
+}
+
+void Parameter_c3d::BuildIndex(Parameter_c3d* parameter) {
+    parameter->index.clear();
+
+    for(int i = 0; i < parameter->group_size; i++) {
+        std::string groupName = parameter->group[i].Name() + ":";
+        for(int j = 0; j < parameter->group[i].ParameterSize(); j++) {
+            Parameter_Parameter_C3D* par = parameter->group[i].ParameterPointer(j);
+            parameter->index[groupName + par->Name()] = par;
+        }
     }
-    fseek(file, -1, SEEK_CUR);
 }
 
-void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::string fileName) {
+void Parameter_c3d::print_parameter_to_file(Parameter_c3d* parameter, const std::string fileName) {
     FILE* outputFile;
 
     outputFile = fopen(fileName.c_str(), "w");
 
     //Print Parameter Header
-    fprintf(outputFile, "Parameter_Block_Start = %d\n", parameter.Header().ParameterBlock());
-    fprintf(outputFile, "ADTech_ID_Number = %d\n", parameter.Header().NumberID());
-    fprintf(outputFile, "Parameter_512_byte_Block = %d\n", parameter.Header().NumberOfParameterBlock());
-    fprintf(outputFile, "Processor_Type = %d\n", parameter.Header().ProcessorType());
+    fprintf(outputFile, "Parameter_Block_Start = %d\n", parameter->Header().ParameterBlock());
+    fprintf(outputFile, "ADTech_ID_Number = %d\n", parameter->Header().NumberID());
+    fprintf(outputFile, "Parameter_512_byte_Block = %d\n", parameter->Header().NumberOfParameterBlock());
+    fprintf(outputFile, "Processor_Type = %d\n", parameter->Header().ProcessorType());
     fprintf(outputFile, "\n\n");
 
-    for (int i = 0; i < parameter.GroupSize(); i++) {
-        fprintf(outputFile, "Group_Name = %s\n", parameter.Group(i).Name().c_str());
-        fprintf(outputFile, "Group_ID = %d\n", parameter.Group(i).ID());
-        if(parameter.Group(i).IsLocked()) {
+    for (int i = 0; i < parameter->GroupSize(); i++) {
+        fprintf(outputFile, "Group_Name = %s\n", parameter->Group(i).Name().c_str());
+        fprintf(outputFile, "Group_ID = %d\n", parameter->Group(i).ID());
+        if(parameter->Group(i).IsLocked()) {
             fprintf(outputFile, "IsLocked = TRUE\n");
         } else {
             fprintf(outputFile, "IsLocked = FALSE\n");
         }
-        fprintf(outputFile, "Description = %s\n\n", parameter.Group(i).Description().c_str()); //Group Description
+        fprintf(outputFile, "Description = %s\n\n", parameter->Group(i).Description().c_str()); //Group Description
 
-        for(int j = 0; j < parameter.Group(i).ParameterSize(); j++) {
-            fprintf(outputFile, "\t\tParameter_Name = %s\n", parameter.Group(i).Parameter(j).Name().c_str()); //Parameter Name
-            fprintf(outputFile, "\t\tParameter_ID = %d\n", parameter.Group(i).Parameter(j).ID()); //Parameter ID
+        for(int j = 0; j < parameter->Group(i).ParameterSize(); j++) {
+            fprintf(outputFile, "\t\tParameter_Name = %s\n", parameter->Group(i).Parameter(j).Name().c_str()); //Parameter Name
+            fprintf(outputFile, "\t\tParameter_ID = %d\n", parameter->Group(i).Parameter(j).ID()); //Parameter ID
 
             //Check if Parameter is Lockes
-            if(parameter.Group(i).Parameter(j).IsLocked()) {
+            if(parameter->Group(i).Parameter(j).IsLocked()) {
                 fprintf(outputFile, "\t\tIsLocked = TRUE\n");
             } else {
                 fprintf(outputFile, "\t\tIsLocked = FALSE\n");
             }
 
             //Parameter Format
-            switch(parameter.Group(i).Parameter(j).Format()) {
+            switch(parameter->Group(i).Parameter(j).Format()) {
             case FORMAT_CHAR: {
                 fprintf(outputFile, "\t\tByte_Format = CHAR\n");
                 break;
@@ -582,23 +833,23 @@ void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::
             }
 
             //Number of Dimensions
-            fprintf(outputFile, "\t\tNumber_Of_Dimensions = %d\n", parameter.Group(i).Parameter(j).DimensionsSize());
+            fprintf(outputFile, "\t\tNumber_Of_Dimensions = %d\n", parameter->Group(i).Parameter(j).DimensionsSize());
 
             //Dimensions Size
-            int dim_size = parameter.Group(i).Parameter(j).Dimension(0);
-            fprintf(outputFile, "\t\tDimension_Sizes = %d", parameter.Group(i).Parameter(j).Dimension(0));
-            for(int dim = 1; dim <  parameter.Group(i).Parameter(j).DimensionsSize(); dim++) {
-                fprintf(outputFile, " x %d", parameter.Group(i).Parameter(j).Dimension(dim));
-                dim_size *= parameter.Group(i).Parameter(j).Dimension(dim);
+            int dim_size = parameter->Group(i).Parameter(j).Dimension(0);
+            fprintf(outputFile, "\t\tDimension_Sizes = %d", parameter->Group(i).Parameter(j).Dimension(0));
+            for(int dim = 1; dim <  parameter->Group(i).Parameter(j).DimensionsSize(); dim++) {
+                fprintf(outputFile, " x %d", parameter->Group(i).Parameter(j).Dimension(dim));
+                dim_size *= parameter->Group(i).Parameter(j).Dimension(dim);
             }
             fprintf(outputFile, "\n");
 
             //Parameter Data
             fprintf(outputFile, "\t\tParameter_Data: ");
-            switch(parameter.Group(i).Parameter(j).Format()) {
+            switch(parameter->Group(i).Parameter(j).Format()) {
             case FORMAT_CHAR: {
-                fprintf(outputFile, "%s\n", parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                if(parameter.Group(i).Parameter(j).ParameterChar() == " ") {
+                fprintf(outputFile, "%s\n", parameter->Group(i).Parameter(j).ParameterChar().c_str());
+                if(parameter->Group(i).Parameter(j).ParameterChar() == " ") {
                     fprintf(outputFile, "\n");
                 }
                 break;
@@ -606,9 +857,9 @@ void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::
             case FORMAT_BYTE: {
                 for(int dim = 0; dim < dim_size; dim++) {
                     if(dim == 0) {
-                        fprintf(outputFile,"%5d\n", parameter.Group(i).Parameter(j).ParameterByte(dim));
+                        fprintf(outputFile,"%5d\n", parameter->Group(i).Parameter(j).ParameterByte(dim));
                     } else {
-                       fprintf(outputFile, "\t\t                %5d\n", parameter.Group(i).Parameter(j).ParameterByte(dim));
+                       fprintf(outputFile, "\t\t                %5d\n", parameter->Group(i).Parameter(j).ParameterByte(dim));
                     }
                 }
                 break;
@@ -616,9 +867,9 @@ void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::
             case FORMAT_INT_16: {
                 for(int dim = 0; dim < dim_size; dim++) {
                     if(dim == 0) {
-                        fprintf(outputFile,"%5d\n", parameter.Group(i).Parameter(j).ParameterInt16(dim));
+                        fprintf(outputFile,"%5d\n", parameter->Group(i).Parameter(j).ParameterInt16(dim));
                     } else {
-                       fprintf(outputFile, "\t\t                %5d\n", parameter.Group(i).Parameter(j).ParameterInt16(dim));
+                       fprintf(outputFile, "\t\t                %5d\n", parameter->Group(i).Parameter(j).ParameterInt16(dim));
                     }
                 }
                 break;
@@ -626,9 +877,9 @@ void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::
             case FORMAT_FLOAT: {
                 for(int dim = 0; dim < dim_size; dim++) {
                     if(dim == 0) {
-                        fprintf(outputFile,"%8.4f\n", parameter.Group(i).Parameter(j).ParameterFloat(dim));
+                        fprintf(outputFile,"%8.4f\n", parameter->Group(i).Parameter(j).ParameterFloat(dim));
                     } else {
-                       fprintf(outputFile, "\t\t                %8.4f\n", parameter.Group(i).Parameter(j).ParameterFloat(dim));
+                       fprintf(outputFile, "\t\t                %8.4f\n", parameter->Group(i).Parameter(j).ParameterFloat(dim));
                     }
                 }
                 break;
@@ -638,7 +889,7 @@ void Parameter_c3d::print_parameter_to_file(Parameter_c3d parameter, const std::
                 break;
             }
 
-            fprintf(outputFile, "\t\tDescription = %s\n\n", parameter.Group(i).Parameter(j).Description().c_str()); //Parameter Description
+            fprintf(outputFile, "\t\tDescription = %s\n\n", parameter->Group(i).Parameter(j).Description().c_str()); //Parameter Description
 
             //fprintf(outputFile, "\n\n");
         }
@@ -653,6 +904,7 @@ void Parameter_c3d::CleanUp(Parameter_c3d* parameter) {
     for(int i = 0; i < parameter->group_size; i++)
         parameter->group[0].CleanUp(&parameter->group[i]);
     free(parameter->group);
+    parameter->index.clear();
 }
 
 /*******************************/
@@ -663,59 +915,15 @@ void Parameter_c3d::CleanUp(Parameter_c3d* parameter) {
 /*   1.TRIAL   */
 /***************/
 
-void Trial::SetTrial(Trial* trial, Parameter_c3d parameter) {
-    //Set Default Values
-    trial->Actual_Start_Field = 0;
-    trial->Actual_Start_Field = 0;
-    trial->Video_Rate_Divider = 0;
-    trial->Camera_Rate = 0.0;
-
-    trial->Date[0] = 0;
-    trial->Date[1] = 0;
-    trial->Date[2] = 0;
-
-    trial->Time[0] = 0;
-    trial->Time[1] = 0;
-    trial->Time[2] = 0;
-
-    for(int i = 0; i < parameter.GroupSize(); i++) {
-        if(parameter.Group(i).Name() == "TRIAL") {
-            for(int j = 0; j < parameter.Group(i).ParameterSize(); j++) {
-
-                if(parameter.Group(i).Parameter(j).Name() == "ACTUAL_START_FIELD") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            trial->Actual_Start_Field = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "ACTUAL_END_FIELD"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            trial->Actual_End_Field = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "VIDEO_RATE_DIVIDER"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            trial->Video_Rate_Divider = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "CAMERA_RATE"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_FLOAT)
-                            trial->Camera_Rate = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "DATE"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 3)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16) {
-                            trial->Date[0] = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                            trial->Date[1] = parameter.Group(i).Parameter(j).ParameterFloat(1);
-                            trial->Date[2] = parameter.Group(i).Parameter(j).ParameterFloat(2);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "TIME"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 3)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16) {
-                            trial->Time[0] = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                            trial->Time[1] = parameter.Group(i).Parameter(j).ParameterFloat(1);
-                            trial->Time[2] = parameter.Group(i).Parameter(j).ParameterFloat(2);
-                        }
-                }
+void Trial::SetTrial(Trial* trial, Parameter_c3d* parameter) {
+    trial->Actual_Start_Field = findInt32(parameter->Find("TRIAL", "ACTUAL_START_FIELD"));
+    trial->Actual_End_Field = findInt32(parameter->Find("TRIAL", "ACTUAL_END_FIELD"));
+    trial->Video_Rate_Divider = (unsigned short int)parameter->FindInt16("TRIAL", "VIDEO_RATE_DIVIDER");
+    trial->Camera_Rate = parameter->FindFloat("TRIAL", "CAMERA_RATE");
 
-            }
-        }
+    for(int i = 0; i < 3; i++) {
+        trial->Date[i] = (unsigned short int)parameter->FindInt16("TRIAL", "DATE", i);
+        trial->Time[i] = (unsigned short int)parameter->FindInt16("TRIAL", "TIME", i);
     }
 }
 
@@ -723,420 +931,57 @@ void Trial::SetTrial(Trial* trial, Parameter_c3d parameter) {
 /*   2.SUBJECTS   */
 /******************/
 
-void Subjects::SetSubjects(Subjects* subjects, Parameter_c3d parameter) {
+void Subjects::SetSubjects(Subjects* subjects, Parameter_c3d* parameter, StringTable* strings) {
     //integers
-    subjects->is_static = 0;
-    subjects->namesSize = 0;
-    subjects->model_paramsSize = 0;
-    subjects->uses_prefixes = 0;
-    subjects->label_prefixesSize = 0;
-    subjects->used = 0;
-    subjects->marker_setsSize = 0;
-    subjects->display_setsSize = 0;
-    subjects->modelsSize = 0;
-
-    //strings
-    subjects->names = new std::string[1];
-    subjects->names[0] = "";
-
-    subjects->model_params = new std::string[1];
-    subjects->model_params[0] = "";
-
-    subjects->label_prefixes = new std::string[1];
-    subjects->label_prefixes[0] = "";
-
-    subjects->marker_sets = new std::string[1];
-    subjects->marker_sets[0] = "";
-
-    subjects->display_sets = new std::string[1];
-    subjects->display_sets[0] = "";
-
-    subjects->models = new std::string[1];
-    subjects->models[0] = "";
-
-    for(int i = 0; i < parameter.GroupSize(); i++) {
-        if(parameter.Group(i).Name() == "SUBJECTS") {
-            for(int j = 0; j < parameter.Group(i).ParameterSize(); j++) {
-
-                if(parameter.Group(i).Parameter(j).Name() == "IS_STATIC") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            subjects->is_static = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "NAMES"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->namesSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->names = new std::string[subjects->namesSize];
-
-                            for(int k = 0; k < namesSize; k++)
-                                subjects->names[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "MODEL_PARAMS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->model_paramsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->model_params = new std::string[subjects->model_paramsSize];
-
-                            for(int k = 0; k < subjects->model_paramsSize; k++)
-                                subjects->model_params[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "USES_PREFIXES") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            subjects->uses_prefixes = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "LABEL_PREFIXES"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->label_prefixesSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->label_prefixes = new std::string[subjects->label_prefixesSize];
-
-                            for(int k = 0; k < subjects->label_prefixesSize; k++)
-                                subjects->label_prefixes[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "USED") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            subjects->used = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "MARKER_SETS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->marker_setsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->marker_sets = new std::string[subjects->marker_setsSize];
-
-                            for(int k = 0; k < subjects->marker_setsSize; k++)
-                                subjects->marker_sets[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "DISPLAY_SETS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->display_setsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->display_sets = new std::string[subjects->display_setsSize];
-
-                            for(int k = 0; k < subjects->marker_setsSize; k++)
-                                subjects->display_sets[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "MODELS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            subjects->modelsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            subjects->models = new std::string[subjects->modelsSize];
-
-                            for(int k = 0; k < subjects->modelsSize; k++)
-                                subjects->models[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                }
-            }
-        }
-    }
-
-
+    subjects->is_static = parameter->FindInt16("SUBJECTS", "IS_STATIC");
+    subjects->uses_prefixes = parameter->FindInt16("SUBJECTS", "USES_PREFIXES");
+    subjects->used = parameter->FindInt16("SUBJECTS", "USED");
+
+    //strings (NULL with size 0 if the parameter doesn't exist)
+    setWords(parameter->Find("SUBJECTS", "NAMES"), strings, &subjects->names, &subjects->namesSize);
+    setWords(parameter->Find("SUBJECTS", "MODEL_PARAMS"), strings, &subjects->model_params, &subjects->model_paramsSize);
+    setWords(parameter->Find("SUBJECTS", "LABEL_PREFIXES"), strings, &subjects->label_prefixes, &subjects->label_prefixesSize);
+    setWords(parameter->Find("SUBJECTS", "MARKER_SETS"), strings, &subjects->marker_sets, &subjects->marker_setsSize);
+    setWords(parameter->Find("SUBJECTS", "DISPLAY_SETS"), strings, &subjects->display_sets, &subjects->display_setsSize);
+    setWords(parameter->Find("SUBJECTS", "MODELS"), strings, &subjects->models, &subjects->modelsSize);
 }
 
 /***************/
 /*   3.POINT   */
 /***************/
 
-void Point::SetPoint(Point* point, Parameter_c3d parameter) {
-    //Used
-    point->used = 0;
-    //Scale
-    point->scale = 0.0;
-    //Rate
-    point->rate = 0.0;
-    //Data Start
-    point->data_start = 0;
-    //Frames
-    point->frames = 0;
-
-    //Labels
-    point->labelsSize = 0;
-    point->labels = new std::string[1];
-    point->labels[0] = "";
-
-    //Description
-    point->descriptionsSize = 0;
-    point->descriptions = new std::string[1];
-    point->descriptions[0] = "";
-
-    //Units
-    point->units = new std::string[1];
-    point->units[0] = "";
-
-    //Initial Command
-    point->initial_command = new std::string[1];
-    point->initial_command[0] = "";
-
-    //X Screen
-    point->x_screen = new std::string[1];
-    point->x_screen[0] = "";
-
-    //Y Screen
-    point->y_screen = new std::string[1];
-    point->y_screen[0] = "";
-
-    //Movie_Delay
-    point->movie_delay = 0.0;
-
-    //Labels2
-    point->labels2Size = 0;
-    point->labels2 = new std::string[1];
-    point->labels2[0] = "";
-
-    //Description2
-    point->descriptions2Size = 0;
-    point->descriptions2 = new std::string[1];
-    point->descriptions2[0] = "";
-
-    //Type Groups
-    point->type_groupsSize = 0;
-    point->type_groups = new std::string[1];
-    point->type_groups[0] = "";
-
-    //Angles
-    point->anglesSize = 0;
-    point->angles = new std::string[1];
-    point->angles[0] = "";
-
-    //Angles Units
-    point->angle_units = new std::string[1];
-    point->angle_units[0] = "";
-
-    //Scalars
-    point->scalarsSize = 0;
-    point->scalars = new std::string[1];
-    point->scalars[0] = "";
-
-    //Scalar Units
-    point->scalar_units = new std::string[1];
-    point->scalar_units[0] = "";
-
-    //Powers
-    point->powersSize = 0;
-    point->powers = new std::string[1];
-    point->powers[0] = "";
-
-    //Power Units
-    point->power_units = new std::string[1];
-    point->power_units[0] = "";
-
-    //Forces
-    point->forcesSize = 0;
-    point->forces = new std::string[1];
-    point->forces[0] = "";
-
-    //Force Units
-    point->force_units = new std::string[1];
-    point->force_units[0] = "";
-
-    //Moments
-    point->momentsSize = 0;
-    point->moments = new std::string[1];
-    point->moments[0] = "";
-
-    //Moment Units
-    point->moment_units = new std::string[1];
-    point->moment_units[0] = "";
-
-    //Reactions
-    point->reactionsSize = 0;
-    point->reactions = new std::string[1];
-    point->reactions[0] = "";/**/
-
-    for(int i = 0; i < parameter.GroupSize(); i++) {
-        if(parameter.Group(i).Name() == "POINT") {
-            for(int j = 0; j < parameter.Group(i).ParameterSize(); j++) {
-
-                if(parameter.Group(i).Parameter(j).Name() == "USED") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            point->used = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "SCALE") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_FLOAT)
-                            point->scale = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "RATE") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_FLOAT)
-                            point->rate = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "DATA_START") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            point->data_start = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "FRAMES") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_INT_16)
-                            point->frames = parameter.Group(i).Parameter(j).ParameterInt16(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "LABELS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->labelsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->labels = new std::string[point->labelsSize];
-
-                            for(int k = 0; k < point->labelsSize; k++)
-                                point->labels[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "DESCRIPTIONS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->descriptionsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->descriptions = new std::string[point->descriptionsSize];
-
-                            for(int k = 0; k < point->descriptionsSize; k++)
-                                point->descriptions[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "INITIAL_COMMAND"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->initial_command[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "X_SCREEN"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->x_screen[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "Y_SCREEN"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->y_screen[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "MOVIE_DELAY") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_FLOAT)
-                            point->movie_delay = parameter.Group(i).Parameter(j).ParameterFloat(0);
-                } else if(parameter.Group(i).Parameter(j).Name() == "LABELS2"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->labels2Size = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->labels2 = new std::string[point->labels2Size];
-
-                            for(int k = 0; k < point->labels2Size; k++)
-                                point->labels2[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "DESCRIPTIONS2"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->descriptions2Size = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->descriptions2 = new std::string[point->descriptions2Size];
-
-                            for(int k = 0; k < point->descriptions2Size; k++)
-                                point->descriptions2[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "TYPE_GROUPS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->type_groupsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->type_groups = new std::string[point->type_groupsSize];
-
-                            for(int k = 0; k < point->type_groupsSize; k++)
-                                point->type_groups[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "ANGLES"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->anglesSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->angles = new std::string[point->anglesSize];
-
-                            for(int k = 0; k < point->anglesSize; k++)
-                                point->angles[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "ANGLE_UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->angle_units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "SCALARS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->scalarsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->scalars = new std::string[point->scalarsSize];
-
-                            for(int k = 0; k < point->scalarsSize; k++)
-                                point->scalars[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "SCALAR_UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->scalar_units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "POWERS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->powersSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->powers = new std::string[point->powersSize];
-
-                            for(int k = 0; k < point->powersSize; k++)
-                                point->powers[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "POWER_UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->power_units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "FORCES"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->forcesSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->forces = new std::string[point->forcesSize];
-
-                            for(int k = 0; k < point->forcesSize; k++)
-                                point->forces[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "FORCE_UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->force_units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "MOMENTS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->momentsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->moments = new std::string[point->momentsSize];
-
-                            for(int k = 0; k < point->momentsSize; k++)
-                                point->moments[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "MOMENT_UNITS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-                            point->moment_units[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                        }
-                } else if(parameter.Group(i).Parameter(j).Name() == "REACTIONS"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR) {
-
-                            point->reactionsSize = wordCounter(parameter.Group(i).Parameter(j).ParameterChar().c_str());
-                            point->reactions = new std::string[point->reactionsSize];
-
-                            for(int k = 0; k < point->reactionsSize; k++)
-                                point->reactions[k] = wordReturn(parameter.Group(i).Parameter(j).ParameterChar().c_str(), k+1);
-                        }
-                }
-            }
-        }
-    }
-
-
+void Point::SetPoint(Point* point, Parameter_c3d* parameter, StringTable* strings) {
+    point->used = (unsigned short int)parameter->FindInt16("POINT", "USED");
+    point->scale = parameter->FindFloat("POINT", "SCALE");
+    point->rate = parameter->FindFloat("POINT", "RATE");
+    point->data_start = (unsigned short int)parameter->FindInt16("POINT", "DATA_START");
+    point->frames = (unsigned short int)parameter->FindInt16("POINT", "FRAMES");
+    point->long_frames = findLongFrames(parameter);
+    point->movie_delay = parameter->FindFloat("POINT", "MOVIE_DELAY");
+
+    //Lists (NULL with size 0 if the parameter doesn't exist)
+    setWords(parameter->Find("POINT", "LABELS"), strings, &point->labels, &point->labelsSize);
+    setWords(parameter->Find("POINT", "DESCRIPTIONS"), strings, &point->descriptions, &point->descriptionsSize);
+    setWords(parameter->Find("POINT", "LABELS2"), strings, &point->labels2, &point->labels2Size);
+    setWords(parameter->Find("POINT", "DESCRIPTIONS2"), strings, &point->descriptions2, &point->descriptions2Size);
+    setWords(parameter->Find("POINT", "TYPE_GROUPS"), strings, &point->type_groups, &point->type_groupsSize);
+    setWords(parameter->Find("POINT", "ANGLES"), strings, &point->angles, &point->anglesSize);
+    setWords(parameter->Find("POINT", "SCALARS"), strings, &point->scalars, &point->scalarsSize);
+    setWords(parameter->Find("POINT", "POWERS"), strings, &point->powers, &point->powersSize);
+    setWords(parameter->Find("POINT", "FORCES"), strings, &point->forces, &point->forcesSize);
+    setWords(parameter->Find("POINT", "MOMENTS"), strings, &point->moments, &point->momentsSize);
+    setWords(parameter->Find("POINT", "REACTIONS"), strings, &point->reactions, &point->reactionsSize);
+
+    //Strings (empty if the parameter doesn't exist)
+    point->units = setString(parameter->Find("POINT", "UNITS"), strings);
+    point->initial_command = setString(parameter->Find("POINT", "INITIAL_COMMAND"), strings);
+    point->x_screen = setString(parameter->Find("POINT", "X_SCREEN"), strings);
+    point->y_screen = setString(parameter->Find("POINT", "Y_SCREEN"), strings);
+    point->angle_units = setString(parameter->Find("POINT", "ANGLE_UNITS"), strings);
+    point->scalar_units = setString(parameter->Find("POINT", "SCALAR_UNITS"), strings);
+    point->power_units = setString(parameter->Find("POINT", "POWER_UNITS"), strings);
+    point->force_units = setString(parameter->Find("POINT", "FORCE_UNITS"), strings);
+    point->moment_units = setString(parameter->Find("POINT", "MOMENT_UNITS"), strings);
 }
 
 float Point::MultiplierForMeters(Point point) {
@@ -1216,40 +1061,203 @@ GeoPoint Point::CheckScreens(Point point, const float X, const float Y, const fl
 
 }
 
-/**********************/
-/*   8.MANUFACTURER   */
-/**********************/
+/****************/
+/*   4.ANALOG   */
+/****************/
+
+void Analog::SetAnalog(Analog* analog, Parameter_c3d* parameter, StringTable* strings) {
+    analog->used = parameter->FindInt16("ANALOG", "USED");
+    analog->gen_scale = parameter->FindFloat("ANALOG", "GEN_SCALE", 0, 1.0);
+    analog->rate = parameter->FindFloat("ANALOG", "RATE");
+    analog->bits = parameter->FindInt16("ANALOG", "BITS");
+
+    setWords(parameter->Find("ANALOG", "LABELS"), strings, &analog->labels, &analog->labelsSize);
+    setWords(parameter->Find("ANALOG", "DESCRIPTIONS"), strings, &analog->descriptions, &analog->descriptionsSize);
+    setWords(parameter->Find("ANALOG", "UNITS"), strings, &analog->units, &analog->unitsSize);
+    analog->format = setString(parameter->Find("ANALOG", "FORMAT"), strings);
+
+    //Per channel arrays (one value per channel, missing values use the defaults of the accessors)
+    analog->scaleSize = setFloats(parameter->Find("ANALOG", "SCALE"), &analog->scale);
+    analog->offsetSize = setInt16s(parameter->Find("ANALOG", "OFFSET"), &analog->offset);
+    analog->gainSize = setInt16s(parameter->Find("ANALOG", "GAIN"), &analog->gain);
+}
 
-void Manufacturer::SetManufacturer(Manufacturer* manufacturer, Parameter_c3d parameter) {
-    manufacturer->company = new std::string[1];
-    manufacturer->software = new std::string[1];
-    manufacturer->version = new std::string[1];
-
-    manufacturer->company[0] = "";
-    manufacturer->software[0] = "";
-    manufacturer->version[0] = "";
-
-    for(int i = 0; i < parameter.GroupSize(); i++) {
-        if(parameter.Group(i).Name() == "MANUFACTURER") {
-            for(int j = 0; j < parameter.Group(i).ParameterSize(); j++) {
-
-                if(parameter.Group(i).Parameter(j).Name() == "COMPANY") {
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR)
-                            manufacturer->company[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                } else if(parameter.Group(i).Parameter(j).Name() == "SOFTWARE"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR)
-                            manufacturer->software[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                } else if(parameter.Group(i).Parameter(j).Name() == "VERSION" || parameter.Group(i).Parameter(j).Name() == "VERSION_LABEL"){
-                    if(parameter.Group(i).Parameter(j).DimensionsSize() > 0)
-                        if(parameter.Group(i).Parameter(j).Format() == FORMAT_CHAR)
-                            manufacturer->version[0] = parameter.Group(i).Parameter(j).ParameterChar();
-                }
-            }
+void Analog::CleanUp(Analog* analog) {
+    free(analog->scale);
+    free(analog->offset);
+    free(analog->gain);
+
+    analog->scale = NULL;
+    analog->offset = NULL;
+    analog->gain = NULL;
+    analog->scaleSize = analog->offsetSize = analog->gainSize = 0;
+}
+
+/************************/
+/*   5.FORCE_PLATFORM   */
+/************************/
+
+void Force_Platform::SetForcePlatform(Force_Platform* platform, Parameter_c3d* parameter) {
+    platform->used = parameter->FindInt16("FORCE_PLATFORM", "USED");
+    platform->zero[0] = parameter->FindInt16("FORCE_PLATFORM", "ZERO", 0);
+    platform->zero[1] = parameter->FindInt16("FORCE_PLATFORM", "ZERO", 1);
+
+    platform->typeSize = setInt16s(parameter->Find("FORCE_PLATFORM", "TYPE"), &platform->type);
+    platform->cornersSize = setFloats(parameter->Find("FORCE_PLATFORM", "CORNERS"), &platform->corners);
+    platform->originSize = setFloats(parameter->Find("FORCE_PLATFORM", "ORIGIN"), &platform->origin);
+
+    Parameter_Parameter_C3D* channel = parameter->Find("FORCE_PLATFORM", "CHANNEL");
+    platform->channelSize = setInt16s(channel, &platform->channel);
+    platform->channelRows = platform->channelSize > 0 && channel->DimensionsSize() > 0 ? channel->Dimension(0) : 0;
+
+    Parameter_Parameter_C3D* cal = parameter->Find("FORCE_PLATFORM", "CAL_MATRIX");
+    platform->cal_matrixSize = setFloats(cal, &platform->cal_matrix);
+    platform->calRows = platform->cal_matrixSize > 0 && cal->DimensionsSize() > 1 ? cal->Dimension(0) : 0;
+    platform->calColumns = platform->cal_matrixSize > 0 && cal->DimensionsSize() > 1 ? cal->Dimension(1) : 0;
+}
+
+void Force_Platform::CleanUp(Force_Platform* platform) {
+    free(platform->type);
+    free(platform->corners);
+    free(platform->origin);
+    free(platform->channel);
+    free(platform->cal_matrix);
+
+    platform->type = NULL;
+    platform->corners = NULL;
+    platform->origin = NULL;
+    platform->channel = NULL;
+    platform->cal_matrix = NULL;
+    platform->used = 0;
+    platform->typeSize = platform->cornersSize = platform->originSize = platform->channelSize = platform->cal_matrixSize = 0;
+}
+
+/***********************/
+/*   6.Event_Context   */
+/***********************/
+
+int Event_Context::Find(std::string_view label) {
+    for(int i = 0; i < labelsSize; i++)
+        if(labels[i] == label)
+            return i;
+
+    return -1;
+}
+
+void Event_Context::SetEventContext(Event_Context* context, Parameter_c3d* parameter, StringTable* strings) {
+    context->used = parameter->FindInt16("EVENT_CONTEXT", "USED");
+
+    setWords(parameter->Find("EVENT_CONTEXT", "LABELS"), strings, &context->labels, &context->labelsSize);
+    setWords(parameter->Find("EVENT_CONTEXT", "DESCRIPTIONS"), strings, &context->descriptions, &context->descriptionsSize);
+    context->icon_idsSize = setInt16s(parameter->Find("EVENT_CONTEXT", "ICON_IDS"), &context->icon_ids);
+    context->coloursSize = setInt16s(parameter->Find("EVENT_CONTEXT", "COLOURS"), &context->colours);
+}
+
+void Event_Context::CleanUp(Event_Context* context) {
+    free(context->icon_ids);
+    free(context->colours);
+
+    context->icon_ids = NULL;
+    context->colours = NULL;
+    context->used = context->labelsSize = context->descriptionsSize = context->icon_idsSize = context->coloursSize = 0;
+}
+
+/***************/
+/*   7.EVENT   */
+/***************/
+
+int Event::Previous(const int frame) {
+    //Last event with frames[i] < frame
+    return (int)(std::lower_bound(frames, frames + eventSize, frame) - frames) - 1;
+}
 
+int Event::Next(const int frame) {
+    //First event with frames[i] > frame
+    int index = (int)(std::upper_bound(frames, frames + eventSize, frame) - frames);
+    return index < eventSize ? index : -1;
+}
+
+void Event::Range(const int firstFrame, const int lastFrame, int* first, int* last) {
+    *first = (int)(std::lower_bound(frames, frames + eventSize, firstFrame) - frames);
+    *last = (int)(std::upper_bound(frames, frames + eventSize, lastFrame) - frames);
+}
+
+void Event::SetEvent(Event* event, Parameter_c3d* parameter, Header_c3d header, StringTable* strings, const float rate, const long long firstFrame) {
+    std::vector<EventEntry> list;
+
+    int used = parameter->FindInt16("EVENT", "USED");
+    Parameter_Parameter_C3D* times = parameter->Find("EVENT", "TIMES");
+    if(used > 0 && times != NULL && times->Format() == FORMAT_FLOAT && times->DataSize() >= 2*used) {
+        const std::string_view* labels; int labelsSize;
+        const std::string_view* contexts; int contextsSize;
+        const std::string_view* subjects; int subjectsSize;
+        const std::string_view* descriptions; int descriptionsSize;
+        short int* icons;
+
+        setWords(parameter->Find("EVENT", "LABELS"), strings, &labels, &labelsSize);
+        setWords(parameter->Find("EVENT", "CONTEXTS"), strings, &contexts, &contextsSize);
+        setWords(parameter->Find("EVENT", "SUBJECTS"), strings, &subjects, &subjectsSize);
+        setWords(parameter->Find("EVENT", "DESCRIPTIONS"), strings, &descriptions, &descriptionsSize);
+        int iconsSize = setInt16s(parameter->Find("EVENT", "ICON_IDS"), &icons);
+
+        for(int i = 0; i < used; i++) {
+            EventEntry entry;
+            entry.time = times->ParameterFloat(2*i)*60.0 + times->ParameterFloat(2*i + 1); //minutes, seconds
+            entry.label = i < labelsSize ? labels[i] : std::string_view();
+            entry.context = i < contextsSize ? contexts[i] : std::string_view();
+            entry.subject = i < subjectsSize ? subjects[i] : std::string_view();
+            entry.description = i < descriptionsSize ? descriptions[i] : std::string_view();
+            entry.iconId = i < iconsSize ? icons[i] : 0;
+            list.push_back(entry);
+        }
+        free(icons);
+    } else {
+        //Header events (4 character labels)
+        for(int i = 0; i < header.EventTime() && i < header.eventTime_size; i++) {
+            EventEntry entry;
+            entry.time = header.EventTimeSec(i);
+            entry.label = strings->Intern(StringTable::Trim(std::string_view(header.EventLabel(i), 4)));
+            entry.iconId = 0;
+            list.push_back(entry);
         }
     }
+
+    //Time (seconds from frame 1) to frame index of the data (clamped: a window of a long trial is far from most events)
+    for(size_t i = 0; i < list.size(); i++) {
+        long long frame = (long long)floor(list[i].time*rate + 0.5) + 1 - firstFrame;
+        list[i].frame = (int)(frame < INT_MIN ? INT_MIN : (frame > INT_MAX ? INT_MAX : frame));
+    }
+
+    std::stable_sort(list.begin(), list.end(), [](const EventEntry& a, const EventEntry& b) {return a.time < b.time;});
+
+    event->eventSize = (int)list.size();
+    event->events = new EventEntry[event->eventSize + 1];
+    event->frames = (int*)malloc((event->eventSize + 1)*sizeof(int));
+    for(int i = 0; i < event->eventSize; i++) {
+        event->events[i] = list[i];
+        event->frames[i] = list[i].frame;
+    }
+}
+
+void Event::CleanUp(Event* event) {
+    delete[] event->events;
+    free(event->frames);
+
+    event->events = NULL;
+    event->frames = NULL;
+    event->eventSize = 0;
+}
+
+/**********************/
+/*   8.MANUFACTURER   */
+/**********************/
+
+void Manufacturer::SetManufacturer(Manufacturer* manufacturer, Parameter_c3d* parameter, StringTable* strings) {
+    manufacturer->company = setString(parameter->Find("MANUFACTURER", "COMPANY"), strings);
+    manufacturer->software = setString(parameter->Find("MANUFACTURER", "SOFTWARE"), strings);
+    manufacturer->version = setString(parameter->Find("MANUFACTURER", "VERSION_LABEL"), strings);
+    if(manufacturer->version.empty())
+        manufacturer->version = setString(parameter->Find("MANUFACTURER", "VERSION"), strings);
 }
 
 /****************************************/
@@ -1272,83 +1280,275 @@ void Relocation_C3D::SetRelocation(Relocation_C3D* rel, Frames_C3D frame1, Frame
     }
 }
 
-void Frames_C3D::ReadFrame(Frames_C3D* frame, FILE* file, const int pointSize, const int analogSize, const float pointScale, const int endianFlag) {
-    frame->points = (Points_C3D*)malloc(pointSize*sizeof(Points_C3D));
-    frame->analog = (Analog_C3D*)malloc(analogSize*sizeof(Analog_C3D));
-
-    int index;
+//Points of a frame (generic path: the format and the byte order are tested for every point and word)
+static void decodePointsGeneric(Points_C3D* points, const char* buffer, const int pointSize, const float pointScale, const int endianFlag) {
     for(int i = 0; i < pointSize; i++) {
-        index = i;
         if(pointScale < 0) {
-            float buf_x = 0.0;
-            float buf_y = 0.0;
-            float buf_z = 0.0;
-            float buf_word_4_f = 0.0;
-            short int buf_cam = 0.0;
-            short int buf_res = 0.0;
-
-            readWordWithEndian(&buf_x, SIZE_32_BIT, file, endianFlag);
-            readWordWithEndian(&buf_y, SIZE_32_BIT, file, endianFlag);
-            readWordWithEndian(&buf_z, SIZE_32_BIT, file, endianFlag);
-            readWordWithEndian(&buf_word_4_f, SIZE_32_BIT, file, endianFlag);
-
-            buf_cam = returnByte((short int)buf_word_4_f, 1);
-            buf_res = returnByte((short int)buf_word_4_f, 2);
-
-            frame->points[0].SetPoint(&frame->points[index], buf_x, buf_y, buf_z, (float) buf_cam, buf_res*(-pointScale));
+            const char* word = &buffer[i*4*SIZE_32_BIT];
+            float buf_x = bufferWord<float>(&word[0], endianFlag);
+            float buf_y = bufferWord<float>(&word[4], endianFlag);
+            float buf_z = bufferWord<float>(&word[8], endianFlag);
+            float buf_word_4_f = bufferWord<float>(&word[12], endianFlag);
+
+            short int buf_cam = returnByte((short int)buf_word_4_f, 1);
+            short int buf_res = returnByte((short int)buf_word_4_f, 2);
+            float residual = buf_word_4_f < 0 ? -1.0 : buf_res*(-pointScale); //negative word 4: invalid sample
+
+            points[0].SetPoint(&points[i], buf_x, buf_y, buf_z, (float) buf_cam, residual);
         } else {
-            short int buf_x = 0;
-            short int buf_y = 0;
-            short int buf_z = 0;
-            short int buf_cam = 0;
-            short int buf_res = 0;
-
-            readWordWithEndian(&buf_x, SIZE_16_BIT, file, endianFlag);
-            readWordWithEndian(&buf_y, SIZE_16_BIT, file, endianFlag);
-            readWordWithEndian(&buf_z, SIZE_16_BIT, file, endianFlag);
-            readWordWithEndian(&buf_cam, SIZE_8_BIT, file, endianFlag);
-            readWordWithEndian(&buf_res, SIZE_8_BIT, file, endianFlag);
-
-            frame->points[0].SetPoint(&frame->points[i], (float) buf_x*pointScale, (float) buf_y*pointScale, (float) buf_z*pointScale, (float) buf_cam, (float) buf_res*pointScale);
+            const char* word = &buffer[i*4*SIZE_16_BIT];
+            short int buf_x = bufferWord<short int>(&word[0], endianFlag);
+            short int buf_y = bufferWord<short int>(&word[2], endianFlag);
+            short int buf_z = bufferWord<short int>(&word[4], endianFlag);
+            short int buf_cam = (unsigned char)word[6];
+            short int buf_res = (unsigned char)word[7];
+            float residual = bufferWord<short int>(&word[6], endianFlag) < 0 ? -1.0 : (float) buf_res*pointScale; //negative word 4: invalid sample
+
+            points[0].SetPoint(&points[i], (float) buf_x*pointScale, (float) buf_y*pointScale, (float) buf_z*pointScale, (float) buf_cam, residual);
         }
-        i = index;
     }
+}
 
-    for(int i = 0; i < analogSize; i++) {
-        if(pointScale < 0) {
-            float buf_analog = 0.0;
+//Points of a frame, the format is fixed at compile time (Float: float32 words, Swap: the file has the other byte order)
+template <bool Float, bool Swap>
+static void decodePoints(Points_C3D* points, const char* buffer, const int pointSize, const float pointScale) {
+    if(Float) {
+        const float residualScale = -pointScale;
+        for(int i = 0; i < pointSize; i++) {
+            const char* word = &buffer[i*4*SIZE_32_BIT];
+            float word4 = loadWord<float, Swap>(&word[12]);
+            short int cameraResidual = (short int)word4; //cameras in the low byte, residual in the high byte
+            float camera = (float)(cameraResidual & 0xFF);
+            float residual = word4 < 0 ? -1.0f : ((cameraResidual >> 8) & 0xFF)*residualScale; //negative word 4: invalid sample
+
+            points[0].SetPoint(&points[i], loadWord<float, Swap>(&word[0]), loadWord<float, Swap>(&word[4]), loadWord<float, Swap>(&word[8]),
+                               camera, residual);
+        }
+    } else {
+        for(int i = 0; i < pointSize; i++) {
+            const char* word = &buffer[i*4*SIZE_16_BIT];
+            float camera = (unsigned char)word[6];
+            float residual = loadWord<short int, Swap>(&word[6]) < 0 ? -1.0f : (unsigned char)word[7]*pointScale; //negative word 4: invalid sample
 
-            readWordWithEndian(&buf_analog, SIZE_32_BIT, file, endianFlag);
+            points[0].SetPoint(&points[i], loadWord<short int, Swap>(&word[0])*pointScale, loadWord<short int, Swap>(&word[2])*pointScale,
+                               loadWord<short int, Swap>(&word[4])*pointScale, camera, residual);
+        }
+    }
+}
 
-            frame->analog[0].SetAnalog(&frame->analog[i], buf_analog);
-        } else {
-            short int buf_analog = 0.0;
+//Raw analog samples of a frame (analogPerFrame samples, each one with every channel), the format is fixed at compile time
+template <bool Float, bool Swap, bool Unsigned>
+static void decodeAnalog(float* analog, const char* buffer, const DecodeLayout* layout, const int frame) {
+    const int wordSize = Float ? SIZE_32_BIT : SIZE_16_BIT;
+    const int channels = layout->analogChannels;
+    const size_t channelStride = (size_t)layout->analogSamples;
+
+    for(int s = 0; s < layout->analogPerFrame; s++) {
+        float* sample = &analog[(size_t)frame*layout->analogPerFrame + s];
+        const char* word = &buffer[s*channels*wordSize];
+        for(int c = 0; c < channels; c++) {
+            float value;
+            if(Float)
+                value = loadWord<float, Swap>(&word[c*wordSize]);
+            else if(Unsigned)
+                value = loadWord<unsigned short int, Swap>(&word[c*wordSize]);
+            else
+                value = loadWord<short int, Swap>(&word[c*wordSize]);
+            sample[c*channelStride] = value;
+        }
+    }
+}
 
-            readWordWithEndian(&buf_analog, SIZE_16_BIT, file, endianFlag);
+//Points and analog samples of a frame (one instance per format, see Data_c3d::SelectDecoder)
+template <bool Float, bool Swap, bool Analog>
+static void decodeFrame(Points_C3D* points, float* analog, const char* buffer, const DecodeLayout* layout, const int frame) {
+    decodePoints<Float, Swap>(points, buffer, layout->pointSize, layout->pointScale);
 
-            frame->analog[0].SetAnalog(&frame->analog[i], buf_analog/pointScale);
-        }
+    if(Analog) {
+        const char* analogBuffer = &buffer[layout->pointSize*4*(Float ? SIZE_32_BIT : SIZE_16_BIT)];
+        if(!Float && layout->analogUnsigned)
+            decodeAnalog<Float, Swap, true>(analog, analogBuffer, layout, frame);
+        else
+            decodeAnalog<Float, Swap, false>(analog, analogBuffer, layout, frame);
     }
 }
 
+//Points and analog samples of a frame of VAX floats: the words of the frame are converted to IEEE in bulk,
+//then the frame is decoded as an IEEE float frame in system byte order
+template <bool Swap, bool Analog>
+static void decodeVaxFrame(Points_C3D* points, float* analog, const char* buffer, const DecodeLayout* layout, const int frame) {
+    thread_local std::vector<float> words;
+    int size = layout->pointSize*4 + (Analog ? layout->analogPerFrame*layout->analogChannels : 0);
+    words.resize(size + 1);
+
+    bufferFloats(words.data(), buffer, size, (Swap ? DIFF_ENDIAN : SAME_ENDIAN) | DEC_FLOAT);
+    decodeFrame<true, false, Analog>(points, analog, (const char*)words.data(), layout, frame);
+}
+
+void Frames_C3D::ReadFrame(Frames_C3D* frame, const char* buffer, const int pointSize, const float pointScale, const int endianFlag) {
+    frame->points = (Points_C3D*)malloc(pointSize*sizeof(Points_C3D));
+    decodePointsGeneric(frame->points, buffer, pointSize, pointScale, endianFlag);
+}
+
+void Frames_C3D::AllocateFrame(Frames_C3D* frame, const int pointSize) {
+    frame->points = (Points_C3D*)malloc((pointSize > 0 ? pointSize : 1)*sizeof(Points_C3D));
+}
+
+void Frames_C3D::SetFrame(Frames_C3D* frame, const Points_C3D* points, const int pointSize) {
+    frame->points = (Points_C3D*)malloc((pointSize > 0 ? pointSize : 1)*sizeof(Points_C3D));
+    memcpy(frame->points, points, pointSize*sizeof(Points_C3D));
+}
+
 void Frames_C3D::CleanUp(Frames_C3D* frame) {
     free(frame->points);
-    free(frame->analog);
 }
 
-void Data_c3d::ReadData(Data_c3d* data, FILE* file, const int frameSize, const int pointSize, const int analogSize, const float pointScale, const int endianFlag) {
+void Data_c3d::ReadData(Data_c3d* data, FILE* file, const int frameSize, const int stride, const int pointSize, const float pointScale,
+                        const int analogWords, const int analogChannels, const int analogPerFrame, const bool analogUnsigned, const int endianFlag) {
+    PROFILE_SCOPE("C3D data");
+
     data->frames = (Frames_C3D*)malloc(frameSize*sizeof(Frames_C3D));
     data->relocation = (Relocation_C3D*)malloc(1*sizeof(Relocation_C3D));
 
+    //Decimated trials keep one analog sample per frame: the mean of the samples of its span (a box low-pass at the new frame rate)
+    int samplesKept = stride > 1 ? 1 : analogPerFrame;
+    bool average = stride > 1 && analogChannels > 0 && analogPerFrame > 0;
+    data->analogChannels = analogChannels;
+    data->analogPerFrame = samplesKept;
+    data->analogSamples = frameSize*samplesKept;
+    data->analog = (float*)calloc((size_t)analogChannels*data->analogSamples + 1, sizeof(float));
+
+    //The decoder of the format is chosen once for the file
+    DecodeLayout layout;
+    layout.pointSize = pointSize;
+    layout.pointScale = pointScale;
+    layout.endianFlag = endianFlag;
+    layout.analogChannels = analogChannels;
+    layout.analogPerFrame = samplesKept;
+    layout.analogSamples = data->analogSamples;
+    layout.analogUnsigned = analogUnsigned;
+    FrameDecoder decode = SelectDecoder(pointScale, endianFlag, analogChannels > 0 && samplesKept > 0);
+
+    //Span of a decimated frame: every raw sample of the stride frames (the analog words only, without points)
+    DecodeLayout span = layout;
+    span.pointSize = 0;
+    span.analogPerFrame = analogPerFrame;
+    span.analogSamples = stride*analogPerFrame;
+    std::vector<float> spanSamples(average ? (size_t)analogChannels*span.analogSamples : 0);
+    if(average) {
+        layout = span;
+        layout.pointSize = pointSize;
+    }
+
+    //One read per frame (points followed by the analog words)
+    int frameBytes = (int)FrameBytes(pointSize, pointScale, analogWords);
+    int pointBytes = (int)FrameBytes(pointSize, pointScale, 0);
+    int analogBytes = frameBytes - pointBytes;
+    std::vector<char> buffer(frameBytes + 1, 0);
+    long long bytesRead = 0;
+
     for(int i = 0; i < frameSize; i++) {
-        data->frames[0].ReadFrame(&data->frames[i], file, pointSize, analogSize, pointScale, endianFlag);
+        size_t read = fread(buffer.data(), 1, frameBytes, file);
+        bytesRead += read;
+        if((int)read < frameBytes) //Truncated file (the missing values are zero)
+            memset(&buffer[read], 0, frameBytes - read);
+
+        data->frames[0].AllocateFrame(&data->frames[i], pointSize);
+        decode(data->frames[i].PointPointer(0), average ? spanSamples.data() : data->analog, buffer.data(), &layout, average ? 0 : i);
+
+        //Skip the frames between two decoded frames (their analog words are read for the mean, the last frame has no span)
+        int spanFrames = 1;
+        if(stride > 1 && i < frameSize - 1) {
+            if(average) {
+                for(; spanFrames < stride; spanFrames++) {
+                    fseeko(file, (off_t)pointBytes, SEEK_CUR);
+                    read = fread(buffer.data(), 1, analogBytes, file);
+                    bytesRead += read;
+                    if((int)read < analogBytes)
+                        break;
+                    decode(NULL, spanSamples.data(), buffer.data(), &span, spanFrames);
+                }
+            } else {
+                fseeko(file, (off_t)(stride - 1)*frameBytes, SEEK_CUR);
+            }
+        }
+
+        if(average) {
+            int samples = spanFrames*analogPerFrame;
+            for(int c = 0; c < analogChannels; c++) {
+                const float* raw = &spanSamples[(size_t)c*span.analogSamples];
+                double sum = 0.0;
+                for(int s = 0; s < samples; s++)
+                    sum += raw[s];
+                data->analog[(size_t)c*data->analogSamples + i] = (float)(sum / samples);
+            }
+        }
+    }
+
+    PROFILE_COUNT(PROFILE_BYTES_READ, bytesRead);
+    PROFILE_COUNT(PROFILE_FRAMES_DECODED, frameSize);
+    PROFILE_COUNT(PROFILE_ALLOCATIONS, 4 + frameSize); //frames, relocation, analog, buffer and the points of every frame
+
+    {
+        PROFILE_SCOPE("C3D relocation");
+        data->relocation[0].SetRelocation(&data->relocation[0], frames[0], frames[frameSize-1], pointSize);
+    }
+}
+
+FrameDecoder Data_c3d::SelectDecoder(const float pointScale, const int endianFlag, const bool analog) {
+    static const FrameDecoder decoders[8] = {decodeFrame<false, false, false>, decodeFrame<false, false, true>,
+                                             decodeFrame<false, true, false>, decodeFrame<false, true, true>,
+                                             decodeFrame<true, false, false>, decodeFrame<true, false, true>,
+                                             decodeFrame<true, true, false>, decodeFrame<true, true, true>};
+    static const FrameDecoder vaxDecoders[4] = {decodeVaxFrame<false, false>, decodeVaxFrame<false, true>,
+                                                decodeVaxFrame<true, false>, decodeVaxFrame<true, true>};
+
+    int swap = endianFlag & DIFF_ENDIAN ? 2 : 0;
+    if(pointScale < 0 && (endianFlag & DEC_FLOAT))
+        return vaxDecoders[swap + (analog ? 1 : 0)]; //DEC integers are read as Intel ones
+    return decoders[(pointScale < 0 ? 4 : 0) + swap + (analog ? 1 : 0)];
+}
+
+void Data_c3d::DecodeFrameGeneric(Points_C3D* points, float* analog, const char* buffer, const DecodeLayout* layout, const int frame) {
+    decodePointsGeneric(points, buffer, layout->pointSize, layout->pointScale, layout->endianFlag);
+
+    //Raw analog samples: analogPerFrame samples, each one with every channel
+    int wordSize = layout->pointScale < 0 ? SIZE_32_BIT : SIZE_16_BIT;
+    const char* analogBuffer = &buffer[layout->pointSize*4*wordSize];
+    for(int s = 0; s < layout->analogPerFrame; s++) {
+        int sample = frame*layout->analogPerFrame + s;
+        for(int c = 0; c < layout->analogChannels; c++) {
+            const char* word = &analogBuffer[(s*layout->analogChannels + c)*wordSize];
+            float value;
+            if(wordSize == SIZE_32_BIT)
+                value = bufferWord<float>(word, layout->endianFlag);
+            else if(layout->analogUnsigned)
+                value = bufferWord<unsigned short int>(word, layout->endianFlag);
+            else
+                value = bufferWord<short int>(word, layout->endianFlag);
+
+            analog[(size_t)c*layout->analogSamples + sample] = value;
+        }
     }
+}
 
-    data->relocation[0].SetRelocation(&data->relocation[0], frames[0], frames[frameSize-1], pointSize);
+void Data_c3d::CalibrateAnalog(Data_c3d* data, Analog analog) {
+    PROFILE_SCOPE("C3D analog calibration");
 
+    #pragma omp parallel for if((size_t)data->analogChannels*data->analogSamples > 65536)
+    for(int c = 0; c < data->analogChannels; c++) {
+        const float offset = analog.OffsetValue(c);
+        const float scale = analog.Scale(c) * analog.GenScale();
+        float* samples = &data->analog[(size_t)c*data->analogSamples];
+        const int sampleSize = data->analogSamples;
+
+        #pragma omp simd
+        for(int s = 0; s < sampleSize; s++)
+            samples[s] = (samples[s] - offset) * scale;
+    }
 }
 
-void Data_c3d::print_point_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int pointSize) {
+void Data_c3d::print_point_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int pointSize, const long long firstFrame) {
     FILE* outputFile;
 
     outputFile = fopen(fileName.c_str(), "w");
@@ -1359,7 +1559,7 @@ void Data_c3d::print_point_data_to_file(Data_c3d data, const std::string fileNam
     }
     fprintf(outputFile, "\n");
     for(int i = 0; i < frameSize; i++) {
-        fprintf(outputFile, "%d", i+1);
+        fprintf(outputFile, "%lld", firstFrame + i);
         for(int j = 0; j < pointSize; j++) {
             fprintf(outputFile, ";%f;%f;%f;%f;%f", data.Frame(i).Point(j).X(), data.Frame(i).Point(j).Y(), data.Frame(i).Point(j).Z(), data.Frame(i).Point(j).Camera(), data.Frame(i).Point(j).Residual());
         }
@@ -1369,20 +1569,21 @@ void Data_c3d::print_point_data_to_file(Data_c3d data, const std::string fileNam
     fclose(outputFile);
 }
 
-void Data_c3d::print_analog_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int analogSize) {
+void Data_c3d::print_analog_data_to_file(Data_c3d data, const std::string fileName, const long long firstFrame) {
     FILE* outputFile;
 
     outputFile = fopen(fileName.c_str(), "w");
 
-    fprintf(outputFile, "FrameNumber");
-    for(int i = 0; i < analogSize; i++) {
+    fprintf(outputFile, "FrameNumber;SampleNumber");
+    for(int i = 0; i < data.analogChannels; i++) {
         fprintf(outputFile, ";Analog_%d", i+1);
     }
     fprintf(outputFile, "\n");
-    for(int i = 0; i < frameSize; i++) {
-        fprintf(outputFile, "%d", i+1);
-        for(int j = 0; j < analogSize; j++) {
-            fprintf(outputFile, ";%f", data.Frame(i).Analog(j).AnalogPoint());
+    int sampleSize = data.analogChannels > 0 ? data.analogSamples : 0;
+    for(int i = 0; i < sampleSize; i++) {
+        fprintf(outputFile, "%lld;%d", firstFrame + i/data.analogPerFrame, i%data.analogPerFrame + 1);
+        for(int j = 0; j < data.analogChannels; j++) {
+            fprintf(outputFile, ";%f", data.AnalogSample(j, i));
         }
         fprintf(outputFile, "\n");
     }
@@ -1390,39 +1591,137 @@ void Data_c3d::print_analog_data_to_file(Data_c3d data, const std::string fileNa
     fclose(outputFile);
 }
 
+void Data_c3d::SetData(Data_c3d* data, const Points_C3D* points, const int frameSize, const int pointSize,
+                       const float* analog, const int analogChannels, const int analogPerFrame) {
+    data->frames = (Frames_C3D*)malloc(frameSize*sizeof(Frames_C3D));
+    data->relocation = (Relocation_C3D*)malloc(1*sizeof(Relocation_C3D));
+    for(int i = 0; i < frameSize; i++)
+        data->frames[0].SetFrame(&data->frames[i], &points[(size_t)i*pointSize], pointSize);
+
+    data->analogChannels = analogChannels;
+    data->analogPerFrame = analogPerFrame;
+    data->analogSamples = frameSize*analogPerFrame;
+    size_t analogSize = (size_t)analogChannels*data->analogSamples;
+    data->analog = (float*)malloc((analogSize + 1)*sizeof(float));
+    memcpy(data->analog, analog, analogSize*sizeof(float));
+
+    data->relocation[0].SetRelocation(&data->relocation[0], data->frames[0], data->frames[frameSize-1], pointSize);
+}
+
 void Data_c3d::CleanUp(Data_c3d* data, const int frameSize) {
     for(int i = 0; i < frameSize; i++)
         data->frames[0].CleanUp(&data->frames[i]);
     free(data->frames);
+    free(data->analog);
+    data->analog = NULL;
+    data->analogChannels = data->analogSamples = 0;
 }
 
 /****************************************/
 /*               Read_c3d               */
 /****************************************/
 
-void Read_C3D::Import(std::string fileName, QWidget* widget, Read_C3D* c3d_f)
+void Read_C3D::Import(std::string fileName, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame, const long long lastFrame, const int stride)
 {
+    PROFILE_SCOPE("Read_C3D::Import");
+
     FILE* openFile = fopen(fileName.c_str(), "rb"); // Open C3D File
     // Error Checking
     if(openFile == NULL) {
         QMessageBox::warning(widget, "Error", "File cannot open!");
+        return ;
+    }
+
+    DataLayout layout;
+    if(!c3d_f->ReadMetadata(openFile, widget, c3d_f, firstFrame, lastFrame, stride, &layout)) {
         fclose(openFile);
         return ;
     }
 
+    fseeko(openFile, (off_t)layout.dataOffset, SEEK_SET);
+    c3d_f->dataBlock.ReadData(&c3d_f->dataBlock, openFile, layout.frameSize, layout.stride, layout.pointSize, layout.pointScale,
+                              layout.analogWords, layout.analogChannels, layout.analogPerFrame, layout.analogUnsigned, layout.endianFlag);
+    c3d_f->dataBlock.CalibrateAnalog(&c3d_f->dataBlock, c3d_f->analog);
+
+    fclose(openFile);
+}
+
+bool Read_C3D::ImportDecoded(const char* metadata, const size_t metadataSize, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame, const long long lastFrame, const int stride,
+                             const Points_C3D* points, const int frameSize, const int pointSize, const float* analog, const int analogChannels, const int analogPerFrame) {
+    PROFILE_SCOPE("Read_C3D::ImportDecoded");
+
+    //The parameter readers take a FILE*: read the header and the parameters from memory
+    FILE* openFile = fmemopen(const_cast<char*>(metadata), metadataSize, "rb");
+    if(openFile == NULL)
+        return false;
+
+    DataLayout layout;
+    bool result = c3d_f->ReadMetadata(openFile, widget, c3d_f, firstFrame, lastFrame, stride, &layout);
+    fclose(openFile);
+    if(!result || layout.frameSize != frameSize || layout.pointSize != pointSize) {
+        if(result)
+            c3d_f->CleanUpParameters(c3d_f); //there is no data block to free
+        return false;
+    }
+
+    c3d_f->dataBlock.SetData(&c3d_f->dataBlock, points, frameSize, pointSize, analog, analogChannels, analogPerFrame);
+    return true;
+}
+
+bool Read_C3D::ImportMetadata(std::string fileName, Read_C3D* c3d_f) {
+    PROFILE_SCOPE("Read_C3D::ImportMetadata");
+
+    FILE* openFile = fopen(fileName.c_str(), "rb");
+    if(openFile == NULL)
+        return false;
+
+    //Files ReadMetadata would refuse (with a warning) are refused here without one
+    Header_c3d header;
+    header.read_header_block(openFile, &header);
+    if(header.NumberID() != 80 && header.ParameterBlock() > 1) {
+        fclose(openFile);
+        return false;
+    }
+    fseek(openFile, 0, SEEK_SET);
+
+    DataLayout layout;
+    bool result = c3d_f->ReadMetadata(openFile, NULL, c3d_f, 0, 0, 1, &layout);
+    fclose(openFile);
+    return result;
+}
+
+bool Read_C3D::ReadFrameRange(std::string fileName, long long* firstFrame, long long* lastFrame) {
+    Read_C3D* probe = new Read_C3D;
+    bool result = probe->ImportMetadata(fileName, probe);
+    if(result) {
+        *firstFrame = probe->FirstFrame();
+        *lastFrame = probe->LastFrame();
+        probe->CleanUpMetadata(probe);
+    }
+    delete probe;
+
+    return result;
+}
+
+bool Read_C3D::ReadMetadata(FILE* openFile, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame, const long long lastFrame, const int stride, DataLayout* layout) {
     c3d_f->isOpen = true;
 
     //Read Header Block
-    c3d_f->headerBlock.read_header_block(openFile, &c3d_f->headerBlock);
+    {
+        PROFILE_SCOPE("C3D header");
+        c3d_f->headerBlock.read_header_block(openFile, &c3d_f->headerBlock);
+        PROFILE_COUNT(PROFILE_BYTES_READ, ftell(openFile));
+    }
     //Error Checking
     if(c3d_f->headerBlock.NumberID() != 80 && c3d_f->headerBlock.ParameterBlock() > 1) {
         QMessageBox::warning(widget, "Error", "This file isn't ADTech format.");
-        fclose(openFile);
-        return ;
+        return false;
     }
 
     //c3d_f->parameterBlock = (Parameter_c3d*)malloc(1*sizeof(Parameter_c3d));
-    //Read Parameter Header Block
+    //Read Parameter Header Block (first block of the parameter section)
+    if(c3d_f->headerBlock.ParameterBlock() > 1)
+        fseek(openFile, (long)(c3d_f->headerBlock.ParameterBlock()-1)*512, SEEK_SET);
     c3d_f->parameterBlock.ReadHeaderParameterBlock(openFile, &c3d_f->parameterBlock);
     //Set Endians
     if(sys_endian::little_endian())
@@ -1439,32 +1738,127 @@ void Read_C3D::Import(std::string fileName, QWidget* widget, Read_C3D* c3d_f)
         endian_flag = DIFF_ENDIAN;
     }
 
-    c3d_f->parameterBlock.ReadGroupParameterBlock(openFile, &c3d_f->parameterBlock, endian_flag);
-
-    c3d_f->trial.SetTrial(&c3d_f->trial, c3d_f->parameterBlock);
-    c3d_f->subjects.SetSubjects(&c3d_f->subjects, c3d_f->parameterBlock);
-    c3d_f->point.SetPoint(&c3d_f->point, c3d_f->parameterBlock);
-
-    c3d_f->manufacturer.SetManufacturer(&c3d_f->manufacturer, c3d_f->parameterBlock);
+    //DEC files are little endian with VAX floats (header, parameters, points and analog)
+    if(parameterBlock.Header().ProcessorType() == PROCESSOR_DEC) {
+        c3d_f->headerBlock.decHeader(&c3d_f->headerBlock);
+        endian_flag |= DEC_FLOAT;
+    }
 
+    c3d_f->parameterBlock.ReadGroupParameterBlock(openFile, &c3d_f->parameterBlock, endian_flag);
 
+    //Layout of the data section (as written in the file)
     int pointSize = c3d_f->Header().NumberOfPoints();
     float pointScale = c3d_f->Header().ScaleFactor();
+    int analogWords = c3d_f->Header().NumberOfAnalog(); //channels * samples per frame (header words 3 and 10)
+    int analogPerFrame = c3d_f->Header().AnalogPerFrame() > 0 ? c3d_f->Header().AnalogPerFrame() : 1;
+    long long fileFirst, fileLast;
+    fileFrames(c3d_f->Header(), &c3d_f->parameterBlock, &fileFirst, &fileLast);
+
+    //Frame range and stride to decode (the decoded frames are counted in 32 bits: see GLWidget::OpenC3D for longer trials)
+    int step = stride > 1 ? stride : 1;
+    long long first = firstFrame > fileFirst ? (firstFrame < fileLast ? firstFrame : fileLast) : fileFirst;
+    long long last = lastFrame > 0 && lastFrame < fileLast ? lastFrame : fileLast;
+    if(last < first)
+        last = first;
+    if((last - first) / step + 1 > INT_MAX)
+        last = first + (long long)(INT_MAX - 1)*step;
+    int frameSize = (int)((last - first) / step + 1);
+
+    if(first != fileFirst || last != fileLast || step > 1)
+        c3d_f->SetFrameRange(c3d_f, fileFirst, first, frameSize, step, analogPerFrame);
+    c3d_f->firstFrame = (first - 1) / step + 1;
+    c3d_f->frameSize = frameSize;
+
+    //Decode the groups
+    {
+        PROFILE_SCOPE("C3D groups");
+        c3d_f->trial.SetTrial(&c3d_f->trial, &c3d_f->parameterBlock);
+        c3d_f->subjects.SetSubjects(&c3d_f->subjects, &c3d_f->parameterBlock, &c3d_f->strings);
+        c3d_f->point.SetPoint(&c3d_f->point, &c3d_f->parameterBlock, &c3d_f->strings);
+        c3d_f->analog.SetAnalog(&c3d_f->analog, &c3d_f->parameterBlock, &c3d_f->strings);
+        c3d_f->forcePlatform.SetForcePlatform(&c3d_f->forcePlatform, &c3d_f->parameterBlock);
+        c3d_f->eventContext.SetEventContext(&c3d_f->eventContext, &c3d_f->parameterBlock, &c3d_f->strings);
+        c3d_f->event.SetEvent(&c3d_f->event, &c3d_f->parameterBlock, c3d_f->headerBlock, &c3d_f->strings,
+                              c3d_f->point.Rate() > 0 ? c3d_f->point.Rate() : c3d_f->headerBlock.FrameRate(), c3d_f->firstFrame);
+
+        c3d_f->manufacturer.SetManufacturer(&c3d_f->manufacturer, &c3d_f->parameterBlock, &c3d_f->strings);
+    }
 
-    int analogSize = c3d_f->Header().NumberOfAnalog();
-
-    int frameSize = c3d_f->Header().LastFrame() - c3d_f->Header().FirstFrame() + 1;
 
-    c3d_f->dataBlock.ReadData(&c3d_f->dataBlock, openFile, frameSize, pointSize, analogSize, pointScale, endian_flag);
+    int analogChannels = c3d_f->analog.Used();
+    if(analogChannels <= 0 || analogChannels*analogPerFrame > analogWords)
+        analogChannels = analogWords / analogPerFrame;
+
+    //Data section starts at POINT:DATA_START (or at the header pointer if the parameter is missing), then seek to the first frame
+    int dataStart = c3d_f->point.DataStart() > 0 ? c3d_f->point.DataStart() : c3d_f->Header().DataStart();
+    long long frameBytes = Data_c3d::FrameBytes(pointSize, pointScale, analogWords);
+
+    layout->dataStart = dataStart;
+    layout->dataOffset = (long long)(dataStart-1)*512 + (long long)(first - fileFirst)*frameBytes;
+    layout->frameSize = frameSize;
+    layout->stride = step;
+    layout->pointSize = pointSize;
+    layout->pointScale = pointScale;
+    layout->analogWords = analogWords;
+    layout->analogChannels = analogChannels;
+    layout->analogPerFrame = analogPerFrame;
+    layout->analogUnsigned = c3d_f->analog.IsUnsigned() && pointScale >= 0;
+    layout->endianFlag = endian_flag;
+    return true;
+}
 
-    fclose(openFile);
+void Read_C3D::SetFrameRange(Read_C3D* c3d_f, const long long fileFirst, const long long first, const int frameSize, const int stride, const int analogPerFrame) {
+    Parameter_c3d* parameter = &c3d_f->parameterBlock;
+    float rate = parameter->FindFloat("POINT", "RATE", 0, c3d_f->headerBlock.FrameRate());
+
+    //Frames of the new rate (the first frame keeps its time when first-1 is a multiple of the stride)
+    long long newFirst = (first - 1) / stride + 1;
+    long long newLast = newFirst + frameSize - 1;
+    int samplesKept = stride > 1 ? 1 : analogPerFrame;
+    int analogWords = c3d_f->headerBlock.NumberOfAnalog() / analogPerFrame * samplesKept;
+    //The gap is counted in frames of the new rate (rounded up: a gap the file allows to fill stays fillable)
+    int maxGap = c3d_f->headerBlock.MaxGap() > 0 ? (c3d_f->headerBlock.MaxGap() + stride - 1) / stride : c3d_f->headerBlock.MaxGap();
+    c3d_f->headerBlock.SetFrames(&c3d_f->headerBlock, (int)(newFirst < MAX_HEADER_FRAME ? newFirst : MAX_HEADER_FRAME),
+                                 (int)(newLast < MAX_HEADER_FRAME ? newLast : MAX_HEADER_FRAME), c3d_f->headerBlock.FrameRate() / stride, analogWords, samplesKept, maxGap);
+
+    setInt16(parameter, "POINT", "FRAMES", 0, (short int)(frameSize < MAX_HEADER_FRAME ? frameSize : MAX_HEADER_FRAME));
+    Parameter_Parameter_C3D* longFrames = parameter->Find("POINT", "LONG_FRAMES");
+    if(longFrames != NULL && longFrames->Format() == FORMAT_FLOAT)
+        setFloat(parameter, "POINT", "LONG_FRAMES", 0, (float)frameSize);
+    else
+        setInt32(parameter, "POINT", "LONG_FRAMES", (unsigned int)frameSize);
+    setFloat(parameter, "POINT", "RATE", 0, rate / stride);
+    if(stride > 1)
+        setFloat(parameter, "ANALOG", "RATE", 0, rate / stride);
+
+    //Camera fields of the decoded frames (2 words: low and high 16 bits). A decimated trial records every
+    //stride-th field: its VIDEO_RATE_DIVIDER is multiplied by the stride (without the parameter the fields count frames)
+    int divider = parameter->FindInt16("TRIAL", "VIDEO_RATE_DIVIDER", 0, 1);
+    divider = divider > 0 ? divider : 1;
+    bool hasDivider = parameter->Find("TRIAL", "VIDEO_RATE_DIVIDER") != NULL;
+    Parameter_Parameter_C3D* start = parameter->Find("TRIAL", "ACTUAL_START_FIELD");
+    if(start != NULL && start->Format() == FORMAT_INT_16) {
+        unsigned int startField = findInt32(start) + (unsigned int)(first - fileFirst)*divider;
+        unsigned int endField = startField + (unsigned int)(frameSize - 1)*(hasDivider ? stride*divider : 1);
+
+        setInt32(parameter, "TRIAL", "ACTUAL_START_FIELD", startField);
+        setInt32(parameter, "TRIAL", "ACTUAL_END_FIELD", endField);
+        setInt16(parameter, "TRIAL", "VIDEO_RATE_DIVIDER", 0, (short int)(divider*stride));
+    }
 }
 
 void Read_C3D::CleanUp(Read_C3D* c3d_f) {
-    int frameSize = c3d_f->Header().LastFrame() - c3d_f->Header().FirstFrame() + 1;
-    c3d_f->dataBlock.CleanUp(&c3d_f->dataBlock, frameSize);
+    c3d_f->dataBlock.CleanUp(&c3d_f->dataBlock, c3d_f->frameSize);
+    c3d_f->CleanUpParameters(c3d_f);
+}
 
+void Read_C3D::CleanUpParameters(Read_C3D* c3d_f) {
     c3d_f->parameterBlock.CleanUp(&c3d_f->parameterBlock);
+    c3d_f->analog.CleanUp(&c3d_f->analog);
+    c3d_f->forcePlatform.CleanUp(&c3d_f->forcePlatform);
+    c3d_f->eventContext.CleanUp(&c3d_f->eventContext);
+    c3d_f->event.CleanUp(&c3d_f->event);
+    c3d_f->strings.CleanUp();
 
     c3d_f->isOpen = false;
 }
@@ -3,8 +3,12 @@
 #define READ_C3D_H
 
 #include <iostream>
+#include <string_view>
+#include <unordered_map>
 #include <QWidget>
 
+#include "string_table.h"
+
 /***********/
 /* DEFINES */
 /***********/
@@ -28,9 +32,12 @@
 
 #define SAME_ENDIAN 0
 #define DIFF_ENDIAN 1
+#define DEC_FLOAT   2 //Flag bit (with SAME_ENDIAN/DIFF_ENDIAN): floats are VAX F-floats (DEC processor files)
 
 #define MAX_DIMENSIONS 7
 
+#define MAX_HEADER_FRAME 65535 //Largest frame number of the 16-bit header words (longer trials: TRIAL fields, POINT:LONG_FRAMES)
+
 /****************/
 /*  STRUCTURES  */
 /****************/
@@ -77,8 +84,8 @@ public:
     inline short int NumberID(void) {return id_number;}
     inline short int NumberOfPoints(void) {return points_number;}
     inline short int NumberOfAnalog(void) {return analog_number;}
-    inline short int FirstFrame(void) {return first_frame;}
-    inline short int LastFrame(void) {return last_frame;}
+    inline int FirstFrame(void) {return (unsigned short int)first_frame;} //unsigned 16-bit word (1 - 65535)
+    inline int LastFrame(void) {return (unsigned short int)last_frame;}
     inline short int MaxGap(void) {return maximum_interpolation_gap;}
     inline float ScaleFactor(void) {return scale_factor;}
     inline short int DataStart(void) {return data_start_block;}
@@ -134,6 +141,13 @@ public:
     /*If File Endian is different than System Endian then swap header values*/
     void swapHeader(Header_c3d* header);
 
+    /*Convert the header floats of a DEC processor file (VAX F-floats) to IEEE*/
+    void decHeader(Header_c3d* header);
+
+    /*Set the frame range, frame rate, analog words and maximum gap of a cropped/decimated trial (frames above 65535 are saturated)*/
+    void SetFrames(Header_c3d* header, const int firstFrame, const int lastFrame, const float frameRate,
+                   const int analogWords, const int analogPerFrame, const int maxGap);
+
     /*Print Header block to file*/
     void print_header_to_file(Header_c3d header, const std::string fileName);
 
@@ -205,16 +219,28 @@ public:
     inline short int DimensionsSize(void) {return number_of_dimensions;} //return number_of_dimensions
     inline short int Dimension(const int index) {return parameter_dimensions[index];} //parameter_dimensions
 
+    //return the number of data elements (1 for scalars)
+    inline int DataSize(void) {
+        int size = 1;
+        for(int i = 0; i < number_of_dimensions; i++)
+            size *= parameter_dimensions[i];
+        return size;
+    }
+
     inline std::string ParameterChar(void) {return parameter_data_char;} //return parameter_data_char
+    inline const char* ParameterCharData(void) {return parameter_data_char;} //return the raw (not NUL trimmed) characters
     inline short int ParameterByte(const int index) {return parameter_data_byte[index];} //return parameter_data_byte
     inline short int ParameterInt16(const int index) {return parameter_data_16_int[index];} //return parameter_data_16_int
     inline float ParameterFloat(const int index) {return parameter_data_float[index];} //return parameter_data_float
 
+    inline void SetParameterInt16(const int index, const short int value) {parameter_data_16_int[index] = value;} //set parameter_data_16_int
+    inline void SetParameterFloat(const int index, const float value) {parameter_data_float[index] = value;} //set parameter_data_float
+
     inline short int DescriptionSize(void) {return description_number;} //return description_number
     inline std::string Description(void) {return description;} //return description
 
-    //Read Parameter Block
-    bool ReadParameterBlock(FILE* file, Parameter_Parameter_C3D& parameter, const int endianFlag);
+    //Read Parameter Block from a memory buffer (returns the bytes read, 0 if the record is broken)
+    int ReadParameterBlock(const char* buffer, const int size, Parameter_Parameter_C3D& parameter, const int endianFlag);
 
     //Clean Memory
     void CleanUp(Parameter_Parameter_C3D& parameter);
@@ -274,14 +300,19 @@ public:
 
     inline short int ParameterSize(void) {return parameter_size;} //return parameter_size
     inline Parameter_Parameter_C3D Parameter(const int index) {
-        if(index > 127 || index < 0) {
+        if(index >= parameter_size || index < 0) {
             return parameter[0];
         } else
             return parameter[index];
     }
 
-    //Check if it's group or parameter, then if it's group read group
-    bool ReadGroupBlock(FILE* file, Parameter_Group_C3D& group, const int endianFlag, const bool isGroup);
+    inline Parameter_Parameter_C3D* ParameterPointer(const int index) {return &parameter[index];} //return a pointer to the parameter (no copy)
+
+    //Read Group Block from a memory buffer and allocate room for its parameters (returns the bytes read, 0 if the record is broken)
+    int ReadGroupBlock(const char* buffer, const int size, Parameter_Group_C3D& group, const int endianFlag, const int parameterSize);
+
+    //Read a Parameter Block of this group from a memory buffer
+    bool AddParameter(const char* buffer, const int size, Parameter_Group_C3D& group, const int endianFlag);
 
     //Clean Memory
     void CleanUp(Parameter_Group_C3D* group);
@@ -300,7 +331,7 @@ private:
     char* group_name;
 
     //a signed integer offset in bytes pointing to the start of the next group/parameter.
-    short int next_group_parameter_start = 1;
+    short int next_group_parameter_start;
 
     //number of characters in the description
     short int description_number;
@@ -319,7 +350,7 @@ public:
 
     inline short int GroupSize(void) {return group_size;}
     inline Parameter_Group_C3D Group(const int index) {
-        if(index > 127 || index < 0) {
+        if(index >= group_size || index < 0) {
             return group[0];
         } else {
             return group[index];
@@ -329,11 +360,22 @@ public:
     //Read Header Parameter Block
     void ReadHeaderParameterBlock(FILE* file, Parameter_c3d* parameter);
 
-    //Read Group Parameter Block
+    //Read Group Parameter Block (the whole section is loaded with one read, size from the parameter header)
     void ReadGroupParameterBlock(FILE* file, Parameter_c3d* parameter, const int endianFlag);
 
+    //Parse the groups/parameters of a parameter section in memory (records are walked by their next pointers)
+    void ReadGroupParameterBlock(const char* buffer, const int size, Parameter_c3d* parameter, const int endianFlag);
+
+    //Return the parameter GROUP:NAME from the index (NULL if the file doesn't have it)
+    Parameter_Parameter_C3D* Find(const std::string group, const std::string name);
+
+    //Typed lookups - return value when the parameter doesn't exist, has another format or index is out of range
+    short int FindInt16(const std::string group, const std::string name, const int index = 0, const short int value = 0);
+    float FindFloat(const std::string group, const std::string name, const int index = 0, const float value = 0.0);
+    std::string FindChar(const std::string group, const std::string name, const std::string value = "");
+
     //Print Parameter Block
-    void print_parameter_to_file(Parameter_c3d parameter, const std::string fileName);
+    void print_parameter_to_file(Parameter_c3d* parameter, const std::string fileName);
 
     //Clean Memory
     void CleanUp(Parameter_c3d* parameter);
@@ -343,6 +385,12 @@ private:
 
     short int group_size;
     Parameter_Group_C3D* group;
+
+    //"GROUP:PARAMETER" -> parameter (built once after reading the parameter section)
+    std::unordered_map<std::string, Parameter_Parameter_C3D*> index;
+
+    //Build the GROUP:PARAMETER index
+    void BuildIndex(Parameter_c3d* parameter);
 };
 
 /*******************************/
@@ -382,7 +430,7 @@ public:
     inline unsigned int Minutes(void) {return Time[1];}
     inline unsigned int Seconds(void) {return Time[2];}
 
-    inline void SetTrial(Trial* trial, Parameter_c3d parameter);
+    void SetTrial(Trial* trial, Parameter_c3d* parameter);
 
 private:
 
@@ -450,36 +498,36 @@ public:
 
     //Names
     inline int NamesSize() {return namesSize;}
-    inline std::string Names(const int index) {return names[index];}
+    inline std::string_view Names(const int index) {return index >= 0 && index < namesSize ? names[index] : std::string_view();}
 
     //ModelParams
     inline int ModelParamsSize() {return model_paramsSize;}
-    inline std::string ModelParams(const int index) {return model_params[index];}
+    inline std::string_view ModelParams(const int index) {return index >= 0 && index < model_paramsSize ? model_params[index] : std::string_view();}
 
     //UsesPrefixes
     inline short int UsesPrefixes() {return uses_prefixes;}
 
     //LabelPrefixes
     inline int LabelPrefixesSize() {return label_prefixesSize;}
-    inline std::string LabelPrefixes(const int index) {return label_prefixes[index];}
+    inline std::string_view LabelPrefixes(const int index) {return index >= 0 && index < label_prefixesSize ? label_prefixes[index] : std::string_view();}
 
     //Used
     inline short int Used() {return used;}
 
     //MarkerSets
     inline int MarkerSetsSize() {return marker_setsSize;}
-    inline std::string MarkerSets(const int index) {return marker_sets[index];}
+    inline std::string_view MarkerSets(const int index) {return index >= 0 && index < marker_setsSize ? marker_sets[index] : std::string_view();}
 
     //DisplaySet
     inline int DisplaySetSize() {return display_setsSize;}
-    inline std::string DisplaySets(const int index) {return display_sets[index];}
+    inline std::string_view DisplaySets(const int index) {return index >= 0 && index < display_setsSize ? display_sets[index] : std::string_view();}
 
     //Models
     inline int ModelsSize() {return modelsSize;}
-    inline std::string Models(const int index) {return models[index];}
+    inline std::string_view Models(const int index) {return index >= 0 && index < modelsSize ? models[index] : std::string_view();}
 
     //Set Subject Values
-    void SetSubjects(Subjects* subjects, Parameter_c3d parameter);
+    void SetSubjects(Subjects* subjects, Parameter_c3d* parameter, StringTable* strings);
 
 private:
     /*A single signed integer variable, this is set to 1 if the trial subjects were captured in a
@@ -497,7 +545,7 @@ private:
     the C3D file is empty. This parameter must serve some function but it is going to
     remain a mystery to anyone who opens the C3D file.*/
     int namesSize;
-    std::string* names;
+    const std::string_view* names;
 
     /*The SUBJECTS:MODEL_PARAMS parameter is an array of ASCII character strings that
     contain the marker set names used in the trial. These identify the model parameter
@@ -520,7 +568,7 @@ private:
     parameter section. Data stored as parameters is preserved and is accessible to
     anyone reading the file.*/
     int model_paramsSize;
-    std::string* model_params;
+    const std::string_view* model_params;
 
     /*A single signed integer variable, this is set to 1 if the trial subjects are identified by
     prefixing the subject name to the point label, otherwise set to 0 . The manufacturers’
@@ -541,7 +589,7 @@ private:
     subject name but with a colon ‘:’ suffix e.g., “ FRED: ” where the NAMES parameter
     contains “ FRED ” without the colon.*/
     int label_prefixesSize;
-    std::string* label_prefixes;
+    const std::string_view* label_prefixes;
 
     /*A single signed integer variable that stores the number of named subjects in the trial.
     It is set to 0 in C3D files where specific subjects were not used or for trials that
@@ -558,13 +606,13 @@ private:
     The parameter contains only the filename – both the file type (i.e. MKR etc) and the
     path or location of the file are omitted from the parameter.*/
     int marker_setsSize;
-    std::string* marker_sets;
+    const std::string_view* marker_sets;
 
     /*This is an array of ASCII strings that identify the active display set within the marker
     set for each subject ordered as in the POINT:NAMES parameter. If this parameter is
     blank then the first display set should be used.*/
     int display_setsSize;
-    std::string* display_sets;
+    const std::string_view* display_sets;
 
     /*An array of ASCII strings containing marker set names. These identify the model
     filenames for each subject ordered as in NAMES. Each subject may use a different
@@ -579,7 +627,7 @@ private:
     much better, if the model information is important, to include it within the C3D file –
     either as a group or a set of parameters.*/
     int modelsSize;
-    std::string* models;
+    const std::string_view* models;
 
 };
 
@@ -627,82 +675,85 @@ public:
     //Frames
     inline int Frames(void) {return frames;}
 
+    //Long Frames (0 if the parameter doesn't exist)
+    inline long long LongFrames(void) {return long_frames;}
+
     //Labels
     inline int LabelsSize(void) {return labelsSize;}
-    inline std::string Labels(const int index) { if(index < labelsSize) return labels[index]; else return "";}
+    inline std::string_view Labels(const int index) {return index >= 0 && index < labelsSize ? labels[index] : std::string_view();}
 
     //Descriptions
     inline int DescriptionsSize(void) {return descriptionsSize;}
-    inline std::string Descriptions(const int index) {return descriptions[index];}
+    inline std::string_view Descriptions(const int index) {return index >= 0 && index < descriptionsSize ? descriptions[index] : std::string_view();}
 
     //Units
-    inline std::string Units(void) {return units[0];}
+    inline std::string_view Units(void) {return units;}
 
     //Initial Command
-    inline std::string InitialCommand(void) {return initial_command[0];}
+    inline std::string_view InitialCommand(void) {return initial_command;}
 
     //X Screen
-    inline std::string X_Screen(void) {return x_screen[0];}
+    inline std::string_view X_Screen(void) {return x_screen;}
 
     //Y Screen
-    inline std::string Y_Screen(void) {return y_screen[0];}
+    inline std::string_view Y_Screen(void) {return y_screen;}
 
     //Movie Delay
     inline float MovieDelay(void) {return movie_delay;}
 
     //Labels2
     inline int Labels2Size(void) {return labels2Size;}
-    inline std::string Labels2(const int index) {return labels2[index];}
+    inline std::string_view Labels2(const int index) {return index >= 0 && index < labels2Size ? labels2[index] : std::string_view();}
 
     //Descriptions
     inline int Descritpions2Size(void) {return descriptions2Size;}
-    inline std::string Descriptions2(const int index) {return descriptions2[index];}
+    inline std::string_view Descriptions2(const int index) {return index >= 0 && index < descriptions2Size ? descriptions2[index] : std::string_view();}
 
     //Type Groups
     inline int TypeGroupsSize(void) {return type_groupsSize;}
-    inline std::string TypeGroups(const int index) {return type_groups[index];}
+    inline std::string_view TypeGroups(const int index) {return index >= 0 && index < type_groupsSize ? type_groups[index] : std::string_view();}
 
     //Angles
     inline int AnglesSize(void) {return anglesSize;}
-    inline std::string Angles(const int index) {return angles[index];}
+    inline std::string_view Angles(const int index) {return index >= 0 && index < anglesSize ? angles[index] : std::string_view();}
 
     //Angle Units
-    inline std::string AngleUnits(void) {return angle_units[0];}
+    inline std::string_view AngleUnits(void) {return angle_units;}
 
     //Scalars
     inline int ScalarsSize(void) {return scalarsSize;}
-    inline std::string Scalars(const int index) {return scalars[index];}
+    inline std::string_view Scalars(const int index) {return index >= 0 && index < scalarsSize ? scalars[index] : std::string_view();}
 
     //Scalar Units
-    inline std::string ScalarUnits(void) {return scalar_units[0];}
+    inline std::string_view ScalarUnits(void) {return scalar_units;}
 
     //Powers
     inline int PowersSize(void) {return powersSize;}
-    inline std::string Powers(const int index) {return powers[index];}
+    inline std::string_view Powers(const int index) {return index >= 0 && index < powersSize ? powers[index] : std::string_view();}
 
     //Power Units
-    inline std::string PowerUnits(void) {return power_units[0];}
+    inline std::string_view PowerUnits(void) {return power_units;}
 
     //Forces
     inline int ForcesSize(void) {return forcesSize;}
-    inline std::string Forces(const int index) {return forces[index];}
+    inline std::string_view Forces(const int index) {return index >= 0 && index < forcesSize ? forces[index] : std::string_view();}
 
     //Force Units
-    inline std::string ForceUnits(void) {return force_units[0];}
+    inline std::string_view ForceUnits(void) {return force_units;}
 
     //Momets
     inline int MomentsSize(void) {return momentsSize;}
-    inline std::string Moments(const int index) {return moments[index];}
+    inline std::string_view Moments(const int index) {return index >= 0 && index < momentsSize ? moments[index] : std::string_view();}
 
     //Moment Units
-    inline std::string MomentUnits(void) {return moment_units[0];}
+    inline std::string_view MomentUnits(void) {return moment_units;}
 
     //Reactions
     inline int ReactionsSize(void) {return reactionsSize;}
-    inline std::string Reactions(const int index) {return reactions[index];}
+    inline std::string_view Reactions(const int index) {return index >= 0 && index < reactionsSize ? reactions[index] : std::string_view();}
 
     //Set Point Values
-    void SetPoint(Point* point, Parameter_c3d parameter);
+    void SetPoint(Point* point, Parameter_c3d* parameter, StringTable* strings);
 
     float MultiplierForMeters(Point point);
     GeoPoint CheckScreens(Point point, const float X, const float Y, const float Z, const float DR);
@@ -825,6 +876,11 @@ private:
     will be necessary to interpret the header frame numbers as unsigned integers.*/
     int frames;
 
+    /*POINT:LONG_FRAMES is not part of the C3D specification: it is written by Vicon
+    software with the number of frames of trials longer than 65535 frames, as a floating-
+    point value (some writers use two integers, least significant word first).*/
+    long long long_frames;
+
     /*The POINT:LABELS parameter is a character data array that consists of one unique
     four-character ASCII value for each 3D data point contained within the C3D file. By
     convention, the parameters are usually four characters of upper-case standard ASCII
@@ -860,7 +916,7 @@ private:
     applications may create labels that are larger. It is recommended that the
     POINT:LABELS values are consistent within a set of data files.*/
     int labelsSize;
-    std::string* labels;
+    const std::string_view* labels;
 
     /*The POINT:DESCRIPTIONS parameter is a character data array that usually consists
     of a short description of each 3D data point referenced by the POINT:LABELS
@@ -882,7 +938,7 @@ private:
     “landmarks” such as LASI, RKNE etc. These names generally have longer
     POINT:DESCRIPTIONS such as Left ASIS Marker and Right Knee Marker.*/
     int descriptionsSize;
-    std::string* descriptions;
+    const std::string_view* descriptions;
 
     /*The POINT:UNITS parameter is a single four-character value that records the units of
     distance measurement used by the 3D data e.g. mm, cm, m etc. POINT:UNITS is
@@ -894,7 +950,7 @@ private:
     POINT:UNITS from “ mm ” to “ cm ” will not re-scale the coordinate system used to
     generate the 3D data points unless this is a feature that is specifically implemented in
     your software application.*/
-    std::string* units;
+    std::string_view units;
 
     /*The POINT:INITIAL_COMMAND parameter is a single ASCII character string
     (character data type) that contains an optional command string that can be read when
@@ -910,7 +966,7 @@ private:
     Since any application or user can access this parameter, it would be a good idea if the
     program that utilizes the values performed a thorough syntax checks on contents to
     make sure that they are correct.*/
-    std::string* initial_command;
+    std::string_view initial_command;
 
     /*This is a two-character ASCII string containing a sign together with a single
     character ( +X, +Y, +Z, -X, -Y, -Z ) that indicates which axis of the reference
@@ -921,7 +977,7 @@ private:
     C3D files it seems that most software applications ignore them. Remember that
     setting a C3D parameter to a particular value will only be effective if the software
     application reading the C3D file implements the parameter.*/
-    std::string* x_screen;
+    std::string_view x_screen;
 
     /*Like the X_SCREEN above , this is an ASCII string containing a sign together with a
     single character ( +X, +Y, +Z, -X, -Y, -Z ). This is used by software applications to
@@ -933,7 +989,7 @@ private:
     the parameter as an array, e.g., SCREEN(1,2 ). However, this might not have been as
     intuitive for a casual user to edit or use. Creating two separate parameters was a
     good decision as it makes the function of both values clear.*/
-    std::string* y_screen;
+    std::string_view y_screen;
 
     /*This is a single floating-point value that records the synchronization offset, in
     seconds and fractions of a second, between frame 1 of the trial and the start of
@@ -968,7 +1024,7 @@ private:
     applications may have problems interpreting these labels unless they treat the
     parameter index as unsigned.*/
     int labels2Size;
-    std::string* labels2;
+    const std::string_view* labels2;
 
     /*This is another array of character strings with an entry to match each LABELS2 value.
     This parameter is synchronized with the LABELS2 parameter and contains additional
@@ -984,7 +1040,7 @@ private:
     applications to handle this at the same time that support was added for the LABELS2
     parameter.*/
     int descriptions2Size;
-    std::string* descriptions2;
+    const std::string_view* descriptions2;
 
     /*This parameter is one of a suite of parameters that are added to C3D files by
     applications that store the results of kinematic calculations in C3D files by storing
@@ -1000,16 +1056,16 @@ private:
     corresponding POINT parameter listing the marker labels that correspond to that type
     group.*/
     int type_groupsSize;
-    std::string* type_groups;
+    const std::string_view* type_groups;
 
     /*This is an array of ASCII character string labels that match strings used in
     POINT:LABELS and are used to identify trajectories stored in the 3D data section. 3D
     trajectories that match strings in POINT:ANGLES should be treated as three-
     dimensional angles measured in degrees.*/
     int anglesSize;
-    std::string* angles;
+    const std::string_view* angles;
 
-    std::string* angle_units;
+    std::string_view angle_units;
 
     /*An array of ASCII character labels. 3D point trajectories with labels matching those
     in POINT:SCALARS are to be treated as scalars rather than 3D co-ordinates. The
@@ -1017,11 +1073,11 @@ private:
     The units (if any) depend on the meaning of each scalar according to the model that
     produced them and are recorded in the parameter POINT:SCALAR_UNITS .*/
     int scalarsSize;
-    std::string* scalars;
+    const std::string_view* scalars;
 
     /*A single ASCII string that stores the measurement units used by the scalar values
     (e.g. mm, M etc.,) stored in the C3D file.*/
-    std::string* scalar_units;
+    std::string_view scalar_units;
 
     /*This is an array of ASCII character labels. 3D trajectories with labels matching
     those in this list are to be treated as powers rather than 3D points. Since powers are
@@ -1029,31 +1085,31 @@ private:
     set to zero. See the parameter POINT:POWER_UNITS parameter for units used to
     store the powers.*/
     int powersSize;
-    std::string* powers;
+    const std::string_view* powers;
 
     /*This is a single ASCII string that stores the measurement units used by the power
     values, e.g. mW, W, kW etc., and stored in the C3D file.*/
-    std::string* power_units;
+    std::string_view power_units;
 
     /*This is an array of ASCII character labels. Trajectories with labels matching those in
     this list are to be treated as forces rather than 3D coordinates. See the parameter
     POINT:FORCE_UNITS for the units used to store the forces.*/
     int forcesSize;
-    std::string* forces;
+    const std::string_view* forces;
 
     /*A single ASCII string that stores the measurement units used by the force values, e.g.
     N, kN, mN, etc.*/
-    std::string* force_units;
+    std::string_view force_units;
 
     /*An array of ASCII character labels. Trajectories with labels matching those in this
     list are to be treated as moments rather than 3D coordinates. See the parameter
     POINT:MOMENT_UNITS for the units used to store the moments.*/
     int momentsSize;
-    std::string* moments;
+    const std::string_view* moments;
 
     /*A single ASCII string that stores the measurement units used by the moment values,
     e.g. Nmm, Nm, etc.*/
-    std::string* moment_units;
+    std::string_view moment_units;
 
     /*An array of ASCII character labels. These labels are used as a base name for
     identifying three trajectories each that represent the force, moment and point
@@ -1063,7 +1119,7 @@ private:
     trajectories. Note that force and moment trajectories listed in REACTIONS should not
     appear in the FORCE and MOMENTS lists.*/
     int reactionsSize;
-    std::string* reactions;
+    const std::string_view* reactions;
 
 };
 
@@ -1073,6 +1129,52 @@ private:
 
 class Analog {
 public:
+    Analog() {scale = NULL; offset = NULL; gain = NULL; scaleSize = offsetSize = gainSize = 0;}
+
+    //Used (number of channels)
+    inline int Used(void) {return used;}
+
+    //Labels
+    inline int LabelsSize(void) {return labelsSize;}
+    inline std::string_view Labels(const int index) {return index >= 0 && index < labelsSize ? labels[index] : std::string_view();}
+
+    //Descriptions
+    inline int DescriptionsSize(void) {return descriptionsSize;}
+    inline std::string_view Descriptions(const int index) {return index >= 0 && index < descriptionsSize ? descriptions[index] : std::string_view();}
+
+    //General Scale (1.0 if missing)
+    inline float GenScale(void) {return gen_scale;}
+
+    //Channel Scale (1.0 if missing)
+    inline float Scale(const int index) {return index >= 0 && index < scaleSize ? scale[index] : 1.0;}
+
+    //Channel Offset (0 if missing, use OffsetValue() for UNSIGNED files)
+    inline short int Offset(const int index) {return index >= 0 && index < offsetSize ? offset[index] : 0;}
+    inline float OffsetValue(const int index) {return IsUnsigned() ? (float)(unsigned short int)Offset(index) : (float)Offset(index);}
+
+    //Units
+    inline int UnitsSize(void) {return unitsSize;}
+    inline std::string_view Units(const int index) {return index >= 0 && index < unitsSize ? units[index] : std::string_view();}
+
+    //Rate
+    inline float Rate(void) {return rate;}
+
+    //Format ("SIGNED" or "UNSIGNED")
+    inline std::string_view Format(void) {return format;}
+    inline bool IsUnsigned(void) {return format == "UNSIGNED";}
+
+    //Bits
+    inline int Bits(void) {return bits;}
+
+    //Gain
+    inline int GainSize(void) {return gainSize;}
+    inline short int Gain(const int index) {return index >= 0 && index < gainSize ? gain[index] : 0;}
+
+    //Set Analog Values
+    void SetAnalog(Analog* analog, Parameter_c3d* parameter, StringTable* strings);
+
+    //Clean Memory
+    void CleanUp(Analog* analog);
 
 private:
     /*The ANALOG:USED parameter is a single signed integer value that records the
@@ -1130,7 +1232,7 @@ private:
     ANALOG:LABELS parameters then the additional analog channels must be referenced
     by number.*/
     int labelsSize;
-    std::string* labels;
+    const std::string_view* labels;
 
     /*The ANALOG:DESCRIPTIONS parameter is a character data array that usually consists
     of a short description of each analog channel referenced by the ANALOG:LABELS
@@ -1153,7 +1255,7 @@ private:
     channels should access each channel by use of the ANALOG:LABEL , not the
     ANALOG:DESCRIPTION parameter.*/
     int descriptionsSize;
-    std::string* descriptions;
+    const std::string_view* descriptions;
 
     /*The ANALOG:GEN_SCALE parameter is a single floating-point value that is used as a
     universal analog scaling factor. It is applied in addition to the individual analog
@@ -1229,6 +1331,7 @@ private:
     data. This is normally ±10Volts, which yields an actual ADC_range of 20 – that is
     to say; the ADC card can record signals as over the range of 10 volts negative to 10
     volts positive magnitude, a total range of 20 Volts.*/
+    int scaleSize;
     float* scale;
 
     /*The ANALOG:OFFSET parameter is an array of integer values that are subtracted from
@@ -1297,6 +1400,7 @@ private:
     here) or, can be used to adjust the sampled analog data values or correct the original
     offset measurement error. Both methods are in common use; both methods may run
     into problems if either the analog data or OFFSET parameters are close to their limits.*/
+    int offsetSize;
     short int* offset;
 
     /*The ANALOG:UNITS parameter is an array of character data values (normally each
@@ -1307,7 +1411,8 @@ private:
     Note that changing the ANALOG:UNITS parameter does not automatically affect the
     calculated analog values, as it is not used in the analog scaling calculations. You
     must change the ANALOG:SCALE parameter to re-scale the analog data.*/
-    std::string* units;
+    int unitsSize;
+    const std::string_view* units;
 
     /*The ANALOG:RATE parameter is a single floating-point value that records the sample
     rate at which the analog data was collected in samples per second. This indicates the
@@ -1355,7 +1460,7 @@ private:
     If the ANALOG:FORMAT parameter does not exist the it should be assumed that its
     value is SIGNED unless the analog data contains 16-bit values, in which case
     UNSIGNED is a possibility.*/
-    std::string* format;
+    std::string_view format;
 
     /*The ANALOG:BITS parameter is a single integer value that describes the analog data
     sample resolution and will normally contain one of three values, 12, 14 or 16. As
@@ -1392,7 +1497,8 @@ private:
 
     This is compatible with the C3D file format although software applications may need
     to be modified to take advantage of the additional information.*/
-    int* gain;
+    int gainSize;
+    short int* gain;
 
 };
 
@@ -1402,9 +1508,86 @@ private:
 
 class Force_Platform {
 public:
+    Force_Platform() {type = NULL; corners = NULL; origin = NULL; channel = NULL; cal_matrix = NULL;
+                      used = 0; typeSize = cornersSize = originSize = channelSize = channelRows = 0; cal_matrixSize = calRows = calColumns = 0;}
+
+    //Used (number of plates)
+    inline int Used(void) {return used;}
+
+    //Type (1-4) of a plate (0 if missing)
+    inline short int Type(const int plate) {return plate >= 0 && plate < typeSize ? type[plate] : 0;}
+
+    //Zero (baseline frame range)
+    inline short int Zero(const int index) {return zero[index];}
+
+    //Corner (0-3) coordinate (0-2) of a plate in the global system
+    inline float Corner(const int plate, const int corner, const int axis) {
+        int index = plate*12 + corner*3 + axis;
+        return index >= 0 && index < cornersSize ? corners[index] : 0.0;
+    }
+
+    //Origin coordinate (0-2) of a plate (from the center of the surface to the sensor origin)
+    inline float Origin(const int plate, const int axis) {
+        int index = plate*3 + axis;
+        return index >= 0 && index < originSize ? origin[index] : 0.0;
+    }
+
+    //Analog channel (1 based, 0 if missing) of the index output of a plate
+    inline int ChannelsPerPlate(void) {return channelRows;}
+    inline short int Channel(const int plate, const int index) {
+        int i = plate*channelRows + index;
+        return index >= 0 && index < channelRows && i >= 0 && i < channelSize ? channel[i] : 0;
+    }
+
+    //Calibration matrix of a plate (Type 4), rows x columns (column-major per plate)
+    inline int CalRows(void) {return calRows;}
+    inline int CalColumns(void) {return calColumns;}
+    inline float CalMatrix(const int plate, const int row, const int column) {
+        int index = plate*calRows*calColumns + column*calRows + row;
+        return index >= 0 && index < cal_matrixSize ? cal_matrix[index] : (row == column ? 1.0 : 0.0);
+    }
+
+    //Set Force Platform Values
+    void SetForcePlatform(Force_Platform* platform, Parameter_c3d* parameter);
+
+    //Clean Memory
+    void CleanUp(Force_Platform* platform);
 
 private:
+    //Number of force plates
+    int used;
 
+    /*Type of every plate:
+    1 - Fx, Fy, Fz, Px, Py, Mz (the center of pressure is an output of the plate)
+    2 - Fx, Fy, Fz, Mx, My, Mz (AMTI, Bertec)
+    3 - Fx12, Fx34, Fy14, Fy23, Fz1, Fz2, Fz3, Fz4 (Kistler)
+    4 - Type 2 with a 6 x 6 calibration matrix (CAL_MATRIX)*/
+    int typeSize;
+    short int* type;
+
+    //First and last frame of the baseline (not applied)
+    short int zero[2];
+
+    //3 x 4 x USED coordinates of the corners in the global system (corner 1 is +x+y, 2 -x+y, 3 -x-y, 4 +x-y)
+    int cornersSize;
+    float* corners;
+
+    /*3 x USED vector from the center of the plate surface to the origin of the plate
+    coordinate system (in plate coordinates). For Type 3 plates it holds the sensor
+    offsets a, b and the height az0.*/
+    int originSize;
+    float* origin;
+
+    //N x USED analog channel numbers (1 based) of the plate outputs
+    int channelRows;
+    int channelSize;
+    short int* channel;
+
+    //N x N x USED calibration matrices (Type 4)
+    int calRows;
+    int calColumns;
+    int cal_matrixSize;
+    float* cal_matrix;
 };
 
 /***********************/
@@ -1413,20 +1596,104 @@ private:
 
 class Event_Context {
 public:
+    Event_Context() {used = 0; labelsSize = descriptionsSize = icon_idsSize = coloursSize = 0;
+                     labels = descriptions = NULL; icon_ids = colours = NULL;}
+
+    //Used
+    inline int Used(void) {return used;}
+
+    //Labels ("Left", "Right", "General" ...)
+    inline int LabelsSize(void) {return labelsSize;}
+    inline std::string_view Labels(const int index) {return index >= 0 && index < labelsSize ? labels[index] : std::string_view();}
+
+    //Descriptions
+    inline std::string_view Descriptions(const int index) {return index >= 0 && index < descriptionsSize ? descriptions[index] : std::string_view();}
+
+    //Icon IDs
+    inline short int IconIds(const int index) {return index >= 0 && index < icon_idsSize ? icon_ids[index] : 0;}
+
+    //Colour (0-2 RGB, 0-255) of a context
+    inline short int Colours(const int index, const int rgb) {return index >= 0 && index*3 + rgb < coloursSize ? colours[index*3 + rgb] : 255;}
+
+    //Return the context index of a label (-1 if it doesn't exist)
+    int Find(std::string_view label);
+
+    //Set Event Context Values
+    void SetEventContext(Event_Context* context, Parameter_c3d* parameter, StringTable* strings);
+
+    //Clean Memory
+    void CleanUp(Event_Context* context);
 
 private:
+    //Number of contexts
+    int used;
 
+    //Context names
+    int labelsSize;
+    const std::string_view* labels;
+
+    //Context descriptions
+    int descriptionsSize;
+    const std::string_view* descriptions;
+
+    //Icon of every context
+    int icon_idsSize;
+    short int* icon_ids;
+
+    //3 x USED colours of the contexts
+    int coloursSize;
+    short int* colours;
 };
 
 /***************/
 /*   7.EVENT   */
 /***************/
 
+//One event of the timeline
+struct EventEntry {
+    float time;   //Seconds from the first frame of the capture
+    int frame;    //Frame index in the trial (0 is the first frame of the data)
+    std::string_view label;
+    std::string_view context;
+    std::string_view subject;
+    std::string_view description;
+    short int iconId;
+};
+
 class Event {
 public:
+    Event() {eventSize = 0; events = NULL; frames = NULL;}
 
-private:
+    //Number of events
+    inline int EventSize(void) {return eventSize;}
+
+    //Event of the timeline (sorted by time)
+    inline EventEntry Events(const int index) {return events[index];}
+
+    //Index of the last event before frame (-1 if there is none)
+    int Previous(const int frame);
+
+    //Index of the first event after frame (-1 if there is none)
+    int Next(const int frame);
+
+    //Range [first, last) of the events between two frames (inclusive)
+    void Range(const int firstFrame, const int lastFrame, int* first, int* last);
+
+    /* Set Event Values and build the timeline.
+     * The EVENT group is used if it exists, otherwise the (up to 18) header events.
+     */
+    void SetEvent(Event* event, Parameter_c3d* parameter, Header_c3d header, StringTable* strings, const float rate, const long long firstFrame);
 
+    //Clean Memory
+    void CleanUp(Event* event);
+
+private:
+    /*EVENT:USED events with EVENT:CONTEXTS, LABELS, DESCRIPTIONS, SUBJECTS, ICON_IDS
+    and TIMES (2 x USED: minutes and seconds). The parameters are not sorted, the
+    timeline is.*/
+    int eventSize;
+    EventEntry* events;
+    int* frames; //Frame of every event (contiguous for the binary searches)
 };
 
 /**********************/
@@ -1440,30 +1707,30 @@ parameters but the following parameters are common.*/
 
 class Manufacturer {
 public:
-    inline std::string Company() {return company[0];}
-    inline std::string Software() {return software[0];}
-    inline std::string Version() {return version[0];}
+    inline std::string_view Company() {return company;}
+    inline std::string_view Software() {return software;}
+    inline std::string_view Version() {return version;}
 
-    inline void SetManufacturer(Manufacturer* manufacturer, Parameter_c3d parameter);
+    void SetManufacturer(Manufacturer* manufacturer, Parameter_c3d* parameter, StringTable* strings);
 
 private:
     /*An ASCII character string, the COMPANY parameter will identify the name of the
     company whose software was the original source of the C3D file. If this parameter
     exists then it should be locked and should not be changed by other software
     applications if they edit or modify the C3D file.*/
-    std::string* company;
+    std::string_view company;
 
     /*An ASCII character string, the SOFTWARE parameter will identify the name of the
     software application that created the C3D file. If this parameter exists then it should
     be locked and should not be changed by other software applications if they edit or
     modify the C3D file.*/
-    std::string* software;
+    std::string_view software;
 
     /*Stored as an ASCII character string, the VERSION parameter is intended to identify
     the version of the software that created the C3D file. If this parameter exists then it
     should be locked and should not be changed by other software applications if they
     edit or modify the C3D file.*/
-    std::string* version;
+    std::string_view version;
 };
 
 /******************/
@@ -1499,7 +1766,8 @@ public:
     inline float Z(void) {return coord_z;}
 
     inline float Camera(void) {return camera;}
-    inline float Residual(void) {return residual;}
+    inline float Residual(void) {return residual;} //negative if the sample is invalid (missing)
+    inline bool IsValid(void) {return residual >= 0;}
 
     inline void SetPoint(Points_C3D* point, const float x, const float y, const float z, const  float cam, const float res) {
         point->coord_x = x;
@@ -1519,30 +1787,41 @@ private:
     float residual;
 };
 
-class Analog_C3D {
-public:
-    inline float AnalogPoint(void) {return analog;}
-
-    inline void SetAnalog(Analog_C3D* analog, float value) {analog->analog = value;}
-
-private:
-    float analog;
-};
-
 class Frames_C3D {
 public:
     inline Points_C3D Point(const int index) {return points[index];}
-    inline Analog_C3D Analog(const int index) {return analog[index];}
+    inline Points_C3D* PointPointer(const int index) {return &points[index];} //return a pointer to the point (no copy)
+
+    //Decode the points of a frame from its raw bytes (generic path: format and byte order are tested for every word)
+    void ReadFrame(Frames_C3D* frame, const char* buffer, const int pointSize, const float pointScale, const int endianFlag);
+
+    //Allocate the points of a frame (filled by a FrameDecoder)
+    void AllocateFrame(Frames_C3D* frame, const int pointSize);
 
-    void ReadFrame(Frames_C3D* frame, FILE* file, const int pointSize,
-                   const int analogSize, const float pointScale, const int endianFlag);
+    //Copy the decoded points of a frame
+    void SetFrame(Frames_C3D* frame, const Points_C3D* points, const int pointSize);
 
     void CleanUp(Frames_C3D* frame);
 private:
     Points_C3D *points;
-    Analog_C3D *analog;
 };
 
+//What a frame decoder needs to know about the frames of a file
+struct DecodeLayout {
+    int pointSize;
+    float pointScale; //negative: float data
+    int endianFlag; //SAME_ENDIAN or DIFF_ENDIAN, with DEC_FLOAT for VAX floats
+    int analogChannels;
+    int analogPerFrame; //samples decoded per frame
+    int analogSamples; //samples of a channel (channel-major output)
+    bool analogUnsigned;
+};
+
+/* Decode one frame of the data section: the points and the raw analog samples of frame "frame"
+ * (analog[c*analogSamples + frame*analogPerFrame + s]). See Data_c3d::SelectDecoder.
+ */
+typedef void (*FrameDecoder)(Points_C3D* points, float* analog, const char* buffer, const DecodeLayout* layout, const int frame);
+
 class Relocation_C3D {
 public:
 
@@ -1570,18 +1849,54 @@ public:
     inline Frames_C3D Frame(const int index) {return frames[index];}
     inline Relocation_C3D Relocation(const int index) {return relocation[index];}
 
-    void ReadData(Data_c3d* data, FILE* file, const int frameSize, const int pointSize,
-                  const int analogSize, const float pointScale, const int endianFlag);
+    //Analog samples (channel-major: every channel is one contiguous array of AnalogSampleSize() values)
+    inline int AnalogChannelSize(void) {return analogChannels;}
+    inline int AnalogSampleSize(void) {return analogSamples;}
+    inline int AnalogPerFrame(void) {return analogPerFrame;}
+    inline const float* AnalogChannel(const int channel) {return &analog[(size_t)channel*analogSamples];}
+    inline float AnalogSample(const int channel, const int sample) {return analog[(size_t)channel*analogSamples + sample];}
+
+    //Bytes of one frame of the data section (points followed by the analog words)
+    static inline long long FrameBytes(const int pointSize, const float pointScale, const int analogWords) {
+        return (long long)(pointSize*4 + analogWords) * (pointScale < 0 ? SIZE_32_BIT : SIZE_16_BIT);
+    }
+
+    /* Read frameSize frames of the 3D/Analog data section from the current file position.
+     * Every frame holds analogWords analog words: analogPerFrame samples of analogChannels channels.
+     * stride > 1 skips the points of the stride-1 frames after every frame read: the analog samples of the span
+     * (the frame and the frames skipped after it) are averaged to one sample per frame, so they aren't aliased.
+     */
+    void ReadData(Data_c3d* data, FILE* file, const int frameSize, const int stride, const int pointSize, const float pointScale,
+                  const int analogWords, const int analogChannels, const int analogPerFrame, const bool analogUnsigned, const int endianFlag);
+
+    /* Decoder of a file, chosen once: float32 (IEEE or VAX) or int16, same or swapped byte order, with or without analog data.
+     * Every decoder is a template instance with the format fixed at compile time, so its loops have no branches
+     * on the format (DecodeFrameGeneric is the per-word path, kept as the reference).
+     */
+    static FrameDecoder SelectDecoder(const float pointScale, const int endianFlag, const bool analog);
+    static void DecodeFrameGeneric(Points_C3D* points, float* analog, const char* buffer, const DecodeLayout* layout, const int frame);
+
+    //Convert the raw analog samples to real world values: (raw - OFFSET) * SCALE * GEN_SCALE
+    void CalibrateAnalog(Data_c3d* data, Analog analog);
 
-    void print_point_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int pointSize);
+    //Copy decoded data: frameSize*pointSize points (frame-major) and calibrated analog samples (channel-major)
+    void SetData(Data_c3d* data, const Points_C3D* points, const int frameSize, const int pointSize,
+                 const float* analog, const int analogChannels, const int analogPerFrame);
 
-    void print_analog_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int analogSize);
+    void print_point_data_to_file(Data_c3d data, const std::string fileName, const int frameSize, const int pointSize, const long long firstFrame = 1);
+
+    void print_analog_data_to_file(Data_c3d data, const std::string fileName, const long long firstFrame = 1);
 
     void CleanUp(Data_c3d* data, const int frameSize);
 
 private:
     Frames_C3D* frames;
     Relocation_C3D* relocation;
+
+    int analogChannels;
+    int analogSamples; //frames * analogPerFrame
+    int analogPerFrame;
+    float* analog;
 };
 
 /****************************************/
@@ -1590,53 +1905,107 @@ private:
 
 class Read_C3D {
 public:
-    Read_C3D() { isOpen = false;}
+    Read_C3D() { isOpen = false; firstFrame = 1; frameSize = 0;}
+
+    /* Import C3D File
+     * firstFrame, lastFrame: frame range to decode (frame numbers of the file, 0 = first/last frame of the trial)
+     * stride: decode every stride-th frame of the range
+     * The header, POINT:FRAMES/RATE, ANALOG:RATE and TRIAL fields are adjusted to the decoded frames.
+     * Trials longer than 65535 frames are read from TRIAL:ACTUAL_START_FIELD/ACTUAL_END_FIELD or POINT:LONG_FRAMES.
+     */
+    void Import(std::string fileName, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame = 0, const long long lastFrame = 0, const int stride = 1);
+
+    /* Import a trial decoded earlier (see TrialCache): the header and the parameters are read from metadata
+     * (the bytes of the file before the data section), the points and the calibrated analog samples are copied.
+     * Returns false if the metadata doesn't describe frameSize frames of pointSize points.
+     */
+    bool ImportDecoded(const char* metadata, const size_t metadataSize, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame, const long long lastFrame, const int stride,
+                       const Points_C3D* points, const int frameSize, const int pointSize, const float* analog, const int analogChannels, const int analogPerFrame);
+
+    /* Read the header and the parameter section of a file only (the data section is not read and no message is shown
+     * on errors): the groups (SUBJECTS, POINT, MANUFACTURER ...) and FrameSize() are set. Free it with CleanUpMetadata.
+     */
+    bool ImportMetadata(std::string fileName, Read_C3D* c3d_f);
+    void CleanUpMetadata(Read_C3D* c3d_f) {CleanUpParameters(c3d_f);}
 
-    void Import(std::string fileName, QWidget* widget, Read_C3D* c3d_f); //Import C3D File
+    /* Frame range of a file (header and parameters only, nothing is decoded): lets a caller choose a window
+     * or a stride before importing a long trial. Returns false if the file cannot be read.
+     */
+    static bool ReadFrameRange(std::string fileName, long long* firstFrame, long long* lastFrame);
 
     void CleanUp(Read_C3D* c3d_f); //Clean memory
 
+    //Decoded frames (frame numbers are 64-bit: the 32-bit TRIAL fields go past INT_MAX, the header words saturate at 65535)
+    inline int FrameSize(void) {return frameSize;}
+    inline long long FirstFrame(void) {return firstFrame;}
+    inline long long LastFrame(void) {return firstFrame + frameSize - 1;}
+
     inline bool IsOpen(void) {return isOpen;}
     //inline void SetIsOpen(bool state) {isOpen = state};
 
     inline Header_c3d Header(void) {return headerBlock;}
-    inline Parameter_c3d Parameter(void) {return parameterBlock;}
+    inline Parameter_c3d* Parameter(void) {return &parameterBlock;} //the parameters hold their index: no copy
     inline Data_c3d Data(void) {return dataBlock;}
 
     inline Trial TRIAL(void) {return trial;}
     inline Subjects SUBJECTS(void) {return subjects;}
     inline Manufacturer MANUFACTURER(void) {return manufacturer;}
     inline Point POINT(void) {return point;}
+    inline Analog ANALOG(void) {return analog;}
+    inline Force_Platform FORCE_PLATFORM(void) {return forcePlatform;}
+    inline Event_Context EVENT_CONTEXT(void) {return eventContext;}
+    inline Event EVENT(void) {return event;}
 
     //Print Header File to a File
     void printHeaderFile(const std::string fileName) {headerBlock.print_header_to_file(headerBlock, fileName);}
 
     //Print Parameter File to a File
-    void printParameterFile(const std::string fileName) {parameterBlock.print_parameter_to_file(parameterBlock, fileName);}
+    void printParameterFile(const std::string fileName) {parameterBlock.print_parameter_to_file(&parameterBlock, fileName);}
 
     //Print Point Data to a CSV Type File
     void printPointFile(const std::string fileName) {
-      int frameSize = headerBlock.LastFrame() - headerBlock.FirstFrame() + 1;
       int pointSize = headerBlock.NumberOfPoints();
 
-      dataBlock.print_point_data_to_file(dataBlock, fileName, frameSize, pointSize);
+      dataBlock.print_point_data_to_file(dataBlock, fileName, frameSize, pointSize, firstFrame);
     }
 
     //Print Analog Data to a CSV Type File
-    void printAnalogFile(const std::string fileName) {
-      int frameSize = headerBlock.LastFrame() - headerBlock.FirstFrame() + 1;
-      int analogSize = headerBlock.NumberOfAnalog();
-
-      dataBlock.print_analog_data_to_file(dataBlock, fileName, frameSize, analogSize);
-    }
+    void printAnalogFile(const std::string fileName) {dataBlock.print_analog_data_to_file(dataBlock, fileName, firstFrame);}
 
     ~Read_C3D() {}
 
 private:
+    //Where and how the frames to decode are stored in the data section
+    struct DataLayout {
+        int dataStart; //First block of the data section
+        long long dataOffset; //Offset of the first frame to decode (files can be larger than 2 GB)
+        int frameSize;
+        int stride;
+        int pointSize;
+        float pointScale;
+        int analogWords;
+        int analogChannels;
+        int analogPerFrame;
+        bool analogUnsigned;
+        int endianFlag;
+    };
+
+    //Free everything but the data block
+    void CleanUpParameters(Read_C3D* c3d_f);
+
+    //Read the header and the parameters, adjust them to the frame range and return the layout of the frames to decode
+    bool ReadMetadata(FILE* openFile, QWidget* widget, Read_C3D* c3d_f, const long long firstFrame, const long long lastFrame, const int stride, DataLayout* layout);
+
+    //Adjust the header and the frame parameters to frameSize frames from frame first (fileFirst: first frame of the file), every stride-th frame
+    void SetFrameRange(Read_C3D* c3d_f, const long long fileFirst, const long long first, const int frameSize, const int stride, const int analogPerFrame);
+
     short int system_endian;
     short int file_endian;
     bool isOpen;
 
+    long long firstFrame; //Frame number of the first decoded frame
+    int frameSize;  //Decoded frames
+
     Header_c3d headerBlock;
     Parameter_c3d parameterBlock;
     Data_c3d dataBlock;
@@ -1644,9 +2013,14 @@ private:
     Trial trial;
     Subjects subjects;
     Point point;
+    Analog analog;
+    Force_Platform forcePlatform;
+    Event_Context eventContext;
+    Event event;
 
     Manufacturer manufacturer;
 
+    StringTable strings; //Labels, descriptions and units of the trial (Point/Subjects/Manufacturer view it)
 };
 
 #endif // READ_C3D_H
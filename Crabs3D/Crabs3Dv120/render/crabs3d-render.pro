@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# crabs3d-render: offscreen rendering of trials to image sequences or raw video
+# (needs EGL: Mesa renders on the CPU on machines without a GPU or a display)
+#
+#-------------------------------------------------
+
+QT       += core gui opengl
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = crabs3d-render
+TEMPLATE = app
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += _FILE_OFFSET_BITS=64
+
+include(../crabs3d_core.pri)
+
+SOURCES += \
+    render_main.cpp \
+    offscreen_renderer.cpp
+
+HEADERS += \
+    offscreen_renderer.h
+
+# Same flags as the application
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_CXXFLAGS += -fno-math-errno
+QMAKE_LFLAGS += -fopenmp
+
+LIBS += -lGL -lGLEW -lglut -lGLU -lEGL
@@ -0,0 +1,144 @@
+#define GL_GLEXT_PROTOTYPES //Framebuffer objects (OpenGL 3.0, exported by libGL)
+#define EGL_NO_X11 //No Xlib types in the EGL headers (they clash with Qt)
+#define MESA_EGL_NO_X11_HEADERS
+
+#include "offscreen_renderer.h"
+#include "../profiler.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glext.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+/**********/
+/* Public */
+/**********/
+
+OffscreenRenderer::OffscreenRenderer() {
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    framebuffer = 0;
+    colorBuffer = 0;
+    depthBuffer = 0;
+    width = 0;
+    height = 0;
+    rows = NULL;
+}
+
+bool OffscreenRenderer::Create(const int width, const int height) {
+    PROFILE_SCOPE("OffscreenRenderer::Create");
+
+    Destroy();
+    if(width <= 0 || height <= 0)
+        return false;
+
+    //Surfaceless platform (no display server), else the default display
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    if(getPlatformDisplay != NULL)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, NULL, NULL))
+        return false;
+    display = eglDisplay;
+
+    //Desktop OpenGL (compatibility profile: the scene is drawn with glBegin/glEnd)
+    EGLint attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+                           EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config;
+    EGLint configs = 0;
+    if(!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, attributes, &config, 1, &configs) || configs < 1) {
+        Destroy();
+        return false;
+    }
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, NULL);
+    if(eglContext == EGL_NO_CONTEXT) {
+        Destroy();
+        return false;
+    }
+    context = eglContext;
+
+    //No surface: the scene is drawn into the framebuffer object
+    if(!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        Destroy();
+        return false;
+    }
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        Destroy();
+        return false;
+    }
+
+    this->width = width;
+    this->height = height;
+    rows = (unsigned char*)malloc((size_t)width*height*3);
+    return rows != NULL;
+}
+
+void OffscreenRenderer::Destroy() {
+    if(context != EGL_NO_CONTEXT) {
+        if(framebuffer != 0) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    }
+    if(display != EGL_NO_DISPLAY)
+        eglTerminate((EGLDisplay)display);
+
+    free(rows);
+    rows = NULL;
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    framebuffer = colorBuffer = depthBuffer = 0;
+    width = height = 0;
+}
+
+void OffscreenRenderer::Attach(GLWidget* widget) {
+    widget->initializeGL();
+    widget->resizeGL(width, height);
+}
+
+bool OffscreenRenderer::RenderFrame(GLWidget* widget, const int frame, unsigned char* pixels) {
+    PROFILE_SCOPE("OffscreenRenderer::RenderFrame");
+
+    if(rows == NULL)
+        return false;
+
+    widget->SetFrame(widget, frame);
+    widget->paintGL();
+
+    //glReadPixels returns the bottom row first
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rows);
+    size_t rowSize = (size_t)width*3;
+    for(int y = 0; y < height; y++)
+        memcpy(pixels + y*rowSize, rows + (size_t)(height - 1 - y)*rowSize, rowSize);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+std::string OffscreenRenderer::Renderer() {
+    const GLubyte* renderer = context != EGL_NO_CONTEXT ? glGetString(GL_RENDERER) : NULL;
+    return renderer != NULL ? std::string((const char*)renderer) : "";
+}
@@ -0,0 +1,48 @@
+#ifndef OFFSCREEN_RENDERER_H
+#define OFFSCREEN_RENDERER_H
+
+#include <string>
+
+#include "../glwidget.h"
+
+/* Renders the scene of a GLWidget (GLWidget::paintGL: axes, grid, points, bones and force plates) without a window.
+ * The context is an EGL context of the surfaceless platform of Mesa: no display server and no GPU are needed
+ * (llvmpipe renders on the CPU when there is no GPU). The scene is drawn into a framebuffer object of the size
+ * of the images. One renderer per process: the context is current on the thread that created it.
+ */
+class OffscreenRenderer
+{
+public:
+    OffscreenRenderer();
+    ~OffscreenRenderer() {Destroy();}
+
+    //Create the context and the framebuffer (false if there is no EGL/OpenGL implementation)
+    bool Create(const int width, const int height);
+
+    //Free the framebuffer and the context
+    void Destroy();
+
+    //Prepare a widget to be drawn here (initializeGL and resizeGL on this context)
+    void Attach(GLWidget* widget);
+
+    //Draw a frame of the trial of a widget and read it back: width*height RGB pixels, top row first
+    bool RenderFrame(GLWidget* widget, const int frame, unsigned char* pixels);
+
+    int Width() {return width;}
+    int Height() {return height;}
+
+    //GL_RENDERER of the context (e.g. llvmpipe)
+    std::string Renderer();
+
+private:
+    void* display; //EGLDisplay
+    void* context; //EGLContext
+    unsigned int framebuffer;
+    unsigned int colorBuffer;
+    unsigned int depthBuffer;
+    int width;
+    int height;
+    unsigned char* rows; //Bottom-up pixels of glReadPixels
+};
+
+#endif // OFFSCREEN_RENDERER_H
@@ -0,0 +1,255 @@
+/* crabs3d-render: render trials to image sequences or raw video without a display (thumbnails and review clips).
+ *
+ * crabs3d-render [--width N] [--height N] [--stride N] [--count N] [--trail N] [--raw] [--jobs N]
+ *                [--eye x,y,z] [--center x,y,z] [--rotate x,y,z] [--zoom degrees] --out dir trial.c3d ...
+ *
+ * Every trial is drawn by GLWidget::paintGL (the scene of the application) at a fixed camera into an offscreen
+ * framebuffer (see offscreen_renderer.h). The images of a trial are <out>/<trial>/<trial>_<frame>.png; with --raw the
+ * frames are one RGB24 stream <out>/<trial>.rgb (--out - writes the stream of a single trial to stdout), e.g.
+ *     crabs3d-render --raw --out - walk.c3d | ffmpeg -f rawvideo -pix_fmt rgb24 -s 640x480 -r 30 -i - walk.mp4
+ * --stride renders every N-th frame, --count renders at most N frames spread over the trial (--count 1: a thumbnail).
+ * --trail draws the last N frames of every marker as a line.
+ * Trials are rendered in parallel, one process per trial (--jobs, default: the number of processors): a QGLWidget
+ * belongs to the thread of its QApplication and an OpenGL context is current on one thread only.
+ * Qt runs on the offscreen platform unless QT_QPA_PLATFORM says otherwise.
+ */
+#include "offscreen_renderer.h"
+#include "../glwidget.h"
+#include <QApplication>
+#include <QImage>
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct RenderArgs {
+    int width;
+    int height;
+    int stride;
+    int count;
+    int trail;
+    bool raw;
+    int jobs;
+    bool camera[4]; //eye, center, rotate and zoom given
+    ViewCamera view;
+    std::string out;
+    std::vector<std::string> trials;
+};
+
+static void PrintUsage() {
+    fprintf(stderr, "usage: crabs3d-render [--width N] [--height N] [--stride N] [--count N] [--trail N] [--raw] [--jobs N]\n"
+                    "                      [--eye x,y,z] [--center x,y,z] [--rotate x,y,z] [--zoom degrees] --out dir trial.c3d ...\n");
+}
+
+//x,y,z
+static bool ParseVector(const char* text, double* vector) {
+    return sscanf(text, "%lf,%lf,%lf", &vector[0], &vector[1], &vector[2]) == 3;
+}
+
+static bool ParseArgs(int argc, char* argv[], RenderArgs* args) {
+    args->width = 640;
+    args->height = 480;
+    args->stride = 1;
+    args->count = 0;
+    args->trail = 0;
+    args->raw = false;
+    args->jobs = std::max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    for(int c = 0; c < 4; c++)
+        args->camera[c] = false;
+    memset(&args->view, 0, sizeof(ViewCamera));
+    args->out = "";
+
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool value = i + 1 < argc;
+        double rotate[3];
+        if(arg == "--width" && value)
+            args->width = atoi(argv[++i]);
+        else if(arg == "--height" && value)
+            args->height = atoi(argv[++i]);
+        else if(arg == "--stride" && value)
+            args->stride = std::max(1, atoi(argv[++i]));
+        else if(arg == "--count" && value)
+            args->count = std::max(0, atoi(argv[++i]));
+        else if(arg == "--trail" && value)
+            args->trail = std::max(0, atoi(argv[++i]));
+        else if(arg == "--jobs" && value)
+            args->jobs = std::max(1, atoi(argv[++i]));
+        else if(arg == "--out" && value)
+            args->out = argv[++i];
+        else if(arg == "--raw")
+            args->raw = true;
+        else if(arg == "--eye" && value && ParseVector(argv[++i], args->view.eye))
+            args->camera[0] = true;
+        else if(arg == "--center" && value && ParseVector(argv[++i], args->view.center))
+            args->camera[1] = true;
+        else if(arg == "--rotate" && value && ParseVector(argv[++i], rotate)) {
+            for(int c = 0; c < 3; c++)
+                args->view.rotate[c] = (float)rotate[c];
+            args->camera[2] = true;
+        } else if(arg == "--zoom" && value) {
+            args->view.zoom = atof(argv[++i]);
+            args->camera[3] = true;
+        } else if(arg == "-platform" && value)
+            i++; //Qt option
+        else if(arg.size() > 1 && arg[0] == '-')
+            return false;
+        else
+            args->trials.push_back(arg);
+    }
+
+    if(args->out == "-" && (!args->raw || args->trials.size() != 1))
+        return false;
+    return !args->out.empty() && !args->trials.empty() && args->width > 0 && args->height > 0;
+}
+
+//Name of a trial without the directory and the extension
+static std::string TrialName(const std::string path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+//Frames to render: every stride-th frame, or count frames at the middle of equal parts of the trial
+static std::vector<int> SelectFrames(const int frameSize, const int stride, const int count) {
+    std::vector<int> frames;
+    int strided = (frameSize + stride - 1)/stride;
+    if(count > 0 && count < strided) {
+        for(int k = 0; k < count; k++)
+            frames.push_back((int)(((2LL*k + 1)*frameSize)/(2LL*count)));
+    } else {
+        for(int f = 0; f < frameSize; f += stride)
+            frames.push_back(f);
+    }
+    return frames;
+}
+
+//Render a trial (runs in its own process)
+static bool RenderTrial(const RenderArgs& args, const std::string trial, int argc, char* argv[]) {
+    QApplication application(argc, argv); //GLWidget is a QGLWidget (its own context is never made current)
+
+    auto start = std::chrono::steady_clock::now();
+    std::string name = TrialName(trial);
+
+    //Checked quietly first: a file Import refuses would show a message box nobody can close.
+    //Read whole without the trial cache (OpenC3D stores it under $HOME and pages long trials), so the images are
+    //numbered by the frames of the file
+    long long first, last;
+    GLWidget widget(NULL);
+    if(!Read_C3D::ReadFrameRange(trial, &first, &last) || !widget.ReadC3D(trial, NULL) || widget.FrameSize() <= 0) {
+        fprintf(stderr, "crabs3d-render: cannot read %s\n", trial.c_str());
+        return false;
+    }
+    widget.SetCloud(&widget);
+
+    //The camera of the application, with the values given on the command line
+    ViewCamera camera = widget.GetCamera();
+    if(args.camera[0])
+        memcpy(camera.eye, args.view.eye, sizeof(camera.eye));
+    if(args.camera[1])
+        memcpy(camera.center, args.view.center, sizeof(camera.center));
+    if(args.camera[2])
+        memcpy(camera.rotate, args.view.rotate, sizeof(camera.rotate));
+    if(args.camera[3])
+        camera.zoom = args.view.zoom;
+    widget.SetCamera(&widget, camera);
+    if(args.trail > 1) {
+        widget.SetTrailLength(&widget, args.trail);
+        widget.SetTrailView(&widget, true);
+    }
+
+    OffscreenRenderer renderer;
+    if(!renderer.Create(args.width, args.height)) {
+        fprintf(stderr, "crabs3d-render: no OpenGL context (EGL) for %s\n", trial.c_str());
+        return false;
+    }
+    renderer.Attach(&widget);
+
+    FILE* stream = NULL;
+    std::string directory = args.out + "/" + name;
+    if(args.raw) {
+        stream = args.out == "-" ? stdout : fopen((args.out + "/" + name + ".rgb").c_str(), "wb");
+    } else if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "crabs3d-render: cannot create %s\n", directory.c_str());
+        return false;
+    }
+    if(args.raw && stream == NULL) {
+        fprintf(stderr, "crabs3d-render: cannot write %s/%s.rgb\n", args.out.c_str(), name.c_str());
+        return false;
+    }
+
+    std::vector<int> frames = SelectFrames(widget.FrameSize(), args.stride, args.count);
+    std::vector<unsigned char> pixels((size_t)args.width*args.height*3);
+    bool result = true;
+    for(size_t f = 0; f < frames.size() && result; f++) {
+        result = renderer.RenderFrame(&widget, frames[f], pixels.data());
+        if(result && args.raw) {
+            result = fwrite(pixels.data(), 1, pixels.size(), stream) == pixels.size();
+        } else if(result) {
+            char fileName[32];
+            snprintf(fileName, sizeof(fileName), "_%06d.png", frames[f]);
+            QImage image(pixels.data(), args.width, args.height, args.width*3, QImage::Format_RGB888);
+            result = image.save(QString::fromStdString(directory + "/" + name + fileName), "PNG");
+        }
+    }
+    if(stream != NULL && stream != stdout)
+        result = fclose(stream) == 0 && result;
+    else if(stream == stdout)
+        fflush(stdout);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%s: %d frames %dx%d in %.0f ms (%s)%s\n", name.c_str(), (int)frames.size(), args.width, args.height, ms,
+            renderer.Renderer().c_str(), result ? "" : " FAILED");
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    RenderArgs args;
+    if(!ParseArgs(argc, argv, &args)) {
+        PrintUsage();
+        return 1;
+    }
+    if(args.out != "-" && mkdir(args.out.c_str(), 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "crabs3d-render: cannot create %s\n", args.out.c_str());
+        return 1;
+    }
+    setenv("QT_QPA_PLATFORM", "offscreen", 0);
+
+    //At most args.jobs trials at once, each in a child process
+    int running = 0;
+    int failed = 0;
+    int status;
+    for(size_t t = 0; t < args.trials.size(); t++) {
+        if(running == args.jobs) {
+            if(wait(&status) > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+                failed++;
+            running--;
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if(pid == 0)
+            _exit(RenderTrial(args, args.trials[t], argc, argv) ? 0 : 1);
+        if(pid < 0) {
+            fprintf(stderr, "crabs3d-render: cannot start a process for %s\n", args.trials[t].c_str());
+            failed++;
+        } else {
+            running++;
+        }
+    }
+    while(running > 0) {
+        if(wait(&status) > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+            failed++;
+        running--;
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,390 @@
+#include "spatial_index.h"
+#include <math.h>
+#include <algorithm>
+
+//Keep (dist, index) if it is one of the k best so far (max-heap: the worst of the k best is on top)
+static inline void KeepNearest(std::vector<std::pair<float, int> >* best, const int k, const float dist, const int index) {
+    if((int)best->size() < k) {
+        best->push_back(std::make_pair(dist, index));
+        std::push_heap(best->begin(), best->end());
+    } else if(dist < best->front().first) {
+        std::pop_heap(best->begin(), best->end());
+        best->back() = std::make_pair(dist, index);
+        std::push_heap(best->begin(), best->end());
+    }
+}
+
+/**********/
+/* Public */
+/**********/
+
+void SpatialGrid::Build(Cloud cloud, const int pointSize, const float cellSize) {
+    CleanUp();
+
+    this->points = cloud;
+    this->pointSize = pointSize;
+    this->cellSize = cellSize > 0 ? cellSize : EstimateCellSize(cloud, pointSize);
+
+    minCell[0] = minCell[1] = minCell[2] = 0;
+    maxCell[0] = maxCell[1] = maxCell[2] = 0;
+
+    pointCell.resize(pointSize);
+    cells.reserve(pointSize);
+
+    for(int i = 0; i < pointSize; i++) {
+        int cx = CellCoord(cloud.x[i]);
+        int cy = CellCoord(cloud.y[i]);
+        int cz = CellCoord(cloud.z[i]);
+
+        if(i == 0) {
+            minCell[0] = maxCell[0] = cx;
+            minCell[1] = maxCell[1] = cy;
+            minCell[2] = maxCell[2] = cz;
+        }
+        ExpandRange(cx, cy, cz);
+        Insert(i, CellKey(cx, cy, cz));
+    }
+
+    built = true;
+}
+
+void SpatialGrid::Update(Cloud cloud) {
+    if(!built)
+        return;
+
+    points = cloud;
+
+    //Only the points that left their cell are moved
+    bool moved = false;
+    for(int i = 0; i < pointSize; i++) {
+        GridCell key = CellKey(CellCoord(cloud.x[i]), CellCoord(cloud.y[i]), CellCoord(cloud.z[i]));
+
+        if(!(key == pointCell[i].cell)) {
+            Remove(i);
+            Insert(i, key);
+            moved = true;
+        }
+    }
+
+    //Cells left empty may have been the bounds of the range
+    if(moved)
+        RecomputeRange();
+}
+
+int SpatialGrid::RadiusQuery(const float x, const float y, const float z, const float radius, std::vector<int>* result) {
+    result->clear();
+    if(!built)
+        return 0;
+
+    float radius2 = radius*radius;
+
+    int cxMin = std::max(CellCoord(x - radius), minCell[0]);
+    int cxMax = std::min(CellCoord(x + radius), maxCell[0]);
+    int cyMin = std::max(CellCoord(y - radius), minCell[1]);
+    int cyMax = std::min(CellCoord(y + radius), maxCell[1]);
+    int czMin = std::max(CellCoord(z - radius), minCell[2]);
+    int czMax = std::min(CellCoord(z + radius), maxCell[2]);
+
+    for(int cx = cxMin; cx <= cxMax; cx++) {
+        for(int cy = cyMin; cy <= cyMax; cy++) {
+            for(int cz = czMin; cz <= czMax; cz++) {
+                std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell = cells.find(CellKey(cx, cy, cz));
+                if(cell == cells.end())
+                    continue;
+
+                for(size_t j = 0; j < cell->second.size(); j++) {
+                    int index = cell->second[j];
+                    float dx = points.x[index] - x;
+                    float dy = points.y[index] - y;
+                    float dz = points.z[index] - z;
+
+                    if(dx*dx + dy*dy + dz*dz <= radius2)
+                        result->push_back(index);
+                }
+            }
+        }
+    }
+
+    return (int)result->size();
+}
+
+int SpatialGrid::NearestQuery(const float x, const float y, const float z, const int k, std::vector<int>* result) {
+    result->clear();
+    if(!built || k <= 0)
+        return 0;
+
+    //Max-heap of (squared distance, index) - the worst of the k best is on top
+    std::vector<std::pair<float, int> > best;
+    best.reserve(k+1);
+
+    //Rings start at the occupied cell nearest to the query (a far query doesn't walk the empty cells up to the cloud).
+    //A cell of the next ring is still at least ring*cellSize from the query: on every axis the query is inside
+    //the occupied range or beyond its near end. Cell distances are 64-bit (cells span the whole int range).
+    long long center[3] = {CellCoord(x), CellCoord(y), CellCoord(z)};
+    long long maxRing = 0;
+    for(int a = 0; a < 3; a++) {
+        center[a] = std::min(std::max(center[a], (long long)minCell[a]), (long long)maxCell[a]);
+        maxRing = std::max(maxRing, std::max(center[a] - minCell[a], maxCell[a] - center[a]));
+    }
+
+    //Cell lookups of the rings: once they outnumber the occupied cells, scanning the cells is cheaper (sparse clouds)
+    size_t lookups = 0;
+
+    for(long long ring = 0; ring <= maxRing; ring++) {
+        //Visit the occupied range cells with chebyshev distance == ring
+        long long dxMin = std::max(-ring, minCell[0] - center[0]);
+        long long dxMax = std::min(ring, maxCell[0] - center[0]);
+        long long dyMin = std::max(-ring, minCell[1] - center[1]);
+        long long dyMax = std::min(ring, maxCell[1] - center[1]);
+        long long dzMin = std::max(-ring, minCell[2] - center[2]);
+        long long dzMax = std::min(ring, maxCell[2] - center[2]);
+
+        for(long long dx = dxMin; dx <= dxMax; dx++) {
+            for(long long dy = dyMin; dy <= dyMax; dy++) {
+                bool shell = (std::abs(dx) == ring || std::abs(dy) == ring);
+                long long stepZ = shell ? 1 : 2*ring; //Inside the shell only the two z faces are on the ring
+                if(stepZ == 0)
+                    stepZ = 1;
+
+                for(long long dz = -ring; dz <= ring; dz += stepZ) {
+                    if(dz > dzMax)
+                        break;
+                    if(dz < dzMin) {
+                        if(shell)
+                            dz = dzMin - 1; //skip to the range (the loop step is 1 on the shell)
+                        continue;
+                    }
+                    lookups++;
+                    std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell =
+                            cells.find(CellKey((int)(center[0]+dx), (int)(center[1]+dy), (int)(center[2]+dz)));
+                    if(cell == cells.end())
+                        continue;
+
+                    for(size_t j = 0; j < cell->second.size(); j++) {
+                        int index = cell->second[j];
+                        float px = points.x[index] - x;
+                        float py = points.y[index] - y;
+                        float pz = points.z[index] - z;
+                        KeepNearest(&best, k, px*px + py*py + pz*pz, index);
+                    }
+                }
+            }
+        }
+
+        //Every point of the next ring is at least ring*cellSize away
+        float reach = (float)ring*cellSize;
+        if((int)best.size() == k && best.front().first <= reach*reach)
+            break;
+
+        //Far apart points leave most cells of the rings empty: scan every occupied cell instead
+        if(lookups > cells.size()) {
+            best.clear();
+            for(std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell = cells.begin(); cell != cells.end(); ++cell) {
+                for(size_t j = 0; j < cell->second.size(); j++) {
+                    int index = cell->second[j];
+                    float px = points.x[index] - x;
+                    float py = points.y[index] - y;
+                    float pz = points.z[index] - z;
+                    KeepNearest(&best, k, px*px + py*py + pz*pz, index);
+                }
+            }
+            break;
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for(size_t i = 0; i < best.size(); i++)
+        result->push_back(best[i].second);
+
+    return (int)result->size();
+}
+
+int SpatialGrid::Nearest(const float x, const float y, const float z) {
+    std::vector<int> result;
+    if(NearestQuery(x, y, z, 1, &result) == 0)
+        return -1;
+
+    return result[0];
+}
+
+int SpatialGrid::RayQuery(const float ox, const float oy, const float oz, const float dx, const float dy, const float dz, const float radius,
+                          std::vector<int>* result, const float spread) {
+    result->clear();
+    float length = sqrt(dx*dx + dy*dy + dz*dz);
+    if(!built || cells.empty() || length <= 0)
+        return 0;
+
+    float origin[3] = {ox, oy, oz};
+    float direction[3] = {dx/length, dy/length, dz/length};
+
+    //Clip the ray to the occupied cells (grown by the widest radius), a cone is clipped again with its radius at the clipped end
+    float tMin = 0.0;
+    float tMax = spread > 0 ? length : INFINITY;
+    for(int pass = 0; pass < (spread > 0 ? 2 : 1); pass++) {
+        float widest = radius + (spread > 0 ? spread*tMax : 0.0f);
+        for(int a = 0; a < 3; a++) {
+            float low = minCell[a]*cellSize - widest;
+            float high = (maxCell[a] + 1)*cellSize + widest;
+
+            if(direction[a] == 0) {
+                if(origin[a] < low || origin[a] > high)
+                    return 0;
+                continue;
+            }
+
+            float t0 = (low - origin[a]) / direction[a];
+            float t1 = (high - origin[a]) / direction[a];
+            if(t0 > t1)
+                std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+        }
+        if(tMin > tMax)
+            return 0;
+    }
+
+    //Walk the ray one cell at a time, every point within radius of the segment is within reach of a sample
+    std::vector<std::pair<float, int> > hits;
+    std::unordered_set<GridCell, GridCellHash> visited;
+    long long steps = (long long)ceil((tMax - tMin) / cellSize) + 1;
+    for(long long step = 0; step <= steps; step++) {
+        float t = tMin + step*cellSize;
+        float px = origin[0] + t*direction[0];
+        float py = origin[1] + t*direction[1];
+        float pz = origin[2] + t*direction[2];
+        float reach = radius + spread*(t + cellSize) + 0.5*cellSize; //the cone is wider at the next sample
+
+        for(int cx = CellCoord(px - reach); cx <= CellCoord(px + reach); cx++) {
+            for(int cy = CellCoord(py - reach); cy <= CellCoord(py + reach); cy++) {
+                for(int cz = CellCoord(pz - reach); cz <= CellCoord(pz + reach); cz++) {
+                    std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell = cells.find(CellKey(cx, cy, cz));
+                    if(cell == cells.end() || !visited.insert(cell->first).second)
+                        continue;
+
+                    for(size_t j = 0; j < cell->second.size(); j++) {
+                        int index = cell->second[j];
+                        float vx = points.x[index] - ox;
+                        float vy = points.y[index] - oy;
+                        float vz = points.z[index] - oz;
+                        float along = vx*direction[0] + vy*direction[1] + vz*direction[2];
+                        float within = radius + spread*along;
+
+                        if(along >= 0 && (spread <= 0 || along <= length) && vx*vx + vy*vy + vz*vz - along*along <= within*within)
+                            hits.push_back(std::make_pair(along, index));
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(hits.begin(), hits.end());
+    for(size_t i = 0; i < hits.size(); i++)
+        result->push_back(hits[i].second);
+
+    return (int)result->size();
+}
+
+float SpatialGrid::EstimateCellSize(Cloud cloud, const int pointSize) {
+    if(pointSize <= 0)
+        return 1.0;
+
+    float min[3] = {cloud.x[0], cloud.y[0], cloud.z[0]};
+    float max[3] = {cloud.x[0], cloud.y[0], cloud.z[0]};
+
+    for(int i = 1; i < pointSize; i++) {
+        min[0] = std::min(min[0], cloud.x[i]); max[0] = std::max(max[0], cloud.x[i]);
+        min[1] = std::min(min[1], cloud.y[i]); max[1] = std::max(max[1], cloud.y[i]);
+        min[2] = std::min(min[2], cloud.z[i]); max[2] = std::max(max[2], cloud.z[i]);
+    }
+
+    //About two points per cell for a uniform cloud
+    float volume = 1.0;
+    int axes = 0;
+    for(int i = 0; i < 3; i++) {
+        if(max[i] - min[i] > 0) {
+            volume *= max[i] - min[i];
+            axes++;
+        }
+    }
+    if(axes == 0)
+        return 1.0;
+
+    float size = pow(2.0 * volume / pointSize, 1.0 / axes);
+    if(size <= 0)
+        return 1.0;
+
+    return size;
+}
+
+void SpatialGrid::CleanUp() {
+    cells.clear();
+    pointCell.clear();
+    pointSize = 0;
+    built = false;
+}
+
+/***********/
+/* Private */
+/***********/
+
+int SpatialGrid::CellCoord(const float value) {
+    //Far away values share the last cell (the int conversion must not overflow)
+    const float limit = 1 << 30;
+    float coord = floor(value / cellSize);
+
+    if(coord != coord)
+        return 0;
+    if(coord < -limit)
+        return -(1 << 30);
+    if(coord > limit)
+        return 1 << 30;
+    return (int)coord;
+}
+
+GridCell SpatialGrid::CellKey(const int cx, const int cy, const int cz) {
+    GridCell cell = {cx, cy, cz};
+    return cell;
+}
+
+void SpatialGrid::Insert(const int index, const GridCell key) {
+    std::vector<int>& cell = cells[key];
+    pointCell[index].cell = key;
+    pointCell[index].slot = (int)cell.size();
+    cell.push_back(index);
+}
+
+void SpatialGrid::Remove(const int index) {
+    std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell = cells.find(pointCell[index].cell);
+    if(cell == cells.end())
+        return;
+
+    //Swap with the last point of the cell and pop
+    std::vector<int>& list = cell->second;
+    int slot = pointCell[index].slot;
+    int last = list.back();
+
+    list[slot] = last;
+    pointCell[last].slot = slot;
+    list.pop_back();
+
+    if(list.empty())
+        cells.erase(cell);
+}
+
+void SpatialGrid::ExpandRange(const int cx, const int cy, const int cz) {
+    minCell[0] = std::min(minCell[0], cx); maxCell[0] = std::max(maxCell[0], cx);
+    minCell[1] = std::min(minCell[1], cy); maxCell[1] = std::max(maxCell[1], cy);
+    minCell[2] = std::min(minCell[2], cz); maxCell[2] = std::max(maxCell[2], cz);
+}
+
+void SpatialGrid::RecomputeRange() {
+    std::unordered_map<GridCell, std::vector<int>, GridCellHash>::iterator cell = cells.begin();
+    if(cell == cells.end())
+        return;
+
+    minCell[0] = maxCell[0] = cell->first.x;
+    minCell[1] = maxCell[1] = cell->first.y;
+    minCell[2] = maxCell[2] = cell->first.z;
+    for(++cell; cell != cells.end(); ++cell)
+        ExpandRange(cell->first.x, cell->first.y, cell->first.z);
+}
@@ -0,0 +1,107 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "kmeans.h"
+
+/* Uniform hash grid over the x/y/z arrays of a Cloud (one frame).
+ * Every point is stored in the cell (floor(x/cellSize), floor(y/cellSize), floor(z/cellSize)).
+ * Queries return indices to the cloud arrays (not cloud ids).
+ * When the next frame arrives Update() moves only the points that changed cell,
+ * so stepping through a trial costs O(moved points) instead of a full rebuild.
+ */
+
+//Cell coordinates (compared on lookup, so far away cells never share a list)
+struct GridCell
+{
+    int x;
+    int y;
+    int z;
+
+    bool operator==(const GridCell& cell) const {return x == cell.x && y == cell.y && z == cell.z;}
+};
+
+struct GridCellHash
+{
+    size_t operator()(const GridCell& cell) const {
+        return (size_t)cell.x*73856093u ^ (size_t)cell.y*19349663u ^ (size_t)cell.z*83492791u;
+    }
+};
+
+struct GridSlot
+{
+    GridCell cell; //Cell of the point
+    int slot; //Position of the point inside the cell list
+};
+
+class SpatialGrid
+{
+public:
+    SpatialGrid() {pointSize = 0; cellSize = 1.0; built = false;}
+
+    //Build the grid for a cloud (if cellSize <= 0 it is estimated from the cloud)
+    void Build(Cloud cloud, const int pointSize, const float cellSize = 0.0);
+
+    //Move the points of the new cloud (same point size) to their new cells
+    void Update(Cloud cloud);
+
+    //Return the indices of the points inside the sphere (x, y, z, radius)
+    int RadiusQuery(const float x, const float y, const float z, const float radius, std::vector<int>* result);
+
+    //Return the indices of the k nearest points, closest first
+    int NearestQuery(const float x, const float y, const float z, const int k, std::vector<int>* result);
+
+    //Return the index of the nearest point (-1 if grid is empty)
+    int Nearest(const float x, const float y, const float z);
+
+    /* Return the indices of the points within radius of the ray (origin, direction), closest to the origin first.
+     * spread > 0 makes a cone: the radius grows by spread per unit along the ray (a perspective pick), up to |direction|.
+     */
+    int RayQuery(const float ox, const float oy, const float oz, const float dx, const float dy, const float dz, const float radius,
+                 std::vector<int>* result, const float spread = 0.0);
+
+    //Estimate a cell size so each cell holds a few points
+    static float EstimateCellSize(Cloud cloud, const int pointSize);
+
+    bool IsBuilt() {return built;}
+    int PointSize() {return pointSize;}
+    float CellSize() {return cellSize;}
+
+    //Clean memory
+    void CleanUp();
+
+private:
+    Cloud points; //Current frame (the grid doesn't own the arrays)
+    int pointSize;
+    float cellSize;
+    bool built;
+
+    //Occupied cell range (limits the kNN search)
+    int minCell[3];
+    int maxCell[3];
+
+    std::unordered_map<GridCell, std::vector<int>, GridCellHash> cells;
+    std::vector<GridSlot> pointCell;
+
+    //Cell coordinate of a value (clamped, NaN goes to cell 0)
+    int CellCoord(const float value);
+
+    //Cell of cell coordinates
+    static GridCell CellKey(const int cx, const int cy, const int cz);
+
+    //Insert/Remove point to/from a cell
+    void Insert(const int index, const GridCell key);
+    void Remove(const int index);
+
+    //Expand the occupied cell range
+    void ExpandRange(const int cx, const int cy, const int cz);
+
+    //Set the occupied cell range to the cells that still hold points
+    void RecomputeRange();
+};
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,73 @@
+#include "string_table.h"
+#include <string.h>
+
+#define STRING_BLOCK_SIZE 65536
+
+/**********/
+/* Public */
+/**********/
+
+std::string_view StringTable::Intern(std::string_view text) {
+    if(text.empty())
+        return std::string_view();
+
+    std::unordered_set<std::string_view>::iterator it = storage->index.find(text);
+    if(it != storage->index.end())
+        return *it;
+
+    std::string_view stored(Store(text), text.size());
+    storage->index.insert(stored);
+
+    return stored;
+}
+
+const std::string_view* StringTable::Split(const char* data, const int width, const int count) {
+    if(count <= 0)
+        return NULL;
+
+    std::string_view* list = new std::string_view[count];
+    storage->lists.push_back(std::unique_ptr<std::string_view[]>(list));
+
+    for(int i = 0; i < count; i++)
+        list[i] = Intern(Trim(std::string_view(&data[(size_t)i*width], width)));
+
+    return list;
+}
+
+std::string_view StringTable::Trim(std::string_view text) {
+    size_t start = 0;
+    size_t end = text.size();
+
+    while(start < end && (text[start] == ' ' || text[start] == '\0'))
+        start++;
+    while(end > start && (text[end-1] == ' ' || text[end-1] == '\0'))
+        end--;
+
+    return text.substr(start, end - start);
+}
+
+void StringTable::CleanUp() {
+    //Copies that still use the old storage keep it alive
+    storage = std::make_shared<StringStorage>();
+    storage->blockUsed = 0;
+    storage->blockSize = 0;
+}
+
+/***********/
+/* Private */
+/***********/
+
+const char* StringTable::Store(std::string_view text) {
+    if(storage->blocks.empty() || storage->blockUsed + text.size() > storage->blockSize) {
+        size_t size = text.size() > STRING_BLOCK_SIZE ? text.size() : STRING_BLOCK_SIZE;
+        storage->blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+        storage->blockUsed = 0;
+        storage->blockSize = size;
+    }
+
+    char* stored = storage->blocks.back().get() + storage->blockUsed;
+    memcpy(stored, text.data(), text.size());
+    storage->blockUsed += text.size();
+
+    return stored;
+}
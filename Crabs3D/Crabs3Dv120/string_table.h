@@ -0,0 +1,55 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/* Interned strings of a trial (labels, descriptions, units, names ...).
+ * Characters are stored in large blocks that never move, so the string_views handed out
+ * stay valid until CleanUp(). Equal strings are stored once.
+ * Copies of the table share the same storage.
+ */
+
+struct StringStorage
+{
+    std::vector<std::unique_ptr<char[]> > blocks; //Character blocks
+    size_t blockUsed; //Characters used in the last block
+    size_t blockSize; //Size of the last block
+
+    std::vector<std::unique_ptr<std::string_view[]> > lists; //Arrays returned by Split()
+    std::unordered_set<std::string_view> index; //Interned strings (views to blocks)
+};
+
+class StringTable
+{
+public:
+    StringTable() {CleanUp();}
+
+    //Return the stored copy of text (the same view for equal strings)
+    std::string_view Intern(std::string_view text);
+
+    /* Split count entries of width characters (e.g. POINT:LABELS is 32 x N) in one pass.
+     * Every entry is trimmed and interned. Returns an array of count views owned by the table.
+     */
+    const std::string_view* Split(const char* data, const int width, const int count);
+
+    //Remove leading/trailing blanks (spaces and NUL padding)
+    static std::string_view Trim(std::string_view text);
+
+    //Number of unique strings
+    int Size() {return (int)storage->index.size();}
+
+    //Clean memory (views returned before are not valid anymore)
+    void CleanUp();
+
+private:
+    std::shared_ptr<StringStorage> storage;
+
+    //Copy characters to the blocks
+    const char* Store(std::string_view text);
+};
+
+#endif // STRING_TABLE_H
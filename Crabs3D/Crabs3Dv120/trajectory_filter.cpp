@@ -0,0 +1,374 @@
+#include "trajectory_filter.h"
+#include <math.h>
+#include <algorithm>
+
+#define BUTTERWORTH_CORRECTION 0.802 //cut-off correction of a 2nd order filter applied twice (Winter)
+
+/**********/
+/* Public */
+/**********/
+
+bool TrajectoryFilter::Apply(TrajectoryFilter* filter, const FrameStore frames, const float rate, const FilterOptions options, MarkerGaps* gaps) {
+    CleanUp(filter);
+
+    if(frames.positions == NULL || frames.frameSize <= 0 || frames.pointSize <= 0)
+        return false;
+
+    filter->frameSize = frames.frameSize;
+    filter->pointSize = frames.pointSize;
+    filter->rate = rate > 0 ? rate : 1.0;
+
+    const int n = filter->frameSize;
+    const int columns = filter->pointSize*3;
+    filter->raw.resize((size_t)columns*n);
+    filter->filtered.resize((size_t)columns*n);
+    filter->filteredState.assign(columns, 0);
+    filter->velocityState.assign(columns, 0);
+    filter->accelerationState.assign(columns, 0);
+
+    //Frame-major x,y,z to columns (blocks of frames stay in cache)
+    float* raw = filter->raw.data();
+    const float* positions = frames.positions;
+    #pragma omp parallel for
+    for(int block = 0; block < n; block += FILTER_TRANSPOSE_BLOCK) {
+        int end = std::min(block + FILTER_TRANSPOSE_BLOCK, n);
+        for(int c = 0; c < columns; c++)
+            for(int f = block; f < end; f++)
+                raw[(size_t)c*n + f] = positions[(size_t)f*columns + c];
+    }
+
+    //Valid intervals of every marker (the whole trial without gap analysis)
+    filter->segmentStart.resize(filter->pointSize + 1);
+    bool useGaps = gaps != NULL && gaps->PointSize() == filter->pointSize && gaps->FrameSize() == n;
+    for(int p = 0; p < filter->pointSize; p++) {
+        filter->segmentStart[p] = (int)filter->segments.size();
+        if(!useGaps)
+            filter->segments.push_back({0, n - 1});
+        else
+            for(int i = 0; i < gaps->IntervalSize(p); i++)
+                filter->segments.push_back(gaps->Interval(p, i));
+    }
+    filter->segmentStart[filter->pointSize] = (int)filter->segments.size();
+
+    filter->SetOptions(filter, options);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int c = 0; c < columns; c++)
+        filter->FilterColumn(c);
+
+    return true;
+}
+
+bool TrajectoryFilter::Reapply(TrajectoryFilter* filter, const FilterOptions options) {
+    if(filter->frameSize <= 0)
+        return false;
+
+    filter->SetOptions(filter, options);
+    filter->Invalidate(-1);
+
+    const int columns = filter->pointSize*3;
+    #pragma omp parallel for schedule(dynamic)
+    for(int c = 0; c < columns; c++)
+        filter->FilterColumn(c);
+
+    return true;
+}
+
+void TrajectoryFilter::Store(TrajectoryFilter* filter, FrameStore frames) {
+    if(frames.positions == NULL || frames.frameSize != filter->frameSize || frames.pointSize != filter->pointSize)
+        return;
+
+    const int n = filter->frameSize;
+    const int columns = filter->pointSize*3;
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int c = 0; c < columns; c++)
+        if(!filter->filteredState[c])
+            filter->FilterColumn(c);
+
+    const float* filtered = filter->filtered.data();
+    float* positions = frames.positions;
+    #pragma omp parallel for
+    for(int block = 0; block < n; block += FILTER_TRANSPOSE_BLOCK) {
+        int end = std::min(block + FILTER_TRANSPOSE_BLOCK, n);
+        for(int f = block; f < end; f++)
+            for(int c = 0; c < columns; c++)
+                positions[(size_t)f*columns + c] = filtered[(size_t)c*n + f];
+    }
+}
+
+const float* TrajectoryFilter::Position(const int point, const int axis) {
+    int column = point*3 + axis;
+    if(!filteredState[column])
+        FilterColumn(column);
+    return &filtered[(size_t)column*frameSize];
+}
+
+const float* TrajectoryFilter::Velocity(const int point, const int axis) {
+    int column = point*3 + axis;
+    if(velocity.empty())
+        velocity.resize(raw.size());
+    if(!velocityState[column]) {
+        DeriveColumn(column, 1, &velocity[(size_t)column*frameSize]);
+        velocityState[column] = 1;
+    }
+    return &velocity[(size_t)column*frameSize];
+}
+
+const float* TrajectoryFilter::Acceleration(const int point, const int axis) {
+    int column = point*3 + axis;
+    if(acceleration.empty())
+        acceleration.resize(raw.size());
+    if(!accelerationState[column]) {
+        DeriveColumn(column, 2, &acceleration[(size_t)column*frameSize]);
+        accelerationState[column] = 1;
+    }
+    return &acceleration[(size_t)column*frameSize];
+}
+
+void TrajectoryFilter::SetPosition(const int point, const int frame, const float x, const float y, const float z) {
+    raw[(size_t)(point*3 + 0)*frameSize + frame] = x;
+    raw[(size_t)(point*3 + 1)*frameSize + frame] = y;
+    raw[(size_t)(point*3 + 2)*frameSize + frame] = z;
+    Invalidate(point);
+}
+
+void TrajectoryFilter::Invalidate(const int point) {
+    int first = point < 0 ? 0 : point*3;
+    int last = point < 0 ? pointSize*3 : point*3 + 3;
+    for(int c = first; c < last; c++)
+        filteredState[c] = velocityState[c] = accelerationState[c] = 0;
+}
+
+void TrajectoryFilter::CleanUp(TrajectoryFilter* filter) {
+    std::vector<float>().swap(filter->raw);
+    std::vector<float>().swap(filter->filtered);
+    std::vector<float>().swap(filter->velocity);
+    std::vector<float>().swap(filter->acceleration);
+    filter->filteredState.clear();
+    filter->velocityState.clear();
+    filter->accelerationState.clear();
+    filter->segmentStart.clear();
+    filter->segments.clear();
+    for(int d = 0; d < 3; d++)
+        filter->golay[d].clear();
+
+    filter->frameSize = 0;
+    filter->pointSize = 0;
+}
+
+/***********/
+/* Private */
+/***********/
+
+void TrajectoryFilter::SetOptions(TrajectoryFilter* filter, const FilterOptions options) {
+    filter->options = options;
+    if(filter->options.window < 3)
+        filter->options.window = 3;
+    if(filter->options.window % 2 == 0)
+        filter->options.window++;
+    if(filter->options.polynomial < 1)
+        filter->options.polynomial = 1;
+    if(filter->options.polynomial >= filter->options.window)
+        filter->options.polynomial = filter->options.window - 1;
+
+    if(filter->options.method == FILTER_SAVITZKY_GOLAY)
+        GolayTables(filter->options.window, filter->options.polynomial, filter->golay);
+}
+
+void TrajectoryFilter::FilterColumn(const int column) {
+    const int n = frameSize;
+    const int point = column / 3;
+    const float* in = &raw[(size_t)column*n];
+    float* out = &filtered[(size_t)column*n];
+
+    //Samples outside the valid intervals are kept as they are
+    std::copy(in, in + n, out);
+
+    for(int s = segmentStart[point]; s < segmentStart[point+1]; s++) {
+        int first = segments[s].first;
+        int size = segments[s].last - first + 1;
+
+        if(options.method == FILTER_BUTTERWORTH)
+            Butterworth(&out[first], size, options.cutoff, rate);
+        else if(options.method == FILTER_SAVITZKY_GOLAY && size >= options.window)
+            Golay(&in[first], &out[first], size, options.window, golay[0], 1.0);
+    }
+
+    filteredState[column] = 1;
+}
+
+void TrajectoryFilter::DeriveColumn(const int column, const int order, float* out) {
+    const int n = frameSize;
+    const int point = column / 3;
+    const float* in = &raw[(size_t)column*n];
+    const float* p = Position(point, column % 3);
+    const float factor = order == 1 ? rate : rate*rate;
+
+    std::fill(out, out + n, 0.0f);
+
+    for(int s = segmentStart[point]; s < segmentStart[point+1]; s++) {
+        int first = segments[s].first;
+        int size = segments[s].last - first + 1;
+
+        //Savitzky-Golay derivative of the raw samples (a polynomial of lower degree has no such derivative)
+        if(options.method == FILTER_SAVITZKY_GOLAY && order <= options.polynomial && size >= options.window) {
+            Golay(&in[first], &out[first], size, options.window, golay[order], factor);
+            continue;
+        }
+
+        //Central differences of the filtered samples
+        if(size < 3)
+            continue;
+        const float* x = &p[first];
+        float* y = &out[first];
+        if(order == 1) {
+            #pragma omp simd
+            for(int i = 1; i < size - 1; i++)
+                y[i] = (x[i+1] - x[i-1]) * 0.5f * factor;
+            y[0] = (x[1] - x[0]) * factor;
+            y[size-1] = (x[size-1] - x[size-2]) * factor;
+        } else {
+            #pragma omp simd
+            for(int i = 1; i < size - 1; i++)
+                y[i] = (x[i+1] - 2.0f*x[i] + x[i-1]) * factor;
+            y[0] = y[1];
+            y[size-1] = y[size-2];
+        }
+    }
+}
+
+void TrajectoryFilter::GolayTables(const int window, const int polynomial, std::vector<float> tables[3]) {
+    const int terms = polynomial + 1;
+    for(int d = 0; d < 3; d++)
+        tables[d].assign((size_t)window*window, 0.0f);
+
+    std::vector<double> a((size_t)window*terms);
+    std::vector<double> m((size_t)terms*terms*2);
+
+    //Least squares fit of the window around every position t0: coefficients = d! * row d of (A'A)^-1 A'
+    for(int t0 = 0; t0 < window; t0++) {
+        for(int j = 0; j < window; j++) {
+            double power = 1.0;
+            for(int k = 0; k < terms; k++) {
+                a[j*terms + k] = power;
+                power *= j - t0;
+            }
+        }
+
+        //[A'A | I] and Gauss-Jordan elimination
+        for(int r = 0; r < terms; r++) {
+            for(int c = 0; c < terms; c++) {
+                double sum = 0.0;
+                for(int j = 0; j < window; j++)
+                    sum += a[j*terms + r] * a[j*terms + c];
+                m[r*2*terms + c] = sum;
+                m[r*2*terms + terms + c] = r == c ? 1.0 : 0.0;
+            }
+        }
+        for(int c = 0; c < terms; c++) {
+            int pivot = c;
+            for(int r = c + 1; r < terms; r++)
+                if(fabs(m[r*2*terms + c]) > fabs(m[pivot*2*terms + c]))
+                    pivot = r;
+            for(int k = 0; k < 2*terms; k++)
+                std::swap(m[c*2*terms + k], m[pivot*2*terms + k]);
+            double diagonal = m[c*2*terms + c];
+            for(int k = 0; k < 2*terms; k++)
+                m[c*2*terms + k] /= diagonal;
+            for(int r = 0; r < terms; r++) {
+                if(r == c)
+                    continue;
+                double value = m[r*2*terms + c];
+                for(int k = 0; k < 2*terms; k++)
+                    m[r*2*terms + k] -= value * m[c*2*terms + k];
+            }
+        }
+
+        for(int d = 0; d < 3 && d < terms; d++) {
+            double factorial = d == 2 ? 2.0 : 1.0;
+            for(int j = 0; j < window; j++) {
+                double sum = 0.0;
+                for(int k = 0; k < terms; k++)
+                    sum += m[d*2*terms + terms + k] * a[j*terms + k];
+                tables[d][(size_t)t0*window + j] = factorial * sum;
+            }
+        }
+    }
+}
+
+void TrajectoryFilter::Butterworth(float* x, const int n, const float cutoff, const float rate) {
+    if(n < 3 || cutoff <= 0 || cutoff >= rate / 2.0 * BUTTERWORTH_CORRECTION)
+        return;
+
+    //2nd order low-pass coefficients
+    const double wc = tan(M_PI * cutoff / rate) / BUTTERWORTH_CORRECTION;
+    const double k1 = sqrt(2.0) * wc;
+    const double k2 = wc * wc;
+    const double a0 = k2 / (1.0 + k1 + k2);
+    const double a1 = 2.0 * a0;
+    const double a2 = a0;
+    const double k3 = 2.0 * a0 / k2;
+    const double b1 = -2.0 * a0 + k3;
+    const double b2 = 1.0 - 2.0 * a0 - k3;
+
+    //Odd reflection at both ends (about one period of the cut-off) against the start-up transient
+    int pad = std::min(n - 1, (int)ceil(rate / cutoff));
+    std::vector<double> y(n + 2*pad);
+    for(int i = 0; i < n; i++)
+        y[pad + i] = x[i];
+    for(int k = 1; k <= pad; k++) {
+        y[pad - k] = 2.0*x[0] - x[k];
+        y[pad + n - 1 + k] = 2.0*x[n-1] - x[n-1-k];
+    }
+
+    //Forward and backward passes (zero lag)
+    const int size = (int)y.size();
+    double x1 = y[0], x2 = y[0], y1 = y[0], y2 = y[0];
+    for(int i = 0; i < size; i++) {
+        double value = y[i];
+        double out = a0*value + a1*x1 + a2*x2 + b1*y1 + b2*y2;
+        x2 = x1; x1 = value;
+        y2 = y1; y1 = out;
+        y[i] = out;
+    }
+    x1 = x2 = y1 = y2 = y[size-1];
+    for(int i = size - 1; i >= 0; i--) {
+        double value = y[i];
+        double out = a0*value + a1*x1 + a2*x2 + b1*y1 + b2*y2;
+        x2 = x1; x1 = value;
+        y2 = y1; y1 = out;
+        y[i] = out;
+    }
+
+    for(int i = 0; i < n; i++)
+        x[i] = y[pad + i];
+}
+
+void TrajectoryFilter::Golay(const float* x, float* out, const int n, const int window, const std::vector<float>& table, const float factor) {
+    const int half = window / 2;
+
+    //Centered window
+    const float* c = &table[(size_t)half*window];
+    for(int i = half; i < n - half; i++) {
+        const float* samples = &x[i - half];
+        float sum = 0.0f;
+        #pragma omp simd reduction(+:sum)
+        for(int j = 0; j < window; j++)
+            sum += c[j] * samples[j];
+        out[i] = sum * factor;
+    }
+
+    //First and last samples: the fit of the first/last window at their position
+    for(int i = 0; i < half; i++) {
+        const float* head = &table[(size_t)i*window];
+        const float* tail = &table[(size_t)(window - 1 - i)*window];
+        float first = 0.0f, last = 0.0f;
+        for(int j = 0; j < window; j++) {
+            first += head[j] * x[j];
+            last += tail[j] * x[n - window + j];
+        }
+        out[i] = first * factor;
+        out[n - 1 - i] = last * factor;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef TRAJECTORY_FILTER_H
+#define TRAJECTORY_FILTER_H
+
+#include <vector>
+#include "model.h"
+#include "marker_gaps.h"
+
+//Filter methods
+#define FILTER_NONE            0
+#define FILTER_BUTTERWORTH     1 //4th order zero-lag low-pass (2nd order forward and backward)
+#define FILTER_SAVITZKY_GOLAY  2
+
+//Default options (method, cut-off, window, polynomial)
+#define FILTER_DEFAULT_OPTIONS {FILTER_NONE, 6.0, 11, 3}
+
+//Frames of the blocked transpose between the frame store and the columns
+#define FILTER_TRANSPOSE_BLOCK 64
+
+struct FilterOptions {
+    int method;
+    float cutoff;   //Butterworth cut-off frequency (Hz)
+    int window;     //Savitzky-Golay window (odd number of frames)
+    int polynomial; //Savitzky-Golay polynomial degree
+};
+
+/* Filtered positions of every marker and their velocity and acceleration.
+ * Every marker axis is one contiguous column of FrameSize() values, so markers are filtered in parallel
+ * with sequential memory access. Each valid interval of a marker (see MarkerGaps) is filtered on its own.
+ * Velocity and acceleration columns are computed on the first request and dropped when a position is edited.
+ */
+class TrajectoryFilter
+{
+public:
+    TrajectoryFilter() {frameSize = 0; pointSize = 0; rate = 0.0; options = FILTER_DEFAULT_OPTIONS;}
+
+    //Copy the positions of the frame store (points per second: rate) and filter every marker
+    bool Apply(TrajectoryFilter* filter, const FrameStore frames, const float rate, const FilterOptions options, MarkerGaps* gaps = NULL);
+
+    //Filter the positions copied by Apply again with other options
+    bool Reapply(TrajectoryFilter* filter, const FilterOptions options);
+
+    //Return the options of the last filter (after the window/polynomial limits)
+    FilterOptions Options() {return options;}
+
+    //Write the filtered positions to a frame store of the same size
+    void Store(TrajectoryFilter* filter, FrameStore frames);
+
+    //Return the number of frames
+    int FrameSize() {return frameSize;}
+
+    //Return the number of markers
+    int PointSize() {return pointSize;}
+
+    //Return the filtered positions of a marker axis (0 x, 1 y, 2 z)
+    const float* Position(const int point, const int axis);
+
+    //Return the velocity of a marker axis (units per second)
+    const float* Velocity(const int point, const int axis);
+
+    //Return the acceleration of a marker axis (units per second^2)
+    const float* Acceleration(const int point, const int axis);
+
+    //Edit a raw position (the marker is filtered again on the next request)
+    void SetPosition(const int point, const int frame, const float x, const float y, const float z);
+
+    //Drop the filtered and derived columns of a marker (every marker if point < 0)
+    void Invalidate(const int point);
+
+    //Clean Memory
+    void CleanUp(TrajectoryFilter* filter);
+
+private:
+    int frameSize;
+    int pointSize;
+    float rate;
+    FilterOptions options;
+
+    std::vector<float> raw;          //[pointSize*3][frameSize]
+    std::vector<float> filtered;     //[pointSize*3][frameSize]
+    std::vector<float> velocity;     //allocated on the first request
+    std::vector<float> acceleration; //allocated on the first request
+    std::vector<char> filteredState; //per column
+    std::vector<char> velocityState;
+    std::vector<char> accelerationState;
+
+    std::vector<int> segmentStart;        //first segment of every marker (pointSize + 1 values)
+    std::vector<GapInterval> segments;    //valid intervals of the markers
+
+    //Savitzky-Golay coefficients [derivative][position in the window][sample]
+    std::vector<float> golay[3];
+
+    //Set the options (odd window of 3 frames or more, polynomial below the window) and the Savitzky-Golay tables
+    void SetOptions(TrajectoryFilter* filter, const FilterOptions options);
+
+    //Filter a column
+    void FilterColumn(const int column);
+
+    //Differentiate a column (order 1 velocity, 2 acceleration; central differences when the Savitzky-Golay polynomial is below the order)
+    void DeriveColumn(const int column, const int order, float* out);
+
+    //Savitzky-Golay coefficient tables of the window
+    static void GolayTables(const int window, const int polynomial, std::vector<float> tables[3]);
+
+    //Zero-lag Butterworth low-pass of n samples (in place)
+    static void Butterworth(float* x, const int n, const float cutoff, const float rate);
+
+    //Savitzky-Golay convolution of n samples (derivative: table of GolayTables)
+    static void Golay(const float* x, float* out, const int n, const int window, const std::vector<float>& table, const float factor);
+};
+
+#endif // TRAJECTORY_FILTER_H
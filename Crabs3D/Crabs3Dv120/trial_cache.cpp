@@ -0,0 +1,548 @@
+#include "trial_cache.h"
+#include "profiler.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define TRIAL_CACHE_MAGIC "C3DCACHE"
+#define TRIAL_CACHE_EXTENSION ".c3dcache"
+#define TRIAL_CACHE_ALIGN 64
+#define TRIAL_CACHE_CHUNK (1 << 20) //Bytes hashed per read
+#define TRIAL_CACHE_HEAD (1 << 18)   //Bytes sampled from the start of a file (the header and the largest parameter section, 255 blocks)
+#define TRIAL_CACHE_SAMPLES 16       //Chunks sampled after them (the last one ends the file)
+#define TRIAL_CACHE_SAMPLE 4096      //Bytes of a chunk
+
+//First bytes of an entry (sections are 64-byte aligned after it)
+struct TrialCacheHeader {
+    char magic[8];
+    int version;
+    int endian; //1 in the byte order of the writer
+    unsigned long long key;
+    TrialParameters parameters;
+    TrialSource source;
+
+    int frameSize;
+    int pointSize;
+    int analogChannels;
+    int analogPerFrame;
+    int clusterSize;
+    int modelSize;
+
+    long long offset[TRIAL_CACHE_SECTION_SIZE];
+    long long size[TRIAL_CACHE_SECTION_SIZE];
+};
+
+//Mix a 64-bit value into a hash (multiply and xor-shift)
+static inline unsigned long long Mix(unsigned long long hash, const unsigned long long value) {
+    hash ^= value;
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29);
+}
+
+//Mix bytes into four lanes of 64-bit words (independent multiplies), the tail is zero padded (buffer holds whole words)
+static void MixBytes(unsigned long long lane[4], unsigned long long* buffer, const size_t bytes) {
+    size_t words = (bytes + 7) / 8;
+    memset((char*)buffer + bytes, 0, words*8 - bytes);
+    size_t w = 0;
+    for(; w + 4 <= words; w += 4) {
+        lane[0] = Mix(lane[0], buffer[w + 0]);
+        lane[1] = Mix(lane[1], buffer[w + 1]);
+        lane[2] = Mix(lane[2], buffer[w + 2]);
+        lane[3] = Mix(lane[3], buffer[w + 3]);
+    }
+    for(; w < words; w++)
+        lane[w % 4] = Mix(lane[w % 4], buffer[w]);
+}
+
+//Hash of the lanes and the byte count
+static unsigned long long LaneHash(const unsigned long long lane[4], const long long total) {
+    unsigned long long value = Mix(lane[0], (unsigned long long)total);
+    for(int l = 1; l < 4; l++)
+        value = Mix(value, lane[l]);
+    return value;
+}
+
+//Bytes of a section padded to the alignment
+static inline long long Align(const long long size) {
+    return (size + TRIAL_CACHE_ALIGN - 1) / TRIAL_CACHE_ALIGN * TRIAL_CACHE_ALIGN;
+}
+
+//Same file as the one an entry was written from (same inode, not modified and without status change since)
+static bool SameFile(const TrialSource a, const TrialSource b) {
+    return a.fileSize == b.fileSize && a.modified == b.modified && a.modifiedNano == b.modifiedNano &&
+           a.changed == b.changed && a.changedNano == b.changedNano &&
+           a.device == b.device && a.inode == b.inode;
+}
+
+static bool SameParameters(const TrialParameters a, const TrialParameters b) {
+    return a.firstFrame == b.firstFrame && a.lastFrame == b.lastFrame && a.stride == b.stride && a.clusterSize == b.clusterSize &&
+           a.miniBatch == b.miniBatch && a.batchSize == b.batchSize && a.iterations == b.iterations && a.rigidityThreshold == b.rigidityThreshold;
+}
+
+/**********/
+/* Public */
+/**********/
+
+TrialCache::TrialCache() {
+    limit = TRIAL_CACHE_LIMIT;
+    directory = DefaultDirectory();
+
+    //Size limit in MB (0 disables the cache)
+    const char* size = getenv("CRABS3D_CACHE_SIZE");
+    if(size != NULL && size[0] != '\0')
+        limit = atoll(size)*1024*1024;
+}
+
+std::string TrialCache::DefaultDirectory() {
+    const char* path = getenv("CRABS3D_CACHE_DIR");
+    if(path != NULL && path[0] != '\0')
+        return path;
+    else if((path = getenv("XDG_CACHE_HOME")) != NULL && path[0] != '\0')
+        return std::string(path) + "/crabs3d";
+    else if((path = getenv("HOME")) != NULL && path[0] != '\0')
+        return std::string(path) + "/.cache/crabs3d";
+    return "";
+}
+
+bool TrialCache::HashFile(const std::string fileName, unsigned long long* hash, long long* fileSize) {
+    PROFILE_SCOPE("TrialCache::HashFile");
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if(file == NULL)
+        return false;
+
+    unsigned long long lane[4] = {0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL};
+    std::vector<unsigned long long> buffer(TRIAL_CACHE_CHUNK / sizeof(unsigned long long));
+    long long total = 0;
+    size_t bytes;
+    while((bytes = fread(buffer.data(), 1, TRIAL_CACHE_CHUNK, file)) > 0) {
+        MixBytes(lane, buffer.data(), bytes);
+        total += bytes;
+    }
+    bool result = !ferror(file);
+    fclose(file);
+    PROFILE_COUNT(PROFILE_BYTES_READ, total);
+
+    *hash = LaneHash(lane, total);
+    *fileSize = total;
+    return result;
+}
+
+bool TrialCache::SampleFile(const std::string fileName, TrialSource* source) {
+    PROFILE_SCOPE("TrialCache::SampleFile");
+
+    struct stat status;
+    if(stat(fileName.c_str(), &status) != 0)
+        return false;
+    source->fileSize = (long long)status.st_size;
+    source->modified = (long long)status.st_mtime;
+    source->modifiedNano = (long long)status.st_mtim.tv_nsec;
+    source->changed = (long long)status.st_ctime;
+    source->changedNano = (long long)status.st_ctim.tv_nsec;
+    source->device = (long long)status.st_dev;
+    source->inode = (long long)status.st_ino;
+    source->content = 0;
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if(file == NULL)
+        return false;
+
+    //Every byte of the header and the parameter blocks (the whole file if it is small)
+    unsigned long long lane[4] = {0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL};
+    const bool whole = source->fileSize <= TRIAL_CACHE_HEAD + (long long)TRIAL_CACHE_SAMPLES*TRIAL_CACHE_SAMPLE;
+    std::vector<unsigned long long> buffer(TRIAL_CACHE_HEAD / sizeof(unsigned long long));
+    long long total = 0;
+    size_t bytes;
+    while((bytes = fread(buffer.data(), 1, TRIAL_CACHE_HEAD, file)) > 0) {
+        MixBytes(lane, buffer.data(), bytes);
+        total += bytes;
+        if(!whole)
+            break;
+    }
+
+    //Chunks spread evenly from the end of the head to the end of the file
+    const long long span = source->fileSize - TRIAL_CACHE_HEAD - TRIAL_CACHE_SAMPLE;
+    for(int s = 0; s < TRIAL_CACHE_SAMPLES && !whole; s++) {
+        long long offset = TRIAL_CACHE_HEAD + span*s / (TRIAL_CACHE_SAMPLES - 1);
+        if(fseeko(file, (off_t)offset, SEEK_SET) != 0)
+            break;
+        bytes = fread(buffer.data(), 1, TRIAL_CACHE_SAMPLE, file);
+        MixBytes(lane, buffer.data(), bytes);
+        total += bytes;
+    }
+    bool result = !ferror(file);
+    fclose(file);
+    PROFILE_COUNT(PROFILE_BYTES_READ, total);
+
+    source->sample = LaneHash(lane, source->fileSize);
+    return result;
+}
+
+unsigned long long TrialCache::Key(const unsigned long long hash, const long long fileSize, const TrialParameters parameters) {
+    unsigned int threshold;
+    memcpy(&threshold, &parameters.rigidityThreshold, sizeof(threshold));
+
+    unsigned long long key = Mix(hash, (unsigned long long)fileSize);
+    key = Mix(key, TRIAL_CACHE_VERSION);
+    key = Mix(key, (unsigned long long)parameters.firstFrame);
+    key = Mix(key, (unsigned long long)parameters.lastFrame);
+    key = Mix(key, (unsigned long long)parameters.stride << 32 | (unsigned int)parameters.clusterSize);
+    key = Mix(key, (unsigned long long)parameters.miniBatch << 32 | (unsigned int)parameters.batchSize);
+    key = Mix(key, (unsigned long long)parameters.iterations << 32 | threshold);
+    return key;
+}
+
+bool TrialCache::ReadMetadata(const std::string fileName, const int dataStart, std::vector<char>* metadata) {
+    if(dataStart < 2)
+        return false;
+
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if(file == NULL)
+        return false;
+
+    metadata->resize((size_t)(dataStart-1)*512);
+    bool result = fread(metadata->data(), 1, metadata->size(), file) == metadata->size();
+    fclose(file);
+    return result;
+}
+
+bool TrialCache::Load(const unsigned long long key, const TrialParameters parameters, const std::string fileName, const TrialSource source, CachedTrial* trial) {
+    PROFILE_SCOPE("TrialCache::Load");
+
+    if(!IsEnabled())
+        return false;
+
+    std::string path = EntryPath(key);
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if(descriptor < 0)
+        return false;
+
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || status.st_size < (off_t)sizeof(TrialCacheHeader)) {
+        close(descriptor);
+        return false;
+    }
+
+    //Private mapping: the frame store may be changed in place (filters) without touching the entry
+    size_t fileSize = (size_t)status.st_size;
+    void* address = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if(address == MAP_FAILED)
+        return false;
+
+    std::shared_ptr<char> mapping((char*)address, [fileSize](char* base) {munmap(base, fileSize);});
+    char* base = mapping.get();
+    const TrialCacheHeader* header = (const TrialCacheHeader*)base;
+
+    //Check the entry
+    bool valid = memcmp(header->magic, TRIAL_CACHE_MAGIC, 8) == 0 && header->version == TRIAL_CACHE_VERSION && header->endian == 1 &&
+                 header->key == key && SameParameters(header->parameters, parameters) && header->source.fileSize == source.fileSize &&
+                 header->frameSize > 0 && header->pointSize > 0 && header->clusterSize >= 0 && header->modelSize >= 0;
+    for(int s = 0; s < TRIAL_CACHE_SECTION_SIZE && valid; s++)
+        valid = header->offset[s] % TRIAL_CACHE_ALIGN == 0 && header->size[s] >= 0 && header->offset[s] >= (long long)sizeof(TrialCacheHeader) &&
+                header->offset[s] + header->size[s] <= (long long)fileSize;
+
+    const long long frameSize = header->frameSize, pointSize = header->pointSize, clusterSize = header->clusterSize;
+    valid = valid && header->size[TRIAL_CACHE_POINTS] == frameSize*pointSize*(long long)sizeof(Points_C3D) &&
+            header->size[TRIAL_CACHE_ANALOG] == (long long)header->analogChannels*frameSize*header->analogPerFrame*(long long)sizeof(float) &&
+            header->size[TRIAL_CACHE_STORE_ID] == pointSize*(long long)sizeof(int) &&
+            header->size[TRIAL_CACHE_STORE_POSITIONS] == frameSize*pointSize*3*(long long)sizeof(float) &&
+            header->size[TRIAL_CACHE_CENTROIDS] == clusterSize*(long long)sizeof(Centroid) &&
+            header->size[TRIAL_CACHE_COLORS] == clusterSize*(long long)sizeof(Color) &&
+            header->size[TRIAL_CACHE_CLUSTER_START] == (clusterSize > 0 ? clusterSize + 1 : 0)*(long long)sizeof(int) &&
+            header->size[TRIAL_CACHE_MODELS] == header->modelSize*(long long)sizeof(CachedModel);
+    if(!valid) {
+        unlink(path.c_str()); //stale or damaged entry
+        return false;
+    }
+
+    //Clusters and bones index other sections: check the ranges once here
+    const int* clusterStart = (const int*)(base + header->offset[TRIAL_CACHE_CLUSTER_START]);
+    long long clusterIds = header->size[TRIAL_CACHE_CLUSTER_IDS] / (long long)sizeof(int);
+    for(int i = 0; i < clusterSize && valid; i++)
+        valid = clusterStart[0] == 0 && clusterStart[i] <= clusterStart[i+1] && clusterStart[i+1] <= clusterIds;
+
+    const CachedModel* models = (const CachedModel*)(base + header->offset[TRIAL_CACHE_MODELS]);
+    long long boneInts = header->size[TRIAL_CACHE_BONES] / (long long)sizeof(int);
+    const int* boneData = (const int*)(base + header->offset[TRIAL_CACHE_BONES]);
+    for(int m = 0; m < header->modelSize && valid; m++) {
+        const CachedModel model = models[m];
+        valid = model.boneSize >= 0 && model.edgeSize >= 0 && model.bone >= 0 && model.bone + 2LL*model.boneSize + 1 + model.edgeSize <= boneInts;
+        const int* column = &boneData[valid ? model.bone : 0];
+        const int* offsets = &column[model.boneSize];
+        for(int i = 0; i < model.boneSize && valid; i++)
+            valid = column[i] >= 0 && column[i] < pointSize && offsets[0] == 0 && offsets[i] <= offsets[i+1];
+        valid = valid && offsets[model.boneSize] == model.edgeSize;
+        for(int e = 0; e < model.edgeSize && valid; e++)
+            valid = offsets[model.boneSize + 1 + e] >= 0 && offsets[model.boneSize + 1 + e] < model.boneSize;
+    }
+    if(!valid) {
+        unlink(path.c_str());
+        return false;
+    }
+
+    //Another file, or modified since the entry was written: the sampled key is checked against every byte once
+    if(!SameFile(header->source, source)) {
+        unsigned long long content;
+        long long fileSize;
+        if(!HashFile(fileName, &content, &fileSize) || fileSize != source.fileSize || content != header->source.content) {
+            unlink(path.c_str()); //another file with the same samples
+            return false;
+        }
+
+        //The entry takes the identity of this file (an entry that can't be opened for writing is hashed on every open)
+        TrialSource stamp = source;
+        stamp.content = header->source.content;
+        int descriptor = open(path.c_str(), O_WRONLY);
+        if(descriptor >= 0) {
+            ssize_t written = pwrite(descriptor, &stamp, sizeof(stamp), offsetof(TrialCacheHeader, source));
+            close(descriptor);
+            if(written != (ssize_t)sizeof(stamp)) {
+                unlink(path.c_str()); //the header may be half written
+                return false;
+            }
+        }
+    }
+
+    trial->metadata = base + header->offset[TRIAL_CACHE_METADATA];
+    trial->metadataSize = (size_t)header->size[TRIAL_CACHE_METADATA];
+    trial->frameSize = header->frameSize;
+    trial->pointSize = header->pointSize;
+    trial->points = (const Points_C3D*)(base + header->offset[TRIAL_CACHE_POINTS]);
+    trial->analogChannels = header->analogChannels;
+    trial->analogPerFrame = header->analogPerFrame;
+    trial->analog = (const float*)(base + header->offset[TRIAL_CACHE_ANALOG]);
+
+    trial->frames.frameSize = header->frameSize;
+    trial->frames.pointSize = header->pointSize;
+    trial->frames.id = (int*)(base + header->offset[TRIAL_CACHE_STORE_ID]);
+    trial->frames.positions = (float*)(base + header->offset[TRIAL_CACHE_STORE_POSITIONS]);
+    trial->frames.arena = mapping;
+
+    trial->clusterSize = header->clusterSize;
+    trial->centroids = (const Centroid*)(base + header->offset[TRIAL_CACHE_CENTROIDS]);
+    trial->colors = (const Color*)(base + header->offset[TRIAL_CACHE_COLORS]);
+    trial->clusterStart = clusterStart;
+    trial->clusterIds = (const int*)(base + header->offset[TRIAL_CACHE_CLUSTER_IDS]);
+
+    trial->modelSize = header->modelSize;
+    trial->models = models;
+    trial->bones = boneData;
+    trial->mapping = mapping;
+
+    utime(path.c_str(), NULL); //most recently used
+    return true;
+}
+
+bool TrialCache::Store(const unsigned long long key, const TrialParameters parameters, const TrialSource source, const std::vector<char>& metadata, Read_C3D* c3d_f,
+                       const FrameStore frames, KMeans* cluster, const int clusterSize, std::vector<Model>* models) {
+    PROFILE_SCOPE("TrialCache::Store");
+
+    if(!IsEnabled() || !CreateDirectory())
+        return false;
+
+    const int frameSize = frames.frameSize;
+    const int pointSize = frames.pointSize;
+    Data_c3d data = c3d_f->Data();
+    if(frameSize <= 0 || pointSize <= 0 || c3d_f->Header().NumberOfPoints() != pointSize || source.content == 0)
+        return false;
+
+    //Cluster ids (CSR)
+    std::vector<int> clusterStart, clusterIds;
+    std::vector<Centroid> centroids;
+    std::vector<Color> colors;
+    for(int i = 0; i < clusterSize; i++) {
+        Cluster c = cluster->GetCluster(i);
+        clusterStart.push_back((int)clusterIds.size());
+        clusterIds.insert(clusterIds.end(), c.cloud.id, c.cloud.id + c.size);
+        centroids.push_back(c.centroid);
+        colors.push_back(c.color);
+    }
+    if(clusterSize > 0)
+        clusterStart.push_back((int)clusterIds.size());
+
+    //Models and their bones
+    std::vector<CachedModel> cachedModels;
+    std::vector<int> bones;
+    for(size_t m = 0; models != NULL && m < models->size(); m++) {
+        Bones b = (*models)[m].GetBones();
+        if(!b.state || b.frames.positions != frames.positions)
+            continue; //bones of another store
+
+        CachedModel cached;
+        memset(&cached, 0, sizeof(cached));
+        strncpy(cached.name, (*models)[m].GetModelName().c_str(), sizeof(cached.name) - 1);
+        cached.color = (*models)[m].GetColor();
+        cached.boneSize = b.boneSize;
+        cached.edgeSize = b.edgeSize;
+        cached.bone = (long long)bones.size();
+        bones.insert(bones.end(), b.column, b.column + b.boneSize);
+        bones.insert(bones.end(), b.offsets, b.offsets + b.boneSize + 1);
+        bones.insert(bones.end(), b.neighbors, b.neighbors + b.edgeSize);
+        cachedModels.push_back(cached);
+    }
+
+    TrialCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRIAL_CACHE_MAGIC, 8);
+    header.version = TRIAL_CACHE_VERSION;
+    header.endian = 1;
+    header.key = key;
+    header.parameters = parameters;
+    header.source = source;
+    header.frameSize = frameSize;
+    header.pointSize = pointSize;
+    header.analogChannels = data.AnalogChannelSize();
+    header.analogPerFrame = data.AnalogPerFrame();
+    header.clusterSize = clusterSize;
+    header.modelSize = (int)cachedModels.size();
+
+    header.size[TRIAL_CACHE_METADATA] = (long long)metadata.size();
+    header.size[TRIAL_CACHE_POINTS] = (long long)frameSize*pointSize*sizeof(Points_C3D);
+    header.size[TRIAL_CACHE_ANALOG] = (long long)header.analogChannels*data.AnalogSampleSize()*sizeof(float);
+    header.size[TRIAL_CACHE_STORE_ID] = (long long)pointSize*sizeof(int);
+    header.size[TRIAL_CACHE_STORE_POSITIONS] = (long long)frameSize*pointSize*3*sizeof(float);
+    header.size[TRIAL_CACHE_CENTROIDS] = (long long)centroids.size()*sizeof(Centroid);
+    header.size[TRIAL_CACHE_COLORS] = (long long)colors.size()*sizeof(Color);
+    header.size[TRIAL_CACHE_CLUSTER_START] = (long long)clusterStart.size()*sizeof(int);
+    header.size[TRIAL_CACHE_CLUSTER_IDS] = (long long)clusterIds.size()*sizeof(int);
+    header.size[TRIAL_CACHE_MODELS] = (long long)cachedModels.size()*sizeof(CachedModel);
+    header.size[TRIAL_CACHE_BONES] = (long long)bones.size()*sizeof(int);
+
+    long long offset = Align(sizeof(TrialCacheHeader));
+    for(int s = 0; s < TRIAL_CACHE_SECTION_SIZE; s++) {
+        header.offset[s] = offset;
+        offset += Align(header.size[s]);
+    }
+
+    //Write a temporary file and rename it (readers see the old entry or the new one)
+    std::string path = EntryPath(key);
+    std::string temporary = path + ".tmp" + std::to_string((long long)getpid());
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    static const char zeros[TRIAL_CACHE_ALIGN] = {0};
+    long long written = 0;
+    auto Write = [&](const int section, const void* bytes, const long long size) {
+        if(section >= 0) {
+            fwrite(zeros, 1, (size_t)(header.offset[section] - written), file);
+            written = header.offset[section];
+        }
+        fwrite(bytes, 1, (size_t)size, file);
+        written += size;
+    };
+
+    Write(-1, &header, sizeof(header));
+    Write(TRIAL_CACHE_METADATA, metadata.data(), header.size[TRIAL_CACHE_METADATA]);
+
+    //Points one frame at a time (Frames_C3D keeps them behind accessors)
+    std::vector<Points_C3D> framePoints(pointSize);
+    for(int i = 0; i < frameSize; i++) {
+        Frames_C3D frame = data.Frame(i);
+        for(int j = 0; j < pointSize; j++)
+            framePoints[j] = frame.Point(j);
+        Write(i == 0 ? TRIAL_CACHE_POINTS : -1, framePoints.data(), (long long)pointSize*sizeof(Points_C3D));
+    }
+    Write(TRIAL_CACHE_ANALOG, header.analogChannels > 0 ? data.AnalogChannel(0) : NULL, header.size[TRIAL_CACHE_ANALOG]);
+    Write(TRIAL_CACHE_STORE_ID, frames.id, header.size[TRIAL_CACHE_STORE_ID]);
+    Write(TRIAL_CACHE_STORE_POSITIONS, frames.positions, header.size[TRIAL_CACHE_STORE_POSITIONS]);
+    Write(TRIAL_CACHE_CENTROIDS, centroids.data(), header.size[TRIAL_CACHE_CENTROIDS]);
+    Write(TRIAL_CACHE_COLORS, colors.data(), header.size[TRIAL_CACHE_COLORS]);
+    Write(TRIAL_CACHE_CLUSTER_START, clusterStart.data(), header.size[TRIAL_CACHE_CLUSTER_START]);
+    Write(TRIAL_CACHE_CLUSTER_IDS, clusterIds.data(), header.size[TRIAL_CACHE_CLUSTER_IDS]);
+    Write(TRIAL_CACHE_MODELS, cachedModels.data(), header.size[TRIAL_CACHE_MODELS]);
+    Write(TRIAL_CACHE_BONES, bones.data(), header.size[TRIAL_CACHE_BONES]);
+    fwrite(zeros, 1, (size_t)(offset - written), file);
+
+    bool result = !ferror(file);
+    result = fclose(file) == 0 && result;
+    if(!result || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    Trim(path);
+    return true;
+}
+
+void TrialCache::Trim(const std::string keep) {
+    DIR* dir = opendir(directory.c_str());
+    if(dir == NULL)
+        return ;
+
+    struct Entry {
+        std::string path;
+        long long size;
+        time_t used;
+    };
+    std::vector<Entry> entries;
+
+    const size_t extension = strlen(TRIAL_CACHE_EXTENSION);
+    struct dirent* item;
+    while((item = readdir(dir)) != NULL) {
+        std::string name = item->d_name;
+        if(name.size() <= extension || name.compare(name.size() - extension, extension, TRIAL_CACHE_EXTENSION) != 0)
+            continue;
+
+        Entry entry;
+        entry.path = directory + "/" + name;
+        struct stat status;
+        if(stat(entry.path.c_str(), &status) != 0)
+            continue;
+        entry.size = (long long)status.st_size;
+        entry.used = status.st_mtime;
+        entries.push_back(entry);
+    }
+    closedir(dir);
+
+    //Most recently used first, keep them while they fit
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {return a.used > b.used;});
+    long long total = 0;
+    for(size_t i = 0; i < entries.size(); i++) {
+        if(entries[i].path == keep) {
+            total += entries[i].size;
+            continue;
+        }
+        if(total + entries[i].size > limit)
+            unlink(entries[i].path.c_str());
+        else
+            total += entries[i].size;
+    }
+}
+
+void TrialCache::Clear() {
+    long long size = limit;
+    limit = 0;
+    Trim();
+    limit = size;
+}
+
+/***********/
+/* Private */
+/***********/
+
+std::string TrialCache::EntryPath(const unsigned long long key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", key);
+    return directory + "/" + name + TRIAL_CACHE_EXTENSION;
+}
+
+bool TrialCache::CreateDirectory() {
+    struct stat status;
+    if(stat(directory.c_str(), &status) == 0)
+        return S_ISDIR(status.st_mode);
+
+    //$HOME/.cache may not exist yet
+    size_t slash = directory.find_last_of('/');
+    if(slash != std::string::npos && slash > 0)
+        mkdir(directory.substr(0, slash).c_str(), 0755);
+    return mkdir(directory.c_str(), 0755) == 0;
+}
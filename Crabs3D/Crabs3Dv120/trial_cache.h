@@ -0,0 +1,161 @@
+#ifndef TRIAL_CACHE_H
+#define TRIAL_CACHE_H
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "read_c3d.h"
+#include "kmeans.h"
+#include "model.h"
+
+//Layout version (entries of another version are ignored and replaced, also bumped when the stored clusters/models change)
+#define TRIAL_CACHE_VERSION 5
+
+//Default size of the cache directory (least recently used entries are deleted above it)
+#define TRIAL_CACHE_LIMIT (1024LL*1024*1024)
+
+//Sections of an entry
+#define TRIAL_CACHE_METADATA        0 //File bytes before the data section (header and parameters)
+#define TRIAL_CACHE_POINTS          1 //Points_C3D [frameSize*pointSize] frame-major (gaps filled)
+#define TRIAL_CACHE_ANALOG          2 //float [analogChannels*frameSize*analogPerFrame] calibrated, channel-major
+#define TRIAL_CACHE_STORE_ID        3 //int [pointSize] frame store ids
+#define TRIAL_CACHE_STORE_POSITIONS 4 //float [frameSize*pointSize*3] frame store positions
+#define TRIAL_CACHE_CENTROIDS       5 //Centroid [clusterSize]
+#define TRIAL_CACHE_COLORS          6 //Color [clusterSize]
+#define TRIAL_CACHE_CLUSTER_START   7 //int [clusterSize+1] first id of every cluster
+#define TRIAL_CACHE_CLUSTER_IDS     8 //int [pointSize] cloud ids of the clusters
+#define TRIAL_CACHE_MODELS          9 //CachedModel [modelSize]
+#define TRIAL_CACHE_BONES          10 //int: column[boneSize], offsets[boneSize+1], neighbors[edgeSize] of every model
+#define TRIAL_CACHE_SECTION_SIZE   11
+
+//Everything that changes the decoded trial, the clusters or the bones (part of the key)
+struct TrialParameters {
+    long long firstFrame; //frame numbers of the file (64-bit like Read_C3D::FirstFrame)
+    long long lastFrame;
+    int stride;
+    int clusterSize;
+    int miniBatch;
+    int batchSize;
+    int iterations;
+    float rigidityThreshold;
+};
+
+//C3D file of an entry: the sampled hash is part of the key, the rest validates the entry
+struct TrialSource {
+    unsigned long long sample;  //Hash of the header and parameter blocks and of chunks spread over the data (see SampleFile)
+    unsigned long long content; //Hash of every byte (see HashFile, 0 until it is computed)
+    long long fileSize;
+    long long modified;     //Modification time of the file (seconds)
+    long long modifiedNano; //and its nanoseconds
+    long long changed;      //Status change time (seconds): a copy that keeps the modification time changes it
+    long long changedNano;
+    long long device;
+    long long inode;
+};
+
+//A model of an entry (its bones start at int "bone" of the bones section)
+struct CachedModel {
+    char name[64];
+    ModelColor color;
+    int boneSize;
+    int edgeSize;
+    long long bone;
+};
+
+/* A loaded entry. Every pointer points into the mapped file, which stays mapped while
+ * "mapping" or "frames" (the frame store is used in place, without a copy) is alive.
+ */
+struct CachedTrial {
+    const char* metadata;
+    size_t metadataSize;
+
+    int frameSize;
+    int pointSize;
+    const Points_C3D* points;
+
+    int analogChannels;
+    int analogPerFrame;
+    const float* analog;
+
+    FrameStore frames;
+
+    int clusterSize;
+    const Centroid* centroids;
+    const Color* colors;
+    const int* clusterStart;
+    const int* clusterIds;
+
+    int modelSize;
+    const CachedModel* models;
+    const int* bones;
+
+    std::shared_ptr<char> mapping;
+};
+
+/* Decoded trials on disk, keyed by a sampled hash of the C3D file and the processing parameters.
+ * An entry also holds the full content hash, compared only when the file isn't the one the entry was written from
+ * (another inode, modification or status change time).
+ * An entry is one file laid out so it can be mapped and used in place: a header with the offset and
+ * size of every section, each section 64-byte aligned. Entries are written to a temporary file and
+ * renamed, so a reader never sees half an entry. The modification time of an entry is its last use.
+ * Directory: $CRABS3D_CACHE_DIR, else $XDG_CACHE_HOME/crabs3d, else $HOME/.cache/crabs3d.
+ */
+class TrialCache
+{
+public:
+    TrialCache();
+
+    //Default directory: $CRABS3D_CACHE_DIR, else $XDG_CACHE_HOME/crabs3d, else $HOME/.cache/crabs3d (empty if none is set)
+    static std::string DefaultDirectory();
+
+    //Set the directory of the entries
+    void SetDirectory(const std::string directory) {this->directory = directory;}
+    std::string GetDirectory() {return directory;}
+
+    //Set the size limit of the directory in bytes (0 disables the cache)
+    void SetLimit(const long long bytes) {limit = bytes;}
+    long long GetLimit() {return limit;}
+    bool IsEnabled() {return limit > 0 && !directory.empty();}
+
+    //Content hash of a file (64-bit, not cryptographic) and its size
+    static bool HashFile(const std::string fileName, unsigned long long* hash, long long* fileSize);
+
+    //Size, modification time and sampled hash of a file: every byte of the header and parameter blocks and chunks of the data
+    static bool SampleFile(const std::string fileName, TrialSource* source);
+
+    //Key of an entry: the sampled hash, the file size and the parameters
+    static unsigned long long Key(const unsigned long long hash, const long long fileSize, const TrialParameters parameters);
+
+    //Read the bytes of a file before the data section (dataStart: first block of the data section)
+    static bool ReadMetadata(const std::string fileName, const int dataStart, std::vector<char>* metadata);
+
+    /* Map an entry (false if it is missing or doesn't match the key and the parameters). If the file isn't the one the entry
+     * was written from, its content hash is compared with the one of the entry (and the entry takes the new file identity)
+     */
+    bool Load(const unsigned long long key, const TrialParameters parameters, const std::string fileName, const TrialSource source, CachedTrial* trial);
+
+    /* Write an entry: the decoded trial (gaps filled), the frame store, the clusters and the models,
+     * then delete the least recently used entries above the size limit
+     */
+    bool Store(const unsigned long long key, const TrialParameters parameters, const TrialSource source, const std::vector<char>& metadata, Read_C3D* c3d_f,
+               const FrameStore frames, KMeans* cluster, const int clusterSize, std::vector<Model>* models);
+
+    //Delete the least recently used entries until the directory fits the limit (keep: entry never deleted)
+    void Trim(const std::string keep = "");
+
+    //Delete every entry
+    void Clear();
+
+private:
+    std::string directory;
+    long long limit;
+
+    //Path of the entry of a key
+    std::string EntryPath(const unsigned long long key);
+
+    //Create the directory (and its parent)
+    bool CreateDirectory();
+};
+
+#endif // TRIAL_CACHE_H
@@ -0,0 +1,461 @@
+#include "trial_catalog.h"
+#include "trial_cache.h"
+#include "profiler.h"
+#include <algorithm>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#define TRIAL_CATALOG_MAGIC "C3DCATLG"
+#define TRIAL_CATALOG_EXTENSION ".c3dcatalog"
+
+//First bytes of the index: the header, the directory, the records and the pool follow
+struct TrialCatalogHeader {
+    char magic[8];
+    int version;
+    int endian; //1 in the byte order of the writer
+    int recordBytes; //sizeof(CatalogRecord) of the writer
+    int recordSize;
+    long long directorySize;
+    long long poolSize;
+};
+
+//A C3D file found by the scan
+struct CatalogFile {
+    std::string path;
+    long long modified;
+    long long fileSize;
+};
+
+//Case-insensitive ".c3d" extension
+static bool IsC3D(const std::string& name) {
+    size_t size = name.size();
+    return size > 4 && name[size-4] == '.' && tolower(name[size-3]) == 'c' && name[size-2] == '3' && tolower(name[size-1]) == 'd';
+}
+
+//Files of a directory tree (hidden entries are skipped, symbolic links are not followed into directories)
+static void ListFiles(const std::string directory, std::vector<CatalogFile>* files) {
+    DIR* dir = opendir(directory.c_str());
+    if(dir == NULL)
+        return ;
+
+    std::vector<std::string> subdirectories;
+    struct dirent* item;
+    while((item = readdir(dir)) != NULL) {
+        if(item->d_name[0] == '.')
+            continue;
+
+        std::string path = directory + "/" + item->d_name;
+        struct stat status;
+        if(item->d_type == DT_DIR) {
+            subdirectories.push_back(path);
+        } else if(IsC3D(item->d_name) && stat(path.c_str(), &status) == 0 && S_ISREG(status.st_mode)) {
+            CatalogFile file;
+            file.path = path;
+            file.modified = (long long)status.st_mtime;
+            file.fileSize = (long long)status.st_size;
+            files->push_back(file);
+        } else if(item->d_type == DT_UNKNOWN && lstat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+            subdirectories.push_back(path); //File systems without d_type
+        }
+    }
+    closedir(dir);
+
+    for(size_t i = 0; i < subdirectories.size(); i++)
+        ListFiles(subdirectories[i], files);
+}
+
+//Case-insensitive substring (needle is lower case)
+static bool Contains(std::string_view folded, const std::string& needle) {
+    return needle.empty() || folded.find(needle) != std::string_view::npos;
+}
+
+static std::string Lower(std::string text) {
+    for(size_t i = 0; i < text.size(); i++)
+        text[i] = (char)tolower((unsigned char)text[i]);
+    return text;
+}
+
+//Create a directory (and its parent)
+static bool MakeDirectory(const std::string directory) {
+    struct stat status;
+    if(stat(directory.c_str(), &status) == 0)
+        return S_ISDIR(status.st_mode);
+
+    size_t slash = directory.find_last_of('/');
+    if(slash != std::string::npos && slash > 0)
+        MakeDirectory(directory.substr(0, slash));
+    return mkdir(directory.c_str(), 0755) == 0;
+}
+
+/**********/
+/* Public */
+/**********/
+
+bool TrialCatalog::Update(const std::string directory, CatalogUpdate* result) {
+    PROFILE_SCOPE("TrialCatalog::Update");
+
+    char absolute[PATH_MAX];
+    if(realpath(directory.c_str(), absolute) == NULL)
+        return false;
+
+    //The previous index of the directory (if any)
+    if(this->directory != absolute)
+        Load(absolute);
+    this->directory = absolute;
+
+    std::vector<CatalogFile> files;
+    {
+        PROFILE_SCOPE("Catalog scan");
+        ListFiles(this->directory, &files);
+        std::sort(files.begin(), files.end(), [](const CatalogFile& a, const CatalogFile& b) {return a.path < b.path;});
+    }
+
+    //Unchanged files keep their record, the others are read again
+    std::unordered_map<std::string_view, int> previous;
+    for(size_t i = 0; i < records.size(); i++)
+        previous[Text(records[i].path)] = (int)i;
+
+    std::vector<int> reused(files.size(), -1);
+    std::vector<int> changed;
+    for(size_t i = 0; i < files.size(); i++) {
+        auto found = previous.find(files[i].path);
+        if(found != previous.end() && records[found->second].modified == files[i].modified && records[found->second].fileSize == files[i].fileSize)
+            reused[i] = found->second;
+        else
+            changed.push_back((int)i);
+    }
+
+    //Metadata of the changed files (one file per iteration, the slow ones don't hold the others back)
+    struct Scanned {
+        CatalogRecord record;
+        std::string subjects;
+        std::string labels;
+        std::string manufacturer;
+        bool valid;
+    };
+    std::vector<Scanned> scanned(changed.size());
+    {
+        PROFILE_SCOPE("Catalog metadata");
+        int threads = std::max(omp_get_max_threads(), TRIAL_CATALOG_THREADS);
+        int size = (int)changed.size();
+        #pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for(int i = 0; i < size; i++) {
+            Scanned* trial = &scanned[i];
+            trial->valid = ReadTrial(files[changed[i]].path, &trial->record, &trial->subjects, &trial->labels, &trial->manufacturer);
+        }
+    }
+
+    //New records and pool (reused strings are copied from the old pool)
+    std::vector<CatalogRecord> oldRecords;
+    std::vector<char> oldPool;
+    oldRecords.swap(records);
+    oldPool.swap(pool);
+    auto OldText = [&](const CatalogText text) {return std::string_view(oldPool.data() + text.offset, text.size);};
+
+    CatalogUpdate update;
+    update.files = (int)files.size();
+    update.reused = 0;
+    update.read = (int)changed.size();
+    update.failed = 0;
+
+    size_t next = 0;
+    for(size_t i = 0; i < files.size(); i++) {
+        CatalogRecord record;
+        if(reused[i] >= 0) {
+            const CatalogRecord& old = oldRecords[reused[i]];
+            record = old;
+            record.subjects = Store(OldText(old.subjects));
+            record.labels = Store(OldText(old.labels));
+            record.manufacturer = Store(OldText(old.manufacturer));
+            update.reused++;
+        } else {
+            Scanned* trial = &scanned[next++];
+            if(trial->valid) {
+                record = trial->record;
+                record.subjects = Store(trial->subjects);
+                record.labels = Store(trial->labels);
+                record.manufacturer = Store(trial->manufacturer);
+                record.failed = 0;
+            } else {
+                memset(&record, 0, sizeof(record));
+                record.failed = 1;
+                update.failed++;
+            }
+        }
+        record.path = Store(files[i].path);
+        record.modified = files[i].modified;
+        record.fileSize = files[i].fileSize;
+        records.push_back(record);
+    }
+    Fold();
+
+    if(result != NULL)
+        *result = update;
+
+    return Save();
+}
+
+bool TrialCatalog::Load(const std::string directory) {
+    PROFILE_SCOPE("TrialCatalog::Load");
+
+    records.clear();
+    pool.clear();
+    folded.clear();
+    this->directory = directory;
+
+    FILE* file = fopen(IndexPath(directory).c_str(), "rb");
+    if(file == NULL)
+        return false;
+
+    TrialCatalogHeader header;
+    bool result = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, TRIAL_CATALOG_MAGIC, 8) == 0
+               && header.version == TRIAL_CATALOG_VERSION && header.endian == 1 && header.recordBytes == (int)sizeof(CatalogRecord)
+               && header.recordSize >= 0 && header.directorySize >= 0 && header.poolSize >= 0 && header.poolSize <= UINT_MAX;
+
+    //The index of another directory with the same hash is ignored
+    std::string name;
+    if(result) {
+        name.resize((size_t)header.directorySize);
+        result = fread(&name[0], 1, name.size(), file) == name.size() && name == directory;
+    }
+    if(result) {
+        records.resize(header.recordSize);
+        pool.resize((size_t)header.poolSize);
+        result = fread(records.data(), sizeof(CatalogRecord), records.size(), file) == records.size()
+              && fread(pool.data(), 1, pool.size(), file) == pool.size();
+    }
+    fclose(file);
+
+    //Every string must be inside the pool
+    for(size_t i = 0; result && i < records.size(); i++) {
+        const CatalogText texts[4] = {records[i].path, records[i].subjects, records[i].labels, records[i].manufacturer};
+        for(int t = 0; t < 4; t++)
+            result = result && (unsigned long long)texts[t].offset + texts[t].size <= pool.size();
+    }
+
+    if(!result) {
+        records.clear();
+        pool.clear();
+        return false;
+    }
+    Fold();
+    return true;
+}
+
+std::string TrialCatalog::IndexPath(const std::string directory) {
+    //FNV-1a of the absolute path
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    for(size_t i = 0; i < directory.size(); i++) {
+        hash ^= (unsigned char)directory[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", hash);
+    return TrialCache::DefaultDirectory() + "/" + name + TRIAL_CATALOG_EXTENSION;
+}
+
+std::vector<int> TrialCatalog::Filter(const CatalogFilter filter) {
+    PROFILE_SCOPE("TrialCatalog::Filter");
+
+    std::vector<std::string> words;
+    for(size_t w = 0; w < filter.words.size(); w++)
+        words.push_back(Lower(filter.words[w]));
+    std::string subject = Lower(filter.subject);
+    std::string label = Lower(filter.label);
+    std::string manufacturer = Lower(filter.manufacturer);
+
+    int size = (int)records.size();
+    std::vector<char> match(size, 0);
+    #pragma omp parallel for schedule(static) if(size > 4096)
+    for(int i = 0; i < size; i++) {
+        const CatalogRecord& record = records[i];
+        if(record.failed)
+            continue;
+        if((filter.minRate > 0 && record.pointRate < filter.minRate) || (filter.maxRate > 0 && record.pointRate > filter.maxRate) ||
+           (filter.minFrames > 0 && record.frameSize < filter.minFrames) || (filter.maxFrames > 0 && record.frameSize > filter.maxFrames))
+            continue;
+
+        std::string_view path(folded.data() + record.path.offset, record.path.size);
+        std::string_view subjects(folded.data() + record.subjects.offset, record.subjects.size);
+        std::string_view labels(folded.data() + record.labels.offset, record.labels.size);
+        std::string_view maker(folded.data() + record.manufacturer.offset, record.manufacturer.size);
+        if(!Contains(subjects, subject) || !Contains(labels, label) || !Contains(maker, manufacturer))
+            continue;
+
+        bool found = true;
+        for(size_t w = 0; found && w < words.size(); w++)
+            found = Contains(path, words[w]) || Contains(subjects, words[w]) || Contains(labels, words[w]) || Contains(maker, words[w]);
+        match[i] = found;
+    }
+
+    std::vector<int> indices;
+    for(int i = 0; i < size; i++)
+        if(match[i])
+            indices.push_back(i);
+    return indices;
+}
+
+int TrialCatalog::FailedSize() {
+    int size = 0;
+    for(size_t i = 0; i < records.size(); i++)
+        size += records[i].failed ? 1 : 0;
+    return size;
+}
+
+CatalogFilter TrialCatalog::ParseFilter(const std::string query) {
+    CatalogFilter filter;
+    filter.minRate = filter.maxRate = 0.0;
+    filter.minFrames = filter.maxFrames = 0;
+
+    size_t start = 0;
+    while(start < query.size()) {
+        size_t end = query.find(' ', start);
+        if(end == std::string::npos)
+            end = query.size();
+        std::string word = query.substr(start, end - start);
+        start = end + 1;
+        if(word.empty())
+            continue;
+
+        //key:value and key>=value, key<=value (key>value and key<value)
+        size_t colon = word.find(':');
+        size_t compare = word.find_first_of("<>");
+        std::string key = Lower(word.substr(0, std::min(colon, compare)));
+        if(colon != std::string::npos && compare == std::string::npos) {
+            std::string value = word.substr(colon + 1);
+            if(key == "subject")
+                filter.subject = value;
+            else if(key == "label")
+                filter.label = value;
+            else if(key == "maker" || key == "manufacturer")
+                filter.manufacturer = value;
+            else
+                filter.words.push_back(word);
+        } else if(compare != std::string::npos && (key == "rate" || key == "frames")) {
+            bool greater = word[compare] == '>';
+            bool equal = compare + 1 < word.size() && word[compare + 1] == '=';
+            const char* value = word.c_str() + compare + (equal ? 2 : 1);
+            if(key == "rate") {
+                float rate = (float)atof(value);
+                if(greater)
+                    filter.minRate = rate;
+                else
+                    filter.maxRate = rate;
+            } else {
+                long long frames = atoll(value) + (equal ? 0 : (greater ? 1 : -1));
+                if(greater)
+                    filter.minFrames = (int)std::min<long long>(frames, INT_MAX);
+                else
+                    filter.maxFrames = (int)std::max<long long>(frames, 1);
+            }
+        } else {
+            filter.words.push_back(word);
+        }
+    }
+    return filter;
+}
+
+/***********/
+/* Private */
+/***********/
+
+bool TrialCatalog::ReadTrial(const std::string path, CatalogRecord* record, std::string* subjects, std::string* labels, std::string* manufacturer) {
+    Read_C3D* c3d_f = new Read_C3D; //new: the parameter index and the string table need their constructors
+    if(!c3d_f->ImportMetadata(path, c3d_f)) {
+        delete c3d_f;
+        return false;
+    }
+
+    memset(record, 0, sizeof(CatalogRecord));
+    record->pointRate = c3d_f->POINT().Rate() > 0 ? c3d_f->POINT().Rate() : c3d_f->Header().FrameRate();
+    record->analogRate = c3d_f->ANALOG().Rate();
+    record->firstFrame = c3d_f->FirstFrame();
+    record->frameSize = c3d_f->FrameSize();
+    record->pointSize = c3d_f->Header().NumberOfPoints();
+    record->analogChannels = c3d_f->ANALOG().Used();
+    record->processor = c3d_f->Parameter()->Header().ProcessorType();
+    record->floatFormat = c3d_f->Header().ScaleFactor() < 0;
+
+    //Lists are stored one entry per line
+    auto Append = [](std::string* text, std::string_view entry) {
+        if(entry.empty())
+            return ;
+        if(!text->empty())
+            text->push_back('\n');
+        text->append(entry.data(), entry.size());
+    };
+    Subjects subjectGroup = c3d_f->SUBJECTS();
+    for(int i = 0; i < subjectGroup.NamesSize(); i++)
+        Append(subjects, subjectGroup.Names(i));
+    Point point = c3d_f->POINT();
+    for(int i = 0; i < point.LabelsSize(); i++)
+        Append(labels, point.Labels(i));
+    Manufacturer maker = c3d_f->MANUFACTURER();
+    Append(manufacturer, maker.Company());
+    Append(manufacturer, maker.Software());
+    Append(manufacturer, maker.Version());
+
+    c3d_f->CleanUpMetadata(c3d_f);
+    delete c3d_f;
+    return true;
+}
+
+CatalogText TrialCatalog::Store(std::string_view text) {
+    CatalogText stored;
+    stored.offset = (unsigned int)pool.size();
+    stored.size = (unsigned int)text.size();
+    pool.insert(pool.end(), text.begin(), text.end());
+    return stored;
+}
+
+bool TrialCatalog::Save() {
+    PROFILE_SCOPE("TrialCatalog::Save");
+
+    std::string path = IndexPath(directory);
+    if(pool.size() > UINT_MAX || !MakeDirectory(path.substr(0, path.find_last_of('/'))))
+        return false;
+
+    TrialCatalogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRIAL_CATALOG_MAGIC, 8);
+    header.version = TRIAL_CATALOG_VERSION;
+    header.endian = 1;
+    header.recordBytes = (int)sizeof(CatalogRecord);
+    header.recordSize = (int)records.size();
+    header.directorySize = (long long)directory.size();
+    header.poolSize = (long long)pool.size();
+
+    //Write a temporary file and rename it (readers see the old index or the new one)
+    std::string temporary = path + ".tmp" + std::to_string((long long)getpid());
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(directory.data(), 1, directory.size(), file);
+    fwrite(records.data(), sizeof(CatalogRecord), records.size(), file);
+    fwrite(pool.data(), 1, pool.size(), file);
+
+    bool result = !ferror(file);
+    result = fclose(file) == 0 && result;
+    if(!result || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void TrialCatalog::Fold() {
+    folded.resize(pool.size());
+    for(size_t i = 0; i < pool.size(); i++)
+        folded[i] = (char)tolower((unsigned char)pool[i]);
+}
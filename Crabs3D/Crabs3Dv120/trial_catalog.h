@@ -0,0 +1,120 @@
+#ifndef TRIAL_CATALOG_H
+#define TRIAL_CATALOG_H
+
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "read_c3d.h"
+
+//Layout version (an index of another version is rebuilt)
+#define TRIAL_CATALOG_VERSION 3
+
+//Threads reading metadata (at least: the reads wait on the disk more than on the CPU)
+#define TRIAL_CATALOG_THREADS 8
+
+//A string of the pool of the catalog
+struct CatalogText {
+    unsigned int offset;
+    unsigned int size;
+};
+
+//A trial of the catalog (a fixed-size record, the strings are in the pool)
+struct CatalogRecord {
+    long long modified; //Modification time of the file (seconds)
+    long long fileSize;
+
+    CatalogText path;
+    CatalogText subjects; //SUBJECTS:NAMES, one per line
+    CatalogText labels; //POINT:LABELS, one per line
+    CatalogText manufacturer; //MANUFACTURER:COMPANY, SOFTWARE and VERSION, one per line
+
+    float pointRate;
+    float analogRate;
+    long long firstFrame;
+    int frameSize; //32-bit (TRIAL fields of long trials)
+    int pointSize;
+    int analogChannels;
+    int processor; //PROCESSOR_INTEL, PROCESSOR_DEC or PROCESSOR_MIPS
+    int floatFormat; //1 for float data, 0 for int16
+    int failed; //1 if the file isn't a C3D file: it is kept (and left out of the filters) so it isn't read again until it changes
+};
+
+/* A query: every condition must hold (empty strings and 0 limits match everything).
+ * Strings are compared case-insensitively as substrings.
+ */
+struct CatalogFilter {
+    std::vector<std::string> words; //Every word in the path, the subjects, the labels or the manufacturer
+    std::string subject;
+    std::string label;
+    std::string manufacturer;
+    float minRate;
+    float maxRate;
+    int minFrames;
+    int maxFrames;
+};
+
+//What an update did
+struct CatalogUpdate {
+    int files; //C3D files found
+    int reused; //Unchanged since the last update (same modification time and size), failed files included
+    int read; //Metadata read again
+    int failed; //Read again but not C3D files (or not readable)
+};
+
+/* Metadata of the C3D files of a directory tree, to find trials without opening them one by one.
+ * Only the header and the parameter section of a file are read (Read_C3D::ImportMetadata: header block, SUBJECTS,
+ * POINT, ANALOG, MANUFACTURER ...), by TRIAL_CATALOG_THREADS threads or more. The index on disk is a header, the
+ * records and one string pool, so loading it is three reads. An update only reads the files whose modification
+ * time or size changed (files that aren't C3D files are recorded as failed, so they aren't read every update). Index: <TrialCache::DefaultDirectory()>/<hash of the directory>.c3dcatalog.
+ */
+class TrialCatalog
+{
+public:
+    TrialCatalog() {}
+
+    //Scan a directory (and its subdirectories) and write the index (result: what was read, may be NULL)
+    bool Update(const std::string directory, CatalogUpdate* result = NULL);
+
+    //Load the index of a directory written by an earlier Update (false if there is none)
+    bool Load(const std::string directory);
+
+    //Directory of the catalog and path of its index
+    std::string GetDirectory() {return directory;}
+    static std::string IndexPath(const std::string directory);
+
+    //Files of the catalog (sorted by path), the ones that failed to read included
+    int Size() {return (int)records.size();}
+    int FailedSize();
+    const CatalogRecord& Record(const int index) {return records[index];}
+    std::string_view Text(const CatalogText text) {return std::string_view(pool.data() + text.offset, text.size);}
+    std::string Path(const int index) {return std::string(Text(records[index].path));}
+
+    //Indices of the trials matching a filter
+    std::vector<int> Filter(const CatalogFilter filter);
+
+    /* Filter of a query: subject:<text> label:<text> maker:<text> rate>=<Hz> rate<=<Hz> frames>=<n> frames<=<n>
+     * (> and < are accepted too), any other word must be found in one of the strings of the trial
+     */
+    static CatalogFilter ParseFilter(const std::string query);
+
+private:
+    std::string directory;
+    std::vector<CatalogRecord> records;
+    std::vector<char> pool;
+    std::vector<char> folded; //Lower case copy of the pool (filters)
+
+    //Read the metadata of a file (false if it isn't a C3D file)
+    static bool ReadTrial(const std::string path, CatalogRecord* record, std::string* subjects, std::string* labels, std::string* manufacturer);
+
+    //Append a string to the pool
+    CatalogText Store(std::string_view text);
+
+    //Write the index (temporary file renamed over the old index)
+    bool Save();
+
+    //Fill the lower case copy of the pool
+    void Fold();
+};
+
+#endif // TRIAL_CATALOG_H
@@ -0,0 +1,407 @@
+#include "write_c3d.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+
+/**********/
+/* Public */
+/**********/
+
+bool Write_C3D::Export(std::string fileName, Read_C3D* c3d_f, const bool floatFormat, const int processor, const float scale) {
+    if(c3d_f == NULL || !c3d_f->IsOpen())
+        return false;
+
+    const unsigned one = 1U;
+    bool littleSystem = *(const char*)&one == 1;
+    bool littleFile = processor != PROCESSOR_MIPS;
+    endianFlag = littleSystem == littleFile ? SAME_ENDIAN : DIFF_ENDIAN;
+
+    //POINT:SCALE (negative for float data)
+    float pointScale = fabs(scale);
+    if(pointScale == 0 && c3d_f->Header().ScaleFactor() > 0)
+        pointScale = c3d_f->Header().ScaleFactor();
+    else if(pointScale == 0) {
+        //Float trial written as int16: 0.1 or the scale that keeps every coordinate in range
+        pointScale = 0.1;
+        Data_c3d data = c3d_f->Data();
+        int frameSize = c3d_f->FrameSize();
+        for(int i = 0; i < frameSize; i++)
+            for(int j = 0; j < c3d_f->Header().NumberOfPoints(); j++) {
+                Points_C3D point = data.Frame(i).Point(j);
+                float range = fmax(fabs(point.X()), fmax(fabs(point.Y()), fabs(point.Z()))) / 32767.0;
+                if(range > pointScale)
+                    pointScale = range;
+            }
+    }
+    if(floatFormat)
+        pointScale = c3d_f->Header().ScaleFactor() < 0 ? c3d_f->Header().ScaleFactor() : -pointScale;
+
+    //Parameters are encoded first (the data start depends on their size)
+    buffer.clear();
+    buffer.reserve(C3D_WRITE_BUFFER + 4096);
+    int blocks = PutParameters(c3d_f->Parameter(), processor == PROCESSOR_MIPS ? PROCESSOR_MIPS : PROCESSOR_INTEL, pointScale);
+    if(blocks < 0)
+        return false;
+    std::vector<char> parameters;
+    parameters.swap(buffer);
+
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    PutHeader(c3d_f->Header(), c3d_f->Data(), 2 + blocks, pointScale);
+    bool state = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    state = state && fwrite(parameters.data(), 1, parameters.size(), file) == parameters.size();
+
+    state = state && WriteData(file, c3d_f, floatFormat, pointScale);
+
+    fclose(file);
+    return state;
+}
+
+bool Write_C3D::RoundTrip(std::string fileName, Read_C3D* c3d_f, const bool floatFormat, const int processor) {
+    if(!Export(fileName, c3d_f, floatFormat, processor))
+        return false;
+
+    Read_C3D* copy = new Read_C3D;
+    copy->Import(fileName, NULL, copy);
+
+    Header_c3d h1 = c3d_f->Header();
+    Header_c3d h2 = copy->Header();
+    bool state = copy->IsOpen() && h1.NumberOfPoints() == h2.NumberOfPoints()
+              && h1.FirstFrame() == h2.FirstFrame() && h1.LastFrame() == h2.LastFrame()
+              && c3d_f->FirstFrame() == copy->FirstFrame() && c3d_f->FrameSize() == copy->FrameSize()
+              && h1.FrameRate() == h2.FrameRate() && h1.EventTime() == h2.EventTime();
+    for(int i = 0; state && i < h1.EventTime() && i < h1.eventTime_size; i++)
+        state = h1.EventTimeSec(i) == h2.EventTimeSec(i);
+
+    //Parameters (POINT:DATA_START and POINT:SCALE are rewritten)
+    Parameter_c3d* p1 = c3d_f->Parameter();
+    Parameter_c3d* p2 = copy->Parameter();
+    for(int g = 0; state && g < p1->GroupSize(); g++) {
+        Parameter_Group_C3D group = p1->Group(g);
+        for(int p = 0; state && p < group.ParameterSize(); p++) {
+            Parameter_Parameter_C3D* a = group.ParameterPointer(p);
+            if(group.Name() == "POINT" && (a->Name() == "DATA_START" || a->Name() == "SCALE"))
+                continue;
+
+            Parameter_Parameter_C3D* b = p2->Find(group.Name(), a->Name());
+            state = b != NULL && a->Format() == b->Format() && a->DimensionsSize() == b->DimensionsSize() && a->DataSize() == b->DataSize();
+            for(int d = 0; state && d < a->DimensionsSize(); d++)
+                state = a->Dimension(d) == b->Dimension(d);
+            for(int i = 0; state && i < a->DataSize(); i++) {
+                switch(a->Format()) {
+                    case FORMAT_CHAR: state = a->ParameterCharData()[i] == b->ParameterCharData()[i]; break;
+                    case FORMAT_BYTE: state = a->ParameterByte(i) == b->ParameterByte(i); break;
+                    case FORMAT_INT_16: state = a->ParameterInt16(i) == b->ParameterInt16(i); break;
+                    case FORMAT_FLOAT: state = a->ParameterFloat(i) == b->ParameterFloat(i); break;
+                }
+            }
+        }
+    }
+
+    //Points (bit-exact if the format doesn't change, else within half a scale step)
+    Data_c3d d1 = c3d_f->Data();
+    Data_c3d d2 = copy->Data();
+    bool sameFormat = floatFormat == (h1.ScaleFactor() < 0) && fabs(h1.ScaleFactor()) == fabs(h2.ScaleFactor());
+    float tolerance = sameFormat ? 0.0 : fabs(h2.ScaleFactor())*0.51;
+    int frameSize = c3d_f->FrameSize();
+    for(int i = 0; state && i < frameSize; i++) {
+        for(int j = 0; state && j < h1.NumberOfPoints(); j++) {
+            Points_C3D a = d1.Frame(i).Point(j);
+            Points_C3D b = d2.Frame(i).Point(j);
+            if(!a.IsValid())
+                state = !b.IsValid();
+            else
+                state = fabs(a.X() - b.X()) <= tolerance && fabs(a.Y() - b.Y()) <= tolerance && fabs(a.Z() - b.Z()) <= tolerance
+                        && a.Camera() == b.Camera();
+        }
+    }
+
+    //Analog (bit-exact unless float samples are written as integers)
+    Analog analog = c3d_f->ANALOG();
+    state = state && d1.AnalogChannelSize() == d2.AnalogChannelSize() && d1.AnalogSampleSize() == d2.AnalogSampleSize();
+    bool analogExact = floatFormat || h1.ScaleFactor() > 0;
+    for(int c = 0; state && c < d1.AnalogChannelSize(); c++) {
+        float step = analogExact ? 0.0 : fabs(analog.Scale(c)*analog.GenScale())*0.51;
+        const float* a = d1.AnalogChannel(c);
+        const float* b = d2.AnalogChannel(c);
+        for(int s = 0; state && s < d1.AnalogSampleSize(); s++)
+            state = fabs(a[s] - b[s]) <= step;
+    }
+
+    copy->CleanUp(copy);
+    delete copy;
+
+    return state;
+}
+
+/***********/
+/* Private */
+/***********/
+
+template <typename T>
+void Write_C3D::Put(const T value) {
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+
+    if(endianFlag == DIFF_ENDIAN)
+        for(int i = (int)sizeof(T) - 1; i >= 0; i--)
+            buffer.push_back(bytes[i]);
+    else
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void Write_C3D::PutBytes(const char* data, const int size) {
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+int Write_C3D::PutParameters(Parameter_c3d* parameter, const int processor, const float scale) {
+    //Parameter header: first block, key (80), number of blocks (patched), processor type
+    buffer.push_back(1);
+    buffer.push_back(80);
+    buffer.push_back(0);
+    buffer.push_back((char)processor);
+
+    long lastNext = -1;
+    long dataStart = -1;
+    long scaleStart = -1;
+    bool fits = true;
+
+    for(int g = 0; g < parameter->GroupSize(); g++) {
+        Parameter_Group_C3D group = parameter->Group(g);
+        std::string name = group.Name();
+        std::string description = group.Description();
+
+        buffer.push_back((char)(group.IsLocked() ? -(int)name.size() : (int)name.size()));
+        buffer.push_back((char)group.ID());
+        PutBytes(name.c_str(), (int)name.size());
+        lastNext = (long)buffer.size();
+        long next = 2 + 1 + (long)description.size();
+        fits = fits && next <= C3D_MAX_RECORD_NEXT;
+        Put<short int>((short int)next);
+        buffer.push_back((char)description.size());
+        PutBytes(description.c_str(), (int)description.size());
+
+        for(int p = 0; p < group.ParameterSize(); p++) {
+            Parameter_Parameter_C3D* par = group.ParameterPointer(p);
+            std::string parName = par->Name();
+            std::string parDescription = par->Description();
+            int elementSize = par->Format() == FORMAT_CHAR ? SIZE_8_BIT : par->Format();
+            int dataSize = par->DataSize();
+
+            buffer.push_back((char)(par->IsLocked() ? -(int)parName.size() : (int)parName.size()));
+            buffer.push_back((char)par->ID());
+            PutBytes(parName.c_str(), (int)parName.size());
+            lastNext = (long)buffer.size();
+            long next = 2 + 2 + par->DimensionsSize() + (long)dataSize*elementSize + 1 + (long)parDescription.size();
+            fits = fits && next <= C3D_MAX_RECORD_NEXT;
+            Put<short int>((short int)next);
+
+            buffer.push_back((char)par->Format());
+            buffer.push_back((char)par->DimensionsSize());
+            for(int d = 0; d < par->DimensionsSize(); d++) {
+                fits = fits && par->Dimension(d) <= 255; //one unsigned byte
+                buffer.push_back((char)par->Dimension(d));
+            }
+
+            if(name == "POINT" && parName == "DATA_START" && par->Format() == FORMAT_INT_16)
+                dataStart = (long)buffer.size();
+            if(name == "POINT" && parName == "SCALE" && par->Format() == FORMAT_FLOAT)
+                scaleStart = (long)buffer.size();
+
+            switch(par->Format()) {
+                case FORMAT_CHAR: {
+                    PutBytes(par->ParameterCharData(), dataSize);
+                    break;
+                } case FORMAT_BYTE: {
+                    for(int i = 0; i < dataSize; i++)
+                        buffer.push_back((char)par->ParameterByte(i));
+                    break;
+                } case FORMAT_INT_16: {
+                    for(int i = 0; i < dataSize; i++)
+                        Put<short int>(par->ParameterInt16(i));
+                    break;
+                } case FORMAT_FLOAT: {
+                    for(int i = 0; i < dataSize; i++)
+                        Put<float>(par->ParameterFloat(i));
+                    break;
+                }
+            }
+
+            buffer.push_back((char)parDescription.size());
+            PutBytes(parDescription.c_str(), (int)parDescription.size());
+        }
+    }
+
+    //The last record points to 0
+    if(lastNext >= 0)
+        buffer[lastNext] = buffer[lastNext+1] = 0;
+
+    //Whole blocks
+    buffer.resize((buffer.size() + 511) / 512 * 512, 0);
+    int blocks = (int)(buffer.size() / 512);
+    if(!fits || blocks > C3D_MAX_PARAMETER_BLOCKS)
+        return -1;
+    buffer[2] = (char)blocks;
+
+    //POINT:DATA_START and POINT:SCALE of the new file
+    std::vector<char> patch;
+    patch.swap(buffer);
+    if(dataStart >= 0) {
+        Put<short int>((short int)(2 + blocks));
+        memcpy(&patch[dataStart], buffer.data(), SIZE_16_BIT);
+        buffer.clear();
+    }
+    if(scaleStart >= 0) {
+        Put<float>(scale);
+        memcpy(&patch[scaleStart], buffer.data(), SIZE_32_BIT);
+        buffer.clear();
+    }
+    patch.swap(buffer);
+
+    return blocks;
+}
+
+void Write_C3D::PutHeader(Header_c3d header, Data_c3d data, const int dataStart, const float scale) {
+    int analogPerFrame = data.AnalogChannelSize() > 0 ? data.AnalogPerFrame() : header.AnalogPerFrame();
+
+    buffer.clear();
+    buffer.push_back(2);  //First block of the parameter section
+    buffer.push_back(80); //Key
+    Put<short int>(header.NumberOfPoints());
+    Put<short int>((short int)(data.AnalogChannelSize()*data.AnalogPerFrame()));
+    Put<short int>(header.FirstFrame());
+    Put<short int>(header.LastFrame());
+    Put<short int>(header.MaxGap());
+    Put<float>(scale);
+    Put<short int>((short int)dataStart);
+    Put<short int>((short int)analogPerFrame);
+    Put<float>(header.FrameRate());
+
+    for(int i = 0; i < header.futureBlock_1_size; i++)
+        Put<short int>(header.FutureBlock_1(i));
+
+    //No label range section is written
+    Put<short int>(0);
+    Put<short int>(0);
+    Put<short int>(header.KeyValue_2());
+    Put<short int>(header.EventTime());
+    Put<short int>(header.FutureBlock_2());
+
+    for(int i = 0; i < header.eventTime_size; i++)
+        Put<float>(header.EventTimeSec(i));
+    for(int i = 0; i < header.displayFlag_size; i++)
+        Put<short int>(header.EventDisplayFlags(i));
+    Put<short int>(header.FutureBlock_3());
+    for(int i = 0; i < header.eventLabel_size; i++)
+        PutBytes(header.EventLabel(i), 4);
+    for(int i = 0; i < header.futureBlock_4_size; i++)
+        Put<short int>(header.FutureBlock_4(i));
+}
+
+bool Write_C3D::WriteData(FILE* file, Read_C3D* c3d_f, const bool floatFormat, const float scale) {
+    Header_c3d header = c3d_f->Header();
+    Data_c3d data = c3d_f->Data();
+    Analog analog = c3d_f->ANALOG();
+
+    int frameSize = c3d_f->FrameSize();
+    int pointSize = header.NumberOfPoints();
+    int channels = data.AnalogChannelSize();
+    int analogPerFrame = data.AnalogPerFrame();
+    float step = fabs(scale);
+    bool analogUnsigned = analog.IsUnsigned();
+
+    //Calibration of every channel (the same expressions as Data_c3d::CalibrateAnalog)
+    std::vector<float> offset(channels);
+    std::vector<float> gain(channels);
+    for(int c = 0; c < channels; c++) {
+        offset[c] = analog.OffsetValue(c);
+        gain[c] = analog.Scale(c) * analog.GenScale();
+    }
+
+    buffer.clear();
+    size_t written = 0;
+    bool state = true;
+
+    for(int i = 0; i < frameSize && state; i++) {
+        Frames_C3D frame = data.Frame(i);
+        for(int j = 0; j < pointSize; j++) {
+            Points_C3D point = frame.Point(j);
+            int camera = (int)point.Camera() & 0xFF;
+            int residual = (int)floor(point.Residual()/step + 0.5);
+            if(residual < 0) residual = 0;
+            if(residual > 255) residual = 255;
+
+            if(!point.IsValid()) {
+                //Invalid sample: word 4 is -1
+                if(floatFormat) {
+                    Put<float>(point.X());
+                    Put<float>(point.Y());
+                    Put<float>(point.Z());
+                    Put<float>(-1.0);
+                } else {
+                    for(int k = 0; k < 3; k++)
+                        Put<short int>(0);
+                    Put<short int>(-1);
+                }
+            } else if(floatFormat) {
+                Put<float>(point.X());
+                Put<float>(point.Y());
+                Put<float>(point.Z());
+                Put<float>((float)(short int)(camera | (residual << 8)));
+            } else {
+                float xyz[3] = {point.X(), point.Y(), point.Z()};
+                for(int k = 0; k < 3; k++) {
+                    float value = floor(xyz[k]/scale + 0.5);
+                    if(value > 32767) value = 32767;
+                    if(value < -32768) value = -32768;
+                    Put<short int>((short int)value);
+                }
+                buffer.push_back((char)camera);
+                buffer.push_back((char)residual);
+            }
+        }
+
+        for(int s = 0; s < analogPerFrame; s++) {
+            int sample = i*analogPerFrame + s;
+            for(int c = 0; c < channels; c++) {
+                float value = data.AnalogSample(c, sample);
+                float raw = gain[c] != 0 ? value/gain[c] + offset[c] : offset[c];
+
+                if(floatFormat) {
+                    //Move raw by an ulp until it calibrates back to the same value
+                    for(int k = 0; k < 4 && gain[c] != 0 && (raw - offset[c]) * gain[c] != value; k++)
+                        raw = nextafterf(raw, ((raw - offset[c]) * gain[c] < value) == (gain[c] > 0) ? HUGE_VALF : -HUGE_VALF);
+                    Put<float>(raw);
+                } else {
+                    raw = floor(raw + 0.5);
+                    if(analogUnsigned) {
+                        if(raw < 0) raw = 0;
+                        if(raw > 65535) raw = 65535;
+                        Put<unsigned short int>((unsigned short int)raw);
+                    } else {
+                        if(raw < -32768) raw = -32768;
+                        if(raw > 32767) raw = 32767;
+                        Put<short int>((short int)raw);
+                    }
+                }
+            }
+        }
+
+        //Large sequential writes
+        if(buffer.size() >= C3D_WRITE_BUFFER) {
+            state = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    //Last write padded to a whole block
+    written += buffer.size();
+    buffer.resize(buffer.size() + (512 - written % 512) % 512, 0);
+    state = state && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+
+    return state;
+}
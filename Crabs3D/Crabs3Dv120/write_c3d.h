@@ -0,0 +1,53 @@
+#ifndef WRITE_C3D_H
+#define WRITE_C3D_H
+
+#include <vector>
+#include "read_c3d.h"
+
+//Bytes encoded before every fwrite of the data section
+#define C3D_WRITE_BUFFER (1 << 20)
+
+//Limits of the parameter section: its size is one byte of blocks, the next pointer of a record is a signed 16-bit word
+#define C3D_MAX_PARAMETER_BLOCKS 255
+#define C3D_MAX_RECORD_NEXT 32767
+
+/* Write a trial (header, parameters and 3D/Analog data) to a C3D file.
+ * The data is written as float or as scaled 16-bit integers, little-endian (Intel)
+ * or big-endian (MIPS). Analog samples are converted back to raw ADC values.
+ */
+class Write_C3D
+{
+public:
+    /* Write c3d_f to fileName.
+     * floatFormat: float (true) or scaled int16 (false) data
+     * processor: PROCESSOR_INTEL or PROCESSOR_MIPS
+     * scale: POINT:SCALE of int16 data (0 keeps the scale of the trial, or 0.1 for float trials)
+     * Fails (and writes nothing) if the parameters don't fit the limits of the parameter section.
+     */
+    bool Export(std::string fileName, Read_C3D* c3d_f, const bool floatFormat, const int processor, const float scale = 0.0);
+
+    /* Write c3d_f, import the file again and compare the header, every parameter and every value.
+     * Values must be bit-exact when the data format doesn't change (float to int16 is compared to the scale).
+     */
+    bool RoundTrip(std::string fileName, Read_C3D* c3d_f, const bool floatFormat, const int processor);
+
+private:
+    std::vector<char> buffer;
+    int endianFlag;
+
+    //Append words in the file byte order
+    template <typename T> void Put(const T value);
+    void PutBytes(const char* data, const int size);
+
+    //Encode the parameter section with the new POINT:DATA_START and POINT:SCALE
+    //(returns the number of 512 byte blocks, -1 if a record or the section is too long)
+    int PutParameters(Parameter_c3d* parameter, const int processor, const float scale);
+
+    //Encode the header block
+    void PutHeader(Header_c3d header, Data_c3d data, const int dataStart, const float scale);
+
+    //Encode and write the data section
+    bool WriteData(FILE* file, Read_C3D* c3d_f, const bool floatFormat, const float scale);
+};
+
+#endif // WRITE_C3D_H